@@ -470,6 +470,10 @@ static void main_task(void* args)
     }
 #endif
 
+#if CONFIG_LOG_DEFERRED
+    ESP_ERROR_CHECK(esp_log_deferred_init());
+#endif
+
     //Initialize task wdt if configured to do so
 #ifdef CONFIG_TASK_WDT_PANIC
     ESP_ERROR_CHECK(esp_task_wdt_init(CONFIG_TASK_WDT_TIMEOUT_S, true));
@@ -39,6 +39,7 @@ extern "C" {
         .lru_purge_enable   = false,                    \
         .recv_wait_timeout  = 5,                        \
         .send_wait_timeout  = 5,                        \
+        .worker_tasks       = 0,                        \
 };
 
 #define ESP_ERR_HTTPD_BASE              (0x8000)                    /*!< Starting number of HTTPD error codes */
@@ -99,6 +100,15 @@ typedef struct httpd_config {
     bool        lru_purge_enable;   /*!< Purge "Least Recently Used" connection */
     uint16_t    recv_wait_timeout;  /*!< Timeout for recv function (in seconds)*/
     uint16_t    send_wait_timeout;  /*!< Timeout for send function (in seconds)*/
+
+    /**
+     * Number of worker tasks running URI handlers, with the same stack size
+     * and priority as the server task. The server task then only accepts
+     * connections and parses requests, so that a slow handler doesn't delay
+     * the requests of other clients. Requests of a same connection are still
+     * handled one after the other. If 0, URI handlers run in the server task.
+     */
+    uint16_t    worker_tasks;
 } httpd_config_t;
 
 /**
@@ -260,6 +270,25 @@ typedef struct httpd_uri {
  * @note    URI handlers can be registered in real time as long as the
  *          server handle is valid.
  *
+ * The URI is matched against the path of a request one segment (separated by
+ * '/') at a time, so the time taken to find the handler of a request doesn't
+ * grow with the number of registered handlers. Besides literal segments, URIs
+ * may contain :
+ *  - "{name}" segments, which match any non-empty segment of the request path.
+ *    The value of the segment is retrieved with httpd_req_get_uri_param().
+ *  - "*" as the last segment, which matches the rest of the request path,
+ *    including an empty one. E.g. "/files/\*" matches "/files", "/files/" and
+ *    "/files/a/b.txt".
+ *
+ * If a request path is matched by several URIs, literal segments are preferred
+ * over "{name}" segments, which are preferred over "*". The handler is then
+ * selected according to the request method, a request for a URI registered
+ * only with other methods is responded with 405 Method Not Allowed.
+ *
+ * URIs which only differ in the names of their "{name}" segments, such as
+ * "/users/{id}" and "/users/{name}", are the same URI: only one handler per
+ * method can be registered for them, and it can be unregistered with either.
+ *
  * Example usage:
  * @code{c}
  *
@@ -312,6 +341,9 @@ esp_err_t httpd_register_uri_handler(httpd_handle_t handle,
 /**
  * @brief   Unregister a URI handler
  *
+ * The names of the "{name}" segments of the URI don't need to be the
+ * ones the handler was registered with.
+ *
  * @param[in] handle    handle to HTTPD server instance
  * @param[in] uri       URI string
  * @param[in] method    HTTP method
@@ -327,6 +359,9 @@ esp_err_t httpd_unregister_uri_handler(httpd_handle_t handle,
 /**
  * @brief   Unregister all URI handlers with the specified uri string
  *
+ * As for httpd_unregister_uri_handler(), the names of the "{name}"
+ * segments of the URI don't matter.
+ *
  * @param[in] handle   handle to HTTPD server instance
  * @param[in] uri      uri string specifying all handlers that need
  *                     to be deregisterd
@@ -603,6 +638,34 @@ esp_err_t httpd_req_get_url_query_str(httpd_req_t *r, char *buf, size_t buf_len)
  */
 esp_err_t httpd_query_key_value(const char *qry, const char *key, char *val, size_t val_size);
 
+/**
+ * @brief   Get the value of a "{name}" segment of the URI with which the
+ *          handler of the request was registered
+ *
+ * E.g. for a handler registered with URI "/users/{id}/posts", the parameter
+ * "id" of a request for "/users/42/posts" is "42".
+ *
+ * @note
+ *  - This API is supposed to be called only from the context of
+ *    a URI handler where httpd_req_t* request pointer is valid.
+ *  - The value is not URLdecoded.
+ *  - If actual value size is greater than val_size, then the value is truncated,
+ *    accompanied by truncation error as return value.
+ *
+ * @param[in]  r         The request being responded to
+ * @param[in]  name      Name of the parameter, without the braces
+ * @param[out] val       Pointer to the buffer into which the value will be copied if the parameter is found
+ * @param[in]  val_size  Size of the user buffer "val"
+ *
+ * @return
+ *  - ESP_OK : Parameter is found in the URI and its value copied to buffer
+ *  - ESP_ERR_NOT_FOUND          : Parameter not found
+ *  - ESP_ERR_INVALID_ARG        : Null arguments
+ *  - ESP_ERR_HTTPD_INVALID_REQ  : Invalid HTTP request pointer
+ *  - ESP_ERR_HTTPD_RESULT_TRUNC : Value string truncated
+ */
+esp_err_t httpd_req_get_uri_param(httpd_req_t *r, const char *name, char *val, size_t val_size);
+
 /**
  * @brief   API to send a complete HTTP response.
  *
@@ -989,6 +1052,98 @@ esp_err_t httpd_queue_work(httpd_handle_t handle, httpd_work_fn_t work, void *ar
  * @}
  */
 
+/* ************** Group: Static Files ************** */
+/** @name Static Files
+ * APIs related to serving files from a filesystem
+ * @{
+ */
+
+#define HTTPD_STATIC_DEFAULT_CONFIG() {             \
+        .uri_prefix         = "/",                  \
+        .base_path          = NULL,                 \
+        .index_file         = "index.html",         \
+        .cache_control      = "no-cache",           \
+        .read_buf_size      = 4096,                 \
+};
+
+/**
+ * @brief   Static file handler configuration
+ *
+ * @note    Use HTTPD_STATIC_DEFAULT_CONFIG() to initialize the configuration
+ *          and then set base_path, and modify the other fields if needed.
+ */
+typedef struct httpd_static_config {
+    const char *uri_prefix;     /*!< URI under which the files are served, e.g. "/" or "/static" */
+    const char *base_path;      /*!< Path of the directory to serve in the VFS, e.g. "/spiffs" */
+    const char *index_file;     /*!< File served for URIs ending with '/', NULL if none */
+
+    /**
+     * Value of the Cache-Control header of responses, NULL if none. With the
+     * default "no-cache", clients revalidate their cached copy of a file on
+     * each use, which costs a 304 Not Modified response as long as the file
+     * is unchanged.
+     */
+    const char *cache_control;
+
+    size_t      read_buf_size;  /*!< Size of the buffer file data is read into and sent from */
+} httpd_static_config_t;
+
+/**
+ * @brief   Registers a handler serving the files of a directory for GET requests
+ *
+ * The file served for a URI is the one with the same path relative to
+ * base_path as the URI relative to uri_prefix. E.g. with uri_prefix "/static"
+ * and base_path "/spiffs", GET /static/css/app.css is responded with file
+ * /spiffs/css/app.css.
+ *
+ * The files are indexed when the handler is registered, which includes
+ * computing an ETag from the content of each file. Responses carry the ETag,
+ * and requests with a matching If-None-Match header are responded with
+ * 304 Not Modified. Files added or modified afterwards are only served as
+ * such once the handler is registered again.
+ *
+ * If a file has a sibling with extension ".gz" (e.g. app.js and app.js.gz),
+ * the latter is sent with header "Content-Encoding: gzip" to clients which
+ * accept gzip encoding. The uncompressed file may also be omitted, in which
+ * case only such clients are served.
+ *
+ * File data is read from the VFS into a buffer of read_buf_size bytes and
+ * sent from there, small files are sent along with the response headers.
+ *
+ * @note    The handler is registered with URI "<uri_prefix>/\*", so handlers
+ *          registered with more specific URIs under uri_prefix take precedence.
+ *          The segments of a URI are matched against file paths verbatim, i.e.
+ *          without URL decoding.
+ *
+ * @param[in] handle    Handle to HTTPD server instance
+ * @param[in] config    Configuration of the handler
+ *
+ * @return
+ *  - ESP_OK : On successfully registering the handler
+ *  - ESP_ERR_INVALID_ARG : Null arguments, or no base_path
+ *  - ESP_ERR_NOT_FOUND   : base_path couldn't be opened as a directory
+ *  - ESP_ERR_HTTPD_ALLOC_MEM : Failed to allocate memory for the file index
+ *  - Errors of httpd_register_uri_handler()
+ */
+esp_err_t httpd_register_static_handler(httpd_handle_t handle, const httpd_static_config_t *config);
+
+/**
+ * @brief   Unregisters a static file handler, and frees its file index
+ *
+ * @param[in] handle        Handle to HTTPD server instance
+ * @param[in] uri_prefix    uri_prefix with which the handler was registered
+ *
+ * @return
+ *  - ESP_OK : On successfully deregistering the handler
+ *  - ESP_ERR_INVALID_ARG : Null arguments
+ *  - ESP_ERR_NOT_FOUND   : No handler registered with this prefix
+ */
+esp_err_t httpd_unregister_static_handler(httpd_handle_t handle, const char *uri_prefix);
+
+/** End of Group Static Files
+ * @}
+ */
+
 #ifdef __cplusplus
 }
 #endif
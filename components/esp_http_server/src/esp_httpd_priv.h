@@ -125,6 +125,8 @@ struct sock_db {
     int64_t timestamp;                      /*!< Timestamp indicating when the socket was last used */
     char pending_data[PARSER_BLOCK_SIZE];   /*!< Buffer for pending data to be received */
     size_t pending_len;                     /*!< Length of pending data to be received */
+    struct httpd_worker *worker;            /*!< Worker handling a request of this socket, if any */
+    bool close_pending;                     /*!< Close the socket once the worker is done */
 };
 
 /**
@@ -145,6 +147,20 @@ struct httpd_req_aux {
         const char *value;
     } *resp_hdrs;                                   /*!< Additional headers in response packet */
     struct http_parser_url url_parse_res;           /*!< URL parsing result, used for retrieving URL elements */
+    const char     *uri_tmpl;                       /*!< URI of the handler the request was routed to */
+    esp_err_t     (*handler)(httpd_req_t *r);       /*!< Handler the request was routed to, NULL if already responded */
+};
+
+/**
+ * @brief   Task running URI handlers for requests parsed by the server task
+ */
+struct httpd_worker {
+    struct httpd_data   *hd;                /*!< Server instance data */
+    struct thread_data   td;                /*!< Information for the worker thread */
+    struct sock_db      *sd;                /*!< Socket of the request being handled, NULL if idle */
+    esp_err_t            ret;               /*!< Result of handling the request */
+    struct httpd_req     req;               /*!< The request being handled */
+    struct httpd_req_aux req_aux;           /*!< Additional data about the request */
 };
 
 /**
@@ -159,8 +175,10 @@ struct httpd_data {
     struct thread_data hd_td;               /*!< Information for the HTTPd thread */
     struct sock_db *hd_sd;                  /*!< The socket database */
     httpd_uri_t **hd_calls;                 /*!< Registered URI handlers */
+    struct httpd_uri_router *hd_router;     /*!< Lookup tree of registered URI handlers */
     struct httpd_req hd_req;                /*!< The current HTTPD request */
     struct httpd_req_aux hd_req_aux;        /*!< Additional data about the HTTPD request kept unexposed */
+    struct httpd_worker *hd_workers;        /*!< Worker tasks, if configured */
 };
 
 /******************* Group : Session Management ********************/
@@ -288,6 +306,7 @@ bool httpd_sess_pending(struct httpd_data *hd, int fd);
  *
  * @return
  *  - ESP_OK    : if session closure initiated successfully
+ *  - ESP_ERR_NOT_FOUND : if all clients have a request being handled by a worker
  *  - ESP_FAIL  : if failed
  */
 esp_err_t httpd_sess_close_lru(struct httpd_data *hd);
@@ -304,15 +323,45 @@ esp_err_t httpd_sess_close_lru(struct httpd_data *hd);
 
 /**
  * @brief   For an HTTP request, searches through all the registered URI handlers
- *          and invokes the appropriate one if found
+ *          for the appropriate one. If not found, the request is responded with
+ *          an error.
+ *
+ * @note    The handler is saved in the request, to be invoked with
+ *          httpd_uri_call_handler().
+ *
+ * @param[in] hd  Server instance data
+ * @param[in] r   The request to route
+ *
+ * @return
+ *  - ESP_OK    : if handler found, or error response sent successfully
+ *  - ESP_FAIL  : otherwise
+ */
+esp_err_t httpd_uri(struct httpd_data *hd, httpd_req_t *r);
+
+/**
+ * @brief   Invokes the URI handler found for a request by httpd_uri()
  *
- * @param[in] hd  Server instance data for which handler needs to be invoked
+ * @param[in] r   The request to handle
  *
  * @return
- *  - ESP_OK    : if handler found and executed successfully
+ *  - ESP_OK    : if handler executed successfully, or there was no handler
  *  - ESP_FAIL  : otherwise
  */
-esp_err_t httpd_uri(struct httpd_data *hd);
+esp_err_t httpd_uri_call_handler(httpd_req_t *r);
+
+/**
+ * @brief   Registers a URI handler whose user_ctx is freed with the handler
+ *
+ * @param[in] handle      Handle to HTTPD server instance
+ * @param[in] uri_handler Handler to register
+ * @param[in] free_ctx    Function called with uri_handler->user_ctx when the
+ *                        handler is unregistered, NULL if none
+ *
+ * @return  Same as httpd_register_uri_handler()
+ */
+esp_err_t httpd_register_uri_handler_with_free(httpd_handle_t handle,
+                                               const httpd_uri_t *uri_handler,
+                                               httpd_free_sess_ctx_fn_t free_ctx);
 
 /**
  * @brief   Deregister all URI handlers
@@ -349,33 +398,69 @@ bool httpd_valid_req(httpd_req_t *r);
  * Receives incoming TCP packet on a socket, then parses the packet as
  * HTTP request and fills httpd_req_t data structure with the extracted
  * URI, headers are ready to be fetched from scratch buffer and calling
- * http_recv() after this reads the body of the request.
+ * http_recv() after this reads the body of the request. The request is
+ * then routed with httpd_uri().
  *
  * @param[in] hd  Server instance data
+ * @param[in] r   Request to fill, either the one of the server or of a worker
+ * @param[in] ra  Auxiliary data of the request, from the server or the same worker
  * @param[in] sd  Pointer to socket which is needed for receiving TCP packets.
  *
  * @return
  *  - ESP_OK    : if request packet is valid
  *  - ESP_FAIL  : otherwise
  */
-esp_err_t httpd_req_new(struct httpd_data *hd, struct sock_db *sd);
+esp_err_t httpd_req_new(struct httpd_data *hd, httpd_req_t *r, struct httpd_req_aux *ra, struct sock_db *sd);
 
 /**
  * @brief   For an HTTP request, resets the resources allocated for it and
  *          purges any data left to be received
  *
- * @param[in] hd  Server instance data
+ * @param[in] r   The request to delete
  *
  * @return
  *  - ESP_OK    : if request packet deleted and resources cleaned.
  *  - ESP_FAIL  : otherwise.
  */
-esp_err_t httpd_req_delete(struct httpd_data *hd);
+esp_err_t httpd_req_delete(httpd_req_t *r);
 
 /** End of Group : Parsing
  * @}
  */
 
+/****************** Group : Workers ********************/
+/** @name Workers
+ * Methods for running URI handlers in worker tasks
+ * @{
+ */
+
+/**
+ * @brief   Returns a worker not handling any request
+ *
+ * @param[in] hd  Server instance data
+ *
+ * @return
+ *  - Idle worker
+ *  - NULL : if all workers are busy, or none is configured
+ */
+struct httpd_worker *httpd_worker_get_idle(struct httpd_data *hd);
+
+/**
+ * @brief   Hands over a request parsed in the worker's request structure
+ *          to the worker task
+ *
+ * The socket isn't processed by the server task until the worker is done,
+ * at which point the socket is closed if handling the request failed.
+ *
+ * @param[in] worker  Idle worker
+ * @param[in] sd      Socket of the request
+ */
+void httpd_worker_run(struct httpd_worker *worker, struct sock_db *sd);
+
+/** End of Group : Workers
+ * @}
+ */
+
 /****************** Group : Send/Receive ********************/
 /** @name Send and Receive
  * Methods for transmitting and receiving HTTP requests and responses
@@ -407,6 +492,34 @@ esp_err_t httpd_resp_send_err(httpd_req_t *req, httpd_err_resp_t error);
  */
 int httpd_send(httpd_req_t *req, const char *buf, size_t buf_len);
 
+/**
+ * @brief   For sending out data in response to an HTTP request, retrying
+ *          until all of it is sent.
+ *
+ * @param[in] req     Pointer to the HTTP request for which the resonse needs to be sent
+ * @param[in] buf     Pointer to the buffer from where the body of the response is taken
+ * @param[in] buf_len Length of the buffer
+ *
+ * @return
+ *  - ESP_OK    : if successful
+ *  - ESP_FAIL  : if failed
+ */
+esp_err_t httpd_send_all(httpd_req_t *req, const char *buf, size_t buf_len);
+
+/**
+ * @brief   For sending out the status line and headers of a response, the body
+ *          of which is then sent with httpd_send_all().
+ *
+ * @param[in] req         Pointer to the HTTP request for which the resonse needs to be sent
+ * @param[in] content_len Length of the body of the response
+ *
+ * @return
+ *  - ESP_OK : if successful
+ *  - ESP_ERR_HTTPD_RESP_HDR  : Essential headers are too large for internal buffer
+ *  - ESP_ERR_HTTPD_RESP_SEND : Error in raw send
+ */
+esp_err_t httpd_resp_send_hdrs(httpd_req_t *req, size_t content_len);
+
 /**
  * @brief   For receiving HTTP request data
  *
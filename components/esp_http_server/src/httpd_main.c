@@ -32,13 +32,18 @@ static esp_err_t httpd_accept_conn(struct httpd_data *hd, int listen_fd)
     if (hd->config.lru_purge_enable == true) {
         if (!httpd_is_sess_available(hd)) {
             /* Queue asynchronous closure of the least recently used session */
-            return httpd_sess_close_lru(hd);
+            esp_err_t ret = httpd_sess_close_lru(hd);
             /* Returning from this allowes the main server thread to process
              * the queued asynchronous control message for closing LRU session.
              * Since connection request hasn't been addressed yet using accept()
              * therefore httpd_accept_conn() will be called again, but this time
              * with space available for one session
              */
+            if (ret != ESP_ERR_NOT_FOUND) {
+                return ret;
+            }
+            /* Else all sessions are busy with workers,
+             * and the connection is refused below */
        }
     }
 
@@ -141,6 +146,107 @@ static void httpd_process_ctrl_msg(struct httpd_data *hd)
     }
 }
 
+struct httpd_worker *httpd_worker_get_idle(struct httpd_data *hd)
+{
+    for (int i = 0; i < hd->config.worker_tasks; i++) {
+        if (hd->hd_workers[i].sd == NULL) {
+            return &hd->hd_workers[i];
+        }
+    }
+    return NULL;
+}
+
+/* Executed by the server thread, once the worker has handled a request */
+static void httpd_worker_done(void *arg)
+{
+    struct httpd_worker *worker = (struct httpd_worker *) arg;
+    struct sock_db      *sd     = worker->sd;
+
+    sd->worker = NULL;
+    worker->sd = NULL;
+    if (worker->ret != ESP_OK || sd->close_pending) {
+        int fd = sd->fd;
+        ESP_LOGD(TAG, LOG_FMT("closing socket %d"), fd);
+        httpd_sess_delete(worker->hd, fd);
+        close(fd);
+        return;
+    }
+    sd->timestamp = httpd_os_get_timestamp();
+}
+
+void httpd_worker_run(struct httpd_worker *worker, struct sock_db *sd)
+{
+    sd->worker = worker;
+    worker->sd = sd;
+    httpd_os_thread_notify(worker->td.handle);
+}
+
+static void httpd_worker_thread(void *arg)
+{
+    struct httpd_worker *worker = (struct httpd_worker *) arg;
+
+    while (1) {
+        httpd_os_thread_wait();
+        if (worker->td.status == THREAD_STOPPING) {
+            break;
+        }
+        if (worker->sd == NULL) {
+            continue;
+        }
+
+        worker->ret = httpd_uri_call_handler(&worker->req);
+        if (worker->ret == ESP_OK) {
+            worker->ret = httpd_req_delete(&worker->req);
+        }
+
+        /* Let the server thread release the socket. The message
+         * is retried, as it's the only way out of this state */
+        while (httpd_queue_work(worker->hd, httpd_worker_done, worker) != ESP_OK) {
+            if (worker->td.status == THREAD_STOPPING) {
+                break;
+            }
+            httpd_os_thread_sleep(100);
+        }
+    }
+
+    worker->td.status = THREAD_STOPPED;
+    httpd_os_thread_delete();
+}
+
+static void httpd_workers_stop(struct httpd_data *hd)
+{
+    for (int i = 0; i < hd->config.worker_tasks; i++) {
+        struct httpd_worker *worker = &hd->hd_workers[i];
+        if (worker->td.status == THREAD_RUNNING) {
+            worker->td.status = THREAD_STOPPING;
+            httpd_os_thread_notify(worker->td.handle);
+        }
+    }
+    /* Wait for the handlers being executed to return */
+    for (int i = 0; i < hd->config.worker_tasks; i++) {
+        while (hd->hd_workers[i].td.status == THREAD_STOPPING) {
+            httpd_os_thread_sleep(100);
+        }
+    }
+}
+
+static esp_err_t httpd_workers_start(struct httpd_data *hd)
+{
+    for (int i = 0; i < hd->config.worker_tasks; i++) {
+        struct httpd_worker *worker = &hd->hd_workers[i];
+        worker->td.status = THREAD_RUNNING;
+        if (httpd_os_thread_create(&worker->td.handle, "httpd_worker",
+                                   hd->config.stack_size,
+                                   hd->config.task_priority,
+                                   httpd_worker_thread, worker) != ESP_OK) {
+            worker->td.status = THREAD_IDLE;
+            httpd_workers_stop(hd);
+            return ESP_FAIL;
+        }
+    }
+    return ESP_OK;
+}
+
 /* Manage in-coming connection or data requests */
 static esp_err_t httpd_server(struct httpd_data *hd)
 {
@@ -219,6 +325,7 @@ static void httpd_thread(void *arg)
     }
 
     ESP_LOGD(TAG, LOG_FMT("web server exiting"));
+    httpd_workers_stop(hd);
     close(hd->msg_fd);
     cs_free_ctrl_sock(hd->ctrl_fd);
     httpd_close_all_sessions(hd);
@@ -242,6 +349,14 @@ static esp_err_t httpd_server_init(struct httpd_data *hd)
         .sin6_port    = htons(hd->config.server_port)
     };
 
+    /* Sessions closed by the server keep the port in TIME_WAIT,
+     * which would prevent restarting the server for a while */
+    int enable = 1;
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable)) < 0) {
+        /* Fails if CONFIG_LWIP_SO_REUSE is not enabled */
+        ESP_LOGW(TAG, LOG_FMT("error in setsockopt SO_REUSEADDR (%d)"), errno);
+    }
+
     int ret = bind(fd, (struct sockaddr *)&serv_addr, sizeof(serv_addr));
     if (ret < 0) {
         ESP_LOGE(TAG, LOG_FMT("error in bind (%d)"), errno);
@@ -277,6 +392,37 @@ static esp_err_t httpd_server_init(struct httpd_data *hd)
     return ESP_OK;
 }
 
+static void httpd_workers_free(struct httpd_data *hd)
+{
+    if (hd->hd_workers) {
+        for (int i = 0; i < hd->config.worker_tasks; i++) {
+            free(hd->hd_workers[i].req_aux.resp_hdrs);
+        }
+        free(hd->hd_workers);
+    }
+}
+
+static esp_err_t httpd_workers_create(struct httpd_data *hd)
+{
+    if (hd->config.worker_tasks == 0) {
+        return ESP_OK;
+    }
+    hd->hd_workers = calloc(hd->config.worker_tasks, sizeof(struct httpd_worker));
+    if (hd->hd_workers == NULL) {
+        return ESP_FAIL;
+    }
+    for (int i = 0; i < hd->config.worker_tasks; i++) {
+        struct httpd_worker *worker = &hd->hd_workers[i];
+        worker->hd = hd;
+        worker->req_aux.resp_hdrs = calloc(hd->config.max_resp_headers, sizeof(struct resp_hdr));
+        if (worker->req_aux.resp_hdrs == NULL) {
+            httpd_workers_free(hd);
+            return ESP_FAIL;
+        }
+    }
+    return ESP_OK;
+}
+
 static struct httpd_data *httpd_create(const httpd_config_t *config)
 {
     /* Allocate memory for httpd instance data */
@@ -303,6 +449,13 @@ static struct httpd_data *httpd_create(const httpd_config_t *config)
         }
         /* Save the configuration for this instance */
         hd->config = *config;
+        if (httpd_workers_create(hd) != ESP_OK) {
+            free(ra->resp_hdrs);
+            free(hd->hd_sd);
+            free(hd->hd_calls);
+            free(hd);
+            return NULL;
+        }
     } else {
         ESP_LOGE(TAG, "mem alloc failed");
     }
@@ -313,6 +466,7 @@ static void httpd_delete(struct httpd_data *hd)
 {
     struct httpd_req_aux *ra = &hd->hd_req_aux;
     /* Free memory of httpd instance data */
+    httpd_workers_free(hd);
     free(ra->resp_hdrs);
     free(hd->hd_sd);
 
@@ -340,11 +494,20 @@ esp_err_t httpd_start(httpd_handle_t *handle, const httpd_config_t *config)
     }
 
     httpd_sess_init(hd);
+    if (httpd_workers_start(hd) != ESP_OK) {
+        /* Failed to launch worker tasks */
+        close(hd->listen_fd);
+        close(hd->msg_fd);
+        cs_free_ctrl_sock(hd->ctrl_fd);
+        httpd_delete(hd);
+        return ESP_ERR_HTTPD_TASK;
+    }
     if (httpd_os_thread_create(&hd->hd_td.handle, "httpd",
                                hd->config.stack_size,
                                hd->config.task_priority,
                                httpd_thread, hd) != ESP_OK) {
         /* Failed to launch task */
+        httpd_workers_stop(hd);
         httpd_delete(hd);
         return ESP_ERR_HTTPD_TASK;
     }
@@ -88,8 +88,13 @@ void httpd_sess_set_descriptors(struct httpd_data *hd,
 {
     int i;
     *maxfd = -1;
+    /* With workers, wait for one of them to be idle before reading
+     * further requests, and leave the sockets being handled to them */
+    if (hd->config.worker_tasks && !httpd_worker_get_idle(hd)) {
+        return;
+    }
     for (i = 0; i < hd->config.max_open_sockets; i++) {
-        if (hd->hd_sd[i].fd != -1) {
+        if (hd->hd_sd[i].fd != -1 && hd->hd_sd[i].worker == NULL) {
             FD_SET(hd->hd_sd[i].fd, fdset);
             if (hd->hd_sd[i].fd > *maxfd) {
                 *maxfd = hd->hd_sd[i].fd;
@@ -156,12 +161,38 @@ esp_err_t httpd_sess_process(struct httpd_data *hd, int newfd)
         return ESP_FAIL;
     }
 
+    httpd_req_t *r = &hd->hd_req;
+    struct httpd_req_aux *ra = &hd->hd_req_aux;
+    struct httpd_worker *worker = NULL;
+    if (hd->config.worker_tasks) {
+        if (sd->worker) {
+            /* Previous request of this socket not handled yet */
+            return ESP_OK;
+        }
+        worker = httpd_worker_get_idle(hd);
+        if (worker == NULL) {
+            /* Processed once a worker is done */
+            return ESP_OK;
+        }
+        /* Requests of workers have their own auxiliary data */
+        r = &worker->req;
+        ra = &worker->req_aux;
+    }
+
     ESP_LOGD(TAG, LOG_FMT("httpd_req_new"));
-    if (httpd_req_new(hd, sd) != ESP_OK) {
+    if (httpd_req_new(hd, r, ra, sd) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    if (worker && ra->handler) {
+        ESP_LOGD(TAG, LOG_FMT("handing over to worker"));
+        httpd_worker_run(worker, sd);
+        return ESP_OK;
+    }
+    if (httpd_uri_call_handler(r) != ESP_OK) {
         return ESP_FAIL;
     }
     ESP_LOGD(TAG, LOG_FMT("httpd_req_delete"));
-    if (httpd_req_delete(hd) != ESP_OK) {
+    if (httpd_req_delete(r) != ESP_OK) {
         return ESP_FAIL;
     }
     ESP_LOGD(TAG, LOG_FMT("success"));
@@ -200,6 +231,10 @@ esp_err_t httpd_sess_close_lru(struct httpd_data *hd)
         if (hd->hd_sd[i].fd == -1) {
             return ESP_OK;
         }
+        /* Sessions in the middle of a request aren't inactive */
+        if (hd->hd_sd[i].worker) {
+            continue;
+        }
         if (hd->hd_sd[i].timestamp < timestamp) {
             timestamp = hd->hd_sd[i].timestamp;
             lru_fd = hd->hd_sd[i].fd;
@@ -235,7 +270,10 @@ int httpd_sess_iterate(struct httpd_data *hd, int start_fd)
 static void httpd_sess_close(void *arg)
 {
     struct sock_db *sock_db = (struct sock_db *)arg;
-    if (sock_db) {
+    if (sock_db && sock_db->worker) {
+        /* Closed once the worker is done */
+        sock_db->close_pending = true;
+    } else if (sock_db) {
         int fd = sock_db->fd;
         struct httpd_data *hd = (struct httpd_data *) sock_db->handle;
         httpd_sess_delete(hd, fd);
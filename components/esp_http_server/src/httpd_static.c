@@ -0,0 +1,469 @@
+// Copyright 2015-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include <esp_log.h>
+#include <esp_err.h>
+#include <http_parser.h>
+
+#include <esp_http_server.h>
+#include "esp_httpd_priv.h"
+
+static const char *TAG = "httpd_static";
+
+/* Maximum length of the path of a file, including base path */
+#define HTTPD_STATIC_MAX_PATH   256
+
+#define HTTPD_STATIC_GZ_EXT     ".gz"
+
+/* A file found under the base path when the handler was registered */
+struct httpd_static_file {
+    char   *path;       /*!< Path relative to base path, starting with '/' */
+    size_t  size;
+    int     gz;         /*!< Index of the ".gz" sibling of the file, -1 if none */
+    char    etag[24];   /*!< Quoted ETag, made of file size and hash of its content */
+};
+
+struct httpd_static_ctx {
+    char                     *uri_prefix;       /*!< Without trailing '/' */
+    char                     *base_path;        /*!< Without trailing '/' */
+    char                     *index_file;
+    char                     *cache_control;
+    size_t                    read_buf_size;
+    struct httpd_static_file *files;            /*!< Sorted by path */
+    size_t                    num_files;
+};
+
+static const struct {
+    const char *ext;
+    const char *type;
+} httpd_static_types[] = {
+    { ".html",  "text/html" },
+    { ".htm",   "text/html" },
+    { ".css",   "text/css" },
+    { ".js",    "application/javascript" },
+    { ".json",  "application/json" },
+    { ".txt",   "text/plain" },
+    { ".xml",   "text/xml" },
+    { ".svg",   "image/svg+xml" },
+    { ".png",   "image/png" },
+    { ".jpg",   "image/jpeg" },
+    { ".jpeg",  "image/jpeg" },
+    { ".gif",   "image/gif" },
+    { ".ico",   "image/x-icon" },
+    { ".woff",  "font/woff" },
+    { ".woff2", "font/woff2" },
+    { ".pdf",   "application/pdf" },
+};
+
+static const char *httpd_static_type(const char *path, size_t path_len)
+{
+    for (int i = 0; i < sizeof(httpd_static_types) / sizeof(httpd_static_types[0]); i++) {
+        size_t ext_len = strlen(httpd_static_types[i].ext);
+        if (path_len >= ext_len &&
+            strncasecmp(path + path_len - ext_len, httpd_static_types[i].ext, ext_len) == 0) {
+            return httpd_static_types[i].type;
+        }
+    }
+    return HTTPD_TYPE_OCTET;
+}
+
+static char *httpd_static_strdup(const char *str, bool strip_slash)
+{
+    if (str == NULL) {
+        return NULL;
+    }
+    size_t len = strlen(str);
+    if (strip_slash && len > 0 && str[len - 1] == '/') {
+        len--;
+    }
+    return strndup(str, len);
+}
+
+static void httpd_static_free(void *arg)
+{
+    struct httpd_static_ctx *ctx = (struct httpd_static_ctx *) arg;
+    if (ctx == NULL) {
+        return;
+    }
+    for (size_t i = 0; i < ctx->num_files; i++) {
+        free(ctx->files[i].path);
+    }
+    free(ctx->files);
+    free(ctx->uri_prefix);
+    free(ctx->base_path);
+    free(ctx->index_file);
+    free(ctx->cache_control);
+    free(ctx);
+}
+
+/* Computes the ETag of a file from its size and a FNV-1a hash of its content */
+static esp_err_t httpd_static_etag(const char *path, char *buf, size_t buf_size, struct httpd_static_file *file)
+{
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return ESP_FAIL;
+    }
+
+    uint32_t hash = 2166136261U;
+    size_t size = 0;
+    int len;
+    while ((len = read(fd, buf, buf_size)) > 0) {
+        for (int i = 0; i < len; i++) {
+            hash = (hash ^ (uint8_t)buf[i]) * 16777619U;
+        }
+        size += len;
+    }
+    close(fd);
+    if (len < 0) {
+        return ESP_FAIL;
+    }
+
+    file->size = size;
+    snprintf(file->etag, sizeof(file->etag), "\"%x-%08x\"", size, hash);
+    return ESP_OK;
+}
+
+/* Adds the files of directory 'path' and its subdirectories to the index.
+ * 'path' is a buffer of HTTPD_STATIC_MAX_PATH bytes, whose content
+ * is restored before returning */
+static esp_err_t httpd_static_scan(struct httpd_static_ctx *ctx, char *path, char *buf)
+{
+    DIR *dir = opendir(path);
+    if (dir == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    esp_err_t ret = ESP_OK;
+    size_t path_len = strlen(path);
+    struct dirent *entry;
+    while (ret == ESP_OK && (entry = readdir(dir)) != NULL) {
+        if (strcmp(entry->d_name, ".") == 0 || strcmp(entry->d_name, "..") == 0) {
+            continue;
+        }
+        if (path_len + 1 + strlen(entry->d_name) >= HTTPD_STATIC_MAX_PATH) {
+            ESP_LOGW(TAG, LOG_FMT("path too long, skipping %s"), entry->d_name);
+            continue;
+        }
+        snprintf(path + path_len, HTTPD_STATIC_MAX_PATH - path_len, "/%s", entry->d_name);
+
+        struct stat st;
+        if (stat(path, &st) != 0) {
+            ESP_LOGW(TAG, LOG_FMT("error in stat (%d) for %s"), errno, path);
+        } else if (S_ISDIR(st.st_mode)) {
+            ret = httpd_static_scan(ctx, path, buf);
+        } else {
+            struct httpd_static_file *files = realloc(ctx->files, (ctx->num_files + 1) * sizeof(*files));
+            if (files == NULL) {
+                ret = ESP_ERR_HTTPD_ALLOC_MEM;
+                break;
+            }
+            ctx->files = files;
+
+            struct httpd_static_file *file = &files[ctx->num_files];
+            file->gz = -1;
+            file->path = strdup(path + strlen(ctx->base_path));
+            if (file->path == NULL) {
+                ret = ESP_ERR_HTTPD_ALLOC_MEM;
+            } else if (httpd_static_etag(path, buf, ctx->read_buf_size, file) != ESP_OK) {
+                ESP_LOGW(TAG, LOG_FMT("error reading %s"), path);
+                free(file->path);
+            } else {
+                ESP_LOGD(TAG, LOG_FMT("%s, %d bytes, etag %s"), file->path, file->size, file->etag);
+                ctx->num_files++;
+            }
+        }
+        path[path_len] = '\0';
+    }
+    closedir(dir);
+    return ret;
+}
+
+static int httpd_static_file_cmp(const void *a, const void *b)
+{
+    return strcmp(((const struct httpd_static_file *)a)->path,
+                  ((const struct httpd_static_file *)b)->path);
+}
+
+static struct httpd_static_file *httpd_static_find(struct httpd_static_ctx *ctx, const char *path)
+{
+    struct httpd_static_file key = { .path = (char *)path };
+    return bsearch(&key, ctx->files, ctx->num_files, sizeof(key), httpd_static_file_cmp);
+}
+
+/* Indexes the files under the base path, and links each file with its ".gz" sibling */
+static esp_err_t httpd_static_index(struct httpd_static_ctx *ctx)
+{
+    char *path = malloc(HTTPD_STATIC_MAX_PATH);
+    char *buf  = malloc(ctx->read_buf_size);
+    if (path == NULL || buf == NULL) {
+        free(path);
+        free(buf);
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
+    strlcpy(path, ctx->base_path, HTTPD_STATIC_MAX_PATH);
+    esp_err_t ret = httpd_static_scan(ctx, path, buf);
+    free(buf);
+    if (ret != ESP_OK) {
+        free(path);
+        return ret;
+    }
+
+    qsort(ctx->files, ctx->num_files, sizeof(struct httpd_static_file), httpd_static_file_cmp);
+    for (size_t i = 0; i < ctx->num_files; i++) {
+        size_t len = strlen(ctx->files[i].path);
+        size_t ext_len = strlen(HTTPD_STATIC_GZ_EXT);
+        if (len > ext_len && strcmp(ctx->files[i].path + len - ext_len, HTTPD_STATIC_GZ_EXT) == 0) {
+            strlcpy(path, ctx->files[i].path, len - ext_len + 1);
+            struct httpd_static_file *file = httpd_static_find(ctx, path);
+            if (file) {
+                file->gz = i;
+            }
+        }
+    }
+    free(path);
+    ESP_LOGI(TAG, LOG_FMT("%d files under %s"), ctx->num_files, ctx->base_path);
+    return ESP_OK;
+}
+
+/* Returns true if the value of request header 'field' contains 'token' */
+static bool httpd_static_hdr_has(httpd_req_t *req, const char *field, const char *token)
+{
+    char val[128];
+    esp_err_t ret = httpd_req_get_hdr_value_str(req, field, val, sizeof(val));
+    if (ret != ESP_OK && ret != ESP_ERR_HTTPD_RESULT_TRUNC) {
+        return false;
+    }
+    return strstr(val, token) != NULL;
+}
+
+/* Returns true if the If-None-Match header of the request matches 'etag' */
+static bool httpd_static_etag_match(httpd_req_t *req, const char *etag)
+{
+    char val[128];
+    esp_err_t ret = httpd_req_get_hdr_value_str(req, "If-None-Match", val, sizeof(val));
+    if (ret != ESP_OK && ret != ESP_ERR_HTTPD_RESULT_TRUNC) {
+        return false;
+    }
+    /* "*" matches any current representation of the file */
+    const char *p = val + strspn(val, " \t");
+    if (p[0] == '*' && p[strspn(p + 1, " \t") + 1] == '\0') {
+        return true;
+    }
+    return strstr(val, etag) != NULL;
+}
+
+static esp_err_t httpd_static_send_file(httpd_req_t *req, struct httpd_static_ctx *ctx,
+                                        const struct httpd_static_file *file)
+{
+    char path[HTTPD_STATIC_MAX_PATH];
+    snprintf(path, sizeof(path), "%s%s", ctx->base_path, file->path);
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        ESP_LOGW(TAG, LOG_FMT("error in open (%d) for %s"), errno, path);
+        return httpd_resp_send_404(req);
+    }
+
+    /* Small files are sent along with the headers */
+    size_t buf_size = MIN(file->size, ctx->read_buf_size);
+    char *buf = malloc(MAX(buf_size, 1));
+    if (buf == NULL) {
+        close(fd);
+        return httpd_resp_send_500(req);
+    }
+
+    esp_err_t ret = ESP_OK;
+    if (file->size <= buf_size) {
+        int len = read(fd, buf, buf_size);
+        if (len != file->size) {
+            ret = httpd_resp_send_500(req);
+        } else {
+            ret = httpd_resp_send(req, buf, len);
+        }
+    } else {
+        ret = httpd_resp_send_hdrs(req, file->size);
+        size_t remaining = file->size;
+        while (ret == ESP_OK && remaining > 0) {
+            int len = read(fd, buf, MIN(buf_size, remaining));
+            if (len <= 0) {
+                /* Content-Length can't be honoured anymore */
+                ESP_LOGW(TAG, LOG_FMT("error in read (%d) for %s"), errno, path);
+                ret = ESP_FAIL;
+                break;
+            }
+            ret = httpd_send_all(req, buf, len);
+            remaining -= len;
+        }
+    }
+    free(buf);
+    close(fd);
+    return ret;
+}
+
+static esp_err_t httpd_static_handler(httpd_req_t *req)
+{
+    struct httpd_static_ctx *ctx = (struct httpd_static_ctx *) req->user_ctx;
+    struct httpd_req_aux    *ra  = req->aux;
+    struct http_parser_url  *res = &ra->url_parse_res;
+
+    /* Path of the file relative to the base path */
+    const char *uri_path = req->uri + res->field_data[UF_PATH].off;
+    size_t      uri_len  = res->field_data[UF_PATH].len;
+    size_t      pfx_len  = strlen(ctx->uri_prefix);
+    char path[HTTPD_STATIC_MAX_PATH];
+    size_t path_len = uri_len - pfx_len;
+    /* Room for '/', the index file, the ".gz" extension and null termination */
+    if (path_len + (ctx->index_file ? strlen(ctx->index_file) : 0) +
+        strlen(HTTPD_STATIC_GZ_EXT) + 2 > sizeof(path)) {
+        return httpd_resp_send_404(req);
+    }
+    memcpy(path, uri_path + pfx_len, path_len);
+    path[path_len] = '\0';
+    if (path_len == 0 || path[path_len - 1] == '/') {
+        if (ctx->index_file == NULL) {
+            return httpd_resp_send_404(req);
+        }
+        snprintf(path + path_len, sizeof(path) - path_len, "%s%s",
+                 path_len == 0 ? "/" : "", ctx->index_file);
+    }
+
+    const struct httpd_static_file *file = httpd_static_find(ctx, path);
+    const struct httpd_static_file *gz = NULL;
+    if (file) {
+        gz = (file->gz != -1) ? &ctx->files[file->gz] : NULL;
+    } else {
+        /* Only the compressed file may be present */
+        size_t len = strlen(path);
+        strcpy(path + len, HTTPD_STATIC_GZ_EXT);
+        gz = httpd_static_find(ctx, path);
+        path[len] = '\0';
+        if (gz == NULL) {
+            return httpd_resp_send_404(req);
+        }
+    }
+
+    /* Request headers are to be read before sending anything */
+    if (gz && httpd_static_hdr_has(req, "Accept-Encoding", "gzip")) {
+        file = gz;
+        httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    } else if (file == NULL) {
+        return httpd_resp_send_404(req);
+    }
+    bool not_modified = httpd_static_etag_match(req, file->etag);
+
+    httpd_resp_set_type(req, httpd_static_type(path, strlen(path)));
+    httpd_resp_set_hdr(req, "ETag", file->etag);
+    if (gz) {
+        httpd_resp_set_hdr(req, "Vary", "Accept-Encoding");
+    }
+    if (ctx->cache_control) {
+        httpd_resp_set_hdr(req, "Cache-Control", ctx->cache_control);
+    }
+
+    if (not_modified) {
+        ESP_LOGD(TAG, LOG_FMT("%s not modified"), file->path);
+        httpd_resp_set_status(req, "304 Not Modified");
+        /* No body, Content-Length is the one of the file */
+        return httpd_resp_send_hdrs(req, file->size);
+    }
+    ESP_LOGD(TAG, LOG_FMT("sending %s (%d bytes)"), file->path, file->size);
+    return httpd_static_send_file(req, ctx, file);
+}
+
+/* Builds the URI with which the handler is registered for 'uri_prefix' */
+static char *httpd_static_uri(const char *uri_prefix)
+{
+    size_t len = strlen(uri_prefix);
+    if (len > 0 && uri_prefix[len - 1] == '/') {
+        len--;
+    }
+    char *uri = malloc(len + 3);
+    if (uri) {
+        memcpy(uri, uri_prefix, len);
+        strcpy(uri + len, "/*");
+    }
+    return uri;
+}
+
+esp_err_t httpd_register_static_handler(httpd_handle_t handle, const httpd_static_config_t *config)
+{
+    if (handle == NULL || config == NULL || config->uri_prefix == NULL ||
+        config->base_path == NULL || config->read_buf_size == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    struct httpd_static_ctx *ctx = calloc(1, sizeof(struct httpd_static_ctx));
+    char *uri = httpd_static_uri(config->uri_prefix);
+    if (ctx == NULL || uri == NULL) {
+        free(ctx);
+        free(uri);
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
+    ctx->uri_prefix    = httpd_static_strdup(config->uri_prefix, true);
+    ctx->base_path     = httpd_static_strdup(config->base_path, true);
+    ctx->index_file    = httpd_static_strdup(config->index_file, false);
+    ctx->cache_control = httpd_static_strdup(config->cache_control, false);
+    ctx->read_buf_size = config->read_buf_size;
+    if (ctx->uri_prefix == NULL || ctx->base_path == NULL ||
+        (config->index_file && ctx->index_file == NULL) ||
+        (config->cache_control && ctx->cache_control == NULL)) {
+        httpd_static_free(ctx);
+        free(uri);
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
+
+    esp_err_t ret = httpd_static_index(ctx);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, LOG_FMT("failed to index %s (0x%x)"), ctx->base_path, ret);
+        httpd_static_free(ctx);
+        free(uri);
+        return ret;
+    }
+
+    httpd_uri_t uri_handler = {
+        .uri      = uri,
+        .method   = HTTP_GET,
+        .handler  = httpd_static_handler,
+        .user_ctx = ctx,
+    };
+    ret = httpd_register_uri_handler_with_free(handle, &uri_handler, httpd_static_free);
+    if (ret != ESP_OK) {
+        httpd_static_free(ctx);
+    }
+    free(uri);
+    return ret;
+}
+
+esp_err_t httpd_unregister_static_handler(httpd_handle_t handle, const char *uri_prefix)
+{
+    if (handle == NULL || uri_prefix == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    char *uri = httpd_static_uri(uri_prefix);
+    if (uri == NULL) {
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
+    esp_err_t ret = httpd_unregister_uri_handler(handle, uri, HTTP_GET);
+    free(uri);
+    return ret;
+}
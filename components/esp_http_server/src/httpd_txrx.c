@@ -71,7 +71,7 @@ int httpd_send(httpd_req_t *r, const char *buf, size_t buf_len)
     return ret;
 }
 
-static esp_err_t httpd_send_all(httpd_req_t *r, const char *buf, size_t buf_len)
+esp_err_t httpd_send_all(httpd_req_t *r, const char *buf, size_t buf_len)
 {
     struct httpd_req_aux *ra = r->aux;
     int ret;
@@ -231,67 +231,118 @@ esp_err_t httpd_resp_set_type(httpd_req_t *r, const char *type)
     return ESP_OK;
 }
 
-esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, size_t buf_len)
+/**
+ * Response data is gathered in the scratch buffer (request headers are no longer
+ * available once a response is being sent), so that the status line, the headers
+ * and small payloads go out in a single send instead of one per header field,
+ * separator and line ending.
+ */
+struct httpd_resp_buf {
+    httpd_req_t *r;
+    size_t       len;   /*!< Length of data gathered in scratch buffer */
+    esp_err_t    err;   /*!< First error that occurred while sending */
+};
+
+static void httpd_resp_buf_flush(struct httpd_resp_buf *rb)
 {
-    if (r == NULL) {
-        return ESP_ERR_INVALID_ARG;
+    struct httpd_req_aux *ra = rb->r->aux;
+    if (rb->err == ESP_OK && rb->len > 0 &&
+        httpd_send_all(rb->r, ra->scratch, rb->len) != ESP_OK) {
+        rb->err = ESP_ERR_HTTPD_RESP_SEND;
     }
+    rb->len = 0;
+}
 
-    if (!httpd_valid_req(r)) {
-        return ESP_ERR_HTTPD_INVALID_REQ;
+static void httpd_resp_buf_append(struct httpd_resp_buf *rb, const char *data, size_t len)
+{
+    struct httpd_req_aux *ra = rb->r->aux;
+    if (len <= sizeof(ra->scratch) - rb->len) {
+        memcpy(ra->scratch + rb->len, data, len);
+        rb->len += len;
+        return;
+    }
+    /* Data doesn't fit in the space left, send out what is gathered
+     * so far and then the data itself, without copying it */
+    httpd_resp_buf_flush(rb);
+    if (rb->err == ESP_OK && httpd_send_all(rb->r, data, len) != ESP_OK) {
+        rb->err = ESP_ERR_HTTPD_RESP_SEND;
     }
+}
+
+static inline void httpd_resp_buf_append_str(struct httpd_resp_buf *rb, const char *str)
+{
+    httpd_resp_buf_append(rb, str, strlen(str));
+}
+
+/* Gathers the response head, i.e. the status line and essential headers, followed
+ * by the additional headers based on set_header and the end of the header section */
+static esp_err_t httpd_resp_buf_add_hdrs(struct httpd_resp_buf *rb, const char *hdr_str, size_t content_len)
+{
+    struct httpd_req_aux *ra = rb->r->aux;
 
+    /* Size of essential headers is limited by scratch buffer size */
+    int len = snprintf(ra->scratch, sizeof(ra->scratch), hdr_str,
+                       ra->status, ra->content_type, content_len);
+    if (len < 0 || len >= sizeof(ra->scratch)) {
+        return ESP_ERR_HTTPD_RESP_HDR;
+    }
+    rb->len = len;
+
+    for (unsigned i = 0; i < ra->resp_hdrs_count; i++) {
+        httpd_resp_buf_append_str(rb, ra->resp_hdrs[i].field);
+        httpd_resp_buf_append_str(rb, ": ");
+        httpd_resp_buf_append_str(rb, ra->resp_hdrs[i].value);
+        httpd_resp_buf_append_str(rb, "\r\n");
+    }
+    httpd_resp_buf_append_str(rb, "\r\n");
+    return rb->err;
+}
+
+static const char *httpd_hdr_str = "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %d\r\n";
+
+esp_err_t httpd_resp_send_hdrs(httpd_req_t *r, size_t content_len)
+{
     struct httpd_req_aux *ra = r->aux;
-    const char *httpd_hdr_str = "HTTP/1.1 %s\r\nContent-Type: %s\r\nContent-Length: %d\r\n";
-    const char *colon_separator = ": ";
-    const char *cr_lf_seperator = "\r\n";
+    struct httpd_resp_buf rb = { .r = r };
 
     /* Request headers are no longer available */
     ra->req_hdrs_count = 0;
 
-    /* Size of essential headers is limited by scratch buffer size */
-    if (snprintf(ra->scratch, sizeof(ra->scratch), httpd_hdr_str,
-                 ra->status, ra->content_type, buf_len) >= sizeof(ra->scratch)) {
-        return ESP_ERR_HTTPD_RESP_HDR;
+    esp_err_t ret = httpd_resp_buf_add_hdrs(&rb, httpd_hdr_str, content_len);
+    if (ret != ESP_OK) {
+        return ret;
     }
+    httpd_resp_buf_flush(&rb);
+    return rb.err;
+}
 
-    /* Sending essential headers */
-    if (httpd_send_all(r, ra->scratch, strlen(ra->scratch)) != ESP_OK) {
-        return ESP_ERR_HTTPD_RESP_SEND;
+esp_err_t httpd_resp_send(httpd_req_t *r, const char *buf, size_t buf_len)
+{
+    if (r == NULL) {
+        return ESP_ERR_INVALID_ARG;
     }
 
-    /* Sending additional headers based on set_header */
-    for (unsigned i = 0; i < ra->resp_hdrs_count; i++) {
-        /* Send header field */
-        if (httpd_send_all(r, ra->resp_hdrs[i].field, strlen(ra->resp_hdrs[i].field)) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
-        /* Send ': ' */
-        if (httpd_send_all(r, colon_separator, strlen(colon_separator)) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
-        /* Send header value */
-        if (httpd_send_all(r, ra->resp_hdrs[i].value, strlen(ra->resp_hdrs[i].value)) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
-        /* Send CR + LF */
-        if (httpd_send_all(r, cr_lf_seperator, strlen(cr_lf_seperator)) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
+    if (!httpd_valid_req(r)) {
+        return ESP_ERR_HTTPD_INVALID_REQ;
     }
 
-    /* End header section */
-    if (httpd_send_all(r, cr_lf_seperator, strlen(cr_lf_seperator)) != ESP_OK) {
-        return ESP_ERR_HTTPD_RESP_SEND;
+    struct httpd_req_aux *ra = r->aux;
+    struct httpd_resp_buf rb = { .r = r };
+
+    /* Request headers are no longer available */
+    ra->req_hdrs_count = 0;
+
+    esp_err_t ret = httpd_resp_buf_add_hdrs(&rb, httpd_hdr_str, buf_len);
+    if (ret != ESP_OK) {
+        return ret;
     }
 
-    /* Sending content */
+    /* Content is sent along with the headers if it fits in the scratch buffer */
     if (buf && buf_len) {
-        if (httpd_send_all(r, buf, buf_len) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
+        httpd_resp_buf_append(&rb, buf, buf_len);
     }
-    return ESP_OK;
+    httpd_resp_buf_flush(&rb);
+    return rb.err;
 }
 
 esp_err_t httpd_resp_send_chunk(httpd_req_t *r, const char *buf, size_t buf_len)
@@ -305,70 +356,36 @@ esp_err_t httpd_resp_send_chunk(httpd_req_t *r, const char *buf, size_t buf_len)
     }
 
     struct httpd_req_aux *ra = r->aux;
+    struct httpd_resp_buf rb = { .r = r };
     const char *httpd_chunked_hdr_str = "HTTP/1.1 %s\r\nContent-Type: %s\r\nTransfer-Encoding: chunked\r\n";
-    const char *colon_separator = ": ";
-    const char *cr_lf_seperator = "\r\n";
 
     /* Request headers are no longer available */
     ra->req_hdrs_count = 0;
 
     if (!ra->first_chunk_sent) {
-        /* Size of essential headers is limited by scratch buffer size */
-        if (snprintf(ra->scratch, sizeof(ra->scratch), httpd_chunked_hdr_str,
-                     ra->status, ra->content_type) >= sizeof(ra->scratch)) {
-            return ESP_ERR_HTTPD_RESP_HDR;
-        }
-
-        /* Sending essential headers */
-        if (httpd_send_all(r, ra->scratch, strlen(ra->scratch)) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
-
-        /* Sending additional headers based on set_header */
-        for (unsigned i = 0; i < ra->resp_hdrs_count; i++) {
-            /* Send header field */
-            if (httpd_send_all(r, ra->resp_hdrs[i].field, strlen(ra->resp_hdrs[i].field)) != ESP_OK) {
-                return ESP_ERR_HTTPD_RESP_SEND;
-            }
-            /* Send ': ' */
-            if (httpd_send_all(r, colon_separator, strlen(colon_separator)) != ESP_OK) {
-                return ESP_ERR_HTTPD_RESP_SEND;
-            }
-            /* Send header value */
-            if (httpd_send_all(r, ra->resp_hdrs[i].value, strlen(ra->resp_hdrs[i].value)) != ESP_OK) {
-                return ESP_ERR_HTTPD_RESP_SEND;
-            }
-            /* Send CR + LF */
-            if (httpd_send_all(r, cr_lf_seperator, strlen(cr_lf_seperator)) != ESP_OK) {
-                return ESP_ERR_HTTPD_RESP_SEND;
-            }
+        esp_err_t ret = httpd_resp_buf_add_hdrs(&rb, httpd_chunked_hdr_str, 0);
+        if (ret != ESP_OK) {
+            return ret;
         }
-
-        /* End header section */
-        if (httpd_send_all(r, cr_lf_seperator, strlen(cr_lf_seperator)) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
-        ra->first_chunk_sent = true;
     }
 
-    /* Sending chunked content */
+    /* Chunk size, chunked content and end of chunk are sent in one
+     * go (along with the headers for the first chunk) if they fit */
     char len_str[10];
     snprintf(len_str, sizeof(len_str), "%x\r\n", buf_len);
-    if (httpd_send_all(r, len_str, strlen(len_str)) != ESP_OK) {
-        return ESP_ERR_HTTPD_RESP_SEND;
-    }
-
+    httpd_resp_buf_append_str(&rb, len_str);
     if (buf) {
-        if (httpd_send_all(r, buf, buf_len) != ESP_OK) {
-            return ESP_ERR_HTTPD_RESP_SEND;
-        }
+        httpd_resp_buf_append(&rb, buf, buf_len);
     }
+    httpd_resp_buf_append_str(&rb, "\r\n");
+    httpd_resp_buf_flush(&rb);
 
-    /* Indicate end of chunk */
-    if (httpd_send_all(r, "\r\n", strlen("\r\n")) != ESP_OK) {
-        return ESP_ERR_HTTPD_RESP_SEND;
+    /* The headers are gathered with the first chunk, so
+     * they are only sent once the chunk is sent too */
+    if (rb.err == ESP_OK) {
+        ra->first_chunk_sent = true;
     }
-    return ESP_OK;
+    return rb.err;
 }
 
 esp_err_t httpd_resp_send_404(httpd_req_t *r)
@@ -23,68 +23,331 @@
 
 static const char *TAG = "httpd_uri";
 
-static int httpd_find_uri_handler(struct httpd_data *hd,
-                                  const char* uri,
-                                  httpd_method_t method)
+/* Registered URI handlers are looked up in a tree of path segments, so that
+ * the cost of routing a request depends on the length of its path instead of
+ * the number of handlers. Children of a node are kept in a hash table shared
+ * by all nodes and keyed by the parent node and the segment string, so finding
+ * the next node takes one hash lookup per path segment.
+ *
+ * A URI is split into segments at each '/'. A segment of the form "{name}"
+ * matches any single segment of a request path (see httpd_req_get_uri_param()),
+ * and "*" as the last segment matches any remaining path, including an empty
+ * one. When a request path matches several URIs, a literal segment takes
+ * precedence over "{name}", which takes precedence over "*". The handler for
+ * the request method is then selected among the handlers of the matching URI.
+ */
+
+#define HTTPD_URI_TABLE_MIN_SIZE    16
+
+struct httpd_uri_node;
+
+/* Registered URI handler, with its position in the tree */
+struct httpd_uri_entry {
+    httpd_uri_t             uri;        /*!< Copy of the registered handler, must be first */
+    httpd_free_sess_ctx_fn_t free_ctx;  /*!< Function for freeing uri.user_ctx, if any */
+    struct httpd_uri_node  *node;       /*!< Node of the last path segment */
+    bool                    prefix;     /*!< URI ends with "*" */
+    struct httpd_uri_entry *next;       /*!< Next handler registered on the same node */
+};
+
+struct httpd_uri_node {
+    struct httpd_uri_node  *parent;
+    struct httpd_uri_node  *next;       /*!< Next node in the same bucket of the hash table */
+    struct httpd_uri_node  *param;      /*!< Child matching any segment */
+    struct httpd_uri_entry *exact;      /*!< Handlers of URIs ending at this node */
+    struct httpd_uri_entry *prefix;     /*!< Handlers of URIs ending at this node followed by "*" */
+    unsigned                children;   /*!< Number of child nodes, including 'param' */
+    uint32_t                hash;
+    size_t                  seg_len;
+    char                    seg[];      /*!< Path segment, not null terminated */
+};
+
+struct httpd_uri_router {
+    struct httpd_uri_node  *roots[2];   /*!< Trees of relative URIs and of URIs starting with '/' */
+    size_t                  table_size; /*!< Number of buckets in table, a power of 2 */
+    struct httpd_uri_node  *table[];    /*!< Hash table of non-parameter nodes */
+};
+
+/* FNV-1a hash of a path segment, seeded with the parent node */
+static uint32_t httpd_uri_hash(const struct httpd_uri_node *parent, const char *seg, size_t seg_len)
 {
-    for (int i = 0; i < hd->config.max_uri_handlers; i++) {
-        if (hd->hd_calls[i]) {
-            ESP_LOGD(TAG, LOG_FMT("[%d] = %s"), i, hd->hd_calls[i]->uri);
-            if ((hd->hd_calls[i]->method == method) &&          // First match methods
-                (strcmp(hd->hd_calls[i]->uri, uri) == 0)) {     // Then match uri strings
-                return i;
+    uint32_t hash = 2166136261U ^ (uint32_t)(uintptr_t)parent;
+    for (size_t i = 0; i < seg_len; i++) {
+        hash = (hash ^ (uint8_t)seg[i]) * 16777619U;
+    }
+    return hash;
+}
+
+static inline bool httpd_uri_seg_is_param(const char *seg, size_t seg_len)
+{
+    return seg_len >= 2 && seg[0] == '{' && seg[seg_len - 1] == '}';
+}
+
+/* Returns the length of the segment at the start of 'path' */
+static inline size_t httpd_uri_seg_len(const char *path, size_t path_len)
+{
+    const char *end = memchr(path, '/', path_len);
+    return end ? end - path : path_len;
+}
+
+/* Returns the root node for 'uri', and skips the leading '/' */
+static struct httpd_uri_node **httpd_uri_root(struct httpd_uri_router *router, const char **uri, size_t *uri_len)
+{
+    if (*uri_len > 0 && **uri == '/') {
+        (*uri)++;
+        (*uri_len)--;
+        return &router->roots[1];
+    }
+    return &router->roots[0];
+}
+
+static struct httpd_uri_node *httpd_uri_find_child(struct httpd_uri_router *router,
+                                                   const struct httpd_uri_node *parent,
+                                                   const char *seg, size_t seg_len)
+{
+    uint32_t hash = httpd_uri_hash(parent, seg, seg_len);
+    struct httpd_uri_node *node = router->table[hash & (router->table_size - 1)];
+    for (; node != NULL; node = node->next) {
+        if (node->hash == hash && node->parent == parent &&
+            node->seg_len == seg_len && memcmp(node->seg, seg, seg_len) == 0) {
+            return node;
+        }
+    }
+    return NULL;
+}
+
+static struct httpd_uri_node *httpd_uri_new_node(struct httpd_uri_node *parent, const char *seg, size_t seg_len)
+{
+    struct httpd_uri_node *node = calloc(1, sizeof(struct httpd_uri_node) + seg_len);
+    if (node == NULL) {
+        return NULL;
+    }
+    node->parent  = parent;
+    node->seg_len = seg_len;
+    if (seg_len) {
+        /* The root nodes have no segment, and seg may be NULL for them */
+        memcpy(node->seg, seg, seg_len);
+    }
+    if (parent) {
+        parent->children++;
+    }
+    return node;
+}
+
+/* Returns the child of 'parent' for the segment of a registered URI, creating it if required */
+static struct httpd_uri_node *httpd_uri_add_child(struct httpd_uri_router *router,
+                                                  struct httpd_uri_node *parent,
+                                                  const char *seg, size_t seg_len)
+{
+    if (httpd_uri_seg_is_param(seg, seg_len)) {
+        if (parent->param == NULL) {
+            parent->param = httpd_uri_new_node(parent, seg, seg_len);
+        }
+        return parent->param;
+    }
+
+    struct httpd_uri_node *node = httpd_uri_find_child(router, parent, seg, seg_len);
+    if (node == NULL) {
+        node = httpd_uri_new_node(parent, seg, seg_len);
+        if (node != NULL) {
+            node->hash = httpd_uri_hash(parent, seg, seg_len);
+            struct httpd_uri_node **bucket = &router->table[node->hash & (router->table_size - 1)];
+            node->next = *bucket;
+            *bucket = node;
+        }
+    }
+    return node;
+}
+
+/* Frees 'node' and its ancestors for as long as they are no longer used */
+static void httpd_uri_release_node(struct httpd_uri_router *router, struct httpd_uri_node *node)
+{
+    while (node != NULL && node->parent != NULL &&
+           node->exact == NULL && node->prefix == NULL && node->children == 0) {
+        struct httpd_uri_node *parent = node->parent;
+        if (parent->param == node) {
+            parent->param = NULL;
+        } else {
+            struct httpd_uri_node **pp = &router->table[node->hash & (router->table_size - 1)];
+            while (*pp != node) {
+                pp = &(*pp)->next;
+            }
+            *pp = node->next;
+        }
+        parent->children--;
+        free(node);
+        node = parent;
+    }
+}
+
+/* Walks the tree along the segments of a registered URI. Nodes are created if
+ * 'create' is set, NULL is returned otherwise if the URI is not in the tree */
+static struct httpd_uri_node *httpd_uri_walk(struct httpd_uri_router *router,
+                                             const char *uri, bool create, bool *prefix)
+{
+    size_t uri_len = strlen(uri);
+    struct httpd_uri_node **root = httpd_uri_root(router, &uri, &uri_len);
+    if (*root == NULL) {
+        if (!create) {
+            return NULL;
+        }
+        *root = httpd_uri_new_node(NULL, NULL, 0);
+    }
+
+    struct httpd_uri_node *node = *root;
+    *prefix = false;
+    while (node != NULL) {
+        size_t seg_len = httpd_uri_seg_len(uri, uri_len);
+        if (seg_len == uri_len && seg_len == 1 && uri[0] == '*') {
+            /* "*" as last segment */
+            *prefix = true;
+            break;
+        }
+        struct httpd_uri_node *parent = node;
+        if (create) {
+            node = httpd_uri_add_child(router, parent, uri, seg_len);
+            if (node == NULL) {
+                /* Drop the nodes created so far */
+                httpd_uri_release_node(router, parent);
             }
+        } else if (httpd_uri_seg_is_param(uri, seg_len)) {
+            node = parent->param;
+        } else {
+            node = httpd_uri_find_child(router, parent, uri, seg_len);
+        }
+        if (seg_len == uri_len) {
+            break;
         }
+        uri     += seg_len + 1;
+        uri_len -= seg_len + 1;
     }
-    return -1;
+    return node;
+}
+
+static struct httpd_uri_entry **httpd_uri_list(struct httpd_uri_node *node, bool prefix)
+{
+    return prefix ? &node->prefix : &node->exact;
+}
+
+static struct httpd_uri_router *httpd_uri_get_router(struct httpd_data *hd)
+{
+    if (hd->hd_router == NULL) {
+        size_t table_size = HTTPD_URI_TABLE_MIN_SIZE;
+        while (table_size < hd->config.max_uri_handlers) {
+            table_size *= 2;
+        }
+        hd->hd_router = calloc(1, sizeof(struct httpd_uri_router) + table_size * sizeof(struct httpd_uri_node *));
+        if (hd->hd_router != NULL) {
+            hd->hd_router->table_size = table_size;
+        }
+    }
+    return hd->hd_router;
+}
+
+/* Removes a registered handler from the tree and from its slot */
+static void httpd_uri_remove_entry(struct httpd_data *hd, struct httpd_uri_entry *entry)
+{
+    struct httpd_uri_entry **pe = httpd_uri_list(entry->node, entry->prefix);
+    while (*pe != entry) {
+        pe = &(*pe)->next;
+    }
+    *pe = entry->next;
+    httpd_uri_release_node(hd->hd_router, entry->node);
+
+    for (int i = 0; i < hd->config.max_uri_handlers; i++) {
+        if (hd->hd_calls[i] == &entry->uri) {
+            ESP_LOGD(TAG, LOG_FMT("[%d] removing %s"), i, entry->uri.uri);
+            hd->hd_calls[i] = NULL;
+            break;
+        }
+    }
+    if (entry->free_ctx) {
+        entry->free_ctx(entry->uri.user_ctx);
+    }
+    free((char*)entry->uri.uri);
+    free(entry);
 }
 
 esp_err_t httpd_register_uri_handler(httpd_handle_t handle,
                                      const httpd_uri_t *uri_handler)
 {
-    if (handle == NULL || uri_handler == NULL) {
+    return httpd_register_uri_handler_with_free(handle, uri_handler, NULL);
+}
+
+esp_err_t httpd_register_uri_handler_with_free(httpd_handle_t handle,
+                                               const httpd_uri_t *uri_handler,
+                                               httpd_free_sess_ctx_fn_t free_ctx)
+{
+    if (handle == NULL || uri_handler == NULL || uri_handler->uri == NULL) {
         return ESP_ERR_INVALID_ARG;
     }
 
     struct httpd_data *hd = (struct httpd_data *) handle;
-
-    /* Make sure another handler with same URI and method
-     * is not already registered
-     */
-    if (httpd_find_uri_handler(handle, uri_handler->uri,
-                               uri_handler->method) != -1) {
-        ESP_LOGW(TAG, LOG_FMT("handler %s with method %d already registered"),
-                 uri_handler->uri, uri_handler->method);
-        return ESP_ERR_HTTPD_HANDLER_EXISTS;
+    struct httpd_uri_router *router = httpd_uri_get_router(hd);
+    if (router == NULL) {
+        return ESP_ERR_HTTPD_ALLOC_MEM;
     }
 
+    int slot = -1;
     for (int i = 0; i < hd->config.max_uri_handlers; i++) {
         if (hd->hd_calls[i] == NULL) {
-            hd->hd_calls[i] = malloc(sizeof(httpd_uri_t));
-            if (hd->hd_calls[i] == NULL) {
-                /* Failed to allocate memory */
-                return ESP_ERR_HTTPD_ALLOC_MEM;
-            }
+            slot = i;
+            break;
+        }
+    }
 
-            /* Copy URI string */
-            hd->hd_calls[i]->uri = strdup(uri_handler->uri);
-            if (hd->hd_calls[i]->uri == NULL) {
-                /* Failed to allocate memory */
-                free(hd->hd_calls[i]);
-                return ESP_ERR_HTTPD_ALLOC_MEM;
+    bool prefix;
+    struct httpd_uri_node *node = httpd_uri_walk(router, uri_handler->uri, slot != -1, &prefix);
+    if (node != NULL) {
+        /* Make sure another handler with same URI and method
+         * is not already registered
+         */
+        for (struct httpd_uri_entry *e = *httpd_uri_list(node, prefix); e != NULL; e = e->next) {
+            if (e->uri.method == uri_handler->method) {
+                ESP_LOGW(TAG, LOG_FMT("handler %s with method %d already registered"),
+                         uri_handler->uri, uri_handler->method);
+                return ESP_ERR_HTTPD_HANDLER_EXISTS;
             }
-
-            /* Copy remaining members */
-            hd->hd_calls[i]->method   = uri_handler->method;
-            hd->hd_calls[i]->handler  = uri_handler->handler;
-            hd->hd_calls[i]->user_ctx = uri_handler->user_ctx;
-            ESP_LOGD(TAG, LOG_FMT("[%d] installed %s"), i, uri_handler->uri);
-            return ESP_OK;
         }
-        ESP_LOGD(TAG, LOG_FMT("[%d] exists %s"), i, hd->hd_calls[i]->uri);
     }
-    ESP_LOGW(TAG, LOG_FMT("no slots left for registering handler"));
-    return ESP_ERR_HTTPD_HANDLERS_FULL;
+    if (slot == -1) {
+        ESP_LOGW(TAG, LOG_FMT("no slots left for registering handler"));
+        return ESP_ERR_HTTPD_HANDLERS_FULL;
+    }
+
+    struct httpd_uri_entry *entry = calloc(1, sizeof(struct httpd_uri_entry));
+    if (entry == NULL || node == NULL) {
+        /* Failed to allocate memory */
+        free(entry);
+        httpd_uri_release_node(router, node);
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
+
+    /* Copy URI string */
+    entry->uri.uri = strdup(uri_handler->uri);
+    if (entry->uri.uri == NULL) {
+        /* Failed to allocate memory */
+        free(entry);
+        httpd_uri_release_node(router, node);
+        return ESP_ERR_HTTPD_ALLOC_MEM;
+    }
+
+    /* Copy remaining members */
+    entry->uri.method   = uri_handler->method;
+    entry->uri.handler  = uri_handler->handler;
+    entry->uri.user_ctx = uri_handler->user_ctx;
+    entry->free_ctx     = free_ctx;
+
+    /* Add to the handlers of the node */
+    entry->node   = node;
+    entry->prefix = prefix;
+    struct httpd_uri_entry **list = httpd_uri_list(node, prefix);
+    entry->next = *list;
+    *list = entry;
+
+    hd->hd_calls[slot] = &entry->uri;
+    ESP_LOGD(TAG, LOG_FMT("[%d] installed %s"), slot, uri_handler->uri);
+    return ESP_OK;
 }
 
 esp_err_t httpd_unregister_uri_handler(httpd_handle_t handle,
@@ -95,15 +358,18 @@ esp_err_t httpd_unregister_uri_handler(httpd_handle_t handle,
     }
 
     struct httpd_data *hd = (struct httpd_data *) handle;
-    int i = httpd_find_uri_handler(hd, uri, method);
+    bool prefix;
+    struct httpd_uri_node *node = hd->hd_router ? httpd_uri_walk(hd->hd_router, uri, false, &prefix) : NULL;
 
-    if (i != -1) {
-        ESP_LOGD(TAG, LOG_FMT("[%d] removing %s"), i, hd->hd_calls[i]->uri);
-
-        free((char*)hd->hd_calls[i]->uri);
-        free(hd->hd_calls[i]);
-        hd->hd_calls[i] = NULL;
-        return ESP_OK;
+    if (node != NULL) {
+        /* The URIs of the handlers of a node only differ in the names
+         * of their "{name}" segments, which match regardless of the name */
+        for (struct httpd_uri_entry *e = *httpd_uri_list(node, prefix); e != NULL; e = e->next) {
+            if (e->uri.method == method) {
+                httpd_uri_remove_entry(hd, e);
+                return ESP_OK;
+            }
+        }
     }
     ESP_LOGW(TAG, LOG_FMT("handler %s with method %d not found"), uri, method);
     return ESP_ERR_NOT_FOUND;
@@ -117,16 +383,19 @@ esp_err_t httpd_unregister_uri(httpd_handle_t handle, const char *uri)
 
     struct httpd_data *hd = (struct httpd_data *) handle;
     bool found = false;
+    bool prefix;
+    struct httpd_uri_node *node = hd->hd_router ? httpd_uri_walk(hd->hd_router, uri, false, &prefix) : NULL;
 
-    for (int i = 0; i < hd->config.max_uri_handlers; i++) {
-        if ((hd->hd_calls[i] != NULL) &&
-            (strcmp(hd->hd_calls[i]->uri, uri) == 0)) {
-            ESP_LOGD(TAG, LOG_FMT("[%d] removing %s"), i, uri);
-
-            free((char*)hd->hd_calls[i]->uri);
-            free(hd->hd_calls[i]);
-            hd->hd_calls[i] = NULL;
+    if (node != NULL) {
+        /* All the handlers of the node match, as in httpd_unregister_uri_handler() */
+        struct httpd_uri_entry *e = *httpd_uri_list(node, prefix);
+        while (e != NULL) {
+            /* Removing the last handler also frees the node,
+             * so the next entry is to be read beforehand */
+            struct httpd_uri_entry *next = e->next;
+            httpd_uri_remove_entry(hd, e);
             found = true;
+            e = next;
         }
     }
     if (!found) {
@@ -139,51 +408,102 @@ void httpd_unregister_all_uri_handlers(struct httpd_data *hd)
 {
     for (unsigned i = 0; i < hd->config.max_uri_handlers; i++) {
         if (hd->hd_calls[i]) {
-            ESP_LOGD(TAG, LOG_FMT("[%d] removing %s"), i, hd->hd_calls[i]->uri);
+            httpd_uri_remove_entry(hd, (struct httpd_uri_entry *)hd->hd_calls[i]);
+        }
+    }
+    if (hd->hd_router) {
+        free(hd->hd_router->roots[0]);
+        free(hd->hd_router->roots[1]);
+        free(hd->hd_router);
+        hd->hd_router = NULL;
+    }
+}
 
-            free((char*)hd->hd_calls[i]->uri);
-            free(hd->hd_calls[i]);
+/* Returns the handler for 'method' in 'list'. 'uri_found' is set if
+ * the list has handlers, as the request is then to be responded with
+ * 405 Method Not Allowed instead of 404 Not Found if nothing matches */
+static struct httpd_uri_entry *httpd_uri_find_method(struct httpd_uri_entry *list,
+                                                     httpd_method_t method, bool *uri_found)
+{
+    for (; list != NULL; list = list->next) {
+        *uri_found = true;
+        if (list->uri.method == method) {
+            return list;
         }
     }
+    return NULL;
 }
 
-/* Alternate implmentation of httpd_find_uri_handler()
- * which takes a uri_len field. This is useful when the URI
- * string contains extra parameters that are not to be included
- * while matching with the registered URI_handler strings
+/* Finds the handler for the request path remaining after 'node' */
+static struct httpd_uri_entry *httpd_uri_match(struct httpd_uri_router *router,
+                                               struct httpd_uri_node *node,
+                                               const char *path, size_t path_len,
+                                               httpd_method_t method, bool *uri_found)
+{
+    size_t seg_len = httpd_uri_seg_len(path, path_len);
+    struct httpd_uri_node *next[2] = {
+        httpd_uri_find_child(router, node, path, seg_len),
+        seg_len ? node->param : NULL
+    };
+
+    /* Literal segment first, then "{name}" */
+    for (int i = 0; i < 2; i++) {
+        if (next[i] == NULL) {
+            continue;
+        }
+        struct httpd_uri_entry *entry;
+        if (seg_len == path_len) {
+            /* "*" also matches an empty remaining path */
+            entry = httpd_uri_find_method(next[i]->exact, method, uri_found);
+            if (entry == NULL) {
+                entry = httpd_uri_find_method(next[i]->prefix, method, uri_found);
+            }
+        } else {
+            entry = httpd_uri_match(router, next[i], path + seg_len + 1,
+                                    path_len - seg_len - 1, method, uri_found);
+        }
+        if (entry != NULL) {
+            return entry;
+        }
+    }
+
+    /* Then "*", which matches the rest of the path */
+    return httpd_uri_find_method(node->prefix, method, uri_found);
+}
+
+/* Finds the handler for a request path. Replaces the linear search
+ * of the registered URI handlers, the path is matched one segment
+ * at a time. Extra parameters (e.g. query) are not included in
+ * uri_len and so are not matched.
  */
 static httpd_uri_t* httpd_find_uri_handler2(httpd_err_resp_t *err,
                                             struct httpd_data *hd,
                                             const char *uri, size_t uri_len,
                                             httpd_method_t method)
 {
-    *err = 0;
-    for (int i = 0; i < hd->config.max_uri_handlers; i++) {
-        if (hd->hd_calls[i]) {
-            ESP_LOGD(TAG, LOG_FMT("[%d] = %s"), i, hd->hd_calls[i]->uri);
-            if ((strlen(hd->hd_calls[i]->uri) == uri_len) &&            // First match uri length
-                (strncmp(hd->hd_calls[i]->uri, uri, uri_len) == 0))  {  // Then match uri strings
-                if (hd->hd_calls[i]->method == method)  {               // Finally match methods
-                    return hd->hd_calls[i];
-                }
-                /* URI found but method not allowed.
-                 * If URI IS found later then this
-                 * error is to be neglected */
-                *err = HTTPD_405_METHOD_NOT_ALLOWED;
-            }
+    struct httpd_uri_entry *entry = NULL;
+    bool uri_found = false;
+
+    if (hd->hd_router) {
+        struct httpd_uri_node *root = *httpd_uri_root(hd->hd_router, &uri, &uri_len);
+        if (root) {
+            entry = httpd_uri_match(hd->hd_router, root, uri, uri_len, method, &uri_found);
         }
     }
-    if (*err == 0) {
-        *err = HTTPD_404_NOT_FOUND;
+    if (entry == NULL) {
+        /* URI found but method not allowed */
+        *err = uri_found ? HTTPD_405_METHOD_NOT_ALLOWED : HTTPD_404_NOT_FOUND;
+        return NULL;
     }
-    return NULL;
+    *err = 0;
+    return &entry->uri;
 }
 
-esp_err_t httpd_uri(struct httpd_data *hd)
+esp_err_t httpd_uri(struct httpd_data *hd, httpd_req_t *req)
 {
     httpd_uri_t            *uri = NULL;
-    httpd_req_t            *req = &hd->hd_req;
-    struct http_parser_url *res = &hd->hd_req_aux.url_parse_res;
+    struct httpd_req_aux   *ra  = req->aux;
+    struct http_parser_url *res = &ra->url_parse_res;
 
     /* For conveying URI not found/method not allowed */
     httpd_err_resp_t err = 0;
@@ -212,11 +532,73 @@ esp_err_t httpd_uri(struct httpd_data *hd)
     /* Attach user context data (passed during URI registration) into request */
     req->user_ctx = uri->user_ctx;
 
+    /* Keep the matched URI, for retrieving the values of "{name}" segments */
+    ra->uri_tmpl = uri->uri;
+
+    /* Handler is invoked by the server task, or a worker */
+    ra->handler = uri->handler;
+    return ESP_OK;
+}
+
+esp_err_t httpd_uri_call_handler(httpd_req_t *req)
+{
+    struct httpd_req_aux *ra = req->aux;
+    if (ra->handler == NULL) {
+        /* Already responded with an error */
+        return ESP_OK;
+    }
+
     /* Invoke handler */
-    if (uri->handler(req) != ESP_OK) {
+    if (ra->handler(req) != ESP_OK) {
         /* Handler returns error, this socket should be closed */
         ESP_LOGW(TAG, LOG_FMT("uri handler execution failed"));
         return ESP_FAIL;
     }
     return ESP_OK;
 }
+
+esp_err_t httpd_req_get_uri_param(httpd_req_t *r, const char *name, char *val, size_t val_size)
+{
+    if (r == NULL || name == NULL || val == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (!httpd_valid_req(r)) {
+        return ESP_ERR_HTTPD_INVALID_REQ;
+    }
+
+    struct httpd_req_aux   *ra   = r->aux;
+    struct http_parser_url *res  = &ra->url_parse_res;
+    const char             *tmpl = ra->uri_tmpl;
+    if (tmpl == NULL || !(res->field_set & (1 << UF_PATH))) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    /* The request path was matched against the URI, walk both one segment at a time */
+    const char *path     = r->uri + res->field_data[UF_PATH].off;
+    size_t      path_len = res->field_data[UF_PATH].len;
+    size_t      tmpl_len = strlen(tmpl);
+    size_t      name_len = strlen(name);
+    while (tmpl_len > 0 && path_len > 0) {
+        size_t tmpl_seg = httpd_uri_seg_len(tmpl, tmpl_len);
+        size_t path_seg = httpd_uri_seg_len(path, path_len);
+        if (httpd_uri_seg_is_param(tmpl, tmpl_seg) && tmpl_seg == name_len + 2 &&
+            strncmp(tmpl + 1, name, name_len) == 0) {
+            size_t len = MIN(path_seg, val_size - 1);
+            if (val_size == 0) {
+                return ESP_ERR_HTTPD_RESULT_TRUNC;
+            }
+            memcpy(val, path, len);
+            val[len] = '\0';
+            return (len < path_seg) ? ESP_ERR_HTTPD_RESULT_TRUNC : ESP_OK;
+        }
+        if (tmpl_seg == tmpl_len || path_seg == path_len) {
+            break;
+        }
+        tmpl     += tmpl_seg + 1;
+        tmpl_len -= tmpl_seg + 1;
+        path     += path_seg + 1;
+        path_len -= path_seg + 1;
+    }
+    return ESP_ERR_NOT_FOUND;
+}
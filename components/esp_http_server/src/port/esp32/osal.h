@@ -62,6 +62,17 @@ static inline othread_t httpd_os_thread_handle()
     return xTaskGetCurrentTaskHandle();
 }
 
+static inline void httpd_os_thread_notify(othread_t thread)
+{
+    xTaskNotifyGive(thread);
+}
+
+/* Blocks until the calling thread is notified */
+static inline void httpd_os_thread_wait()
+{
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+}
+
 #ifdef __cplusplus
 }
 #endif
@@ -14,7 +14,16 @@
 
 #include <stdlib.h>
 #include <stdbool.h>
+#include <stdio.h>
+#include <strings.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
 #include <esp_system.h>
+#include <esp_spiffs.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
 #include <esp_http_server.h>
 
 #include "unity.h"
@@ -93,6 +102,188 @@ void test_handler_limit(httpd_handle_t hd)
 
 /********************* Test Handler Limit End *******************/
 
+/********************* Test Client *******************/
+
+static int test_client_connect(uint16_t port)
+{
+    int sock = socket(AF_INET, SOCK_STREAM, 0);
+    TEST_ASSERT(sock >= 0);
+    struct sockaddr_in addr = {
+        .sin_family      = AF_INET,
+        .sin_port        = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    TEST_ASSERT(connect(sock, (struct sockaddr *)&addr, sizeof(addr)) == 0);
+    /* Responses are received until the server stays silent for this long */
+    struct timeval tv = { .tv_sec = 0, .tv_usec = 500 * 1000 };
+    setsockopt(sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    return sock;
+}
+
+static void test_client_send(int sock, const char *req)
+{
+    TEST_ASSERT_EQUAL(strlen(req), send(sock, req, strlen(req), 0));
+}
+
+/* Receives into 'buf' until the server closes the connection or stops sending,
+ * returns the number of bytes received. 'buf' is null terminated */
+static int test_client_recv(int sock, char *buf, size_t size)
+{
+    int total = 0;
+    int len;
+    while (total < size - 1 && (len = recv(sock, buf + total, size - 1 - total, 0)) > 0) {
+        total += len;
+    }
+    buf[total] = '\0';
+    return total;
+}
+
+/* Sends 'req' on a new connection, and receives the response into 'resp' */
+static int test_client_request(uint16_t port, const char *req, char *resp, size_t resp_size)
+{
+    int sock = test_client_connect(port);
+    test_client_send(sock, req);
+    int len = test_client_recv(sock, resp, resp_size);
+    close(sock);
+    return len;
+}
+
+static int test_resp_status(const char *resp)
+{
+    TEST_ASSERT(strncmp(resp, "HTTP/1.1 ", 9) == 0);
+    return atoi(resp + 9);
+}
+
+/* Returns the value of header 'field' of the response, NULL if not present */
+static const char *test_resp_hdr(const char *resp, const char *field, char *val, size_t val_size)
+{
+    const char *end = strstr(resp, "\r\n\r\n");
+    size_t field_len = strlen(field);
+    for (const char *line = strstr(resp, "\r\n"); line && line < end; line = strstr(line + 2, "\r\n")) {
+        if (strncasecmp(line + 2, field, field_len) == 0 && line[2 + field_len] == ':') {
+            const char *v = line + 2 + field_len + 1;
+            v += strspn(v, " ");
+            snprintf(val, val_size, "%.*s", (int)(strstr(v, "\r\n") - v), v);
+            return val;
+        }
+    }
+    return NULL;
+}
+
+static const char *test_resp_body(const char *resp)
+{
+    const char *end = strstr(resp, "\r\n\r\n");
+    TEST_ASSERT_NOT_NULL(end);
+    return end + 4;
+}
+
+/********************* Test Client End *******************/
+
+/* Responds with the name of the route, and the result of
+ * httpd_req_get_uri_param() for "id" into a 4 byte buffer */
+static esp_err_t route_handler(httpd_req_t *req)
+{
+    char id[4] = "";
+    char resp[32];
+    esp_err_t ret = httpd_req_get_uri_param(req, "id", id, sizeof(id));
+    snprintf(resp, sizeof(resp), "%s %s %s", (const char *)req->user_ctx,
+             ret == ESP_OK ? "ok" : ret == ESP_ERR_HTTPD_RESULT_TRUNC ? "trunc" :
+             ret == ESP_ERR_NOT_FOUND ? "none" : "err", id);
+    return httpd_resp_send(req, resp, strlen(resp));
+}
+
+static httpd_uri_t route_uri(char *path, httpd_method_t method, char *name)
+{
+    httpd_uri_t uri = handler_limit_uri(path);
+    uri.method   = method;
+    uri.handler  = route_handler;
+    uri.user_ctx = name;
+    return uri;
+}
+
+/* Requests 'path' with 'method', checks the status and, for 200, the body */
+static void test_route(uint16_t port, const char *method, const char *path,
+                       int status, const char *body)
+{
+    char req[128];
+    char resp[512];
+    snprintf(req, sizeof(req), "%s %s HTTP/1.1\r\nHost: localhost\r\nContent-Length: 0\r\n\r\n", method, path);
+    test_client_request(port, req, resp, sizeof(resp));
+    TEST_ASSERT_EQUAL(status, test_resp_status(resp));
+    if (body) {
+        TEST_ASSERT_EQUAL_STRING(body, test_resp_body(resp));
+    }
+}
+
+void test_uri_templates(httpd_handle_t hd, uint16_t port)
+{
+    httpd_uri_t user     = handler_limit_uri("/users/{id}");
+    httpd_uri_t user_dup = handler_limit_uri("/users/{name}");
+    httpd_uri_t me       = handler_limit_uri("/users/me");
+    httpd_uri_t files    = handler_limit_uri("/files/*");
+
+    TEST_ASSERT(httpd_register_uri_handler(hd, &user) == ESP_OK);
+    TEST_ASSERT(httpd_register_uri_handler(hd, &me) == ESP_OK);
+    TEST_ASSERT(httpd_register_uri_handler(hd, &files) == ESP_OK);
+
+    /* Parameter segments match regardless of their name */
+    TEST_ASSERT(httpd_register_uri_handler(hd, &user_dup) == ESP_ERR_HTTPD_HANDLER_EXISTS);
+    TEST_ASSERT(httpd_register_uri_handler(hd, &files) == ESP_ERR_HTTPD_HANDLER_EXISTS);
+
+    /* Names of parameter segments don't matter either to unregister, but "/files"
+     * is another URI than the one ending with "*" */
+    TEST_ASSERT(httpd_unregister_uri(hd, "/files") == ESP_ERR_NOT_FOUND);
+    TEST_ASSERT(httpd_unregister_uri_handler(hd, user_dup.uri, HTTP_POST) == ESP_ERR_NOT_FOUND);
+    TEST_ASSERT(httpd_unregister_uri_handler(hd, user_dup.uri, user_dup.method) == ESP_OK);
+    TEST_ASSERT(httpd_unregister_uri_handler(hd, user.uri, user.method) == ESP_ERR_NOT_FOUND);
+    TEST_ASSERT(httpd_unregister_uri(hd, files.uri) == ESP_OK);
+    TEST_ASSERT(httpd_unregister_uri(hd, me.uri) == ESP_OK);
+    TEST_ASSERT(httpd_register_uri_handler(hd, &user_dup) == ESP_OK);
+    TEST_ASSERT(httpd_unregister_uri(hd, "/users/{other}") == ESP_OK);
+    TEST_ASSERT(httpd_unregister_uri(hd, user.uri) == ESP_ERR_NOT_FOUND);
+
+    httpd_uri_t routes[] = {
+        route_uri("/users/{id}",        HTTP_GET, "user"),
+        route_uri("/users/me",          HTTP_GET, "me"),
+        route_uri("/users/{id}/posts",  HTTP_GET, "posts"),
+        route_uri("/users/me/settings", HTTP_GET, "settings"),
+        route_uri("/files/*",           HTTP_GET, "files"),
+    };
+    for (int i = 0; i < sizeof(routes) / sizeof(routes[0]); i++) {
+        TEST_ASSERT(httpd_register_uri_handler(hd, &routes[i]) == ESP_OK);
+    }
+
+    /* Literal segments are matched before "{name}" */
+    test_route(port, "GET", "/users/me", 200, "me none ");
+    test_route(port, "GET", "/users/42", 200, "user ok 42");
+    test_route(port, "GET", "/users/me/settings", 200, "settings none ");
+
+    /* "/users/me" has no "posts", so "{id}" is tried after it */
+    test_route(port, "GET", "/users/me/posts", 200, "posts ok me");
+    test_route(port, "GET", "/users/42/posts?x=1", 200, "posts ok 42");
+
+    /* Values not fitting in the buffer are truncated */
+    test_route(port, "GET", "/users/12345", 200, "user trunc 123");
+    test_route(port, "GET", "/users/12345/posts", 200, "posts trunc 123");
+
+    /* "*" matches the rest of the path, including none */
+    test_route(port, "GET", "/files/a/b/c.txt", 200, "files none ");
+    test_route(port, "GET", "/files/", 200, "files none ");
+    test_route(port, "GET", "/files", 200, "files none ");
+
+    /* 405 if a handler matches the path but not the method, 404 otherwise */
+    test_route(port, "POST", "/users/me", 405, NULL);
+    test_route(port, "POST", "/files/a", 405, NULL);
+    test_route(port, "GET", "/users", 404, NULL);
+    test_route(port, "GET", "/users/42/comments", 404, NULL);
+    test_route(port, "GET", "/user/42", 404, NULL);
+
+    for (int i = 0; i < sizeof(routes) / sizeof(routes[0]); i++) {
+        TEST_ASSERT(httpd_unregister_uri_handler(hd, routes[i].uri, routes[i].method) == ESP_OK);
+    }
+    test_route(port, "GET", "/users/me", 404, NULL);
+}
+
 httpd_handle_t test_httpd_start(uint16_t id)
 {
     httpd_handle_t hd;
@@ -156,6 +347,149 @@ TEST_CASE("Leak Test", "[HTTP SERVER]")
     TEST_ASSERT(res == true);
 }
 
+/********************* Worker Tasks *******************/
+
+static volatile int worker_hold_count;
+static volatile bool worker_release;
+
+/* Waits for up to a second for 'var' to reach 'value' */
+static bool test_wait_for(volatile int *var, int value)
+{
+    for (int i = 0; i < 100 && *var != value; i++) {
+        vTaskDelay(10 / portTICK_PERIOD_MS);
+    }
+    return *var == value;
+}
+
+/* Responds whether the handler runs in a worker, and the request is valid there */
+static esp_err_t worker_where_handler(httpd_req_t *req)
+{
+    bool in_worker = strcmp(pcTaskGetTaskName(NULL), "httpd_worker") == 0;
+    if (httpd_req_get_hdr_value_len(req, "Host") == 0) {
+        return httpd_resp_send_500(req);
+    }
+    const char *where = in_worker ? "worker" : "server";
+    return httpd_resp_send(req, where, strlen(where));
+}
+
+/* Sleeps for the number of milliseconds given as query, then echoes it */
+static esp_err_t worker_delay_handler(httpd_req_t *req)
+{
+    char query[8] = "";
+    httpd_req_get_url_query_str(req, query, sizeof(query));
+    vTaskDelay(atoi(query) / portTICK_PERIOD_MS);
+    return httpd_resp_send(req, query, strlen(query));
+}
+
+/* Closes its own session, which is busy until the handler returns */
+static esp_err_t worker_close_handler(httpd_req_t *req)
+{
+    if (httpd_trigger_sess_close(req->handle, httpd_req_to_sockfd(req)) != ESP_OK) {
+        return httpd_resp_send_500(req);
+    }
+    /* Let the server process the close */
+    vTaskDelay(50 / portTICK_PERIOD_MS);
+    return httpd_resp_send(req, "closing", 7);
+}
+
+/* Keeps its worker busy until released */
+static esp_err_t worker_hold_handler(httpd_req_t *req)
+{
+    worker_hold_count++;
+    for (int i = 0; i < 500 && !worker_release; i++) {
+        vTaskDelay(10 / portTICK_PERIOD_MS);
+    }
+    return httpd_resp_send(req, "released", 8);
+}
+
+static void test_worker_requests(httpd_handle_t hd, uint16_t port)
+{
+    httpd_uri_t where_uri = handler_limit_uri("/where");
+    httpd_uri_t delay_uri = handler_limit_uri("/delay");
+    httpd_uri_t close_uri = handler_limit_uri("/close");
+    httpd_uri_t hold_uri  = handler_limit_uri("/hold");
+    where_uri.handler = worker_where_handler;
+    delay_uri.handler = worker_delay_handler;
+    close_uri.handler = worker_close_handler;
+    hold_uri.handler  = worker_hold_handler;
+    TEST_ASSERT(httpd_register_uri_handler(hd, &where_uri) == ESP_OK);
+    TEST_ASSERT(httpd_register_uri_handler(hd, &delay_uri) == ESP_OK);
+    TEST_ASSERT(httpd_register_uri_handler(hd, &close_uri) == ESP_OK);
+    TEST_ASSERT(httpd_register_uri_handler(hd, &hold_uri) == ESP_OK);
+
+    char resp[512];
+    const char *get_hold = "GET /hold HTTP/1.1\r\nHost: localhost\r\n\r\n";
+
+    /* Handlers run in a worker, with a valid request */
+    test_client_request(port, "GET /where HTTP/1.1\r\nHost: localhost\r\n\r\n", resp, sizeof(resp));
+    TEST_ASSERT_EQUAL(200, test_resp_status(resp));
+    TEST_ASSERT_EQUAL_STRING("worker", test_resp_body(resp));
+
+    /* Requests of a keep-alive session are handled one after the other,
+     * even if the first one takes longer */
+    test_client_request(port, "GET /delay?200 HTTP/1.1\r\nHost: localhost\r\n\r\n"
+                              "GET /delay?0 HTTP/1.1\r\nHost: localhost\r\n\r\n", resp, sizeof(resp));
+    const char *second = strstr(test_resp_body(resp), "HTTP/1.1 200");
+    TEST_ASSERT_NOT_NULL(second);
+    TEST_ASSERT_EQUAL_STRING_LEN("200", test_resp_body(resp), 3);
+    TEST_ASSERT_EQUAL_STRING("0", test_resp_body(second));
+
+    /* Closing a busy session waits for its handler to respond */
+    int sock = test_client_connect(port);
+    test_client_send(sock, "GET /close HTTP/1.1\r\nHost: localhost\r\n\r\n");
+    test_client_recv(sock, resp, sizeof(resp));
+    TEST_ASSERT_EQUAL_STRING("closing", test_resp_body(resp));
+    TEST_ASSERT_EQUAL(0, recv(sock, resp, sizeof(resp), 0));
+    close(sock);
+
+    /* With every session busy, the least recently used one isn't closed,
+     * and new connections are refused */
+    worker_hold_count = 0;
+    worker_release = false;
+    int busy[2];
+    for (int i = 0; i < 2; i++) {
+        busy[i] = test_client_connect(port);
+        test_client_send(busy[i], get_hold);
+    }
+    TEST_ASSERT(test_wait_for(&worker_hold_count, 2));
+    sock = test_client_connect(port);
+    TEST_ASSERT_EQUAL(0, recv(sock, resp, sizeof(resp), 0));
+    close(sock);
+    worker_release = true;
+    for (int i = 0; i < 2; i++) {
+        test_client_recv(busy[i], resp, sizeof(resp));
+        TEST_ASSERT_EQUAL_STRING("released", test_resp_body(resp));
+        close(busy[i]);
+    }
+
+    TEST_ASSERT(httpd_unregister_uri(hd, where_uri.uri) == ESP_OK);
+    TEST_ASSERT(httpd_unregister_uri(hd, delay_uri.uri) == ESP_OK);
+    TEST_ASSERT(httpd_unregister_uri(hd, close_uri.uri) == ESP_OK);
+    TEST_ASSERT(httpd_unregister_uri(hd, hold_uri.uri) == ESP_OK);
+}
+
+TEST_CASE("Worker Tasks Test", "[HTTP SERVER]")
+{
+    httpd_handle_t hd;
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    config.worker_tasks = 2;
+    config.max_open_sockets = 2;
+    config.lru_purge_enable = true;
+
+    test_case_uses_tcpip();
+
+    unsigned task_count = uxTaskGetNumberOfTasks();
+    TEST_ASSERT(httpd_start(&hd, &config) == ESP_OK);
+    vTaskDelay(10);
+    /* Server task and its workers */
+    TEST_ASSERT_EQUAL(task_count + 1 + config.worker_tasks, uxTaskGetNumberOfTasks());
+    test_handler_limit(hd);
+    test_worker_requests(hd, config.server_port);
+    TEST_ASSERT(httpd_stop(hd) == ESP_OK);
+    vTaskDelay(10);
+    TEST_ASSERT_EQUAL(task_count, uxTaskGetNumberOfTasks());
+}
+
 TEST_CASE("Basic Functionality Tests", "[HTTP SERVER]")
 {
     httpd_handle_t hd;
@@ -165,5 +499,253 @@ TEST_CASE("Basic Functionality Tests", "[HTTP SERVER]")
 
     TEST_ASSERT(httpd_start(&hd, &config) == ESP_OK);
     test_handler_limit(hd);
+    test_uri_templates(hd, config.server_port);
+    TEST_ASSERT(httpd_stop(hd) == ESP_OK);
+}
+
+/********************* Response Output *******************/
+
+#define RESP_BIG_SIZE       1500
+#define RESP_LONG_HDRS      6
+#define RESP_LONG_HDR_LEN   100
+
+static char resp_long_hdr[RESP_LONG_HDR_LEN + 1];
+
+static void resp_fill(char *buf, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        buf[i] = 'a' + i % 26;
+    }
+}
+
+/* Status, type, additional headers and a body fitting in one send */
+static esp_err_t resp_small_handler(httpd_req_t *req)
+{
+    httpd_resp_set_status(req, "201 Created");
+    httpd_resp_set_type(req, HTTPD_TYPE_JSON);
+    httpd_resp_set_hdr(req, "X-A", "1");
+    httpd_resp_set_hdr(req, "X-B", "two");
+    return httpd_resp_send(req, "{\"ok\":true}", 11);
+}
+
+/* Headers and a body which don't fit in the scratch buffer */
+static esp_err_t resp_big_handler(httpd_req_t *req)
+{
+    static char body[RESP_BIG_SIZE];
+    resp_fill(body, sizeof(body));
+    for (int i = 0; i < RESP_LONG_HDRS; i++) {
+        static const char *fields[RESP_LONG_HDRS] = { "X-0", "X-1", "X-2", "X-3", "X-4", "X-5" };
+        httpd_resp_set_hdr(req, fields[i], resp_long_hdr);
+    }
+    return httpd_resp_send(req, body, sizeof(body));
+}
+
+static esp_err_t resp_chunked_handler(httpd_req_t *req)
+{
+    static char big[RESP_BIG_SIZE];
+    resp_fill(big, sizeof(big));
+    httpd_resp_set_type(req, HTTPD_TYPE_TEXT);
+    httpd_resp_set_hdr(req, "X-A", "1");
+    if (httpd_resp_send_chunk(req, "abc", 3) != ESP_OK ||
+        httpd_resp_send_chunk(req, big, sizeof(big)) != ESP_OK ||
+        httpd_resp_send_chunk(req, "de", 2) != ESP_OK) {
+        return ESP_FAIL;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+
+static void test_resp_output(uint16_t port, const char *uri, const char *expected, size_t expected_len)
+{
+    char req[64];
+    char resp[4096];
+    snprintf(req, sizeof(req), "GET %s HTTP/1.1\r\nHost: localhost\r\n\r\n", uri);
+    int len = test_client_request(port, req, resp, sizeof(resp));
+    TEST_ASSERT_EQUAL(expected_len, len);
+    TEST_ASSERT_EQUAL_MEMORY(expected, resp, expected_len);
+}
+
+/* The response is checked byte for byte, regardless of how it is split into sends */
+TEST_CASE("Response Output Test", "[HTTP SERVER]")
+{
+    httpd_handle_t hd;
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    httpd_uri_t small_uri   = handler_limit_uri("/small");
+    httpd_uri_t big_uri     = handler_limit_uri("/big");
+    httpd_uri_t chunked_uri = handler_limit_uri("/chunked");
+    small_uri.handler   = resp_small_handler;
+    big_uri.handler     = resp_big_handler;
+    chunked_uri.handler = resp_chunked_handler;
+
+    test_case_uses_tcpip();
+
+    TEST_ASSERT(httpd_start(&hd, &config) == ESP_OK);
+    TEST_ASSERT(httpd_register_uri_handler(hd, &small_uri) == ESP_OK);
+    TEST_ASSERT(httpd_register_uri_handler(hd, &big_uri) == ESP_OK);
+    TEST_ASSERT(httpd_register_uri_handler(hd, &chunked_uri) == ESP_OK);
+
+    const char *small = "HTTP/1.1 201 Created\r\n"
+                        "Content-Type: application/json\r\n"
+                        "Content-Length: 11\r\n"
+                        "X-A: 1\r\n"
+                        "X-B: two\r\n"
+                        "\r\n"
+                        "{\"ok\":true}";
+    test_resp_output(config.server_port, "/small", small, strlen(small));
+
+    char *expected = malloc(4096);
+    TEST_ASSERT_NOT_NULL(expected);
+    resp_fill(resp_long_hdr, RESP_LONG_HDR_LEN);
+    resp_long_hdr[RESP_LONG_HDR_LEN] = '\0';
+    int len = sprintf(expected, "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\nContent-Length: %d\r\n", RESP_BIG_SIZE);
+    for (int i = 0; i < RESP_LONG_HDRS; i++) {
+        len += sprintf(expected + len, "X-%d: %s\r\n", i, resp_long_hdr);
+    }
+    len += sprintf(expected + len, "\r\n");
+    resp_fill(expected + len, RESP_BIG_SIZE);
+    len += RESP_BIG_SIZE;
+    test_resp_output(config.server_port, "/big", expected, len);
+
+    len = sprintf(expected, "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\nTransfer-Encoding: chunked\r\nX-A: 1\r\n\r\n"
+                            "3\r\nabc\r\n%x\r\n", RESP_BIG_SIZE);
+    resp_fill(expected + len, RESP_BIG_SIZE);
+    len += RESP_BIG_SIZE;
+    len += sprintf(expected + len, "\r\n2\r\nde\r\n0\r\n\r\n");
+    test_resp_output(config.server_port, "/chunked", expected, len);
+    free(expected);
+
+    TEST_ASSERT(httpd_stop(hd) == ESP_OK);
+}
+
+/********************* Static Files *******************/
+
+#define STATIC_BASE_PATH    "/spiffs"
+#define STATIC_BIG_SIZE     3000
+
+static void static_write_file(const char *name, const void *data, size_t len)
+{
+    char path[64];
+    snprintf(path, sizeof(path), STATIC_BASE_PATH "%s", name);
+    FILE *f = fopen(path, "wb");
+    TEST_ASSERT_NOT_NULL(f);
+    TEST_ASSERT_EQUAL(len, fwrite(data, 1, len, f));
+    fclose(f);
+}
+
+static void static_create_files(void)
+{
+    static_write_file("/index.html", "<p>index</p>", 12);
+    static_write_file("/sub/index.html", "<p>sub</p>", 10);
+    static_write_file("/css/app.css", "p{}", 3);
+    static_write_file("/css/app.css.gz", "GZ-css", 6);
+    static_write_file("/js/only.js.gz", "GZ-js", 5);
+
+    char *big = malloc(STATIC_BIG_SIZE);
+    TEST_ASSERT_NOT_NULL(big);
+    for (int i = 0; i < STATIC_BIG_SIZE; i++) {
+        big[i] = 'a' + i % 26;
+    }
+    static_write_file("/big.bin", big, STATIC_BIG_SIZE);
+    free(big);
+}
+
+/* Requests 'uri' with the extra request headers 'hdrs', returns the status code */
+static int static_get(uint16_t port, const char *uri, const char *hdrs, char *resp, size_t resp_size)
+{
+    char req[256];
+    snprintf(req, sizeof(req), "GET %s HTTP/1.1\r\nHost: localhost\r\n%s\r\n", uri, hdrs);
+    test_client_request(port, req, resp, resp_size);
+    return test_resp_status(resp);
+}
+
+TEST_CASE("Static Files Test", "[HTTP SERVER]")
+{
+    esp_vfs_spiffs_conf_t spiffs_conf = {
+        .base_path = STATIC_BASE_PATH,
+        .partition_label = "flash_test",
+        .max_files = 5,
+        .format_if_mount_failed = true
+    };
+    httpd_static_config_t static_conf = {
+        .uri_prefix    = "/static/",
+        .base_path     = STATIC_BASE_PATH,
+        .index_file    = "index.html",
+        .cache_control = "max-age=60",
+        .read_buf_size = 512,
+    };
+    httpd_handle_t hd;
+    httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+    const size_t resp_size = 4096;
+    char *resp = malloc(resp_size);
+    char val[64];
+    char etag[32];
+
+    test_case_uses_tcpip();
+    TEST_ASSERT_NOT_NULL(resp);
+    TEST_ASSERT(esp_vfs_spiffs_register(&spiffs_conf) == ESP_OK);
+    static_create_files();
+    TEST_ASSERT(httpd_start(&hd, &config) == ESP_OK);
+    TEST_ASSERT(httpd_register_static_handler(hd, &static_conf) == ESP_OK);
+
+    /* URIs ending with '/' map to the index file of the directory */
+    TEST_ASSERT_EQUAL(200, static_get(config.server_port, "/static/", "", resp, resp_size));
+    TEST_ASSERT_EQUAL_STRING("<p>index</p>", test_resp_body(resp));
+    TEST_ASSERT_EQUAL_STRING("text/html", test_resp_hdr(resp, "Content-Type", val, sizeof(val)));
+    TEST_ASSERT_EQUAL_STRING("max-age=60", test_resp_hdr(resp, "Cache-Control", val, sizeof(val)));
+    TEST_ASSERT_EQUAL(200, static_get(config.server_port, "/static/sub/", "", resp, resp_size));
+    TEST_ASSERT_EQUAL_STRING("<p>sub</p>", test_resp_body(resp));
+
+    /* The ".gz" sibling is sent only to clients accepting gzip */
+    TEST_ASSERT_EQUAL(200, static_get(config.server_port, "/static/css/app.css", "", resp, resp_size));
+    TEST_ASSERT_EQUAL_STRING("p{}", test_resp_body(resp));
+    TEST_ASSERT_EQUAL_STRING("text/css", test_resp_hdr(resp, "Content-Type", val, sizeof(val)));
+    TEST_ASSERT_EQUAL_STRING("Accept-Encoding", test_resp_hdr(resp, "Vary", val, sizeof(val)));
+    TEST_ASSERT_NULL(test_resp_hdr(resp, "Content-Encoding", val, sizeof(val)));
+    TEST_ASSERT_NOT_NULL(test_resp_hdr(resp, "ETag", etag, sizeof(etag)));
+    TEST_ASSERT_EQUAL(200, static_get(config.server_port, "/static/css/app.css",
+                                      "Accept-Encoding: deflate, gzip\r\n", resp, resp_size));
+    TEST_ASSERT_EQUAL_STRING("GZ-css", test_resp_body(resp));
+    TEST_ASSERT_EQUAL_STRING("text/css", test_resp_hdr(resp, "Content-Type", val, sizeof(val)));
+    TEST_ASSERT_EQUAL_STRING("gzip", test_resp_hdr(resp, "Content-Encoding", val, sizeof(val)));
+    TEST_ASSERT_NOT_EQUAL(0, strcmp(etag, test_resp_hdr(resp, "ETag", val, sizeof(val))));
+
+    /* A file present only compressed */
+    TEST_ASSERT_EQUAL(200, static_get(config.server_port, "/static/js/only.js",
+                                      "Accept-Encoding: gzip\r\n", resp, resp_size));
+    TEST_ASSERT_EQUAL_STRING("GZ-js", test_resp_body(resp));
+    TEST_ASSERT_EQUAL_STRING("application/javascript", test_resp_hdr(resp, "Content-Type", val, sizeof(val)));
+    TEST_ASSERT_EQUAL(404, static_get(config.server_port, "/static/js/only.js", "", resp, resp_size));
+
+    /* 304 has the headers of the file and no body */
+    char hdrs[64];
+    snprintf(hdrs, sizeof(hdrs), "If-None-Match: %s\r\n", etag);
+    TEST_ASSERT_EQUAL(304, static_get(config.server_port, "/static/css/app.css", hdrs, resp, resp_size));
+    TEST_ASSERT_EQUAL_STRING("", test_resp_body(resp));
+    TEST_ASSERT_EQUAL_STRING("3", test_resp_hdr(resp, "Content-Length", val, sizeof(val)));
+    TEST_ASSERT_EQUAL_STRING(etag, test_resp_hdr(resp, "ETag", val, sizeof(val)));
+    TEST_ASSERT_EQUAL(304, static_get(config.server_port, "/static/css/app.css",
+                                      "If-None-Match: *\r\n", resp, resp_size));
+    TEST_ASSERT_EQUAL_STRING("", test_resp_body(resp));
+    TEST_ASSERT_EQUAL(200, static_get(config.server_port, "/static/css/app.css",
+                                      "If-None-Match: \"0-00000000\"\r\n", resp, resp_size));
+    TEST_ASSERT_EQUAL_STRING("p{}", test_resp_body(resp));
+
+    /* Unknown files, and directories without index file */
+    TEST_ASSERT_EQUAL(404, static_get(config.server_port, "/static/missing.txt", "", resp, resp_size));
+    TEST_ASSERT_EQUAL(404, static_get(config.server_port, "/static/css/", "", resp, resp_size));
+    TEST_ASSERT_EQUAL(404, static_get(config.server_port, "/big.bin", "", resp, resp_size));
+
+    /* Files larger than read_buf_size are streamed after the headers */
+    TEST_ASSERT_EQUAL(200, static_get(config.server_port, "/static/big.bin", "", resp, resp_size));
+    TEST_ASSERT_EQUAL_STRING("3000", test_resp_hdr(resp, "Content-Length", val, sizeof(val)));
+    TEST_ASSERT_EQUAL_STRING(HTTPD_TYPE_OCTET, test_resp_hdr(resp, "Content-Type", val, sizeof(val)));
+    const char *body = test_resp_body(resp);
+    TEST_ASSERT_EQUAL(STATIC_BIG_SIZE, strlen(body));
+    for (int i = 0; i < STATIC_BIG_SIZE; i++) {
+        TEST_ASSERT_EQUAL('a' + i % 26, body[i]);
+    }
+
+    TEST_ASSERT(httpd_unregister_static_handler(hd, static_conf.uri_prefix) == ESP_OK);
     TEST_ASSERT(httpd_stop(hd) == ESP_OK);
+    TEST_ASSERT(esp_vfs_spiffs_unregister(spiffs_conf.partition_label) == ESP_OK);
+    free(resp);
 }
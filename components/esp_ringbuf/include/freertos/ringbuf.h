@@ -125,6 +125,81 @@ BaseType_t xRingbufferSend(RingbufHandle_t xRingbuffer, const void *pvItem, size
  */
 BaseType_t xRingbufferSendFromISR(RingbufHandle_t xRingbuffer, const void *pvItem, size_t xItemSize, BaseType_t *pxHigherPriorityTaskWoken);
 
+/**
+ * @brief       Acquire memory for an item in the ring buffer
+ *
+ * Attempt to reserve space for an item in a no-split ring buffer, so that the
+ * item can be written in place instead of being copied in. This function will
+ * block until enough free space is available or until it timesout. The item
+ * must be sent with xRingbufferSendComplete() once it has been written.
+ *
+ * @param[in]   xRingbuffer     Ring buffer to acquire memory from
+ * @param[out]  ppvItem         Double pointer to the acquired memory (set to NULL if no memory is acquired)
+ * @param[in]   xItemSize       Size of the item to acquire.
+ * @param[in]   xTicksToWait    Ticks to wait for room in the ring buffer.
+ *
+ * @note    Only applicable to no-split ring buffers.
+ * @note    Several items can be acquired at the same time. Items are made
+ *          available for retrieval in the order they were acquired, i.e. an
+ *          item completed before an item acquired earlier is only retrieved
+ *          once the earlier item has been completed as well.
+ *
+ * @return
+ *      - pdTRUE if succeeded
+ *      - pdFALSE on time-out or when the item is larger than the maximum permissible size of the buffer
+ */
+BaseType_t xRingbufferSendAcquire(RingbufHandle_t xRingbuffer, void **ppvItem, size_t xItemSize, TickType_t xTicksToWait);
+
+/**
+ * @brief       Acquire memory for an item in the ring buffer in an ISR
+ *
+ * Attempt to reserve space for an item in a no-split ring buffer from an ISR.
+ * This function will return immediately if there is insufficient free space in
+ * the buffer.
+ *
+ * @param[in]   xRingbuffer Ring buffer to acquire memory from
+ * @param[out]  ppvItem     Double pointer to the acquired memory (set to NULL if no memory is acquired)
+ * @param[in]   xItemSize   Size of the item to acquire.
+ * @param[out]  pxHigherPriorityTaskWoken   Value pointed to will be set to pdTRUE if the function woke up a higher priority task.
+ *
+ * @note    Only applicable to no-split ring buffers.
+ *
+ * @return
+ *      - pdTRUE if succeeded
+ *      - pdFALSE when the ring buffer does not have space.
+ */
+BaseType_t xRingbufferSendAcquireFromISR(RingbufHandle_t xRingbuffer, void **ppvItem, size_t xItemSize, BaseType_t *pxHigherPriorityTaskWoken);
+
+/**
+ * @brief       Complete an item acquired with xRingbufferSendAcquire()
+ *
+ * Mark an acquired item as written. The item becomes available for retrieval
+ * once all the items acquired before it have been completed.
+ *
+ * @param[in]   xRingbuffer Ring buffer the item was acquired from
+ * @param[in]   pvItem      Pointer to the acquired memory, as returned by xRingbufferSendAcquire()
+ *
+ * @note    Only applicable to no-split ring buffers.
+ *
+ * @return
+ *      - pdTRUE if succeeded
+ */
+BaseType_t xRingbufferSendComplete(RingbufHandle_t xRingbuffer, void *pvItem);
+
+/**
+ * @brief       Complete an item acquired with xRingbufferSendAcquire() in an ISR
+ *
+ * @param[in]   xRingbuffer Ring buffer the item was acquired from
+ * @param[in]   pvItem      Pointer to the acquired memory, as returned by xRingbufferSendAcquire()
+ * @param[out]  pxHigherPriorityTaskWoken   Value pointed to will be set to pdTRUE if the function woke up a higher priority task.
+ *
+ * @note    Only applicable to no-split ring buffers.
+ *
+ * @return
+ *      - pdTRUE if succeeded
+ */
+BaseType_t xRingbufferSendCompleteFromISR(RingbufHandle_t xRingbuffer, void *pvItem, BaseType_t *pxHigherPriorityTaskWoken);
+
 /**
  * @brief   Retrieve an item from the ring buffer
  *
@@ -382,6 +457,115 @@ void vRingbufferGetInfo(RingbufHandle_t xRingbuffer, UBaseType_t *uxFree, UBaseT
  */
 void xRingbufferPrintInfo(RingbufHandle_t xRingbuffer);
 
+/**
+ * Type by which single producer, single consumer ring buffers are referenced.
+ * A call to xRingbufferSpscCreate() returns a RingbufSpscHandle_t variable that
+ * can then be used as a parameter to xRingbufferSpscSend(), xRingbufferSpscReceive(), etc.
+ */
+typedef void * RingbufSpscHandle_t;
+
+/**
+ * @brief       Create a single producer, single consumer ring buffer
+ *
+ * A single producer, single consumer ring buffer stores data as a sequence of
+ * bytes, like a byte buffer. Data is sent and received without any critical
+ * section, as long as only one task or ISR sends data and only one task or ISR
+ * receives data at any time. A consumer blocked in xRingbufferSpscReceive() is
+ * only woken up once xWakeupThreshold bytes are available.
+ *
+ * @param[in]   xBufferSize         Size of the buffer in bytes
+ * @param[in]   xWakeupThreshold    Number of bytes that wake up a blocked consumer (a value of 0 is treated as 1)
+ *
+ * @return  A handle to the created ring buffer, or NULL in case of error.
+ */
+RingbufSpscHandle_t xRingbufferSpscCreate(size_t xBufferSize, size_t xWakeupThreshold);
+
+/**
+ * @brief       Delete a single producer, single consumer ring buffer
+ *
+ * @param[in]   xRingbuffer     Ring buffer to delete
+ */
+void vRingbufferSpscDelete(RingbufSpscHandle_t xRingbuffer);
+
+/**
+ * @brief       Send data to a single producer, single consumer ring buffer
+ *
+ * Copy data into the ring buffer. This function will block until all the data
+ * has been copied or until it timesout, in which case only part of the data
+ * may have been sent.
+ *
+ * @param[in]   xRingbuffer     Ring buffer to send the data to
+ * @param[in]   pvData          Pointer to the data to send. NULL is allowed if xLen is 0.
+ * @param[in]   xLen            Size of the data to send
+ * @param[in]   xTicksToWait    Ticks to wait for room in the ring buffer
+ *
+ * @return  Number of bytes sent
+ */
+size_t xRingbufferSpscSend(RingbufSpscHandle_t xRingbuffer, const void *pvData, size_t xLen, TickType_t xTicksToWait);
+
+/**
+ * @brief       Send data to a single producer, single consumer ring buffer in an ISR
+ *
+ * Copy as much of the data as fits into the ring buffer, without blocking.
+ *
+ * @param[in]   xRingbuffer Ring buffer to send the data to
+ * @param[in]   pvData      Pointer to the data to send. NULL is allowed if xLen is 0.
+ * @param[in]   xLen        Size of the data to send
+ * @param[out]  pxHigherPriorityTaskWoken   Value pointed to will be set to pdTRUE if the function woke up a higher priority task.
+ *
+ * @return  Number of bytes sent
+ */
+size_t xRingbufferSpscSendFromISR(RingbufSpscHandle_t xRingbuffer, const void *pvData, size_t xLen, BaseType_t *pxHigherPriorityTaskWoken);
+
+/**
+ * @brief       Receive data from a single producer, single consumer ring buffer
+ *
+ * Wait until the wakeup threshold (or xMaxLen bytes, if smaller) is reached or
+ * until it timesout, then copy the available data, up to xMaxLen bytes.
+ *
+ * @param[in]   xRingbuffer     Ring buffer to receive the data from
+ * @param[out]  pvBuf           Buffer to copy the data to
+ * @param[in]   xMaxLen         Size of the buffer
+ * @param[in]   xTicksToWait    Ticks to wait for the wakeup threshold to be reached
+ *
+ * @note    On time-out, the data available so far is returned.
+ *
+ * @return  Number of bytes received
+ */
+size_t xRingbufferSpscReceive(RingbufSpscHandle_t xRingbuffer, void *pvBuf, size_t xMaxLen, TickType_t xTicksToWait);
+
+/**
+ * @brief       Receive data from a single producer, single consumer ring buffer in an ISR
+ *
+ * Copy the available data, up to xMaxLen bytes, without blocking.
+ *
+ * @param[in]   xRingbuffer Ring buffer to receive the data from
+ * @param[out]  pvBuf       Buffer to copy the data to
+ * @param[in]   xMaxLen     Size of the buffer
+ * @param[out]  pxHigherPriorityTaskWoken   Value pointed to will be set to pdTRUE if the function woke up a higher priority task.
+ *
+ * @return  Number of bytes received
+ */
+size_t xRingbufferSpscReceiveFromISR(RingbufSpscHandle_t xRingbuffer, void *pvBuf, size_t xMaxLen, BaseType_t *pxHigherPriorityTaskWoken);
+
+/**
+ * @brief       Get the number of bytes in a single producer, single consumer ring buffer
+ *
+ * @param[in]   xRingbuffer     Ring buffer
+ *
+ * @return  Number of bytes that can be received
+ */
+size_t xRingbufferSpscGetDataSize(RingbufSpscHandle_t xRingbuffer);
+
+/**
+ * @brief       Get the free space of a single producer, single consumer ring buffer
+ *
+ * @param[in]   xRingbuffer     Ring buffer
+ *
+ * @return  Number of bytes that can be sent without blocking
+ */
+size_t xRingbufferSpscGetFreeSize(RingbufSpscHandle_t xRingbuffer);
+
 /* -------------------------------- Deprecated Functions --------------------------- */
 
 /** @cond */    //Doxygen command to hide deprecated function from API Reference
@@ -26,12 +26,13 @@
 //Ring buffer flags
 #define rbALLOW_SPLIT_FLAG          ( ( UBaseType_t ) 1 )   //The ring buffer allows items to be split
 #define rbBYTE_BUFFER_FLAG          ( ( UBaseType_t ) 2 )   //The ring buffer is a byte buffer
-#define rbBUFFER_FULL_FLAG          ( ( UBaseType_t ) 4 )   //The ring buffer is currently full (write pointer == free pointer)
+#define rbBUFFER_FULL_FLAG          ( ( UBaseType_t ) 4 )   //The ring buffer is currently full (acquire pointer == free pointer)
 
 //Item flags
 #define rbITEM_FREE_FLAG            ( ( UBaseType_t ) 1 )   //Item has been retrieved and returned by application, free to overwrite
 #define rbITEM_DUMMY_DATA_FLAG      ( ( UBaseType_t ) 2 )   //Data from here to end of the ring buffer is dummy data. Restart reading at start of head of the buffer
 #define rbITEM_SPLIT_FLAG           ( ( UBaseType_t ) 4 )   //Valid for RINGBUF_TYPE_ALLOWSPLIT, indicating that rest of the data is wrapped around
+#define rbITEM_WRITTEN_FLAG         ( ( UBaseType_t ) 8 )   //Valid for RINGBUF_TYPE_NOSPLIT, item has been written by the application and can be read
 
 typedef struct {
     //This size of this structure must be 32-bit aligned
@@ -59,13 +60,15 @@ struct Ringbuffer_t {
     ReturnItemFunction_t vReturnItem;           //Function to return item to ring buffer
     GetCurMaxSizeFunction_t xGetCurMaxSize;     //Function to get current free size
 
-    uint8_t *pucWrite;                          //Write Pointer. Points to where the next item should be written
+    uint8_t *pucAcquire;                        //Acquire Pointer. Points to where the next item should be written
+    uint8_t *pucWrite;                          //Write Pointer. Points to the first item that has yet to be completed by the application
     uint8_t *pucRead;                           //Read Pointer. Points to where the next item should be read from
     uint8_t *pucFree;                           //Free Pointer. Points to the last item that has yet to be returned to the ring buffer
     uint8_t *pucHead;                           //Pointer to the start of the ring buffer storage area
     uint8_t *pucTail;                           //Pointer to the end of the ring buffer storage area
 
     BaseType_t xItemsWaiting;                   //Number of items/bytes(for byte buffers) currently in ring buffer that have not yet been read
+    UBaseType_t uxItemsAcquired;                //Number of items acquired with xRingbufferSendAcquire() that have not yet been completed
     SemaphoreHandle_t xFreeSpaceSemaphore;      //Binary semaphore, wakes up writing threads when more free space becomes available or when another thread times out attempting to write
     SemaphoreHandle_t xItemsBufferedSemaphore;  //Binary semaphore, indicates there are new packets in the circular buffer. See remark.
     portMUX_TYPE mux;                           //Spinlock required for SMP
@@ -97,6 +100,12 @@ static BaseType_t prvCheckItemFitsDefault( Ringbuffer_t *pxRingbuffer, size_t xI
 //Checks if an item will currently fit in a byte buffer
 static BaseType_t prvCheckItemFitsByteBuffer( Ringbuffer_t *pxRingbuffer, size_t xItemSize);
 
+//Reserves space for an item in a no-split ring buffer. Only call this function after calling prvCheckItemFitsDefault()
+static uint8_t *prvAcquireItemNoSplit(Ringbuffer_t *pxRingbuffer, size_t xItemSize);
+
+//Marks an acquired item of a no-split ring buffer as written. Returns pdTRUE if items became available for retrieval
+static BaseType_t prvSendItemDoneNoSplit(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem);
+
 //Copies an item to a no-split ring buffer. Only call this function after calling prvCheckItemFitsDefault()
 static void prvCopyItemNoSplit(Ringbuffer_t *pxRingbuffer, const uint8_t *pucItem, size_t xItemSize);
 
@@ -138,6 +147,16 @@ static BaseType_t prvReceiveGeneric(Ringbuffer_t *pxRingbuffer, void **pvItem1,
 //Generic function used to retrieve an item/data from ring buffers in an ISR
 static BaseType_t prvReceiveGenericFromISR(Ringbuffer_t *pxRingbuffer, void **pvItem1, void **pvItem2, size_t *xItemSize1, size_t *xItemSize2, size_t xMaxSize);
 
+/**
+ * Generic function used to send an item to ring buffers. If ppvItem is not NULL,
+ * space is only acquired in a no-split buffer and *ppvItem is set to point to it,
+ * pvItem is copied otherwise.
+ */
+static BaseType_t prvSendGeneric(Ringbuffer_t *pxRingbuffer, const void *pvItem, void **ppvItem, size_t xItemSize, TickType_t xTicksToWait);
+
+//Generic function used to send an item to ring buffers in an ISR
+static BaseType_t prvSendGenericFromISR(Ringbuffer_t *pxRingbuffer, const void *pvItem, void **ppvItem, size_t xItemSize, BaseType_t *pxHigherPriorityTaskWoken);
+
 /* ------------------------------------------------ Static Definitions ------------------------------------------- */
 
 static size_t prvGetFreeSize(Ringbuffer_t *pxRingbuffer)
@@ -146,7 +165,7 @@ static size_t prvGetFreeSize(Ringbuffer_t *pxRingbuffer)
     if (pxRingbuffer->uxRingbufferFlags & rbBUFFER_FULL_FLAG) {
         xReturn =  0;
     } else {
-        BaseType_t xFreeSize = pxRingbuffer->pucFree - pxRingbuffer->pucWrite;
+        BaseType_t xFreeSize = pxRingbuffer->pucFree - pxRingbuffer->pucAcquire;
         //Check if xFreeSize has underflowed
         if (xFreeSize <= 0) {
             xFreeSize += pxRingbuffer->xSize;
@@ -160,26 +179,26 @@ static size_t prvGetFreeSize(Ringbuffer_t *pxRingbuffer)
 static BaseType_t prvCheckItemFitsDefault( Ringbuffer_t *pxRingbuffer, size_t xItemSize)
 {
     //Check arguments and buffer state
-    configASSERT(rbCHECK_ALIGNED(pxRingbuffer->pucWrite));              //pucWrite is always aligned in no-split ring buffers
-    configASSERT(pxRingbuffer->pucWrite >= pxRingbuffer->pucHead && pxRingbuffer->pucWrite < pxRingbuffer->pucTail);    //Check write pointer is within bounds
+    configASSERT(rbCHECK_ALIGNED(pxRingbuffer->pucAcquire));              //pucAcquire is always aligned in no-split ring buffers
+    configASSERT(pxRingbuffer->pucAcquire >= pxRingbuffer->pucHead && pxRingbuffer->pucAcquire < pxRingbuffer->pucTail);    //Check write pointer is within bounds
 
     size_t xTotalItemSize = rbALIGN_SIZE(xItemSize) + rbHEADER_SIZE;    //Rounded up aligned item size with header
-    if (pxRingbuffer->pucWrite == pxRingbuffer->pucFree) {
+    if (pxRingbuffer->pucAcquire == pxRingbuffer->pucFree) {
         //Buffer is either complete empty or completely full
         return (pxRingbuffer->uxRingbufferFlags & rbBUFFER_FULL_FLAG) ? pdFALSE : pdTRUE;
     }
-    if (pxRingbuffer->pucFree > pxRingbuffer->pucWrite) {
+    if (pxRingbuffer->pucFree > pxRingbuffer->pucAcquire) {
         //Free space does not wrap around
-        return (xTotalItemSize <= pxRingbuffer->pucFree - pxRingbuffer->pucWrite) ? pdTRUE : pdFALSE;
+        return (xTotalItemSize <= pxRingbuffer->pucFree - pxRingbuffer->pucAcquire) ? pdTRUE : pdFALSE;
     }
     //Free space wraps around
-    if (xTotalItemSize <= pxRingbuffer->pucTail - pxRingbuffer->pucWrite) {
+    if (xTotalItemSize <= pxRingbuffer->pucTail - pxRingbuffer->pucAcquire) {
         return pdTRUE;      //Item fits without wrapping around
     }
     //Check if item fits by wrapping
     if (pxRingbuffer->uxRingbufferFlags & rbALLOW_SPLIT_FLAG) {
         //Allow split wrapping incurs an extra header
-        return (xTotalItemSize + rbHEADER_SIZE <= pxRingbuffer->xSize - (pxRingbuffer->pucWrite - pxRingbuffer->pucFree)) ? pdTRUE : pdFALSE;
+        return (xTotalItemSize + rbHEADER_SIZE <= pxRingbuffer->xSize - (pxRingbuffer->pucAcquire - pxRingbuffer->pucFree)) ? pdTRUE : pdFALSE;
     } else {
         return (xTotalItemSize <= pxRingbuffer->pucFree - pxRingbuffer->pucHead) ? pdTRUE : pdFALSE;
     }
@@ -188,55 +207,108 @@ static BaseType_t prvCheckItemFitsDefault( Ringbuffer_t *pxRingbuffer, size_t xI
 static BaseType_t prvCheckItemFitsByteBuffer( Ringbuffer_t *pxRingbuffer, size_t xItemSize)
 {
     //Check arguments and buffer state
-    configASSERT(pxRingbuffer->pucWrite >= pxRingbuffer->pucHead && pxRingbuffer->pucWrite < pxRingbuffer->pucTail);    //Check write pointer is within bounds
+    configASSERT(pxRingbuffer->pucAcquire >= pxRingbuffer->pucHead && pxRingbuffer->pucAcquire < pxRingbuffer->pucTail);    //Check write pointer is within bounds
 
-    if (pxRingbuffer->pucWrite == pxRingbuffer->pucFree) {
+    if (pxRingbuffer->pucAcquire == pxRingbuffer->pucFree) {
         //Buffer is either complete empty or completely full
         return (pxRingbuffer->uxRingbufferFlags & rbBUFFER_FULL_FLAG) ? pdFALSE : pdTRUE;
     }
-    if (pxRingbuffer->pucFree > pxRingbuffer->pucWrite) {
+    if (pxRingbuffer->pucFree > pxRingbuffer->pucAcquire) {
         //Free space does not wrap around
-        return (xItemSize <= pxRingbuffer->pucFree - pxRingbuffer->pucWrite) ? pdTRUE : pdFALSE;
+        return (xItemSize <= pxRingbuffer->pucFree - pxRingbuffer->pucAcquire) ? pdTRUE : pdFALSE;
     }
     //Free space wraps around
-    return (xItemSize <= pxRingbuffer->xSize - (pxRingbuffer->pucWrite - pxRingbuffer->pucFree)) ? pdTRUE : pdFALSE;
+    return (xItemSize <= pxRingbuffer->xSize - (pxRingbuffer->pucAcquire - pxRingbuffer->pucFree)) ? pdTRUE : pdFALSE;
 }
 
-static void prvCopyItemNoSplit(Ringbuffer_t *pxRingbuffer, const uint8_t *pucItem, size_t xItemSize)
+static uint8_t *prvAcquireItemNoSplit(Ringbuffer_t *pxRingbuffer, size_t xItemSize)
 {
     //Check arguments and buffer state
     size_t xAlignedItemSize = rbALIGN_SIZE(xItemSize);                  //Rounded up aligned item size
-    size_t xRemLen = pxRingbuffer->pucTail - pxRingbuffer->pucWrite;    //Length from pucWrite until end of buffer
-    configASSERT(rbCHECK_ALIGNED(pxRingbuffer->pucWrite));              //pucWrite is always aligned in no-split ring buffers
-    configASSERT(pxRingbuffer->pucWrite >= pxRingbuffer->pucHead && pxRingbuffer->pucWrite < pxRingbuffer->pucTail);    //Check write pointer is within bounds
+    size_t xRemLen = pxRingbuffer->pucTail - pxRingbuffer->pucAcquire;  //Length from pucAcquire until end of buffer
+    configASSERT(rbCHECK_ALIGNED(pxRingbuffer->pucAcquire));            //pucAcquire is always aligned in no-split ring buffers
+    configASSERT(pxRingbuffer->pucAcquire >= pxRingbuffer->pucHead && pxRingbuffer->pucAcquire < pxRingbuffer->pucTail);    //Check acquire pointer is within bounds
     configASSERT(xRemLen >= rbHEADER_SIZE);                             //Remaining length must be able to at least fit an item header
 
     //If remaining length can't fit item, set as dummy data and wrap around
     if (xRemLen < xAlignedItemSize + rbHEADER_SIZE) {
-        ItemHeader_t *pxDummy = (ItemHeader_t *)pxRingbuffer->pucWrite;
+        ItemHeader_t *pxDummy = (ItemHeader_t *)pxRingbuffer->pucAcquire;
         pxDummy->uxItemFlags = rbITEM_DUMMY_DATA_FLAG;      //Set remaining length as dummy data
         pxDummy->xItemLen = 0;                              //Dummy data should have no length
-        pxRingbuffer->pucWrite = pxRingbuffer->pucHead;     //Reset write pointer to wrap around
+        pxRingbuffer->pucAcquire = pxRingbuffer->pucHead;   //Reset acquire pointer to wrap around
     }
 
-    //Item should be guaranteed to fit at this point. Set item header and copy data
-    ItemHeader_t *pxHeader = (ItemHeader_t *)pxRingbuffer->pucWrite;
+    //Item should be guaranteed to fit at this point. Set item header, data is written later by the caller
+    ItemHeader_t *pxHeader = (ItemHeader_t *)pxRingbuffer->pucAcquire;
     pxHeader->xItemLen = xItemSize;
     pxHeader->uxItemFlags = 0;
-    pxRingbuffer->pucWrite += rbHEADER_SIZE;    //Advance pucWrite past header
-    memcpy(pxRingbuffer->pucWrite, pucItem, xItemSize);
-    pxRingbuffer->xItemsWaiting++;
-    pxRingbuffer->pucWrite += xAlignedItemSize; //Advance pucWrite past item to next aligned address
+    uint8_t *pucItem = pxRingbuffer->pucAcquire + rbHEADER_SIZE;
+    pxRingbuffer->uxItemsAcquired++;
+    pxRingbuffer->pucAcquire += rbHEADER_SIZE + xAlignedItemSize;   //Advance pucAcquire past header and item to next aligned address
 
-    //If current remaining length can't fit a header, wrap around write pointer
-    if (pxRingbuffer->pucTail - pxRingbuffer->pucWrite < rbHEADER_SIZE) {
-        pxRingbuffer->pucWrite = pxRingbuffer->pucHead;   //Wrap around pucWrite
+    //If current remaining length can't fit a header, wrap around acquire pointer
+    if (pxRingbuffer->pucTail - pxRingbuffer->pucAcquire < rbHEADER_SIZE) {
+        pxRingbuffer->pucAcquire = pxRingbuffer->pucHead;   //Wrap around pucAcquire
     }
     //Check if buffer is full
-    if (pxRingbuffer->pucWrite == pxRingbuffer->pucFree) {
+    if (pxRingbuffer->pucAcquire == pxRingbuffer->pucFree) {
         //Mark the buffer as full to distinguish with an empty buffer
         pxRingbuffer->uxRingbufferFlags |= rbBUFFER_FULL_FLAG;
     }
+    return pucItem;
+}
+
+static BaseType_t prvSendItemDoneNoSplit(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem)
+{
+    //Check arguments and buffer state
+    configASSERT(rbCHECK_ALIGNED(pucItem));
+    configASSERT(pucItem >= pxRingbuffer->pucHead);
+    configASSERT(pucItem <= pxRingbuffer->pucTail);     //Inclusive of pucTail in the case of zero length item at the very end
+    configASSERT(pxRingbuffer->uxItemsAcquired > 0);
+
+    //Get and check header of the item
+    ItemHeader_t *pxCurHeader = (ItemHeader_t *)(pucItem - rbHEADER_SIZE);
+    configASSERT(pxCurHeader->xItemLen <= pxRingbuffer->xMaxItemSize);
+    configASSERT((pxCurHeader->uxItemFlags & rbITEM_DUMMY_DATA_FLAG) == 0); //Dummy items are never acquired
+    configASSERT((pxCurHeader->uxItemFlags & rbITEM_WRITTEN_FLAG) == 0);    //Indicates item has already been completed before
+    pxCurHeader->uxItemFlags |= rbITEM_WRITTEN_FLAG;                        //Mark as written
+
+    /*
+     * Items might not be completed in the order they were acquired. Move the write
+     * pointer up to the next acquired item that has not been marked as written (by
+     * written flag), so that items are made available for retrieval in the order they
+     * were acquired. Dummy data in front of an acquired item is skipped over
+     */
+    BaseType_t xItemsAvailable = pdFALSE;
+    pxCurHeader = (ItemHeader_t *)pxRingbuffer->pucWrite;
+    while (pxRingbuffer->uxItemsAcquired > 0 && (pxCurHeader->uxItemFlags & (rbITEM_WRITTEN_FLAG | rbITEM_DUMMY_DATA_FLAG))) {
+        if (pxCurHeader->uxItemFlags & rbITEM_DUMMY_DATA_FLAG) {
+            pxRingbuffer->pucWrite = pxRingbuffer->pucHead;     //Wrap around due to dummy data
+        } else {
+            //Item has been written, advance write pointer past this item
+            pxRingbuffer->pucWrite += rbHEADER_SIZE + rbALIGN_SIZE(pxCurHeader->xItemLen);
+            //Redundancy check to ensure write pointer has not overshot buffer bounds
+            configASSERT(pxRingbuffer->pucWrite <= pxRingbuffer->pucTail);
+            pxRingbuffer->uxItemsAcquired--;
+            pxRingbuffer->xItemsWaiting++;
+            xItemsAvailable = pdTRUE;
+        }
+        //Check if pucWrite requires wrap around
+        if ((pxRingbuffer->pucTail - pxRingbuffer->pucWrite) < rbHEADER_SIZE) {
+            pxRingbuffer->pucWrite = pxRingbuffer->pucHead;
+        }
+        pxCurHeader = (ItemHeader_t *)pxRingbuffer->pucWrite;      //Update header to point to next item
+    }
+    return xItemsAvailable;
+}
+
+static void prvCopyItemNoSplit(Ringbuffer_t *pxRingbuffer, const uint8_t *pucItem, size_t xItemSize)
+{
+    //Acquire space, copy the item and complete it in one go. The item becomes available
+    //for retrieval once items acquired before it have been completed as well
+    uint8_t *pucData = prvAcquireItemNoSplit(pxRingbuffer, xItemSize);
+    memcpy(pucData, pucItem, xItemSize);
+    prvSendItemDoneNoSplit(pxRingbuffer, pucData);
 }
 
 static void prvCopyItemAllowSplit(Ringbuffer_t *pxRingbuffer, const uint8_t *pucItem, size_t xItemSize)
@@ -284,6 +356,7 @@ static void prvCopyItemAllowSplit(Ringbuffer_t *pxRingbuffer, const uint8_t *puc
     if (pxRingbuffer->pucTail - pxRingbuffer->pucWrite < rbHEADER_SIZE) {
         pxRingbuffer->pucWrite = pxRingbuffer->pucHead;   //Wrap around pucWrite
     }
+    pxRingbuffer->pucAcquire = pxRingbuffer->pucWrite;    //Items are never acquired in allow-split buffers
     //Check if buffer is full
     if (pxRingbuffer->pucWrite == pxRingbuffer->pucFree) {
         //Mark the buffer as full to distinguish with an empty buffer
@@ -315,6 +388,7 @@ static void prvCopyItemByteBuf(Ringbuffer_t *pxRingbuffer, const uint8_t *pucIte
     if (pxRingbuffer->pucWrite == pxRingbuffer->pucTail) {
         pxRingbuffer->pucWrite = pxRingbuffer->pucHead;
     }
+    pxRingbuffer->pucAcquire = pxRingbuffer->pucWrite;    //Data is never acquired in byte buffers
     //Check if buffer is full
     if (pxRingbuffer->pucWrite == pxRingbuffer->pucFree) {
         pxRingbuffer->uxRingbufferFlags |= rbBUFFER_FULL_FLAG;      //Mark the buffer as full to avoid confusion with an empty buffer
@@ -452,9 +526,9 @@ static void prvReturnItemDefault(Ringbuffer_t *pxRingbuffer, uint8_t *pucItem)
 
     //Check if the buffer full flag should be reset
     if (pxRingbuffer->uxRingbufferFlags & rbBUFFER_FULL_FLAG) {
-        if (pxRingbuffer->pucFree != pxRingbuffer->pucWrite) {
+        if (pxRingbuffer->pucFree != pxRingbuffer->pucAcquire) {
             pxRingbuffer->uxRingbufferFlags &= ~rbBUFFER_FULL_FLAG;
-        } else if (pxRingbuffer->pucFree == pxRingbuffer->pucWrite && pxRingbuffer->pucFree == pxRingbuffer->pucRead) {
+        } else if (pxRingbuffer->pucFree == pxRingbuffer->pucAcquire && pxRingbuffer->pucFree == pxRingbuffer->pucRead) {
             //Special case where a full buffer is completely freed in one go
             pxRingbuffer->uxRingbufferFlags &= ~rbBUFFER_FULL_FLAG;
         }
@@ -481,13 +555,13 @@ static size_t prvGetCurMaxSizeNoSplit(Ringbuffer_t *pxRingbuffer)
     if (pxRingbuffer->uxRingbufferFlags & rbBUFFER_FULL_FLAG) {
         return 0;
     }
-    if (pxRingbuffer->pucWrite < pxRingbuffer->pucFree) {
-        //Free space is contiguous between pucWrite and pucFree
-        xFreeSize = pxRingbuffer->pucFree - pxRingbuffer->pucWrite;
+    if (pxRingbuffer->pucAcquire < pxRingbuffer->pucFree) {
+        //Free space is contiguous between pucAcquire and pucFree
+        xFreeSize = pxRingbuffer->pucFree - pxRingbuffer->pucAcquire;
     } else {
         //Free space wraps around (or overlapped at pucHead), select largest
         //contiguous free space as no-split items require contiguous space
-        size_t xSize1 = pxRingbuffer->pucTail - pxRingbuffer->pucWrite;
+        size_t xSize1 = pxRingbuffer->pucTail - pxRingbuffer->pucAcquire;
         size_t xSize2 = pxRingbuffer->pucFree - pxRingbuffer->pucHead;
         xFreeSize = (xSize1 > xSize2) ? xSize1 : xSize2;
     }
@@ -511,16 +585,16 @@ static size_t prvGetCurMaxSizeAllowSplit(Ringbuffer_t *pxRingbuffer)
     if (pxRingbuffer->uxRingbufferFlags & rbBUFFER_FULL_FLAG) {
         return 0;
     }
-    if (pxRingbuffer->pucWrite == pxRingbuffer->pucHead && pxRingbuffer->pucFree == pxRingbuffer->pucHead) {
-        //Check for special case where pucWrite and pucFree are both at pucHead
+    if (pxRingbuffer->pucAcquire == pxRingbuffer->pucHead && pxRingbuffer->pucFree == pxRingbuffer->pucHead) {
+        //Check for special case where pucAcquire and pucFree are both at pucHead
         xFreeSize = pxRingbuffer->xSize - rbHEADER_SIZE;
-    } else if (pxRingbuffer->pucWrite < pxRingbuffer->pucFree) {
-        //Free space is contiguous between pucWrite and pucFree, requires single header
-        xFreeSize = (pxRingbuffer->pucFree - pxRingbuffer->pucWrite) - rbHEADER_SIZE;
+    } else if (pxRingbuffer->pucAcquire < pxRingbuffer->pucFree) {
+        //Free space is contiguous between pucAcquire and pucFree, requires single header
+        xFreeSize = (pxRingbuffer->pucFree - pxRingbuffer->pucAcquire) - rbHEADER_SIZE;
     } else {
         //Free space wraps around, requires two headers
         xFreeSize = (pxRingbuffer->pucFree - pxRingbuffer->pucHead) +
-                    (pxRingbuffer->pucTail - pxRingbuffer->pucWrite) -
+                    (pxRingbuffer->pucTail - pxRingbuffer->pucAcquire) -
                     (rbHEADER_SIZE * 2);
     }
 
@@ -545,7 +619,7 @@ static size_t prvGetCurMaxSizeByteBuf(Ringbuffer_t *pxRingbuffer)
      * Return whatever space is available depending on relative positions of the free
      * pointer and write pointer. There is no overhead of headers in this mode
      */
-    xFreeSize = pxRingbuffer->pucFree - pxRingbuffer->pucWrite;
+    xFreeSize = pxRingbuffer->pucFree - pxRingbuffer->pucAcquire;
     if (xFreeSize <= 0) {
         xFreeSize += pxRingbuffer->xSize;
     }
@@ -649,6 +723,88 @@ static BaseType_t prvReceiveGenericFromISR(Ringbuffer_t *pxRingbuffer, void **pv
     return xReturn;
 }
 
+static BaseType_t prvSendGeneric(Ringbuffer_t *pxRingbuffer, const void *pvItem, void **ppvItem, size_t xItemSize, TickType_t xTicksToWait)
+{
+    BaseType_t xReturn = pdFALSE;
+    BaseType_t xReturnSemaphore = pdFALSE;
+    TickType_t xTicksEnd = xTaskGetTickCount() + xTicksToWait;
+    TickType_t xTicksRemaining = xTicksToWait;
+    while (xTicksRemaining <= xTicksToWait) {   //xTicksToWait will underflow once xTaskGetTickCount() > ticks_end
+        //Block until more free space becomes available or timeout
+        if (xSemaphoreTake(pxRingbuffer->xFreeSpaceSemaphore, xTicksRemaining) != pdTRUE) {
+            xReturn = pdFALSE;
+            break;
+        }
+        //Semaphore obtained, check if item can fit
+        portENTER_CRITICAL(&pxRingbuffer->mux);
+        if(pxRingbuffer->xCheckItemFits(pxRingbuffer, xItemSize) == pdTRUE) {
+            if (ppvItem != NULL) {
+                //Item will fit, reserve space to be written by the caller
+                *ppvItem = prvAcquireItemNoSplit(pxRingbuffer, xItemSize);
+            } else {
+                //Item will fit, copy item
+                pxRingbuffer->vCopyItem(pxRingbuffer, pvItem, xItemSize);
+            }
+            xReturn = pdTRUE;
+            //Check if the free semaphore should be returned to allow other tasks to send
+            if (prvGetFreeSize(pxRingbuffer) > 0) {
+                xReturnSemaphore = pdTRUE;
+            }
+            portEXIT_CRITICAL(&pxRingbuffer->mux);
+            break;
+        }
+        //Item doesn't fit, adjust ticks and take the semaphore again
+        if (xTicksToWait != portMAX_DELAY) {
+            xTicksRemaining = xTicksEnd - xTaskGetTickCount();
+        }
+        portEXIT_CRITICAL(&pxRingbuffer->mux);
+        /*
+         * Gap between critical section and re-acquiring of the semaphore. If
+         * semaphore is given now, priority inversion might occur (see docs)
+         */
+    }
+
+    if (xReturn == pdTRUE && ppvItem == NULL) {
+        //Indicate item was successfully sent
+        xSemaphoreGive(pxRingbuffer->xItemsBufferedSemaphore);
+    }
+    if (xReturnSemaphore == pdTRUE) {
+        xSemaphoreGive(pxRingbuffer->xFreeSpaceSemaphore);  //Give back semaphore so other tasks can send
+    }
+    return xReturn;
+}
+
+static BaseType_t prvSendGenericFromISR(Ringbuffer_t *pxRingbuffer, const void *pvItem, void **ppvItem, size_t xItemSize, BaseType_t *pxHigherPriorityTaskWoken)
+{
+    BaseType_t xReturn;
+    BaseType_t xReturnSemaphore = pdFALSE;
+    portENTER_CRITICAL_ISR(&pxRingbuffer->mux);
+    if (pxRingbuffer->xCheckItemFits(pxRingbuffer, xItemSize) == pdTRUE) {
+        if (ppvItem != NULL) {
+            *ppvItem = prvAcquireItemNoSplit(pxRingbuffer, xItemSize);
+        } else {
+            pxRingbuffer->vCopyItem(pxRingbuffer, pvItem, xItemSize);
+        }
+        xReturn = pdTRUE;
+        //Check if the free semaphore should be returned to allow other tasks to send
+        if (prvGetFreeSize(pxRingbuffer) > 0) {
+            xReturnSemaphore = pdTRUE;
+        }
+    } else {
+        xReturn = pdFALSE;
+    }
+    portEXIT_CRITICAL_ISR(&pxRingbuffer->mux);
+
+    if (xReturn == pdTRUE && ppvItem == NULL) {
+        //Indicate item was successfully sent
+        xSemaphoreGiveFromISR(pxRingbuffer->xItemsBufferedSemaphore, pxHigherPriorityTaskWoken);
+    }
+    if (xReturnSemaphore == pdTRUE) {
+        xSemaphoreGiveFromISR(pxRingbuffer->xFreeSpaceSemaphore, pxHigherPriorityTaskWoken);  //Give back semaphore so other tasks can send
+    }
+    return xReturn;
+}
+
 /* ------------------------------------------------- Public Definitions -------------------------------------------- */
 
 RingbufHandle_t xRingbufferCreate(size_t xBufferSize, ringbuf_type_t xBufferType)
@@ -672,7 +828,9 @@ RingbufHandle_t xRingbufferCreate(size_t xBufferSize, ringbuf_type_t xBufferType
     pxRingbuffer->pucFree = pxRingbuffer->pucHead;
     pxRingbuffer->pucRead = pxRingbuffer->pucHead;
     pxRingbuffer->pucWrite = pxRingbuffer->pucHead;
+    pxRingbuffer->pucAcquire = pxRingbuffer->pucHead;
     pxRingbuffer->xItemsWaiting = 0;
+    pxRingbuffer->uxItemsAcquired = 0;
     pxRingbuffer->xFreeSpaceSemaphore = xSemaphoreCreateBinary();
     pxRingbuffer->xItemsBufferedSemaphore = xSemaphoreCreateBinary();
     pxRingbuffer->uxRingbufferFlags = 0;
@@ -755,48 +913,7 @@ BaseType_t xRingbufferSend(RingbufHandle_t xRingbuffer, const void *pvItem, size
     }
 
     //Attempt to send an item
-    BaseType_t xReturn = pdFALSE;
-    BaseType_t xReturnSemaphore = pdFALSE;
-    TickType_t xTicksEnd = xTaskGetTickCount() + xTicksToWait;
-    TickType_t xTicksRemaining = xTicksToWait;
-    while (xTicksRemaining <= xTicksToWait) {   //xTicksToWait will underflow once xTaskGetTickCount() > ticks_end
-        //Block until more free space becomes available or timeout
-        if (xSemaphoreTake(pxRingbuffer->xFreeSpaceSemaphore, xTicksRemaining) != pdTRUE) {
-            xReturn = pdFALSE;
-            break;
-        }
-        //Semaphore obtained, check if item can fit
-        portENTER_CRITICAL(&pxRingbuffer->mux);
-        if(pxRingbuffer->xCheckItemFits(pxRingbuffer, xItemSize) == pdTRUE) {
-            //Item will fit, copy item
-            pxRingbuffer->vCopyItem(pxRingbuffer, pvItem, xItemSize);
-            xReturn = pdTRUE;
-            //Check if the free semaphore should be returned to allow other tasks to send
-            if (prvGetFreeSize(pxRingbuffer) > 0) {
-                xReturnSemaphore = pdTRUE;
-            }
-            portEXIT_CRITICAL(&pxRingbuffer->mux);
-            break;
-        }
-        //Item doesn't fit, adjust ticks and take the semaphore again
-        if (xTicksToWait != portMAX_DELAY) {
-            xTicksRemaining = xTicksEnd - xTaskGetTickCount();
-        }
-        portEXIT_CRITICAL(&pxRingbuffer->mux);
-        /*
-         * Gap between critical section and re-acquiring of the semaphore. If
-         * semaphore is given now, priority inversion might occur (see docs)
-         */
-    }
-
-    if (xReturn == pdTRUE) {
-        //Indicate item was successfully sent
-        xSemaphoreGive(pxRingbuffer->xItemsBufferedSemaphore);
-    }
-    if (xReturnSemaphore == pdTRUE) {
-        xSemaphoreGive(pxRingbuffer->xFreeSpaceSemaphore);  //Give back semaphore so other tasks can send
-    }
-    return xReturn;
+    return prvSendGeneric(pxRingbuffer, pvItem, NULL, xItemSize, xTicksToWait);
 }
 
 BaseType_t xRingbufferSendFromISR(RingbufHandle_t xRingbuffer, const void *pvItem, size_t xItemSize, BaseType_t *pxHigherPriorityTaskWoken)
@@ -813,29 +930,75 @@ BaseType_t xRingbufferSendFromISR(RingbufHandle_t xRingbuffer, const void *pvIte
     }
 
     //Attempt to send an item
-    BaseType_t xReturn;
-    BaseType_t xReturnSemaphore = pdFALSE;
-    portENTER_CRITICAL_ISR(&pxRingbuffer->mux);
-    if (pxRingbuffer->xCheckItemFits(xRingbuffer, xItemSize) == pdTRUE) {
-        pxRingbuffer->vCopyItem(xRingbuffer, pvItem, xItemSize);
-        xReturn = pdTRUE;
-        //Check if the free semaphore should be returned to allow other tasks to send
-        if (prvGetFreeSize(pxRingbuffer) > 0) {
-            xReturnSemaphore = pdTRUE;
-        }
-    } else {
-        xReturn = pdFALSE;
+    return prvSendGenericFromISR(pxRingbuffer, pvItem, NULL, xItemSize, pxHigherPriorityTaskWoken);
+}
+
+BaseType_t xRingbufferSendAcquire(RingbufHandle_t xRingbuffer, void **ppvItem, size_t xItemSize, TickType_t xTicksToWait)
+{
+    //Check arguments
+    Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+    configASSERT(pxRingbuffer);
+    configASSERT(ppvItem != NULL);
+    configASSERT((pxRingbuffer->uxRingbufferFlags & (rbBYTE_BUFFER_FLAG | rbALLOW_SPLIT_FLAG)) == 0);   //Only no-split buffers store items contiguously
+    *ppvItem = NULL;
+    if (xItemSize > pxRingbuffer->xMaxItemSize) {
+        return pdFALSE;     //Data will never ever fit in the queue.
     }
+
+    //Attempt to acquire space for an item
+    return prvSendGeneric(pxRingbuffer, NULL, ppvItem, xItemSize, xTicksToWait);
+}
+
+BaseType_t xRingbufferSendAcquireFromISR(RingbufHandle_t xRingbuffer, void **ppvItem, size_t xItemSize, BaseType_t *pxHigherPriorityTaskWoken)
+{
+    //Check arguments
+    Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+    configASSERT(pxRingbuffer);
+    configASSERT(ppvItem != NULL);
+    configASSERT((pxRingbuffer->uxRingbufferFlags & (rbBYTE_BUFFER_FLAG | rbALLOW_SPLIT_FLAG)) == 0);   //Only no-split buffers store items contiguously
+    *ppvItem = NULL;
+    if (xItemSize > pxRingbuffer->xMaxItemSize) {
+        return pdFALSE;     //Data will never ever fit in the queue.
+    }
+
+    //Attempt to acquire space for an item
+    return prvSendGenericFromISR(pxRingbuffer, NULL, ppvItem, xItemSize, pxHigherPriorityTaskWoken);
+}
+
+BaseType_t xRingbufferSendComplete(RingbufHandle_t xRingbuffer, void *pvItem)
+{
+    Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+    configASSERT(pxRingbuffer);
+    configASSERT(pvItem != NULL);
+    configASSERT((pxRingbuffer->uxRingbufferFlags & (rbBYTE_BUFFER_FLAG | rbALLOW_SPLIT_FLAG)) == 0);
+
+    portENTER_CRITICAL(&pxRingbuffer->mux);
+    BaseType_t xItemsAvailable = prvSendItemDoneNoSplit(pxRingbuffer, (uint8_t *)pvItem);
+    portEXIT_CRITICAL(&pxRingbuffer->mux);
+
+    if (xItemsAvailable == pdTRUE) {
+        //Indicate items can be retrieved
+        xSemaphoreGive(pxRingbuffer->xItemsBufferedSemaphore);
+    }
+    return pdTRUE;
+}
+
+BaseType_t xRingbufferSendCompleteFromISR(RingbufHandle_t xRingbuffer, void *pvItem, BaseType_t *pxHigherPriorityTaskWoken)
+{
+    Ringbuffer_t *pxRingbuffer = (Ringbuffer_t *)xRingbuffer;
+    configASSERT(pxRingbuffer);
+    configASSERT(pvItem != NULL);
+    configASSERT((pxRingbuffer->uxRingbufferFlags & (rbBYTE_BUFFER_FLAG | rbALLOW_SPLIT_FLAG)) == 0);
+
+    portENTER_CRITICAL_ISR(&pxRingbuffer->mux);
+    BaseType_t xItemsAvailable = prvSendItemDoneNoSplit(pxRingbuffer, (uint8_t *)pvItem);
     portEXIT_CRITICAL_ISR(&pxRingbuffer->mux);
 
-    if (xReturn == pdTRUE) {
-        //Indicate item was successfully sent
+    if (xItemsAvailable == pdTRUE) {
+        //Indicate items can be retrieved
         xSemaphoreGiveFromISR(pxRingbuffer->xItemsBufferedSemaphore, pxHigherPriorityTaskWoken);
     }
-    if (xReturnSemaphore == pdTRUE) {
-        xSemaphoreGiveFromISR(pxRingbuffer->xFreeSpaceSemaphore, pxHigherPriorityTaskWoken);  //Give back semaphore so other tasks can send
-    }
-    return xReturn;
+    return pdTRUE;
 }
 
 void *xRingbufferReceive(RingbufHandle_t xRingbuffer, size_t *pxItemSize, TickType_t xTicksToWait)
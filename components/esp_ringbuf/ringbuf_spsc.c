@@ -0,0 +1,313 @@
+// Copyright 2015-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/ringbuf.h"
+
+/*
+ * Single producer, single consumer byte buffer.
+ *
+ * The write index is only modified by the producer and the read index only by
+ * the consumer, so data can be sent and received without any critical section.
+ * One byte of storage is always left unused to distinguish a full buffer from
+ * an empty one. Memory barriers order the accesses to the data with respect to
+ * the update of the indices, as the producer and the consumer can run on
+ * different cores.
+ *
+ * Semaphores are only used when a side has to block: the consumer (or producer)
+ * publishes the number of bytes (or free space) it is waiting for, and the other
+ * side gives the semaphore once that amount is reached. The consumer waits for
+ * the wakeup threshold, so a producer sending a few bytes at a time (e.g. a UART
+ * ISR) only wakes it up once per batch.
+ */
+
+#define rbSPSC_MEMORY_BARRIER()     __sync_synchronize()
+
+typedef struct {
+    size_t xSize;                               //Size of the data storage (usable size + 1)
+    uint8_t *pucBuffer;                         //Pointer to the data storage
+    volatile size_t xWrite;                     //Write index, only modified by the producer
+    volatile size_t xRead;                      //Read index, only modified by the consumer
+    size_t xWakeupThreshold;                    //Number of bytes that wake up a blocked consumer
+    volatile size_t xRxWaitBytes;               //Number of bytes the blocked consumer waits for, 0 if not blocked
+    volatile size_t xTxWaitBytes;               //Free space the blocked producer waits for, 0 if not blocked
+    SemaphoreHandle_t xRxSemaphore;             //Binary semaphore, wakes up the consumer
+    SemaphoreHandle_t xTxSemaphore;             //Binary semaphore, wakes up the producer
+} RingbufferSpsc_t;
+
+/* ------------------------------------------------ Static Definitions ------------------------------------------- */
+
+static inline size_t prvGetDataSize(RingbufferSpsc_t *pxRingbuffer, size_t xWrite, size_t xRead)
+{
+    return (xWrite >= xRead) ? xWrite - xRead : pxRingbuffer->xSize - (xRead - xWrite);
+}
+
+/*
+ * Copy as much of the data as fits into the buffer and publish it. Only called
+ * by the producer. Returns the number of bytes copied.
+ */
+static size_t prvCopyIn(RingbufferSpsc_t *pxRingbuffer, const uint8_t *pucData, size_t xLen)
+{
+    size_t xWrite = pxRingbuffer->xWrite;
+    size_t xRead = pxRingbuffer->xRead;
+    size_t xFree = pxRingbuffer->xSize - 1 - prvGetDataSize(pxRingbuffer, xWrite, xRead);
+    if (xLen > xFree) {
+        xLen = xFree;
+    }
+    if (xLen == 0) {
+        return 0;
+    }
+    //Order the read of the read index before overwriting the data it freed
+    rbSPSC_MEMORY_BARRIER();
+
+    //Copy up to the end of the storage, then wrap around
+    size_t xFirst = pxRingbuffer->xSize - xWrite;
+    if (xFirst > xLen) {
+        xFirst = xLen;
+    }
+    memcpy(pxRingbuffer->pucBuffer + xWrite, pucData, xFirst);
+    memcpy(pxRingbuffer->pucBuffer, pucData + xFirst, xLen - xFirst);
+    xWrite += xLen;
+    if (xWrite >= pxRingbuffer->xSize) {
+        xWrite -= pxRingbuffer->xSize;
+    }
+    //Data must be visible before the consumer sees the new write index
+    rbSPSC_MEMORY_BARRIER();
+    pxRingbuffer->xWrite = xWrite;
+    return xLen;
+}
+
+/*
+ * Copy up to xMaxLen bytes out of the buffer and free them. Only called by the
+ * consumer. Returns the number of bytes copied.
+ */
+static size_t prvCopyOut(RingbufferSpsc_t *pxRingbuffer, uint8_t *pucBuf, size_t xMaxLen)
+{
+    size_t xRead = pxRingbuffer->xRead;
+    size_t xLen = prvGetDataSize(pxRingbuffer, pxRingbuffer->xWrite, xRead);
+    if (xLen > xMaxLen) {
+        xLen = xMaxLen;
+    }
+    if (xLen == 0) {
+        return 0;
+    }
+    //Order the read of the write index before reading the data it published
+    rbSPSC_MEMORY_BARRIER();
+
+    size_t xFirst = pxRingbuffer->xSize - xRead;
+    if (xFirst > xLen) {
+        xFirst = xLen;
+    }
+    memcpy(pucBuf, pxRingbuffer->pucBuffer + xRead, xFirst);
+    memcpy(pucBuf + xFirst, pxRingbuffer->pucBuffer, xLen - xFirst);
+    xRead += xLen;
+    if (xRead >= pxRingbuffer->xSize) {
+        xRead -= pxRingbuffer->xSize;
+    }
+    //Data must have been read before the producer sees the space as free
+    rbSPSC_MEMORY_BARRIER();
+    pxRingbuffer->xRead = xRead;
+    return xLen;
+}
+
+/*
+ * Check if the consumer is blocked waiting for data that is now available.
+ * Returns pdTRUE if the consumer should be woken up.
+ */
+static BaseType_t prvCheckWakeConsumer(RingbufferSpsc_t *pxRingbuffer)
+{
+    //Pairs with the barrier in xRingbufferSpscReceive(), either the consumer
+    //sees the new data or the producer sees the consumer is waiting
+    rbSPSC_MEMORY_BARRIER();
+    size_t xWaitBytes = pxRingbuffer->xRxWaitBytes;
+    if (xWaitBytes == 0 || prvGetDataSize(pxRingbuffer, pxRingbuffer->xWrite, pxRingbuffer->xRead) < xWaitBytes) {
+        return pdFALSE;
+    }
+    pxRingbuffer->xRxWaitBytes = 0;
+    return pdTRUE;
+}
+
+//Check if the producer is blocked waiting for free space that is now available
+static BaseType_t prvCheckWakeProducer(RingbufferSpsc_t *pxRingbuffer)
+{
+    rbSPSC_MEMORY_BARRIER();
+    size_t xWaitBytes = pxRingbuffer->xTxWaitBytes;
+    if (xWaitBytes == 0 ||
+        pxRingbuffer->xSize - 1 - prvGetDataSize(pxRingbuffer, pxRingbuffer->xWrite, pxRingbuffer->xRead) < xWaitBytes) {
+        return pdFALSE;
+    }
+    pxRingbuffer->xTxWaitBytes = 0;
+    return pdTRUE;
+}
+
+/* ------------------------------------------------- Public Definitions -------------------------------------------- */
+
+RingbufSpscHandle_t xRingbufferSpscCreate(size_t xBufferSize, size_t xWakeupThreshold)
+{
+    if (xBufferSize == 0) {
+        return NULL;
+    }
+    //Allocate memory, the storage follows the structure
+    RingbufferSpsc_t *pxRingbuffer = calloc(1, sizeof(RingbufferSpsc_t) + xBufferSize + 1);
+    if (pxRingbuffer == NULL) {
+        return NULL;
+    }
+
+    //Initialize values
+    pxRingbuffer->xSize = xBufferSize + 1;
+    pxRingbuffer->pucBuffer = (uint8_t *)(pxRingbuffer + 1);
+    pxRingbuffer->xWakeupThreshold = (xWakeupThreshold == 0) ? 1 : xWakeupThreshold;
+    pxRingbuffer->xRxSemaphore = xSemaphoreCreateBinary();
+    pxRingbuffer->xTxSemaphore = xSemaphoreCreateBinary();
+    if (pxRingbuffer->xRxSemaphore == NULL || pxRingbuffer->xTxSemaphore == NULL) {
+        vRingbufferSpscDelete(pxRingbuffer);
+        return NULL;
+    }
+    return (RingbufSpscHandle_t)pxRingbuffer;
+}
+
+void vRingbufferSpscDelete(RingbufSpscHandle_t xRingbuffer)
+{
+    RingbufferSpsc_t *pxRingbuffer = (RingbufferSpsc_t *)xRingbuffer;
+    configASSERT(pxRingbuffer);
+
+    if (pxRingbuffer->xRxSemaphore) {
+        vSemaphoreDelete(pxRingbuffer->xRxSemaphore);
+    }
+    if (pxRingbuffer->xTxSemaphore) {
+        vSemaphoreDelete(pxRingbuffer->xTxSemaphore);
+    }
+    free(pxRingbuffer);
+}
+
+size_t xRingbufferSpscSend(RingbufSpscHandle_t xRingbuffer, const void *pvData, size_t xLen, TickType_t xTicksToWait)
+{
+    RingbufferSpsc_t *pxRingbuffer = (RingbufferSpsc_t *)xRingbuffer;
+    configASSERT(pxRingbuffer);
+    configASSERT(pvData != NULL || xLen == 0);
+
+    const uint8_t *pucData = (const uint8_t *)pvData;
+    size_t xSent = 0;
+    TickType_t xTicksEnd = xTaskGetTickCount() + xTicksToWait;
+    TickType_t xTicksRemaining = xTicksToWait;
+    while (1) {
+        size_t xCopied = prvCopyIn(pxRingbuffer, pucData + xSent, xLen - xSent);
+        xSent += xCopied;
+        if (xCopied > 0 && prvCheckWakeConsumer(pxRingbuffer) == pdTRUE) {
+            xSemaphoreGive(pxRingbuffer->xRxSemaphore);
+        }
+        if (xSent == xLen || xTicksRemaining == 0 || xTicksRemaining > xTicksToWait) {
+            break;      //Done, or timed out after copying what fits one last time (xTicksRemaining underflows once xTaskGetTickCount() > xTicksEnd)
+        }
+
+        //Wait for space for the rest of the data, or as much of it as the buffer can hold
+        size_t xWaitBytes = xLen - xSent;
+        if (xWaitBytes > pxRingbuffer->xSize - 1) {
+            xWaitBytes = pxRingbuffer->xSize - 1;
+        }
+        pxRingbuffer->xTxWaitBytes = xWaitBytes;
+        //Pairs with the barrier in prvCheckWakeProducer()
+        rbSPSC_MEMORY_BARRIER();
+        if (pxRingbuffer->xSize - 1 - prvGetDataSize(pxRingbuffer, pxRingbuffer->xWrite, pxRingbuffer->xRead) < xWaitBytes) {
+            xSemaphoreTake(pxRingbuffer->xTxSemaphore, xTicksRemaining);
+        }
+        pxRingbuffer->xTxWaitBytes = 0;
+        if (xTicksToWait != portMAX_DELAY) {
+            xTicksRemaining = xTicksEnd - xTaskGetTickCount();
+        }
+    }
+    return xSent;
+}
+
+size_t xRingbufferSpscSendFromISR(RingbufSpscHandle_t xRingbuffer, const void *pvData, size_t xLen, BaseType_t *pxHigherPriorityTaskWoken)
+{
+    RingbufferSpsc_t *pxRingbuffer = (RingbufferSpsc_t *)xRingbuffer;
+    configASSERT(pxRingbuffer);
+    configASSERT(pvData != NULL || xLen == 0);
+
+    size_t xSent = prvCopyIn(pxRingbuffer, (const uint8_t *)pvData, xLen);
+    if (xSent > 0 && prvCheckWakeConsumer(pxRingbuffer) == pdTRUE) {
+        xSemaphoreGiveFromISR(pxRingbuffer->xRxSemaphore, pxHigherPriorityTaskWoken);
+    }
+    return xSent;
+}
+
+size_t xRingbufferSpscReceive(RingbufSpscHandle_t xRingbuffer, void *pvBuf, size_t xMaxLen, TickType_t xTicksToWait)
+{
+    RingbufferSpsc_t *pxRingbuffer = (RingbufferSpsc_t *)xRingbuffer;
+    configASSERT(pxRingbuffer);
+    configASSERT(pvBuf != NULL || xMaxLen == 0);
+
+    //Wait until a full batch is available, or as much as the caller can take
+    size_t xWaitBytes = pxRingbuffer->xWakeupThreshold;
+    if (xWaitBytes > xMaxLen) {
+        xWaitBytes = xMaxLen;
+    }
+    if (xWaitBytes > pxRingbuffer->xSize - 1) {
+        xWaitBytes = pxRingbuffer->xSize - 1;
+    }
+    TickType_t xTicksEnd = xTaskGetTickCount() + xTicksToWait;
+    TickType_t xTicksRemaining = xTicksToWait;
+    while (xTicksRemaining > 0 && xTicksRemaining <= xTicksToWait && xWaitBytes > 0) {
+        pxRingbuffer->xRxWaitBytes = xWaitBytes;
+        //Pairs with the barrier in prvCheckWakeConsumer()
+        rbSPSC_MEMORY_BARRIER();
+        if (prvGetDataSize(pxRingbuffer, pxRingbuffer->xWrite, pxRingbuffer->xRead) >= xWaitBytes) {
+            break;
+        }
+        xSemaphoreTake(pxRingbuffer->xRxSemaphore, xTicksRemaining);
+        if (xTicksToWait != portMAX_DELAY) {
+            xTicksRemaining = xTicksEnd - xTaskGetTickCount();
+        }
+    }
+    pxRingbuffer->xRxWaitBytes = 0;
+
+    //Return whatever is available, the batch may be incomplete on time-out
+    size_t xReceived = prvCopyOut(pxRingbuffer, (uint8_t *)pvBuf, xMaxLen);
+    if (xReceived > 0 && prvCheckWakeProducer(pxRingbuffer) == pdTRUE) {
+        xSemaphoreGive(pxRingbuffer->xTxSemaphore);
+    }
+    return xReceived;
+}
+
+size_t xRingbufferSpscReceiveFromISR(RingbufSpscHandle_t xRingbuffer, void *pvBuf, size_t xMaxLen, BaseType_t *pxHigherPriorityTaskWoken)
+{
+    RingbufferSpsc_t *pxRingbuffer = (RingbufferSpsc_t *)xRingbuffer;
+    configASSERT(pxRingbuffer);
+    configASSERT(pvBuf != NULL || xMaxLen == 0);
+
+    size_t xReceived = prvCopyOut(pxRingbuffer, (uint8_t *)pvBuf, xMaxLen);
+    if (xReceived > 0 && prvCheckWakeProducer(pxRingbuffer) == pdTRUE) {
+        xSemaphoreGiveFromISR(pxRingbuffer->xTxSemaphore, pxHigherPriorityTaskWoken);
+    }
+    return xReceived;
+}
+
+size_t xRingbufferSpscGetDataSize(RingbufSpscHandle_t xRingbuffer)
+{
+    RingbufferSpsc_t *pxRingbuffer = (RingbufferSpsc_t *)xRingbuffer;
+    configASSERT(pxRingbuffer);
+    return prvGetDataSize(pxRingbuffer, pxRingbuffer->xWrite, pxRingbuffer->xRead);
+}
+
+size_t xRingbufferSpscGetFreeSize(RingbufSpscHandle_t xRingbuffer)
+{
+    RingbufferSpsc_t *pxRingbuffer = (RingbufferSpsc_t *)xRingbuffer;
+    configASSERT(pxRingbuffer);
+    return pxRingbuffer->xSize - 1 - prvGetDataSize(pxRingbuffer, pxRingbuffer->xWrite, pxRingbuffer->xRead);
+}
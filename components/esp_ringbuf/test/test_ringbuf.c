@@ -1,5 +1,6 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/queue.h"
@@ -7,6 +8,7 @@
 #include "freertos/ringbuf.h"
 #include "driver/timer.h"
 #include "esp_spi_flash.h"
+#include "esp_timer.h"
 #include "unity.h"
 #include "test_utils.h"
 
@@ -196,6 +198,49 @@ TEST_CASE("Test ring buffer No-Split", "[freertos]")
     vRingbufferDelete(buffer_handle);
 }
 
+TEST_CASE("Test ring buffer No-Split acquire and complete", "[freertos]")
+{
+    //Create buffer
+    RingbufHandle_t buffer_handle = xRingbufferCreate(BUFFER_SIZE, RINGBUF_TYPE_NOSPLIT);
+    TEST_ASSERT_MESSAGE(buffer_handle != NULL, "Failed to create ring buffer");
+    //Acquire a few items at a time, so that the buffer wraps around several times
+    int no_of_items = 3;
+    void *items[3];
+    size_t size;
+
+    for (int round = 0; round < BUFFER_SIZE / (ITEM_HDR_SIZE + SMALL_ITEM_SIZE); round++) {
+        for (int i = 0; i < no_of_items; i++) {
+            TEST_ASSERT_MESSAGE(xRingbufferSendAcquire(buffer_handle, &items[i], SMALL_ITEM_SIZE, TIMEOUT_TICKS) == pdTRUE, "Failed to acquire item");
+            TEST_ASSERT_NOT_NULL(items[i]);
+            memset(items[i], round * no_of_items + i, SMALL_ITEM_SIZE);
+        }
+        //Complete items in reverse order, none can be retrieved before the first one is complete
+        for (int i = no_of_items - 1; i > 0; i--) {
+            TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSendComplete(buffer_handle, items[i]));
+            TEST_ASSERT_NULL(xRingbufferReceive(buffer_handle, &size, 0));
+        }
+        TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSendComplete(buffer_handle, items[0]));
+
+        //Items are received in the order they were acquired
+        for (int i = 0; i < no_of_items; i++) {
+            uint8_t *item = (uint8_t *)xRingbufferReceive(buffer_handle, &size, TIMEOUT_TICKS);
+            TEST_ASSERT_MESSAGE(item == items[i], "Items received out of order");
+            TEST_ASSERT_EQUAL(SMALL_ITEM_SIZE, size);
+            for (int j = 0; j < size; j++) {
+                TEST_ASSERT_EQUAL(round * no_of_items + i, item[j]);
+            }
+            vRingbufferReturnItem(buffer_handle, item);
+        }
+    }
+
+    //Items larger than the buffer can never be acquired
+    TEST_ASSERT_EQUAL(pdFALSE, xRingbufferSendAcquire(buffer_handle, &items[0], BUFFER_SIZE, 0));
+    TEST_ASSERT_NULL(items[0]);
+
+    //Cleanup
+    vRingbufferDelete(buffer_handle);
+}
+
 TEST_CASE("Test ring buffer Allow-Split", "[freertos]")
 {
     //Create buffer
@@ -607,6 +652,110 @@ TEST_CASE("Test ring buffer SMP", "[freertos]")
     vSemaphoreDelete(tasks_done);
 }
 
+/* ------------------------ Test SPSC ring buffer -----------------------------
+ * The following test cases test the single producer, single consumer ring buffer.
+ * A sending task streams a byte pattern in chunks of random length to a receiving
+ * task on the other core, then the throughput is compared against a byte buffer.
+ */
+
+#define SPSC_BUFFER_SIZE                1024
+#define SPSC_WAKEUP_THRESHOLD           64
+#define SPSC_TEST_BYTES                 (64 * 1024)
+#define SPSC_CHUNK_SIZE                 64
+
+static void spsc_send_task(void *args)
+{
+    RingbufSpscHandle_t buffer = (RingbufSpscHandle_t)args;
+    uint8_t chunk[SPSC_CHUNK_SIZE * 2];
+    size_t bytes_sent = 0;
+    while (bytes_sent < SPSC_TEST_BYTES) {
+        size_t len = rand() % (sizeof(chunk) + 1);
+        if (len > SPSC_TEST_BYTES - bytes_sent) {
+            len = SPSC_TEST_BYTES - bytes_sent;
+        }
+        for (int i = 0; i < len; i++) {
+            chunk[i] = (uint8_t)(bytes_sent + i);
+        }
+        TEST_ASSERT_EQUAL(len, xRingbufferSpscSend(buffer, chunk, len, portMAX_DELAY));
+        bytes_sent += len;
+    }
+    xSemaphoreGive(tasks_done);
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("Test SPSC ring buffer", "[freertos]")
+{
+    RingbufSpscHandle_t buffer = xRingbufferSpscCreate(SPSC_BUFFER_SIZE, SPSC_WAKEUP_THRESHOLD);
+    TEST_ASSERT_MESSAGE(buffer != NULL, "Failed to create ring buffer");
+    tasks_done = xSemaphoreCreateBinary();
+    uint8_t data[SPSC_CHUNK_SIZE * 3];
+
+    //Nothing to receive, the data available so far is returned on time-out
+    TEST_ASSERT_EQUAL(0, xRingbufferSpscReceive(buffer, data, sizeof(data), TIMEOUT_TICKS));
+    TEST_ASSERT_EQUAL(3, xRingbufferSpscSend(buffer, "abc", 3, 0));
+    TEST_ASSERT_EQUAL(3, xRingbufferSpscReceive(buffer, data, sizeof(data), TIMEOUT_TICKS));
+    TEST_ASSERT_EQUAL(SPSC_BUFFER_SIZE, xRingbufferSpscGetFreeSize(buffer));
+
+    //Stream data to a receiving task on the other core
+    xTaskCreatePinnedToCore(spsc_send_task, "send tsk", 2048, buffer, UNITY_FREERTOS_PRIORITY, NULL, portNUM_PROCESSORS - 1);
+    size_t bytes_rec = 0;
+    while (bytes_rec < SPSC_TEST_BYTES) {
+        size_t len = xRingbufferSpscReceive(buffer, data, 1 + rand() % sizeof(data), TIMEOUT_TICKS);
+        for (int i = 0; i < len; i++) {
+            TEST_ASSERT_EQUAL_MESSAGE((uint8_t)(bytes_rec + i), data[i], "Received data is corrupted");
+        }
+        bytes_rec += len;
+    }
+    TEST_ASSERT(xSemaphoreTake(tasks_done, 1000 / portTICK_PERIOD_MS));
+    TEST_ASSERT_EQUAL(0, xRingbufferSpscGetDataSize(buffer));
+
+    vTaskDelay(5);  //Allow idle to clean up
+    vSemaphoreDelete(tasks_done);
+    vRingbufferSpscDelete(buffer);
+}
+
+TEST_CASE("Test SPSC ring buffer throughput", "[freertos]")
+{
+    const int COUNT = SPSC_TEST_BYTES / SPSC_CHUNK_SIZE;
+    static uint8_t chunk[SPSC_CHUNK_SIZE];
+    static uint8_t rec[SPSC_CHUNK_SIZE];
+    RingbufSpscHandle_t spsc_buffer = xRingbufferSpscCreate(SPSC_BUFFER_SIZE, SPSC_WAKEUP_THRESHOLD);
+    RingbufHandle_t byte_buffer = xRingbufferCreate(SPSC_BUFFER_SIZE, RINGBUF_TYPE_BYTEBUF);
+    TEST_ASSERT(spsc_buffer != NULL && byte_buffer != NULL);
+
+    //Send and receive a chunk at a time, from the same task, to compare the cost of the data path.
+    //Timings are only printed, the test checks the data.
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < COUNT; i++) {
+        memset(chunk, i, SPSC_CHUNK_SIZE);
+        TEST_ASSERT_EQUAL(SPSC_CHUNK_SIZE, xRingbufferSpscSend(spsc_buffer, chunk, SPSC_CHUNK_SIZE, 0));
+        TEST_ASSERT_EQUAL(SPSC_CHUNK_SIZE, xRingbufferSpscReceive(spsc_buffer, rec, SPSC_CHUNK_SIZE, 0));
+        TEST_ASSERT_EQUAL_MEMORY(chunk, rec, SPSC_CHUNK_SIZE);
+    }
+    int64_t spsc_time = esp_timer_get_time() - start;
+    TEST_ASSERT_EQUAL(0, xRingbufferSpscGetDataSize(spsc_buffer));
+
+    start = esp_timer_get_time();
+    for (int i = 0; i < COUNT; i++) {
+        size_t len;
+        memset(chunk, i, SPSC_CHUNK_SIZE);
+        TEST_ASSERT_EQUAL(pdTRUE, xRingbufferSend(byte_buffer, chunk, SPSC_CHUNK_SIZE, 0));
+        void *data = xRingbufferReceiveUpTo(byte_buffer, &len, 0, SPSC_CHUNK_SIZE);
+        TEST_ASSERT_NOT_NULL(data);
+        TEST_ASSERT_EQUAL(SPSC_CHUNK_SIZE, len);
+        memcpy(rec, data, len);
+        vRingbufferReturnItem(byte_buffer, data);
+        TEST_ASSERT_EQUAL_MEMORY(chunk, rec, SPSC_CHUNK_SIZE);
+    }
+    int64_t byte_time = esp_timer_get_time() - start;
+
+    printf("%d bytes in chunks of %d: SPSC ring buffer %d us, byte buffer %d us\n",
+           SPSC_TEST_BYTES, SPSC_CHUNK_SIZE, (int)spsc_time, (int)byte_time);
+
+    vRingbufferSpscDelete(spsc_buffer);
+    vRingbufferDelete(byte_buffer);
+}
+
 static IRAM_ATTR __attribute__((noinline)) bool iram_ringbuf_test()
 {
     bool result = true;
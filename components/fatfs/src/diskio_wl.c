@@ -13,20 +13,162 @@
 // limitations under the License.
 
 #include <string.h>
+#include <stdlib.h>
 #include "diskio.h"
 #include "ffconf.h"
 #include "ff.h"
 #include "esp_log.h"
+#include "esp_spi_flash.h"
 #include "diskio_wl.h"
 #include "wear_levelling.h"
+#include "sdkconfig.h"
 
 static const char* TAG = "ff_diskio_spiflash";
 
+#ifndef CONFIG_FATFS_WL_CACHE_SECTORS
+#define CONFIG_FATFS_WL_CACHE_SECTORS 0
+#endif
+
+#if CONFIG_FATFS_WL_CACHE_SECTORS > 0 && CONFIG_WL_SECTOR_MODE_SAFE
+// cached flash sectors are erased and written without the Safety mode backup
+#error "FATFS_WL_CACHE_SECTORS can not be used with WL_SECTOR_MODE_SAFE"
+#endif
+
+#define WL_CACHE_UNUSED UINT32_MAX
+
 wl_handle_t ff_wl_handles[FF_VOLUMES] = {
         WL_INVALID_HANDLE,
         WL_INVALID_HANDLE,
 };
 
+/* Flash sector of the partition held in RAM, written back when dirty */
+typedef struct {
+    uint32_t block;         /* flash sector number in the partition, or WL_CACHE_UNUSED */
+    uint32_t last_use;      /* value of use_counter at the last access */
+    bool dirty;
+    uint8_t *data;
+} wl_cache_entry_t;
+
+typedef struct {
+    size_t block_size;      /* flash sector size, multiple of the FAT sector size */
+    uint32_t use_counter;
+    uint8_t *buffer;
+    wl_cache_entry_t entries[];
+} wl_cache_t;
+
+static wl_cache_t *s_wl_cache[FF_VOLUMES];
+
+static esp_err_t wl_cache_flush_entry(wl_handle_t wl_handle, wl_cache_t *cache, wl_cache_entry_t *entry)
+{
+    if (!entry->dirty) {
+        return ESP_OK;
+    }
+    size_t addr = entry->block * cache->block_size;
+    esp_err_t err = wl_erase_range(wl_handle, addr, cache->block_size);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "wl_erase_range failed (%d)", err);
+        return err;
+    }
+    err = wl_write(wl_handle, addr, entry->data, cache->block_size);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "wl_write failed (%d)", err);
+        return err;
+    }
+    entry->dirty = false;
+    return ESP_OK;
+}
+
+static esp_err_t wl_cache_flush(BYTE pdrv)
+{
+    wl_cache_t *cache = s_wl_cache[pdrv];
+    if (cache == NULL) {
+        return ESP_OK;
+    }
+    for (int i = 0; i < CONFIG_FATFS_WL_CACHE_SECTORS; i++) {
+        esp_err_t err = wl_cache_flush_entry(ff_wl_handles[pdrv], cache, &cache->entries[i]);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    return ESP_OK;
+}
+
+static wl_cache_entry_t *wl_cache_find(wl_cache_t *cache, uint32_t block)
+{
+    for (int i = 0; i < CONFIG_FATFS_WL_CACHE_SECTORS; i++) {
+        if (cache->entries[i].block == block) {
+            cache->entries[i].last_use = ++cache->use_counter;
+            return &cache->entries[i];
+        }
+    }
+    return NULL;
+}
+
+/* Take the least recently used entry for the flash sector, its content is read from flash */
+static esp_err_t wl_cache_load(wl_handle_t wl_handle, wl_cache_t *cache, uint32_t block, wl_cache_entry_t **out_entry)
+{
+    wl_cache_entry_t *entry = &cache->entries[0];
+    for (int i = 0; i < CONFIG_FATFS_WL_CACHE_SECTORS; i++) {
+        if (cache->entries[i].block == WL_CACHE_UNUSED) {
+            entry = &cache->entries[i];
+            break;
+        }
+        if (cache->entries[i].last_use < entry->last_use) {
+            entry = &cache->entries[i];
+        }
+    }
+    esp_err_t err = wl_cache_flush_entry(wl_handle, cache, entry);
+    if (err != ESP_OK) {
+        return err;
+    }
+    entry->block = WL_CACHE_UNUSED;
+    err = wl_read(wl_handle, block * cache->block_size, entry->data, cache->block_size);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "wl_read failed (%d)", err);
+        return err;
+    }
+    entry->block = block;
+    entry->last_use = ++cache->use_counter;
+    *out_entry = entry;
+    return ESP_OK;
+}
+
+static void wl_cache_delete(BYTE pdrv)
+{
+    if (s_wl_cache[pdrv] != NULL) {
+        free(s_wl_cache[pdrv]->buffer);
+        free(s_wl_cache[pdrv]);
+        s_wl_cache[pdrv] = NULL;
+    }
+}
+
+static void wl_cache_create(BYTE pdrv, wl_handle_t wl_handle)
+{
+    if (CONFIG_FATFS_WL_CACHE_SECTORS == 0) {
+        return;
+    }
+    size_t block_size = wl_sector_size(wl_handle);
+    if (block_size < SPI_FLASH_SEC_SIZE) {
+        block_size = SPI_FLASH_SEC_SIZE;
+    }
+    wl_cache_t *cache = calloc(1, sizeof(wl_cache_t) + CONFIG_FATFS_WL_CACHE_SECTORS * sizeof(wl_cache_entry_t));
+    uint8_t *buffer = malloc(CONFIG_FATFS_WL_CACHE_SECTORS * block_size);
+    if (cache == NULL || buffer == NULL) {
+        // volume still works, uncached
+        ESP_LOGW(TAG, "no memory for the sector cache of drive %d", pdrv);
+        free(cache);
+        free(buffer);
+        return;
+    }
+    cache->block_size = block_size;
+    cache->buffer = buffer;
+    for (int i = 0; i < CONFIG_FATFS_WL_CACHE_SECTORS; i++) {
+        cache->entries[i].block = WL_CACHE_UNUSED;
+        cache->entries[i].data = buffer + i * block_size;
+    }
+    s_wl_cache[pdrv] = cache;
+}
+
 DSTATUS ff_wl_initialize (BYTE pdrv)
 {
     return 0;
@@ -42,10 +184,38 @@ DRESULT ff_wl_read (BYTE pdrv, BYTE *buff, DWORD sector, UINT count)
     ESP_LOGV(TAG, "ff_wl_read - pdrv=%i, sector=%i, count=%i\n", (unsigned int)pdrv, (unsigned int)sector, (unsigned int)count);
     wl_handle_t wl_handle = ff_wl_handles[pdrv];
     assert(wl_handle + 1);
-    esp_err_t err = wl_read(wl_handle, sector * wl_sector_size(wl_handle), buff, count * wl_sector_size(wl_handle));
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "wl_read failed (%d)", err);
-        return RES_ERROR;
+    wl_cache_t *cache = s_wl_cache[pdrv];
+    if (cache == NULL) {
+        esp_err_t err = wl_read(wl_handle, sector * wl_sector_size(wl_handle), buff, count * wl_sector_size(wl_handle));
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "wl_read failed (%d)", err);
+            return RES_ERROR;
+        }
+        return RES_OK;
+    }
+
+    // sectors of cached flash sectors come from the cache, runs of the others from flash
+    size_t sector_size = wl_sector_size(wl_handle);
+    UINT run_start = 0;
+    for (UINT i = 0; i <= count; i++) {
+        wl_cache_entry_t *entry = NULL;
+        size_t addr = (sector + i) * sector_size;
+        if (i < count) {
+            entry = wl_cache_find(cache, addr / cache->block_size);
+        }
+        if (i == count || entry != NULL) {
+            if (i > run_start) {
+                esp_err_t err = wl_read(wl_handle, (sector + run_start) * sector_size, buff + run_start * sector_size, (i - run_start) * sector_size);
+                if (err != ESP_OK) {
+                    ESP_LOGE(TAG, "wl_read failed (%d)", err);
+                    return RES_ERROR;
+                }
+            }
+            run_start = i + 1;
+        }
+        if (entry != NULL) {
+            memcpy(buff + i * sector_size, entry->data + addr % cache->block_size, sector_size);
+        }
     }
     return RES_OK;
 }
@@ -55,6 +225,36 @@ DRESULT ff_wl_write (BYTE pdrv, const BYTE *buff, DWORD sector, UINT count)
     ESP_LOGV(TAG, "ff_wl_write - pdrv=%i, sector=%i, count=%i\n", (unsigned int)pdrv, (unsigned int)sector, (unsigned int)count);
     wl_handle_t wl_handle = ff_wl_handles[pdrv];
     assert(wl_handle + 1);
+    wl_cache_t *cache = s_wl_cache[pdrv];
+    if (cache != NULL) {
+        size_t sector_size = wl_sector_size(wl_handle);
+        for (UINT i = 0; i < count; ) {
+            size_t addr = (sector + i) * sector_size;
+            uint32_t block = addr / cache->block_size;
+            size_t offset = addr % cache->block_size;
+            UINT n = (cache->block_size - offset) / sector_size;
+            if (n > count - i) {
+                n = count - i;
+            }
+            wl_cache_entry_t *entry = wl_cache_find(cache, block);
+            if (entry == NULL && offset == 0 && n * sector_size == cache->block_size) {
+                // whole flash sector, nothing to merge with
+                if (wl_erase_range(wl_handle, addr, cache->block_size) != ESP_OK ||
+                        wl_write(wl_handle, addr, buff + i * sector_size, cache->block_size) != ESP_OK) {
+                    ESP_LOGE(TAG, "write of flash sector %u failed", (unsigned int)block);
+                    return RES_ERROR;
+                }
+            } else {
+                if (entry == NULL && wl_cache_load(wl_handle, cache, block, &entry) != ESP_OK) {
+                    return RES_ERROR;
+                }
+                memcpy(entry->data + offset, buff + i * sector_size, n * sector_size);
+                entry->dirty = true;
+            }
+            i += n;
+        }
+        return RES_OK;
+    }
     esp_err_t err = wl_erase_range(wl_handle, sector * wl_sector_size(wl_handle), count * wl_sector_size(wl_handle));
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "wl_erase_range failed (%d)", err);
@@ -75,6 +275,9 @@ DRESULT ff_wl_ioctl (BYTE pdrv, BYTE cmd, void *buff)
     assert(wl_handle + 1);
     switch (cmd) {
     case CTRL_SYNC:
+        if (wl_cache_flush(pdrv) != ESP_OK) {
+            return RES_ERROR;
+        }
         return RES_OK;
     case GET_SECTOR_COUNT:
         *((DWORD *) buff) = wl_size(wl_handle) / wl_sector_size(wl_handle);
@@ -102,6 +305,8 @@ esp_err_t ff_diskio_register_wl_partition(BYTE pdrv, wl_handle_t flash_handle)
         .ioctl = &ff_wl_ioctl
     };
     ff_wl_handles[pdrv] = flash_handle;
+    wl_cache_delete(pdrv);
+    wl_cache_create(pdrv, flash_handle);
     ff_diskio_register(pdrv, &wl_impl);
     return ESP_OK;
 }
@@ -120,6 +325,10 @@ void ff_diskio_clear_pdrv_wl(wl_handle_t flash_handle)
 {
     for (int i = 0; i < FF_VOLUMES; i++) {
         if (flash_handle == ff_wl_handles[i]) {
+            if (wl_cache_flush(i) != ESP_OK) {
+                ESP_LOGE(TAG, "sector cache of drive %d not written", i);
+            }
+            wl_cache_delete(i);
             ff_wl_handles[i] = WL_INVALID_HANDLE;
         }
     }
@@ -243,6 +243,17 @@
 #endif
 
 
+/* Free cluster bitmap controls */
+#if FF_USE_FREE_BITMAP
+#if FF_FS_READONLY
+#error FF_USE_FREE_BITMAP must be 0 at read-only configuration
+#endif
+#define FBMP_TEST(fs, c)	((fs)->fbmp[(c) / 8] & (1 << ((c) % 8)))
+#define FBMP_SET(fs, c)		((fs)->fbmp[(c) / 8] |= (BYTE)(1 << ((c) % 8)))
+#define FBMP_CLR(fs, c)		((fs)->fbmp[(c) / 8] &= (BYTE)~(1 << ((c) % 8)))
+#endif
+
+
 /* File lock controls */
 #if FF_FS_LOCK != 0
 #if FF_FS_READONLY
@@ -1264,6 +1275,15 @@ FRESULT put_fat (	/* FR_OK(0):succeeded, !=0:error */
 			fs->wflag = 1;
 			break;
 		}
+#if FF_USE_FREE_BITMAP
+		if (res == FR_OK && fs->fbmp) {	/* Keep the free cluster bitmap in sync with the FAT */
+			if (val == 0) {
+				FBMP_CLR(fs, clst);
+			} else {
+				FBMP_SET(fs, clst);
+			}
+		}
+#endif
 	}
 	return res;
 }
@@ -1273,6 +1293,116 @@ FRESULT put_fat (	/* FR_OK(0):succeeded, !=0:error */
 
 
 
+#if FF_USE_FREE_BITMAP
+/*-----------------------------------------------------------------------*/
+/* FAT access - Build the free cluster bitmap                            */
+/*-----------------------------------------------------------------------*/
+/* Scans the whole FAT once and counts the free clusters on the way.      */
+/* The bitmap is then kept in sync by put_fat().                          */
+
+static
+FRESULT build_fbmp (	/* FR_OK(0):succeeded, !=0:error (bitmap not built) */
+	FATFS* fs			/* Filesystem object (FAT12/16/32) */
+)
+{
+	FRESULT res = FR_OK;
+	DWORD nfree = 0, clst, sect, stat;
+	UINT i, nb;
+	BYTE *bm;
+	FFOBJID obj;
+
+
+	nb = (UINT)((fs->n_fatent + 7) / 8);
+	bm = ff_memalloc(nb);
+	if (!bm) return FR_NOT_ENOUGH_CORE;
+	mem_set(bm, 0, nb);
+	fs->fbmp = bm;
+	FBMP_SET(fs, 0); FBMP_SET(fs, 1);	/* Reserved entries */
+	for (clst = fs->n_fatent; clst < (DWORD)nb * 8; clst++) FBMP_SET(fs, clst);	/* Padding bits beyond the last cluster */
+
+	if (fs->fs_type == FS_FAT12) {	/* FAT12: Scan bit field FAT entries */
+		obj.fs = fs;
+		for (clst = 2; clst < fs->n_fatent; clst++) {
+			stat = get_fat(&obj, clst);
+			if (stat == 0xFFFFFFFF) { res = FR_DISK_ERR; break; }
+			if (stat == 1) { res = FR_INT_ERR; break; }
+			if (stat == 0) {
+				nfree++;
+			} else {
+				FBMP_SET(fs, clst);
+			}
+		}
+	} else {	/* FAT16/32: Scan WORD/DWORD FAT entries */
+		clst = 0;				/* Entry index */
+		sect = fs->fatbase;		/* Top of the FAT */
+		i = 0;					/* Offset in the sector */
+		do {
+			if (i == 0) {
+				res = move_window(fs, sect++);
+				if (res != FR_OK) break;
+			}
+			if (fs->fs_type == FS_FAT16) {
+				stat = ld_word(fs->win + i);
+				i += 2;
+			} else {
+				stat = ld_dword(fs->win + i) & 0x0FFFFFFF;
+				i += 4;
+			}
+			i %= SS(fs);
+			if (clst >= 2) {
+				if (stat == 0) {
+					nfree++;
+				} else {
+					FBMP_SET(fs, clst);
+				}
+			}
+		} while (++clst < fs->n_fatent);
+	}
+
+	if (res != FR_OK) {
+		fs->fbmp = 0;
+		ff_memfree(bm);
+		return res;
+	}
+	fs->free_clst = nfree;	/* Now free_clst is valid */
+	fs->fsi_flag |= 1;		/* FAT32: FSInfo is to be updated */
+	return FR_OK;
+}
+
+
+
+
+/*-----------------------------------------------------------------------*/
+/* FAT access - Find a free cluster in the free cluster bitmap           */
+/*-----------------------------------------------------------------------*/
+
+static
+DWORD find_fbmp (	/* 0:No free cluster, >=2:Free cluster# */
+	FATFS* fs,		/* Filesystem object with the bitmap built */
+	DWORD scl		/* Cluster# to start to find after (1..n_fatent-1) */
+)
+{
+	DWORD ncl = scl, n = fs->n_fatent - 2;	/* Number of clusters to test */
+
+
+	while (n) {
+		ncl++;
+		if (ncl >= fs->n_fatent) ncl = 2;	/* Wrap-around */
+		if (ncl % 8 == 0 && n >= 8 && ncl + 8 <= fs->n_fatent && fs->fbmp[ncl / 8] == 0xFF) {
+			ncl += 7; n -= 8;	/* Skip a byte of clusters in use */
+			continue;
+		}
+		if (!FBMP_TEST(fs, ncl)) return ncl;
+		n--;
+	}
+	return 0;
+}
+
+#endif /* FF_USE_FREE_BITMAP */
+
+
+
+
 #if FF_FS_EXFAT && !FF_FS_READONLY
 /*-----------------------------------------------------------------------*/
 /* exFAT: Accessing FAT and Allocation Bitmap                            */
@@ -1557,6 +1687,24 @@ DWORD create_chain (	/* 0:No free cluster, 1:Internal error, 0xFFFFFFFF:Disk err
 #endif
 	{	/* On the FAT/FAT32 volume */
 		ncl = 0;
+#if FF_USE_FREE_BITMAP
+		if (!fs->fbmp) build_fbmp(fs);			/* Build the bitmap at first allocation, scan the FAT if failed */
+		if (fs->fbmp) {
+			if (scl == clst) {					/* Stretching an existing chain? */
+				ncl = scl + 1;					/* Test if next cluster is free */
+				if (ncl >= fs->n_fatent) ncl = 2;
+				if (FBMP_TEST(fs, ncl)) {		/* Not free? */
+					cs = fs->last_clst;			/* Start at suggested cluster if it is valid */
+					if (cs >= 2 && cs < fs->n_fatent) scl = cs;
+					ncl = 0;
+				}
+			}
+			if (ncl == 0) {
+				ncl = find_fbmp(fs, scl);		/* Find another fragment */
+				if (ncl == 0) return 0;			/* No free cluster found? */
+			}
+		} else
+#endif
 		if (scl == clst) {						/* Stretching an existing chain? */
 			ncl = scl + 1;						/* Test if next cluster is free */
 			if (ncl >= fs->n_fatent) ncl = 2;
@@ -3263,6 +3411,10 @@ FRESULT find_volume (	/* FR_OK(0): successful, !=0: any error occurred */
 	/* Following code attempts to mount the volume. (analyze BPB and initialize the filesystem object) */
 
 	fs->fs_type = 0;					/* Clear the filesystem object */
+#if FF_USE_FREE_BITMAP
+	ff_memfree(fs->fbmp);				/* Discard the free cluster bitmap of the previous medium */
+	fs->fbmp = 0;
+#endif
 	fs->pdrv = LD2PD(vol);				/* Bind the logical drive and a physical drive */
 	stat = disk_initialize(fs->pdrv);	/* Initialize the physical drive */
 	if (stat & STA_NOINIT) { 			/* Check if the initialization succeeded */
@@ -3515,10 +3667,17 @@ FRESULT f_mount (
 		if (!ff_del_syncobj(cfs->sobj)) return FR_INT_ERR;
 #endif
 		cfs->fs_type = 0;				/* Clear old fs object */
+#if FF_USE_FREE_BITMAP
+		ff_memfree(cfs->fbmp);			/* Discard the free cluster bitmap */
+		cfs->fbmp = 0;
+#endif
 	}
 
 	if (fs) {
 		fs->fs_type = 0;				/* Clear new fs object */
+#if FF_USE_FREE_BITMAP
+		fs->fbmp = 0;
+#endif
 #if FF_FS_REENTRANT						/* Create sync object for the new volume */
 		if (!ff_cre_syncobj((BYTE)vol, &fs->sobj)) return FR_INT_ERR;
 #endif
@@ -4373,6 +4532,67 @@ FRESULT f_lseek (
 
 
 
+#if FF_USE_FASTSEEK
+/*-----------------------------------------------------------------------*/
+/* Append New Clusters to the Cluster Link Map Table                     */
+/*-----------------------------------------------------------------------*/
+/* Continues the chain walk of f_lseek(fp, CREATE_LINKMAP) from the last */
+/* mapped cluster, so that clusters added to the file while the table    */
+/* was detached get mapped without walking the chain from its top.       */
+
+FRESULT f_update_linkmap (
+	FIL* fp,		/* Pointer to the file object with a created link map table */
+	DWORD tlen		/* Size of the table buffer in items */
+)
+{
+	FRESULT res;
+	FATFS *fs;
+	DWORD cl, pcl, ncl, tcl, ulen, *tbl;
+
+	res = validate(&fp->obj, &fs);		/* Check validity of the file object */
+	if (res == FR_OK) res = (FRESULT)fp->err;
+	if (res == FR_OK && !fp->cltbl) res = FR_INVALID_PARAMETER;
+	if (res != FR_OK) LEAVE_FF(fs, res);
+
+	tbl = fp->cltbl;
+	ulen = tbl[0];					/* Number of items used */
+	if (ulen > 2) {					/* Reopen the last fragment at its last cluster */
+		ulen -= 2;
+		ncl = tbl[ulen - 1]; tcl = tbl[ulen];
+		cl = tcl + ncl - 1;
+	} else {						/* Nothing mapped yet */
+		cl = fp->obj.sclust;
+		if (cl == 0) LEAVE_FF(fs, FR_OK);
+		ulen = 2; tcl = cl; ncl = 1;
+	}
+	for (;;) {
+		pcl = cl;
+		cl = get_fat(&fp->obj, cl);
+		if (cl <= 1) ABORT(fs, FR_INT_ERR);
+		if (cl == 0xFFFFFFFF) ABORT(fs, FR_DISK_ERR);
+		if (cl != pcl + 1 || cl >= fs->n_fatent) {	/* End of the fragment */
+			ulen += 2;
+			if (ulen <= tlen) {		/* Store the length and top of the fragment */
+				tbl[ulen - 3] = ncl; tbl[ulen - 2] = tcl;
+			}
+			if (cl >= fs->n_fatent) break;			/* End of chain */
+			tcl = cl; ncl = 0;
+		}
+		ncl++;
+	}
+	tbl[0] = ulen;
+	if (ulen <= tlen) {
+		tbl[ulen - 1] = 0;		/* Terminate table */
+	} else {
+		res = FR_NOT_ENOUGH_CORE;	/* Given table size is smaller than required */
+	}
+
+	LEAVE_FF(fs, res);
+}
+#endif
+
+
+
 #if FF_FS_MINIMIZE <= 1
 /*-----------------------------------------------------------------------*/
 /* Create a Directory Object                                             */
@@ -4620,6 +4840,11 @@ FRESULT f_getfree (
 		} else {
 			/* Scan FAT to obtain number of free clusters */
 			nfree = 0;
+#if FF_USE_FREE_BITMAP
+			if (fs->fs_type != FS_EXFAT && (fs->fbmp || build_fbmp(fs) == FR_OK)) {	/* Count them while building the free cluster bitmap */
+				nfree = fs->free_clst;
+			} else
+#endif
 			if (fs->fs_type == FS_FAT12) {	/* FAT12: Scan bit field FAT entries */
 				clst = 2; obj.fs = fs;
 				do {
@@ -44,7 +44,11 @@
 /* This option switches f_mkfs() function. (0:Disable or 1:Enable) */
 
 
+#ifdef CONFIG_FATFS_USE_FASTSEEK
+#define FF_USE_FASTSEEK	1
+#else
 #define FF_USE_FASTSEEK	0
+#endif
 /* This option switches fast seek function. (0:Disable or 1:Enable) */
 
 
@@ -216,6 +220,19 @@
 /  GET_SECTOR_SIZE command. */
 
 
+#ifdef CONFIG_FATFS_FREE_CLUSTER_BITMAP
+#define FF_USE_FREE_BITMAP	1
+#else
+#define FF_USE_FREE_BITMAP	0
+#endif
+/* This option switches the in-memory free cluster bitmap of FAT12/16/32 volumes.
+/  (0:Disable or 1:Enable) When enabled, the bitmap is built by scanning the FAT
+/  once, at the first cluster allocation or f_getfree() after mount, and cluster
+/  allocation searches it instead of reading FAT sectors. It takes one bit per
+/  cluster, allocated with ff_memalloc(). If the allocation fails, the FAT is
+/  scanned as usual. */
+
+
 #define FF_USE_TRIM		0
 /* This option switches support for ATA-TRIM. (0:Disable or 1:Enable)
 /  To enable Trim function, also CTRL_TRIM command should be implemented to the
@@ -33,6 +33,9 @@ typedef struct {
     char tmp_path_buf[FILENAME_MAX+3];  /* temporary buffer used to prepend drive name to the path */
     char tmp_path_buf2[FILENAME_MAX+3]; /* as above; used in functions which take two path arguments */
     bool *o_append;  /* O_APPEND is stored here for each max_files entries (because O_APPEND is not compatible with FA_OPEN_APPEND) */
+#if FF_USE_FASTSEEK
+    DWORD **cltbl;   /* cluster link map table buffer of each of max_files entries, allocated on the first seek */
+#endif
     FIL files[0];   /* array with max_files entries; must be the final member of the structure */
 } vfs_fat_ctx_t;
 
@@ -65,6 +68,10 @@ typedef union {
 
 static const char* TAG = "vfs_fat";
 
+#if FF_USE_FASTSEEK
+#define FAST_SEEK_TABLE_SIZE CONFIG_FATFS_FAST_SEEK_BUFFER_SIZE
+#endif
+
 static ssize_t vfs_fat_write(void* p, int fd, const void * data, size_t size);
 static off_t vfs_fat_lseek(void* p, int fd, off_t size, int mode);
 static ssize_t vfs_fat_read(void* ctx, int fd, void * dst, size_t size);
@@ -159,12 +166,23 @@ esp_err_t esp_vfs_fat_register(const char* base_path, const char* fat_drive, siz
         free(fat_ctx);
         return ESP_ERR_NO_MEM;
     }
+#if FF_USE_FASTSEEK
+    fat_ctx->cltbl = calloc(max_files, sizeof(DWORD*));
+    if (fat_ctx->cltbl == NULL) {
+        free(fat_ctx->o_append);
+        free(fat_ctx);
+        return ESP_ERR_NO_MEM;
+    }
+#endif
     fat_ctx->max_files = max_files;
     strlcpy(fat_ctx->fat_drive, fat_drive, sizeof(fat_ctx->fat_drive) - 1);
     strlcpy(fat_ctx->base_path, base_path, sizeof(fat_ctx->base_path) - 1);
 
     esp_err_t err = esp_vfs_register(base_path, &vfs, fat_ctx);
     if (err != ESP_OK) {
+#if FF_USE_FASTSEEK
+        free(fat_ctx->cltbl);
+#endif
         free(fat_ctx->o_append);
         free(fat_ctx);
         return err;
@@ -193,6 +211,12 @@ esp_err_t esp_vfs_fat_unregister_path(const char* base_path)
         return err;
     }
     _lock_close(&fat_ctx->lock);
+#if FF_USE_FASTSEEK
+    for (size_t i = 0; i < fat_ctx->max_files; i++) {
+        free(fat_ctx->cltbl[i]);
+    }
+    free(fat_ctx->cltbl);
+#endif
     free(fat_ctx->o_append);
     free(fat_ctx);
     s_fat_ctxs[ctx] = NULL;
@@ -278,8 +302,57 @@ static int fresult_to_errno(FRESULT fr)
 static void file_cleanup(vfs_fat_ctx_t* ctx, int fd)
 {
     memset(&ctx->files[fd], 0, sizeof(FIL));
+#if FF_USE_FASTSEEK
+    free(ctx->cltbl[fd]);
+    ctx->cltbl[fd] = NULL;
+#endif
 }
 
+#if FF_USE_FASTSEEK
+/**
+ * @brief Create the cluster link map of a file, used by FATFS to seek
+ * without following the cluster chain.
+ * Nothing is done if the map has been created before. If the file is too
+ * fragmented for the table, the buffer is kept but not used until the
+ * file is closed.
+ */
+static void file_map_create(vfs_fat_ctx_t* ctx, int fd)
+{
+    FIL* file = &ctx->files[fd];
+    if (ctx->cltbl[fd] != NULL || file->obj.sclust == 0) {
+        return;
+    }
+    DWORD* tbl = malloc(FAST_SEEK_TABLE_SIZE * sizeof(DWORD));
+    if (tbl == NULL) {
+        return;
+    }
+    ctx->cltbl[fd] = tbl;
+    tbl[0] = FAST_SEEK_TABLE_SIZE;
+    file->cltbl = tbl;
+    FRESULT res = f_lseek(file, CREATE_LINKMAP);
+    if (res != FR_OK) {
+        ESP_LOGD(TAG, "%s: fresult=%d", __func__, res);
+        file->cltbl = NULL;
+    }
+}
+
+/**
+ * @brief Map the clusters added to a file while its link map was detached.
+ * FATFS doesn't allocate clusters while a link map is in use, so the map is
+ * detached for writes and seeks which may extend the file.
+ */
+static void file_map_update(vfs_fat_ctx_t* ctx, int fd)
+{
+    FIL* file = &ctx->files[fd];
+    file->cltbl = ctx->cltbl[fd];
+    FRESULT res = f_update_linkmap(file, FAST_SEEK_TABLE_SIZE);
+    if (res != FR_OK) {
+        ESP_LOGD(TAG, "%s: fresult=%d", __func__, res);
+        file->cltbl = NULL;
+    }
+}
+#endif // FF_USE_FASTSEEK
+
 /**
  * @brief Prepend drive letters to path names
  * This function returns new path path pointers, pointing to a temporary buffer
@@ -344,7 +417,16 @@ static ssize_t vfs_fat_write(void* ctx, int fd, const void * data, size_t size)
         }
     }
     unsigned written = 0;
+#if FF_USE_FASTSEEK
+    DWORD* cltbl = file->cltbl;
+    file->cltbl = NULL;
+#endif
     res = f_write(file, data, size, &written);
+#if FF_USE_FASTSEEK
+    if (cltbl != NULL) {
+        file_map_update(fat_ctx, fd);
+    }
+#endif
     if (res != FR_OK) {
         ESP_LOGD(TAG, "%s: fresult=%d", __func__, res);
         errno = fresult_to_errno(res);
@@ -421,7 +503,21 @@ static off_t vfs_fat_lseek(void* ctx, int fd, off_t offset, int mode)
         errno = EINVAL;
         return -1;
     }
+#if FF_USE_FASTSEEK
+    file_map_create(fat_ctx, fd);
+    DWORD* cltbl = NULL;
+    if (new_pos > f_size(file)) {
+        // seeking past the end allocates clusters
+        cltbl = file->cltbl;
+        file->cltbl = NULL;
+    }
+#endif
     FRESULT res = f_lseek(file, new_pos);
+#if FF_USE_FASTSEEK
+    if (cltbl != NULL) {
+        file_map_update(fat_ctx, fd);
+    }
+#endif
     if (res != FR_OK) {
         ESP_LOGD(TAG, "%s: fresult=%d", __func__, res);
         errno = fresult_to_errno(res);
@@ -29,6 +29,9 @@
 #include "test_fatfs_common.h"
 #include "wear_levelling.h"
 #include "esp_partition.h"
+#include "esp_spi_flash.h"
+#include "diskio.h"
+#include "diskio_wl.h"
 
 
 static wl_handle_t s_test_wl_handle;
@@ -187,6 +190,137 @@ TEST_CASE("(WL) write/read speed test", "[fatfs][wear_levelling][timeout=60]")
     test_teardown();
 }
 
+#if CONFIG_FATFS_WL_CACHE_SECTORS > 0
+static wl_handle_t s_cache_wl_handle;
+static BYTE s_cache_pdrv;
+static size_t s_cache_sector_size;
+static size_t s_cache_block_size;
+
+static void cache_test_setup()
+{
+    const esp_partition_t* part = get_test_data_partition();
+    TEST_ESP_OK(wl_mount(part, &s_cache_wl_handle));
+    TEST_ESP_OK(ff_diskio_get_drive(&s_cache_pdrv));
+    TEST_ESP_OK(ff_diskio_register_wl_partition(s_cache_pdrv, s_cache_wl_handle));
+    s_cache_sector_size = wl_sector_size(s_cache_wl_handle);
+    s_cache_block_size = s_cache_sector_size < SPI_FLASH_SEC_SIZE ? SPI_FLASH_SEC_SIZE : s_cache_sector_size;
+}
+
+static void cache_test_teardown()
+{
+    ff_diskio_clear_pdrv_wl(s_cache_wl_handle);
+    ff_diskio_unregister(s_cache_pdrv);
+    TEST_ESP_OK(wl_unmount(s_cache_wl_handle));
+}
+
+/* Fill flash sectors [first, first + count) of the volume with the pattern, bypassing the cache */
+static void cache_test_fill_blocks(uint32_t first, uint32_t count, uint8_t pattern)
+{
+    uint8_t* buf = malloc(s_cache_block_size);
+    TEST_ASSERT_NOT_NULL(buf);
+    memset(buf, pattern, s_cache_block_size);
+    for (uint32_t i = first; i < first + count; i++) {
+        TEST_ESP_OK(wl_erase_range(s_cache_wl_handle, i * s_cache_block_size, s_cache_block_size));
+        TEST_ESP_OK(wl_write(s_cache_wl_handle, i * s_cache_block_size, buf, s_cache_block_size));
+    }
+    free(buf);
+}
+
+#if CONFIG_WL_SECTOR_SIZE < 4096
+TEST_CASE("(WL) sector cache merges partial writes and flushes them on sync", "[fatfs][wear_levelling]")
+{
+    cache_test_setup();
+    const UINT per_block = s_cache_block_size / s_cache_sector_size;
+    uint8_t* sector = malloc(s_cache_sector_size);
+    uint8_t* expected = malloc(s_cache_block_size);
+    uint8_t* actual = malloc(s_cache_block_size);
+    TEST_ASSERT_NOT_NULL(sector);
+    TEST_ASSERT_NOT_NULL(expected);
+    TEST_ASSERT_NOT_NULL(actual);
+
+    cache_test_fill_blocks(0, 1, 0xa5);
+    memset(sector, 0x5a, s_cache_sector_size);
+    TEST_ASSERT_EQUAL(RES_OK, ff_disk_write(s_cache_pdrv, sector, 1, 1));
+
+    // the volume sees the merged flash sector, the flash still has the old one
+    memset(expected, 0xa5, s_cache_block_size);
+    memset(expected + s_cache_sector_size, 0x5a, s_cache_sector_size);
+    TEST_ASSERT_EQUAL(RES_OK, ff_disk_read(s_cache_pdrv, actual, 0, per_block));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, actual, s_cache_block_size);
+    TEST_ESP_OK(wl_read(s_cache_wl_handle, 0, actual, s_cache_block_size));
+    TEST_ASSERT_EACH_EQUAL_HEX8(0xa5, actual, s_cache_block_size);
+
+    // a read spanning cached and uncached flash sectors
+    cache_test_fill_blocks(1, 1, 0x3c);
+    TEST_ASSERT_EQUAL(RES_OK, ff_disk_read(s_cache_pdrv, actual, 1, per_block));
+    TEST_ASSERT_EACH_EQUAL_HEX8(0x5a, actual, s_cache_sector_size);
+    TEST_ASSERT_EACH_EQUAL_HEX8(0xa5, actual + s_cache_sector_size, (per_block - 2) * s_cache_sector_size);
+    TEST_ASSERT_EACH_EQUAL_HEX8(0x3c, actual + (per_block - 1) * s_cache_sector_size, s_cache_sector_size);
+
+    TEST_ASSERT_EQUAL(RES_OK, ff_disk_ioctl(s_cache_pdrv, CTRL_SYNC, NULL));
+    memset(expected, 0xa5, s_cache_block_size);
+    memset(expected + s_cache_sector_size, 0x5a, s_cache_sector_size);
+    TEST_ESP_OK(wl_read(s_cache_wl_handle, 0, actual, s_cache_block_size));
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, actual, s_cache_block_size);
+
+    free(sector);
+    free(expected);
+    free(actual);
+    cache_test_teardown();
+}
+
+TEST_CASE("(WL) sector cache writes back evicted sectors and flushes on unmount", "[fatfs][wear_levelling]")
+{
+    cache_test_setup();
+    const uint32_t blocks = CONFIG_FATFS_WL_CACHE_SECTORS + 1;
+    uint8_t* sector = malloc(s_cache_sector_size);
+    uint8_t* actual = malloc(s_cache_sector_size);
+    TEST_ASSERT_NOT_NULL(sector);
+    TEST_ASSERT_NOT_NULL(actual);
+
+    cache_test_fill_blocks(0, blocks, 0xff);
+    for (uint32_t i = 0; i < blocks; i++) {
+        memset(sector, i, s_cache_sector_size);
+        TEST_ASSERT_EQUAL(RES_OK, ff_disk_write(s_cache_pdrv, sector, i * (s_cache_block_size / s_cache_sector_size), 1));
+    }
+    // the first flash sector was evicted to make room for the last one
+    TEST_ESP_OK(wl_read(s_cache_wl_handle, 0, actual, s_cache_sector_size));
+    TEST_ASSERT_EACH_EQUAL_HEX8(0, actual, s_cache_sector_size);
+    TEST_ESP_OK(wl_read(s_cache_wl_handle, (blocks - 1) * s_cache_block_size, actual, s_cache_sector_size));
+    TEST_ASSERT_EACH_EQUAL_HEX8(0xff, actual, s_cache_sector_size);
+
+    ff_diskio_clear_pdrv_wl(s_cache_wl_handle);
+    for (uint32_t i = 0; i < blocks; i++) {
+        TEST_ESP_OK(wl_read(s_cache_wl_handle, i * s_cache_block_size, actual, s_cache_sector_size));
+        TEST_ASSERT_EACH_EQUAL_HEX8(i, actual, s_cache_sector_size);
+    }
+
+    free(sector);
+    free(actual);
+    ff_diskio_unregister(s_cache_pdrv);
+    TEST_ESP_OK(wl_unmount(s_cache_wl_handle));
+}
+#endif // CONFIG_WL_SECTOR_SIZE < 4096
+
+TEST_CASE("(WL) sector cache writes whole uncached flash sectors through", "[fatfs][wear_levelling]")
+{
+    cache_test_setup();
+    const UINT per_block = s_cache_block_size / s_cache_sector_size;
+    uint8_t* buf = malloc(s_cache_block_size);
+    TEST_ASSERT_NOT_NULL(buf);
+
+    cache_test_fill_blocks(2, 1, 0xff);
+    memset(buf, 0x69, s_cache_block_size);
+    TEST_ASSERT_EQUAL(RES_OK, ff_disk_write(s_cache_pdrv, buf, 2 * per_block, per_block));
+    memset(buf, 0, s_cache_block_size);
+    TEST_ESP_OK(wl_read(s_cache_wl_handle, 2 * s_cache_block_size, buf, s_cache_block_size));
+    TEST_ASSERT_EACH_EQUAL_HEX8(0x69, buf, s_cache_block_size);
+
+    free(buf);
+    cache_test_teardown();
+}
+#endif // CONFIG_FATFS_WL_CACHE_SECTORS > 0
+
 /*
  * In FatFs menuconfig, set CONFIG_FATFS_API_ENCODING to UTF-8 and set the
  * Codepage to CP936 (Simplified Chinese) in order to run the following tests.
@@ -2,5 +2,8 @@
 
 #define CONFIG_WL_SECTOR_SIZE   4096
 #define CONFIG_LOG_DEFAULT_LEVEL 3
+#define CONFIG_LOG_MAXIMUM_LEVEL 3
 #define CONFIG_PARTITION_TABLE_OFFSET 0x8000
 #define CONFIG_ESPTOOLPY_FLASHSIZE "8MB"
+#define CONFIG_FATFS_USE_FASTSEEK 1
+#define CONFIG_FATFS_FREE_CLUSTER_BITMAP 1
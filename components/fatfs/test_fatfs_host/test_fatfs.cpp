@@ -1,5 +1,7 @@
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
+#include <vector>
 
 #include "ff.h"
 #include "esp_partition.h"
@@ -91,3 +93,346 @@ TEST_CASE("create volume, open file, write and read back data", "[fatfs]")
     free(read);
     free(data);
 }
+
+// Formats the storage partition and mounts it as logical drive "<pdrv>:"
+static void mount_new_volume(FATFS* fs, wl_handle_t* wl_handle, BYTE* pdrv, char* drv)
+{
+    init_spi_flash(CONFIG_ESPTOOLPY_FLASHSIZE, CONFIG_WL_SECTOR_SIZE * 16, CONFIG_WL_SECTOR_SIZE, CONFIG_WL_SECTOR_SIZE, "partition_table.bin");
+
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_FAT, "storage");
+    REQUIRE(partition != NULL);
+    REQUIRE(wl_mount(partition, wl_handle) == ESP_OK);
+    REQUIRE(ff_diskio_get_drive(pdrv) == ESP_OK);
+    REQUIRE(ff_diskio_register_wl_partition(*pdrv, *wl_handle) == ESP_OK);
+    sprintf(drv, "%d:", *pdrv);
+
+    DWORD part_list[] = {100, 0, 0, 0};
+    BYTE work_area[FF_MAX_SS];
+    REQUIRE(f_fdisk(*pdrv, part_list, work_area) == FR_OK);
+    REQUIRE(f_mkfs(drv, FM_ANY, 0, work_area, sizeof(work_area)) == FR_OK);
+    REQUIRE(f_mount(fs, drv, 1) == FR_OK);
+}
+
+static void unmount_volume(wl_handle_t wl_handle, BYTE pdrv, const char* drv)
+{
+    REQUIRE(f_mount(NULL, drv, 0) == FR_OK);
+    ff_diskio_register(pdrv, NULL);
+    REQUIRE(wl_unmount(wl_handle) == ESP_OK);
+}
+
+static void make_path(char* path, const char* drv, const char* name)
+{
+    sprintf(path, "%s%s", drv, name);
+}
+
+// Appends the data to the file, writing a cluster of the other file after
+// each run bytes such that the file is split into fragments
+static void append_fragmented(FIL* file, FIL* other, const uint8_t* data, UINT size, UINT run, UINT cluster_size)
+{
+    std::vector<uint8_t> filler(cluster_size, 0xA5);
+    UINT bw;
+
+    REQUIRE(f_lseek(file, f_size(file)) == FR_OK);
+    REQUIRE(f_lseek(other, f_size(other)) == FR_OK);
+    for (UINT done = 0; done < size; done += run) {
+        UINT len = (size - done < run) ? size - done : run;
+        REQUIRE(f_write(file, data + done, len, &bw) == FR_OK);
+        REQUIRE(bw == len);
+        REQUIRE(f_write(other, filler.data(), cluster_size, &bw) == FR_OK);
+        REQUIRE(bw == cluster_size);
+    }
+    REQUIRE(f_sync(other) == FR_OK);
+}
+
+// Reads at random positions with the link map attached and detached, both
+// must return the expected content
+static void check_random_reads(FIL* file, DWORD* tbl, const std::vector<uint8_t>& expected, UINT max_len)
+{
+    std::vector<uint8_t> fast(max_len), slow(max_len);
+    UINT br;
+
+    REQUIRE(f_size(file) == expected.size());
+    for (int i = 0; i < 200; i++) {
+        FSIZE_t ofs = rand() % expected.size();
+        UINT len = 1 + rand() % max_len;
+        if (len > expected.size() - ofs) {
+            len = expected.size() - ofs;
+        }
+        file->cltbl = tbl;
+        REQUIRE(f_lseek(file, ofs) == FR_OK);
+        REQUIRE(f_read(file, fast.data(), len, &br) == FR_OK);
+        REQUIRE(br == len);
+        file->cltbl = NULL;
+        REQUIRE(f_lseek(file, ofs) == FR_OK);
+        REQUIRE(f_read(file, slow.data(), len, &br) == FR_OK);
+        REQUIRE(br == len);
+        REQUIRE(memcmp(fast.data(), &expected[ofs], len) == 0);
+        REQUIRE(memcmp(slow.data(), &expected[ofs], len) == 0);
+    }
+    file->cltbl = tbl;
+}
+
+// The updated link map must be the one created from scratch
+static void check_linkmap(FIL* file, DWORD* tbl, DWORD tlen)
+{
+    std::vector<DWORD> fresh(tlen);
+    fresh[0] = tlen;
+    file->cltbl = fresh.data();
+    REQUIRE(f_lseek(file, CREATE_LINKMAP) == FR_OK);
+    file->cltbl = tbl;
+    REQUIRE(fresh[0] == tbl[0]);
+    REQUIRE(memcmp(fresh.data(), tbl, tbl[0] * sizeof(DWORD)) == 0);
+}
+
+// The link map is handled as in vfs_fat.c: it is detached for writes and
+// seeks which may extend the file, then updated with f_update_linkmap, and
+// dropped for good if it overflows.
+TEST_CASE("fast seek with the cluster link map", "[fatfs]")
+{
+    FATFS fs;
+    wl_handle_t wl_handle;
+    BYTE pdrv;
+    char drv[4];
+    char path_a[16], path_b[16];
+    FIL file, other;
+
+    mount_new_volume(&fs, &wl_handle, &pdrv, drv);
+    make_path(path_a, drv, "a.bin");
+    make_path(path_b, drv, "b.bin");
+
+    const UINT cluster_size = fs.csize * fs.ssize;
+    const int fragments = 40;
+
+    srand(1);
+    std::vector<uint8_t> expected(fragments * cluster_size - 100);
+    for (size_t i = 0; i < expected.size(); i++) {
+        expected[i] = rand();
+    }
+
+    REQUIRE(f_open(&file, path_a, FA_CREATE_ALWAYS | FA_READ | FA_WRITE) == FR_OK);
+    REQUIRE(f_open(&other, path_b, FA_CREATE_ALWAYS | FA_WRITE) == FR_OK);
+    append_fragmented(&file, &other, expected.data(), expected.size(), cluster_size, cluster_size);
+    REQUIRE(f_sync(&file) == FR_OK);
+
+    DWORD tbl[128];
+    const DWORD tlen = sizeof(tbl) / sizeof(tbl[0]);
+
+    SECTION("random reads across a fragmented file") {
+        tbl[0] = tlen;
+        file.cltbl = tbl;
+        REQUIRE(f_lseek(&file, CREATE_LINKMAP) == FR_OK);
+        REQUIRE(tbl[0] == 2 + 2 * fragments);
+        check_random_reads(&file, tbl, expected, 3 * cluster_size);
+    }
+
+    SECTION("append and extend with the link map attached") {
+        tbl[0] = tlen;
+        file.cltbl = tbl;
+        REQUIRE(f_lseek(&file, CREATE_LINKMAP) == FR_OK);
+
+        std::vector<uint8_t> data(5 * cluster_size + 10);
+        for (int round = 0; round < 5; round++) {
+            for (size_t i = 0; i < data.size(); i++) {
+                data[i] = rand();
+            }
+            file.cltbl = NULL;
+            append_fragmented(&file, &other, data.data(), data.size(), 3 * cluster_size, cluster_size);
+            file.cltbl = tbl;
+            REQUIRE(f_update_linkmap(&file, tlen) == FR_OK);
+            check_linkmap(&file, tbl, tlen);
+            expected.insert(expected.end(), data.begin(), data.end());
+            check_random_reads(&file, tbl, expected, 3 * cluster_size);
+        }
+
+        // Extend the file by a seek past its end, the gap is read back
+        // through the FAT chain
+        FSIZE_t gap_start = f_size(&file);
+        file.cltbl = NULL;
+        REQUIRE(f_lseek(&file, gap_start + 2 * cluster_size + 100) == FR_OK);
+        REQUIRE(f_size(&file) == gap_start + 2 * cluster_size + 100);
+        file.cltbl = tbl;
+        REQUIRE(f_update_linkmap(&file, tlen) == FR_OK);
+        std::vector<uint8_t> gap(f_size(&file) - gap_start);
+        UINT br;
+        file.cltbl = NULL;
+        REQUIRE(f_lseek(&file, gap_start) == FR_OK);
+        REQUIRE(f_read(&file, gap.data(), gap.size(), &br) == FR_OK);
+        REQUIRE(br == gap.size());
+        expected.insert(expected.end(), gap.begin(), gap.end());
+        check_random_reads(&file, tbl, expected, 3 * cluster_size);
+
+        check_linkmap(&file, tbl, tlen);
+    }
+
+    SECTION("link map overflow falls back to the FAT chain") {
+        // Too many fragments for the map when it is created
+        tbl[0] = 8;
+        file.cltbl = tbl;
+        REQUIRE(f_lseek(&file, CREATE_LINKMAP) == FR_NOT_ENOUGH_CORE);
+        REQUIRE(tbl[0] == 2 + 2 * fragments);
+        file.cltbl = NULL;
+        check_random_reads(&file, NULL, expected, 3 * cluster_size);
+
+        // The map of a new file overflows while it is appended to
+        char path_c[16];
+        FIL grown;
+        make_path(path_c, drv, "c.bin");
+        REQUIRE(f_open(&grown, path_c, FA_CREATE_ALWAYS | FA_READ | FA_WRITE) == FR_OK);
+        std::vector<uint8_t> grown_data(cluster_size);
+        for (size_t i = 0; i < grown_data.size(); i++) {
+            grown_data[i] = rand();
+        }
+        append_fragmented(&grown, &other, grown_data.data(), grown_data.size(), cluster_size, cluster_size);
+        tbl[0] = 8;
+        grown.cltbl = tbl;
+        REQUIRE(f_lseek(&grown, CREATE_LINKMAP) == FR_OK);
+
+        bool overflow = false;
+        for (int round = 0; round < 8 && !overflow; round++) {
+            std::vector<uint8_t> data(cluster_size + 1);
+            for (size_t i = 0; i < data.size(); i++) {
+                data[i] = rand();
+            }
+            grown.cltbl = NULL;
+            append_fragmented(&grown, &other, data.data(), data.size(), cluster_size, cluster_size);
+            grown.cltbl = tbl;
+            FRESULT res = f_update_linkmap(&grown, 8);
+            if (res == FR_NOT_ENOUGH_CORE) {
+                grown.cltbl = NULL;
+                overflow = true;
+            } else {
+                REQUIRE(res == FR_OK);
+            }
+            grown_data.insert(grown_data.end(), data.begin(), data.end());
+            check_random_reads(&grown, grown.cltbl, grown_data, 3 * cluster_size);
+        }
+        REQUIRE(overflow);
+        REQUIRE(f_close(&grown) == FR_OK);
+    }
+
+    file.cltbl = NULL;
+    REQUIRE(f_close(&file) == FR_OK);
+    REQUIRE(f_close(&other) == FR_OK);
+    unmount_volume(wl_handle, pdrv, drv);
+}
+
+// Compares the free cluster bitmap bit by bit with the FAT on the disk,
+// returns the number of free clusters in the FAT
+static DWORD check_free_bitmap(FATFS* fs)
+{
+    REQUIRE(fs->fbmp != NULL);
+    std::vector<BYTE> fat(fs->fsize * fs->ssize);
+    for (DWORD sect = 0; sect < fs->fsize; sect++) {
+        REQUIRE(disk_read(fs->pdrv, &fat[sect * fs->ssize], fs->fatbase + sect, 1) == RES_OK);
+    }
+
+    DWORD nfree = 0;
+    for (DWORD clst = 2; clst < fs->n_fatent; clst++) {
+        DWORD val;
+        if (fs->fs_type == FS_FAT12) {
+            val = fat[clst * 3 / 2] | (fat[clst * 3 / 2 + 1] << 8);
+            val = (clst & 1) ? (val >> 4) : (val & 0xFFF);
+        } else if (fs->fs_type == FS_FAT16) {
+            val = fat[clst * 2] | (fat[clst * 2 + 1] << 8);
+        } else {
+            val = (fat[clst * 4] | (fat[clst * 4 + 1] << 8) | (fat[clst * 4 + 2] << 16) | (fat[clst * 4 + 3] << 24)) & 0x0FFFFFFF;
+        }
+        bool in_use = (fs->fbmp[clst / 8] >> (clst % 8)) & 1;
+        INFO("cluster " << clst);
+        REQUIRE(in_use == (val != 0));
+        if (val == 0) {
+            nfree++;
+        }
+    }
+    return nfree;
+}
+
+static void check_free_count(FATFS* fs, const char* drv)
+{
+    FATFS* pfs;
+    DWORD nfree;
+    REQUIRE(f_getfree(drv, &nfree, &pfs) == FR_OK);
+    REQUIRE(pfs == fs);
+    REQUIRE(nfree == check_free_bitmap(fs));
+}
+
+static void write_file(const char* path, UINT size)
+{
+    FIL file;
+    UINT bw;
+    std::vector<uint8_t> data(size, 0x5A);
+    REQUIRE(f_open(&file, path, FA_CREATE_ALWAYS | FA_WRITE) == FR_OK);
+    REQUIRE(f_write(&file, data.data(), size, &bw) == FR_OK);
+    REQUIRE(bw == size);
+    REQUIRE(f_close(&file) == FR_OK);
+}
+
+TEST_CASE("free cluster bitmap follows the FAT", "[fatfs]")
+{
+    FATFS fs;
+    wl_handle_t wl_handle;
+    BYTE pdrv;
+    char drv[4];
+    char path[16];
+    FIL file;
+    UINT bw;
+
+    mount_new_volume(&fs, &wl_handle, &pdrv, drv);
+    const UINT cluster_size = fs.csize * fs.ssize;
+
+    // Built by the first free space query
+    REQUIRE(fs.fbmp == NULL);
+    check_free_count(&fs, drv);
+
+    // Write
+    for (int i = 0; i < 8; i++) {
+        sprintf(path, "%sf%d.bin", drv, i);
+        write_file(path, (i + 1) * cluster_size - i * 100);
+    }
+    check_free_count(&fs, drv);
+
+    // Unlink
+    sprintf(path, "%sf%d.bin", drv, 3);
+    REQUIRE(f_unlink(path) == FR_OK);
+    sprintf(path, "%sf%d.bin", drv, 6);
+    REQUIRE(f_unlink(path) == FR_OK);
+    check_free_count(&fs, drv);
+
+    // Truncate
+    sprintf(path, "%sf%d.bin", drv, 7);
+    REQUIRE(f_open(&file, path, FA_READ | FA_WRITE) == FR_OK);
+    REQUIRE(f_lseek(&file, 2 * cluster_size + 1) == FR_OK);
+    REQUIRE(f_truncate(&file) == FR_OK);
+    REQUIRE(f_close(&file) == FR_OK);
+    check_free_count(&fs, drv);
+
+    // Fill the volume, the freed clusters in the middle are taken as well
+    sprintf(path, "%sfill.bin", drv);
+    std::vector<uint8_t> data(cluster_size, 0xC3);
+    REQUIRE(f_open(&file, path, FA_CREATE_ALWAYS | FA_WRITE) == FR_OK);
+    do {
+        REQUIRE(f_write(&file, data.data(), data.size(), &bw) == FR_OK);
+    } while (bw == data.size());
+    REQUIRE(f_close(&file) == FR_OK);
+    REQUIRE(check_free_bitmap(&fs) == 0);
+    check_free_count(&fs, drv);
+    sprintf(path, "%sfull.bin", drv);
+    REQUIRE(f_open(&file, path, FA_CREATE_ALWAYS | FA_WRITE) == FR_OK);
+    REQUIRE(f_write(&file, data.data(), data.size(), &bw) == FR_OK);
+    REQUIRE(bw == 0);
+    REQUIRE(f_close(&file) == FR_OK);
+    check_free_count(&fs, drv);
+
+    // Remount, the bitmap is rebuilt by the first allocation
+    sprintf(path, "%sf%d.bin", drv, 5);
+    REQUIRE(f_unlink(path) == FR_OK);
+    REQUIRE(f_mount(NULL, drv, 0) == FR_OK);
+    REQUIRE(f_mount(&fs, drv, 1) == FR_OK);
+    REQUIRE(fs.fbmp == NULL);
+    sprintf(path, "%sf%d.bin", drv, 3);
+    write_file(path, 2 * cluster_size);
+    REQUIRE(fs.fbmp != NULL);
+    check_free_count(&fs, drv);
+
+    unmount_volume(wl_handle, pdrv, drv);
+}
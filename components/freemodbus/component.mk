@@ -1,5 +1,5 @@
 COMPONENT_ADD_INCLUDEDIRS := modbus/include modbus_controller
 //COMPONENT_PRIV_INCLUDEDIRS := . modbus port modbus/ascii modbus/functions modbus/rtu modbus/include 
 //COMPONENT_SRCDIRS := . modbus port modbus/ascii modbus/functions modbus/rtu modbus_controller
-COMPONENT_PRIV_INCLUDEDIRS := . modbus port modbus/ascii modbus/functions modbus/rtu modbus/include modbus/tcp
-COMPONENT_SRCDIRS := . modbus port modbus/ascii modbus/functions modbus/rtu modbus_controller modbus/tcp
\ No newline at end of file
+COMPONENT_PRIV_INCLUDEDIRS := . modbus port modbus/ascii modbus/functions modbus/rtu modbus/include modbus/tcp modbus/udp
+COMPONENT_SRCDIRS := modbus port modbus/ascii modbus/functions modbus/rtu modbus_controller modbus/tcp modbus/udp
@@ -39,9 +39,9 @@
 #include "mb.h"
 #include "mbconfig.h"
 #include "mbascii.h"
+#include "mbasciicodec.h"
 #include "mbframe.h"
 
-#include "mbcrc.h"
 #include "mbport.h"
 
 #if MB_ASCII_ENABLED > 0
@@ -54,6 +54,7 @@
 #define MB_SER_PDU_SIZE_LRC     1       /*!< Size of LRC field in PDU. */
 #define MB_SER_PDU_ADDR_OFF     0       /*!< Offset of slave address in Ser-PDU. */
 #define MB_SER_PDU_PDU_OFF      1       /*!< Offset of Modbus-PDU in Ser-PDU. */
+#define MB_ASCII_CHARS_MAX      ( 2 * MB_SER_PDU_SIZE_MAX ) /*!< Characters between ':' and CR. */
 
 /* ----------------------- Type definitions ---------------------------------*/
 typedef enum
@@ -66,25 +67,10 @@ typedef enum
 typedef enum
 {
     STATE_TX_IDLE,              /*!< Transmitter is in idle state. */
-    STATE_TX_START,             /*!< Starting transmission (':' sent). */
-    STATE_TX_DATA,              /*!< Sending of data (Address, Data, LRC). */
-    STATE_TX_END,               /*!< End of transmission. */
+    STATE_TX_START,             /*!< Frame is encoded and ready to be sent. */
     STATE_TX_NOTIFY             /*!< Notify sender that the frame has been sent. */
 } eMBSndState;
 
-typedef enum
-{
-    BYTE_HIGH_NIBBLE,           /*!< Character for high nibble of byte. */
-    BYTE_LOW_NIBBLE             /*!< Character for low nibble of byte. */
-} eMBBytePos;
-
-/* ----------------------- Static functions ---------------------------------*/
-static UCHAR    prvucMBCHAR2BIN( UCHAR ucCharacter );
-
-static UCHAR    prvucMBBIN2CHAR( UCHAR ucByte );
-
-static UCHAR    prvucMBLRC( UCHAR * pucFrame, USHORT usLen );
-
 /* ----------------------- Static variables ---------------------------------*/
 static volatile eMBSndState eSndState;
 static volatile eMBRcvState eRcvState;
@@ -94,13 +80,15 @@ static volatile eMBRcvState eRcvState;
 extern volatile UCHAR ucRTUBuf[];
 static volatile UCHAR *ucASCIIBuf = ucRTUBuf;
 
+/* Characters of the frame being received or sent. The receiver stores the
+ * characters between ':' and CR, they are decoded at once when the frame
+ * is complete. The transmitter keeps the complete encoded frame. */
+static volatile UCHAR aucASCIIFrame[MB_ASCII_FRAME_SIZE( MB_SER_PDU_SIZE_MAX )];
+
 static volatile USHORT usRcvBufferPos;
-static volatile eMBBytePos eBytePos;
 
-static volatile UCHAR *pucSndBufferCur;
 static volatile USHORT usSndBufferCount;
 
-static volatile UCHAR ucLRC;
 static volatile UCHAR ucMBLFCharacter;
 
 /* ----------------------- Start implementation -----------------------------*/
@@ -152,13 +140,14 @@ eMBErrorCode
 eMBASCIIReceive( UCHAR * pucRcvAddress, UCHAR ** pucFrame, USHORT * pusLength )
 {
     eMBErrorCode    eStatus = MB_ENOERR;
+    USHORT          usSerPDULen = 0;
 
     ENTER_CRITICAL_SECTION(  );
-    assert( usRcvBufferPos < MB_SER_PDU_SIZE_MAX );
+    assert( usRcvBufferPos <= MB_ASCII_CHARS_MAX );
 
-    /* Length and CRC check */
-    if( ( usRcvBufferPos >= MB_SER_PDU_SIZE_MIN )
-        && ( prvucMBLRC( ( UCHAR * ) ucASCIIBuf, usRcvBufferPos ) == 0 ) )
+    /* Decode the hex characters, length and LRC check */
+    if( xMBASCIIDecode( ( UCHAR * ) ucASCIIBuf, ( UCHAR * ) aucASCIIFrame, usRcvBufferPos, &usSerPDULen )
+        && ( ( usSerPDULen + MB_SER_PDU_SIZE_LRC ) >= MB_SER_PDU_SIZE_MIN ) )
     {
         /* Save the address field. All frames are passed to the upper layed
          * and the decision if a frame is used is done there.
@@ -168,7 +157,7 @@ eMBASCIIReceive( UCHAR * pucRcvAddress, UCHAR ** pucFrame, USHORT * pusLength )
         /* Total length of Modbus-PDU is Modbus-Serial-Line-PDU minus
          * size of address field and CRC checksum.
          */
-        *pusLength = ( USHORT )( usRcvBufferPos - MB_SER_PDU_PDU_OFF - MB_SER_PDU_SIZE_LRC );
+        *pusLength = ( USHORT )( usSerPDULen - MB_SER_PDU_PDU_OFF );
 
         /* Return the start of the Modbus PDU to the caller. */
         *pucFrame = ( UCHAR * ) & ucASCIIBuf[MB_SER_PDU_PDU_OFF];
@@ -185,7 +174,7 @@ eMBErrorCode
 eMBASCIISend( UCHAR ucSlaveAddress, const UCHAR * pucFrame, USHORT usLength )
 {
     eMBErrorCode    eStatus = MB_ENOERR;
-    UCHAR           usLRC;
+    UCHAR          *pucSerPDU;
 
     ENTER_CRITICAL_SECTION(  );
     /* Check if the receiver is still in idle state. If not we where too
@@ -195,16 +184,12 @@ eMBASCIISend( UCHAR ucSlaveAddress, const UCHAR * pucFrame, USHORT usLength )
     if( eRcvState == STATE_RX_IDLE )
     {
         /* First byte before the Modbus-PDU is the slave address. */
-        pucSndBufferCur = ( UCHAR * ) pucFrame - 1;
-        usSndBufferCount = 1;
+        pucSerPDU = ( UCHAR * ) pucFrame - 1;
+        pucSerPDU[MB_SER_PDU_ADDR_OFF] = ucSlaveAddress;
 
-        /* Now copy the Modbus-PDU into the Modbus-Serial-Line-PDU. */
-        pucSndBufferCur[MB_SER_PDU_ADDR_OFF] = ucSlaveAddress;
-        usSndBufferCount += usLength;
-
-        /* Calculate LRC checksum for Modbus-Serial-Line-PDU. */
-        usLRC = prvucMBLRC( ( UCHAR * ) pucSndBufferCur, usSndBufferCount );
-        ucASCIIBuf[usSndBufferCount++] = usLRC;
+        /* Encode the Modbus-Serial-Line-PDU and its LRC into the frame. */
+        usSndBufferCount = usMBASCIIEncode( ( UCHAR * ) aucASCIIFrame, pucSerPDU,
+                                            ( USHORT )( usLength + 1 ), ucMBLFCharacter );
 
         /* Activate the transmitter. */
         eSndState = STATE_TX_START;
@@ -223,7 +208,6 @@ xMBASCIIReceiveFSM( void )
 {
     BOOL            xNeedPoll = FALSE;
     UCHAR           ucByte;
-    UCHAR           ucResult;
 
     assert( eSndState == STATE_TX_IDLE );
 
@@ -232,8 +216,8 @@ xMBASCIIReceiveFSM( void )
     {
         /* A new character is received. If the character is a ':' the input
          * buffer is cleared. A CR-character signals the end of the data
-         * block. Other characters are part of the data block and their
-         * ASCII value is converted back to a binary representation.
+         * block. Other characters are part of the data block and are
+         * decoded with the whole frame in eMBASCIIReceive.
          */
     case STATE_RX_RCV:
         /* Enable timer for character timeout. */
@@ -241,43 +225,23 @@ xMBASCIIReceiveFSM( void )
         if( ucByte == ':' )
         {
             /* Empty receive buffer. */
-            eBytePos = BYTE_HIGH_NIBBLE;
             usRcvBufferPos = 0;
         }
         else if( ucByte == MB_ASCII_DEFAULT_CR )
         {
             eRcvState = STATE_RX_WAIT_EOF;
         }
+        else if( usRcvBufferPos < MB_ASCII_CHARS_MAX )
+        {
+            aucASCIIFrame[usRcvBufferPos++] = ucByte;
+        }
         else
         {
-            ucResult = prvucMBCHAR2BIN( ucByte );
-            switch ( eBytePos )
-            {
-                /* High nibble of the byte comes first. We check for
-                 * a buffer overflow here. */
-            case BYTE_HIGH_NIBBLE:
-                if( usRcvBufferPos < MB_SER_PDU_SIZE_MAX )
-                {
-                    ucASCIIBuf[usRcvBufferPos] = ( UCHAR )( ucResult << 4 );
-                    eBytePos = BYTE_LOW_NIBBLE;
-                    break;
-                }
-                else
-                {
-                    /* not handled in Modbus specification but seems
-                     * a resonable implementation. */
-                    eRcvState = STATE_RX_IDLE;
-                    /* Disable previously activated timer because of error state. */
-                    vMBPortTimersDisable(  );
-                }
-                break;
-
-            case BYTE_LOW_NIBBLE:
-                ucASCIIBuf[usRcvBufferPos] |= ucResult;
-                usRcvBufferPos++;
-                eBytePos = BYTE_HIGH_NIBBLE;
-                break;
-            }
+            /* not handled in Modbus specification but seems
+             * a resonable implementation. */
+            eRcvState = STATE_RX_IDLE;
+            /* Disable previously activated timer because of error state. */
+            vMBPortTimersDisable(  );
         }
         break;
 
@@ -297,7 +261,6 @@ xMBASCIIReceiveFSM( void )
         else if( ucByte == ':' )
         {
             /* Empty receive buffer and back to receive state. */
-            eBytePos = BYTE_HIGH_NIBBLE;
             usRcvBufferPos = 0;
             eRcvState = STATE_RX_RCV;
 
@@ -317,8 +280,7 @@ xMBASCIIReceiveFSM( void )
             /* Enable timer for character timeout. */
             vMBPortTimersEnable(  );
             /* Reset the input buffers to store the frame. */
-            usRcvBufferPos = 0;;
-            eBytePos = BYTE_HIGH_NIBBLE;
+            usRcvBufferPos = 0;
             eRcvState = STATE_RX_RCV;
         }
         break;
@@ -331,55 +293,15 @@ BOOL
 xMBASCIITransmitFSM( void )
 {
     BOOL            xNeedPoll = FALSE;
-    UCHAR           ucByte;
 
     assert( eRcvState == STATE_RX_IDLE );
     switch ( eSndState )
     {
-        /* Start of transmission. The start of a frame is defined by sending
-         * the character ':'. */
+        /* The frame from ':' to LF was encoded by eMBASCIISend and is
+         * handed to the port in one write. */
     case STATE_TX_START:
-        ucByte = ':';
-        xMBPortSerialPutByte( ( CHAR )ucByte );
-        eSndState = STATE_TX_DATA;
-        eBytePos = BYTE_HIGH_NIBBLE;
-        break;
-
-        /* Send the data block. Each data byte is encoded as a character hex
-         * stream with the high nibble sent first and the low nibble sent
-         * last. If all data bytes are exhausted we send a '\r' character
-         * to end the transmission. */
-    case STATE_TX_DATA:
-        if( usSndBufferCount > 0 )
-        {
-            switch ( eBytePos )
-            {
-            case BYTE_HIGH_NIBBLE:
-                ucByte = prvucMBBIN2CHAR( ( UCHAR )( *pucSndBufferCur >> 4 ) );
-                xMBPortSerialPutByte( ( CHAR ) ucByte );
-                eBytePos = BYTE_LOW_NIBBLE;
-                break;
-
-            case BYTE_LOW_NIBBLE:
-                ucByte = prvucMBBIN2CHAR( ( UCHAR )( *pucSndBufferCur & 0x0F ) );
-                xMBPortSerialPutByte( ( CHAR )ucByte );
-                pucSndBufferCur++;
-                eBytePos = BYTE_HIGH_NIBBLE;
-                usSndBufferCount--;
-                break;
-            }
-        }
-        else
-        {
-            xMBPortSerialPutByte( MB_ASCII_DEFAULT_CR );
-            eSndState = STATE_TX_END;
-        }
-        break;
-
-        /* Finish the frame by sending a LF character. */
-    case STATE_TX_END:
-        xMBPortSerialPutByte( ( CHAR )ucMBLFCharacter );
-        /* We need another state to make sure that the CR character has
+        ( void )xMBPortSerialPutBuffer( ( CHAR * ) aucASCIIFrame, usSndBufferCount );
+        /* We need another state to make sure that the frame has
          * been sent. */
         eSndState = STATE_TX_NOTIFY;
         break;
@@ -431,56 +353,4 @@ xMBASCIITimerT1SExpired( void )
 }
 
 
-static          UCHAR
-prvucMBCHAR2BIN( UCHAR ucCharacter )
-{
-    if( ( ucCharacter >= '0' ) && ( ucCharacter <= '9' ) )
-    {
-        return ( UCHAR )( ucCharacter - '0' );
-    }
-    else if( ( ucCharacter >= 'A' ) && ( ucCharacter <= 'F' ) )
-    {
-        return ( UCHAR )( ucCharacter - 'A' + 0x0A );
-    }
-    else
-    {
-        return 0xFF;
-    }
-}
-
-static          UCHAR
-prvucMBBIN2CHAR( UCHAR ucByte )
-{
-    if( ucByte <= 0x09 )
-    {
-        return ( UCHAR )( '0' + ucByte );
-    }
-    else if( ( ucByte >= 0x0A ) && ( ucByte <= 0x0F ) )
-    {
-        return ( UCHAR )( ucByte - 0x0A + 'A' );
-    }
-    else
-    {
-        /* Programming error. */
-        assert( 0 );
-    }
-    return '0';
-}
-
-
-static          UCHAR
-prvucMBLRC( UCHAR * pucFrame, USHORT usLen )
-{
-    UCHAR           ucLRC = 0;  /* LRC char initialized */
-
-    while( usLen-- )
-    {
-        ucLRC += *pucFrame++;   /* Add buffer byte without carry */
-    }
-
-    /* Return twos complement */
-    ucLRC = ( UCHAR ) ( -( ( CHAR ) ucLRC ) );
-    return ucLRC;
-}
-
 #endif
@@ -0,0 +1,110 @@
+/* 
+ * FreeModbus Libary: A portable Modbus implementation for Modbus ASCII/RTU.
+ * Copyright (c) 2006 Christian Walter <wolti@sil.at>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * File: $Id: mbasciicodec.c,v 1.0 $
+ */
+
+/* ----------------------- Platform includes --------------------------------*/
+#include "port.h"
+
+/* ----------------------- Modbus includes ----------------------------------*/
+#include "mbasciicodec.h"
+
+/* ----------------------- Defines ------------------------------------------*/
+#define MB_ASCII_START          ':'
+#define MB_ASCII_CR             '\r'
+
+/* ----------------------- Static variables ---------------------------------*/
+static const UCHAR aucBin2Char[16] = {
+    '0', '1', '2', '3', '4', '5', '6', '7',
+    '8', '9', 'A', 'B', 'C', 'D', 'E', 'F'
+};
+
+/* Nibble value plus one of each character, zero for non hex characters. */
+static const UCHAR aucChar2Bin[256] = {
+    ['0'] = 0x01, ['1'] = 0x02, ['2'] = 0x03, ['3'] = 0x04, ['4'] = 0x05,
+    ['5'] = 0x06, ['6'] = 0x07, ['7'] = 0x08, ['8'] = 0x09, ['9'] = 0x0A,
+    ['A'] = 0x0B, ['B'] = 0x0C, ['C'] = 0x0D, ['D'] = 0x0E, ['E'] = 0x0F,
+    ['F'] = 0x10
+};
+
+/* ----------------------- Start implementation -----------------------------*/
+USHORT
+usMBASCIIEncode( UCHAR * pucDst, const UCHAR * pucSrc, USHORT usLen, UCHAR ucLFCharacter )
+{
+    UCHAR          *pucCur = pucDst;
+    UCHAR           ucLRC = 0;
+    UCHAR           ucByte;
+
+    *pucCur++ = MB_ASCII_START;
+    while( usLen-- )
+    {
+        ucByte = *pucSrc++;
+        ucLRC += ucByte;        /* Add buffer byte without carry */
+        *pucCur++ = aucBin2Char[ucByte >> 4];
+        *pucCur++ = aucBin2Char[ucByte & 0x0F];
+    }
+    /* Twos complement of the sum. */
+    ucLRC = ( UCHAR )( -ucLRC );
+    *pucCur++ = aucBin2Char[ucLRC >> 4];
+    *pucCur++ = aucBin2Char[ucLRC & 0x0F];
+    *pucCur++ = MB_ASCII_CR;
+    *pucCur++ = ucLFCharacter;
+    return ( USHORT )( pucCur - pucDst );
+}
+
+BOOL
+xMBASCIIDecode( UCHAR * pucDst, const UCHAR * pucSrc, USHORT usChars, USHORT * pusLen )
+{
+    USHORT          usBytes = usChars >> 1;
+    UCHAR           ucLRC = 0;
+    UCHAR           ucHigh, ucLow;
+    USHORT          i;
+
+    if( ( usChars & 1 ) || ( usBytes == 0 ) )
+    {
+        return FALSE;
+    }
+    for( i = 0; i < usBytes; i++ )
+    {
+        ucHigh = aucChar2Bin[*pucSrc++];
+        ucLow = aucChar2Bin[*pucSrc++];
+        if( ( ucHigh == 0 ) || ( ucLow == 0 ) )
+        {
+            return FALSE;
+        }
+        pucDst[i] = ( UCHAR )( ( ( ucHigh - 1 ) << 4 ) | ( ucLow - 1 ) );
+        ucLRC += pucDst[i];
+    }
+    /* The sum over data and LRC is zero for a valid frame. */
+    if( ucLRC != 0 )
+    {
+        return FALSE;
+    }
+    *pusLen = usBytes - 1;
+    return TRUE;
+}
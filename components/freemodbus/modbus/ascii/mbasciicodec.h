@@ -0,0 +1,61 @@
+/* 
+ * FreeModbus Libary: A portable Modbus implementation for Modbus ASCII/RTU.
+ * Copyright (c) 2006 Christian Walter <wolti@sil.at>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * File: $Id: mbasciicodec.h,v 1.0 $
+ */
+
+#ifndef _MB_ASCII_CODEC_H
+#define _MB_ASCII_CODEC_H
+
+/*! \brief Characters of a Modbus ASCII frame for a Ser-PDU of usLen bytes.
+ *
+ * ':' + two hex characters per byte and for the LRC + CR LF.
+ */
+#define MB_ASCII_FRAME_SIZE( usLen )    ( 1 + 2 * ( ( usLen ) + 1 ) + 2 )
+
+/*! \brief Encode a Ser-PDU into a complete Modbus ASCII frame.
+ *
+ * The LRC is computed while the data is encoded and appended to the frame.
+ * \c pucDst must hold MB_ASCII_FRAME_SIZE( usLen ) characters.
+ *
+ * \return Number of characters of the frame.
+ */
+USHORT          usMBASCIIEncode( UCHAR * pucDst, const UCHAR * pucSrc,
+                                 USHORT usLen, UCHAR ucLFCharacter );
+
+/*! \brief Decode the hex characters between ':' and CR of a frame.
+ *
+ * The LRC is verified in the same pass, it is not included in the
+ * returned length.
+ *
+ * \return FALSE if a character is not a hex digit, the number of
+ *   characters is odd or the LRC does not match.
+ */
+BOOL            xMBASCIIDecode( UCHAR * pucDst, const UCHAR * pucSrc,
+                                USHORT usChars, USHORT * pusLen );
+
+#endif
@@ -86,7 +86,8 @@ PR_BEGIN_EXTERN_C
 {
     MB_RTU,                     /*!< RTU transmission mode. */
     MB_ASCII,                   /*!< ASCII transmission mode. */
-    MB_TCP                      /*!< TCP mode. */
+    MB_TCP,                     /*!< TCP mode. */
+    MB_UDP                      /*!< UDP mode. */
 } eMBMode;
 
 /*! \ingroup modbus
@@ -167,6 +168,79 @@ eMBErrorCode    eMBInit( eMBMode eMode, UCHAR ucSlaveAddress,
  */
 eMBErrorCode    eMBTCPInit( USHORT usTCPPort );
 
+/*! \ingroup modbus
+ * \brief Initialize the Modbus protocol stack for Modbus UDP.
+ *
+ * The Modbus UDP slave uses the MBAP framing of Modbus TCP. Every datagram
+ * carries one request and the response is sent back to the source address.
+ * Retransmitted requests (same peer and transaction identifier) are answered
+ * from a small cache of the last responses and are not executed again.
+ *
+ * \param usUDPPort The UDP port to listen on.
+ * \return If the protocol stack has been initialized correctly the function
+ *   returns eMBErrorCode::MB_ENOERR. Otherwise one of the following error
+ *   codes is returned:
+ *    - eMBErrorCode::MB_EPORTERR IF the porting layer returned an error.
+ */
+eMBErrorCode    eMBUDPInit( USHORT usUDPPort );
+
+/*! \ingroup modbus
+ * \brief Completion callback of a Modbus UDP master transaction.
+ *
+ * \param eStatus eMBErrorCode::MB_ENOERR if a response was received or
+ *   eMBErrorCode::MB_ETIMEDOUT if all retransmissions were unanswered.
+ * \param ucUnitID Unit identifier of the response.
+ * \param pucPDU The response PDU (NULL on timeout). Only valid during the call.
+ * \param usLength Length of the response PDU.
+ * \param pvArg User argument passed to eMBMasterUDPRequest( ).
+ */
+typedef void    ( *pvMBMasterUDPCallback ) ( eMBErrorCode eStatus, UCHAR ucUnitID,
+                                             const UCHAR * pucPDU, USHORT usLength,
+                                             void * pvArg );
+
+/*! \ingroup modbus
+ * \brief Initialize the Modbus UDP master.
+ *
+ * The Modbus UDP master functions are not thread safe. eMBMasterUDPInit( ),
+ * eMBMasterUDPRequest( ), eMBMasterUDPPoll( ) and eMBMasterUDPClose( ) must
+ * all be called from one task. The completion callbacks run in that task
+ * and may issue new requests.
+ *
+ * \param usLocalPort Local UDP port, 0 selects an ephemeral port.
+ */
+eMBErrorCode    eMBMasterUDPInit( USHORT usLocalPort );
+
+/*! \ingroup modbus
+ * \brief Send a Modbus UDP request without waiting for the response.
+ *
+ * Several requests can be outstanding to the same or to different peers.
+ * The request is retransmitted with the same transaction identifier after
+ * MB_UDP_MASTER_RETRY_TIMEOUT_MS, at most MB_UDP_MASTER_RETRIES times.
+ * Duplicate or late responses are dropped.
+ *
+ * \param ulPeerAddr IPv4 address of the slave in network byte order.
+ * \param usPeerPort UDP port of the slave, 0 selects port 502.
+ * \return eMBErrorCode::MB_ENORES if all transaction slots are in use.
+ */
+eMBErrorCode    eMBMasterUDPRequest( ULONG ulPeerAddr, USHORT usPeerPort,
+                                     UCHAR ucUnitID, const UCHAR * pucPDU,
+                                     USHORT usLength,
+                                     pvMBMasterUDPCallback pvCallback,
+                                     void * pvArg );
+
+/*! \ingroup modbus
+ * \brief Process responses and retransmissions of the Modbus UDP master.
+ *
+ * Waits at most usTimeoutMS for a datagram and calls the completion
+ * callbacks from the context of the caller.
+ */
+eMBErrorCode    eMBMasterUDPPoll( USHORT usTimeoutMS );
+
+/*! \ingroup modbus
+ * \brief Close the Modbus UDP master, pending transactions are dropped.
+ */
+eMBErrorCode    eMBMasterUDPClose( void );
+
 /*! \ingroup modbus
  * \brief Release resources used by the protocol stack.
  *
@@ -242,6 +316,38 @@ eMBErrorCode    eMBSetSlaveID( UCHAR ucSlaveID, BOOL xIsRunning,
                                UCHAR const *pucAdditional,
                                USHORT usAdditionalLen );
 
+/*! \ingroup modbus
+ * \brief Callback deciding if the slave answers for a unit identifier.
+ *
+ * It is called for every received frame and must return quickly.
+ */
+typedef BOOL    ( *pxMBUnitFilter ) ( UCHAR ucUnitID );
+
+/*! \ingroup modbus
+ * \brief Install a filter for additional (virtual) unit identifiers.
+ *
+ * Frames addressed to the slave address (or any frame in Modbus TCP/UDP
+ * mode) are still processed as before. In addition a frame is accepted if
+ * the filter returns TRUE for its unit identifier, which is the serial
+ * slave address or the MBAP unit identifier for Modbus TCP/UDP. In serial
+ * modes the response then carries the virtual unit address.
+ *
+ * \param pxFilter The filter function or \c NULL to remove it.
+ *
+ * \return eMBErrorCode::MB_ENOERR or eMBErrorCode::MB_EILLSTATE if the
+ *   feature is disabled by MB_MULTI_UNIT_ENABLED.
+ */
+eMBErrorCode    eMBSetUnitFilter( pxMBUnitFilter pxFilter );
+
+/*! \ingroup modbus
+ * \brief Unit identifier the frame being executed is addressed to.
+ *
+ * May be called from the register callbacks to select the register map.
+ * It returns the slave address if the frame was not accepted by the unit
+ * filter.
+ */
+UCHAR           ucMBGetCurrentUnit( void );
+
 /*! \ingroup modbus
  * \brief Registers a callback handler for a given function code.
  *
@@ -0,0 +1,218 @@
+/* 
+ * FreeModbus Libary: A portable Modbus implementation for Modbus ASCII/RTU.
+ * Copyright (c) 2006 Christian Walter <wolti@sil.at>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * File: $Id: mb_m.h,v 1.0 2013/08/13 Armink $
+ */
+
+#ifndef _MB_M_H
+#define _MB_M_H
+
+#include "mb.h"
+
+#ifdef __cplusplus
+PR_BEGIN_EXTERN_C
+#endif
+
+/*! \defgroup modbus_master Modbus Master
+ * \code #include "mb_m.h" \endcode
+ *
+ * Interface of the Modbus RTU master. The application calls eMBMasterInit()
+ * and eMBMasterEnable() and then runs eMBMasterPoll() from a dedicated task.
+ * Requests are issued from other tasks with the eMBMasterReq*() functions
+ * which block until the slave responded or the request failed.
+ */
+
+/* ----------------------- Type definitions ---------------------------------*/
+
+/*! \ingroup modbus_master
+ * \brief Errors returned by the master request functions.
+ */
+typedef enum
+{
+    MB_MRE_NO_ERR,              /*!< no error. */
+    MB_MRE_NO_REG,              /*!< illegal register address. */
+    MB_MRE_ILL_ARG,             /*!< illegal argument. */
+    MB_MRE_REV_DATA,            /*!< receive data error. */
+    MB_MRE_TIMEDOUT,            /*!< timeout error occurred. */
+    MB_MRE_MASTER_BUSY,         /*!< master is busy now. */
+    MB_MRE_EXE_FUN              /*!< execute function error. */
+} eMBMasterReqErrCode;
+
+/*! \ingroup modbus_master
+ * \brief Purpose the master timer is currently armed for.
+ */
+typedef enum
+{
+    MB_TMODE_T35,               /*!< Master receive frame T3.5 timeout. */
+    MB_TMODE_RESPOND_TIMEOUT,   /*!< Master wait respond for slave. */
+    MB_TMODE_CONVERT_DELAY      /*!< Master sent broadcast, then delay sometime. */
+} eMBMasterTimerMode;
+
+/* ----------------------- Function prototypes ------------------------------*/
+
+/*! \ingroup modbus_master
+ * \brief Initialize the Modbus master protocol stack.
+ *
+ * \param eMode Transmission mode, only eMBMode::MB_RTU is supported.
+ * \param ucPort The UART port used for the master.
+ * \param ulBaudRate The baudrate.
+ * \param eParity Parity used for serial transmission.
+ * \return eMBErrorCode::MB_ENOERR on success, eMBErrorCode::MB_EINVAL for an
+ *   unsupported mode or eMBErrorCode::MB_EPORTERR if the porting layer failed.
+ */
+eMBErrorCode    eMBMasterInit( eMBMode eMode, UCHAR ucPort,
+                               ULONG ulBaudRate, eMBParity eParity );
+
+/*! \ingroup modbus_master
+ * \brief Release the resources of a disabled master protocol stack.
+ */
+eMBErrorCode    eMBMasterClose( void );
+
+/*! \ingroup modbus_master
+ * \brief Enable the master protocol stack.
+ */
+eMBErrorCode    eMBMasterEnable( void );
+
+/*! \ingroup modbus_master
+ * \brief Disable the master protocol stack.
+ */
+eMBErrorCode    eMBMasterDisable( void );
+
+/*! \ingroup modbus_master
+ * \brief Wait for one master event and process it.
+ *
+ * Must be called in a loop from the task running the master stack.
+ */
+eMBErrorCode    eMBMasterPoll( void );
+
+/* ----------------------- Callback -----------------------------------------*/
+
+/*! \ingroup modbus_master
+ * \brief Callbacks the application implements to receive the register values
+ *   read by the master (and to supply the values written).
+ *
+ * The slave address of the current request is available with
+ * ucMBMasterGetDestAddress( ).
+ */
+eMBErrorCode    eMBMasterRegInputCB( UCHAR * pucRegBuffer, USHORT usAddress,
+                                     USHORT usNRegs );
+
+eMBErrorCode    eMBMasterRegHoldingCB( UCHAR * pucRegBuffer, USHORT usAddress,
+                                       USHORT usNRegs, eMBRegisterMode eMode );
+
+eMBErrorCode    eMBMasterRegCoilsCB( UCHAR * pucRegBuffer, USHORT usAddress,
+                                     USHORT usNCoils, eMBRegisterMode eMode );
+
+eMBErrorCode    eMBMasterRegDiscreteCB( UCHAR * pucRegBuffer, USHORT usAddress,
+                                        USHORT usNDiscrete );
+
+/*! \ingroup modbus_master
+ * \brief Master requests.
+ *
+ * Each request waits up to \c lTimeOut milliseconds (-1 waits forever) for
+ * the master to become idle and then blocks until the request finished.
+ */
+eMBMasterReqErrCode eMBMasterReqReadInputRegister( UCHAR ucSndAddr, USHORT usRegAddr,
+                                                   USHORT usNRegs, LONG lTimeOut );
+
+eMBMasterReqErrCode eMBMasterReqWriteHoldingRegister( UCHAR ucSndAddr, USHORT usRegAddr,
+                                                      USHORT usRegData, LONG lTimeOut );
+
+eMBMasterReqErrCode eMBMasterReqWriteMultipleHoldingRegister( UCHAR ucSndAddr, USHORT usRegAddr,
+                                                              USHORT usNRegs, USHORT * pusDataBuffer,
+                                                              LONG lTimeOut );
+
+eMBMasterReqErrCode eMBMasterReqReadHoldingRegister( UCHAR ucSndAddr, USHORT usRegAddr,
+                                                     USHORT usNRegs, LONG lTimeOut );
+
+eMBMasterReqErrCode eMBMasterReqReadWriteMultipleHoldingRegister( UCHAR ucSndAddr,
+                                                                  USHORT usReadRegAddr, USHORT usNReadRegs,
+                                                                  USHORT * pusDataBuffer,
+                                                                  USHORT usWriteRegAddr, USHORT usNWriteRegs,
+                                                                  LONG lTimeOut );
+
+eMBMasterReqErrCode eMBMasterReqReadCoils( UCHAR ucSndAddr, USHORT usCoilAddr,
+                                           USHORT usNCoils, LONG lTimeOut );
+
+eMBMasterReqErrCode eMBMasterReqWriteCoil( UCHAR ucSndAddr, USHORT usCoilAddr,
+                                           USHORT usCoilData, LONG lTimeOut );
+
+eMBMasterReqErrCode eMBMasterReqWriteMultipleCoils( UCHAR ucSndAddr, USHORT usCoilAddr,
+                                                    USHORT usNCoils, UCHAR * pucDataBuffer,
+                                                    LONG lTimeOut );
+
+eMBMasterReqErrCode eMBMasterReqReadDiscreteInputs( UCHAR ucSndAddr, USHORT usDiscreteAddr,
+                                                    USHORT usNDiscreteIn, LONG lTimeOut );
+
+/* ----------------------- Master function handlers -------------------------*/
+eMBException    eMBMasterFuncReadInputRegister( UCHAR * pucFrame, USHORT * usLen );
+
+eMBException    eMBMasterFuncReadHoldingRegister( UCHAR * pucFrame, USHORT * usLen );
+
+eMBException    eMBMasterFuncWriteHoldingRegister( UCHAR * pucFrame, USHORT * usLen );
+
+eMBException    eMBMasterFuncWriteMultipleHoldingRegister( UCHAR * pucFrame, USHORT * usLen );
+
+eMBException    eMBMasterFuncReadWriteMultipleHoldingRegister( UCHAR * pucFrame, USHORT * usLen );
+
+eMBException    eMBMasterFuncReadCoils( UCHAR * pucFrame, USHORT * usLen );
+
+eMBException    eMBMasterFuncWriteCoil( UCHAR * pucFrame, USHORT * usLen );
+
+eMBException    eMBMasterFuncWriteMultipleCoils( UCHAR * pucFrame, USHORT * usLen );
+
+eMBException    eMBMasterFuncReadDiscreteInputs( UCHAR * pucFrame, USHORT * usLen );
+
+/* ----------------------- Master stack internals ---------------------------*/
+void            vMBMasterGetPDUSndBuf( UCHAR ** pucFrame );
+
+UCHAR           ucMBMasterGetDestAddress( void );
+
+void            vMBMasterSetDestAddress( UCHAR Address );
+
+BOOL            xMBMasterGetCBRunInMasterMode( void );
+
+void            vMBMasterSetCBRunInMasterMode( BOOL IsMasterMode );
+
+USHORT          usMBMasterGetPDUSndLength( void );
+
+void            vMBMasterSetPDUSndLength( USHORT SendPDULength );
+
+void            vMBMasterSetCurTimerMode( eMBMasterTimerMode eMBTimerMode );
+
+BOOL            xMBMasterRequestIsBroadcast( void );
+
+eMBMasterErrorEventType eMBMasterGetErrorType( void );
+
+void            vMBMasterSetErrorType( eMBMasterErrorEventType errorType );
+
+eMBMasterReqErrCode eMBMasterWaitRequestFinish( void );
+
+#ifdef __cplusplus
+PR_END_EXTERN_C
+#endif
+#endif
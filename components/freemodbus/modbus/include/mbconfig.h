@@ -55,6 +55,60 @@ PR_BEGIN_EXTERN_C
 /*! \brief If Modbus TCP support is enabled. */
 #define MB_TCP_ENABLED                          (  1 )
 
+/*! \brief If Modbus UDP support is enabled. */
+#define MB_UDP_ENABLED                          (  1 )
+
+/*! \brief Maximum number of outstanding Modbus UDP master transactions.
+ *
+ * Must be a power of two, the transaction identifier selects the slot.
+ */
+#define MB_UDP_MASTER_PENDING_MAX               ( 16 )
+
+/*! \brief Number of responses the Modbus UDP slave keeps to answer
+ *    retransmitted requests without executing them again.
+ *
+ * Must not be smaller than MB_UDP_MASTER_PENDING_MAX, otherwise a master
+ * with a full pipeline can get a retransmitted write executed twice.
+ */
+#define MB_UDP_DUP_CACHE_SIZE                   ( MB_UDP_MASTER_PENDING_MAX )
+
+/*! \brief Modbus UDP master retransmission timeout and retry count. */
+#define MB_UDP_MASTER_RETRY_TIMEOUT_MS          ( 50 )
+#define MB_UDP_MASTER_RETRIES                   (  2 )
+
+/*! \brief Time in milliseconds a cached Modbus UDP response is replayed.
+ *
+ * Covers the retransmissions of the master. A request arriving later with
+ * a reused transaction identifier is executed again.
+ */
+#define MB_UDP_DUP_CACHE_TIMEOUT_MS             ( MB_UDP_MASTER_RETRY_TIMEOUT_MS * ( MB_UDP_MASTER_RETRIES + 1 ) )
+
+/*! \brief If the slave may answer for more than one unit identifier.
+ *
+ * When enabled the application can install a unit filter with
+ * eMBSetUnitFilter( ) to accept frames for additional (virtual) units.
+ */
+#define MB_MULTI_UNIT_ENABLED                   (  1 )
+
+/*! \brief If the Modbus RTU master is enabled. */
+#define MB_MASTER_RTU_ENABLED                   (  1 )
+
+/*! \brief Time the master waits after a broadcast frame before it sends
+ *    the next frame.
+ */
+#define MB_MASTER_DELAY_MS_CONVERT              ( 200 )
+
+/*! \brief Time the master waits for the slave response before it reports
+ *    a respond timeout error.
+ */
+#define MB_MASTER_TIMEOUT_MS_RESPOND            ( 100 )
+
+/*! \brief The total slaves in the Modbus master system.
+ *
+ * The slave addresses must be continuous starting from 1.
+ */
+#define MB_MASTER_TOTAL_SLAVE_NUM               ( 16 )
+
 /*! \brief The character timeout value for Modbus ASCII.
  *
  * The character timeout value is not fixed for Modbus ASCII and is therefore
@@ -45,6 +45,26 @@ typedef enum
     EV_FRAME_SENT               /*!< Frame sent. */
 } eMBEventType;
 
+typedef enum
+{
+    EV_MASTER_READY = 1 << 0,                   /*!< Startup finished. */
+    EV_MASTER_FRAME_RECEIVED = 1 << 1,          /*!< Frame received. */
+    EV_MASTER_EXECUTE = 1 << 2,                 /*!< Execute function. */
+    EV_MASTER_FRAME_SENT = 1 << 3,              /*!< Frame sent. */
+    EV_MASTER_ERROR_PROCESS = 1 << 4,           /*!< Frame error process. */
+    EV_MASTER_PROCESS_SUCESS = 1 << 5,          /*!< Request process success. */
+    EV_MASTER_ERROR_RESPOND_TIMEOUT = 1 << 6,   /*!< Request respond timeout. */
+    EV_MASTER_ERROR_RECEIVE_DATA = 1 << 7,      /*!< Request receive data error. */
+    EV_MASTER_ERROR_EXECUTE_FUNCTION = 1 << 8   /*!< Request execute function error. */
+} eMBMasterEventType;
+
+typedef enum
+{
+    EV_ERROR_RESPOND_TIMEOUT,   /*!< Slave respond timeout. */
+    EV_ERROR_RECEIVE_DATA,      /*!< Receive frame data error. */
+    EV_ERROR_EXECUTE_FUNCTION   /*!< Execute function error. */
+} eMBMasterErrorEventType;
+
 /*! \ingroup modbus
  * \brief Parity used for characters in serial mode.
  *
@@ -81,6 +101,8 @@ BOOL            xMBPortSerialGetByte( CHAR * pucByte );
 
 BOOL            xMBPortSerialPutByte( CHAR ucByte );
 
+BOOL            xMBPortSerialPutBuffer( const CHAR * pucBuffer, USHORT usLength );
+
 /* ----------------------- Timers functions ---------------------------------*/
 BOOL            xMBPortTimersInit( USHORT usTimeOut50us );
 
@@ -111,6 +133,64 @@ extern          BOOL( *pxMBFrameCBTransmitterEmpty ) ( void );
 
 extern          BOOL( *pxMBPortCBTimerExpired ) ( void );
 
+/* ----------------------- Master port functions ----------------------------*/
+BOOL            xMBMasterPortEventInit( void );
+
+void            vMBMasterPortEventClose( void );
+
+BOOL            xMBMasterPortEventPost( eMBMasterEventType eEvent );
+
+BOOL            xMBMasterPortEventGet(  /*@out@ */ eMBMasterEventType * eEvent );
+
+void            vMBMasterOsResInit( void );
+
+BOOL            xMBMasterRunResTake( LONG lTimeOut );
+
+void            vMBMasterRunResRelease( void );
+
+BOOL            xMBMasterPortSerialInit( UCHAR ucPort, ULONG ulBaudRate,
+                                         UCHAR ucDataBits, eMBParity eParity );
+
+void            vMBMasterPortClose( void );
+
+void            xMBMasterPortSerialClose( void );
+
+void            vMBMasterPortSerialEnable( BOOL xRxEnable, BOOL xTxEnable );
+
+BOOL            xMBMasterPortSerialGetByte( CHAR * pucByte );
+
+BOOL            xMBMasterPortSerialPutByte( CHAR ucByte );
+
+BOOL            xMBMasterPortTimersInit( USHORT usTimeOut50us );
+
+void            xMBMasterPortTimersClose( void );
+
+void            vMBMasterPortTimersT35Enable( void );
+
+void            vMBMasterPortTimersConvertDelayEnable( void );
+
+void            vMBMasterPortTimersRespondTimeoutEnable( void );
+
+void            vMBMasterPortTimersDisable( void );
+
+/* ----------------------- Callback for the master error process ------------*/
+void            vMBMasterErrorCBRespondTimeout( UCHAR ucDestAddress, const UCHAR * pucPDUData,
+                                                USHORT usPDULength );
+
+void            vMBMasterErrorCBReceiveData( UCHAR ucDestAddress, const UCHAR * pucPDUData,
+                                             USHORT usPDULength );
+
+void            vMBMasterErrorCBExecuteFunction( UCHAR ucDestAddress, const UCHAR * pucPDUData,
+                                                 USHORT usPDULength );
+
+void            vMBMasterCBRequestScuuess( void );
+
+extern          BOOL( *pxMBMasterFrameCBByteReceived ) ( void );
+
+extern          BOOL( *pxMBMasterFrameCBTransmitterEmpty ) ( void );
+
+extern          BOOL( *pxMBMasterPortCBTimerExpired ) ( void );
+
 /* ----------------------- TCP port functions -------------------------------*/
 //#if MB_TCP_ENABLED == 1
 BOOL            xMBTCPPortInit( USHORT usTCPPort );
@@ -124,6 +204,29 @@ BOOL            xMBTCPPortGetRequest( UCHAR **ppucMBTCPFrame, USHORT * usTCPLeng
 BOOL            xMBTCPPortSendResponse( const UCHAR *pucMBTCPFrame, USHORT usTCPLength );
 //#endif
 
+/* ----------------------- UDP port functions -------------------------------*/
+BOOL            xMBUDPPortInit( USHORT usUDPPort );
+
+void            vMBUDPPortClose( void );
+
+BOOL            xMBUDPPortGetRequest( UCHAR **ppucMBUDPFrame, USHORT * usUDPLength,
+                                      ULONG * pulPeerAddr, USHORT * pusPeerPort );
+
+BOOL            xMBUDPPortSendResponse( const UCHAR *pucMBUDPFrame, USHORT usUDPLength );
+
+BOOL            xMBMasterUDPPortInit( USHORT usLocalPort );
+
+void            vMBMasterUDPPortClose( void );
+
+BOOL            xMBMasterUDPPortSend( ULONG ulPeerAddr, USHORT usPeerPort,
+                                      const UCHAR *pucMBUDPFrame, USHORT usUDPLength );
+
+BOOL            xMBMasterUDPPortReceive( UCHAR *pucMBUDPFrame, USHORT usBufSize,
+                                         USHORT * pusUDPLength, ULONG * pulPeerAddr,
+                                         USHORT * pusPeerPort, USHORT usTimeoutMS );
+
+ULONG           ulMBUDPPortGetTimeMs( void );
+
 #ifdef __cplusplus
 PR_END_EXTERN_C
 #endif
@@ -52,6 +52,9 @@
 #if MB_TCP_ENABLED == 1
 #include "mbtcp.h"
 #endif
+#if MB_UDP_ENABLED == 1
+#include "mbudp.h"
+#endif
 
 #ifndef MB_PORT_HAS_CLOSE
 #define MB_PORT_HAS_CLOSE 0
@@ -61,6 +64,11 @@ static const char* TAG = "MB_C";
 /* ----------------------- Static variables ---------------------------------*/
 
 static UCHAR    ucMBAddress;
+static UCHAR    ucMBCurrentUnit;
+static UCHAR    ucMBReplyAddress;
+#if MB_MULTI_UNIT_ENABLED > 0
+static pxMBUnitFilter pxMBUnitAccept;
+#endif
 static eMBMode  eMBCurrentMode;
 
 static enum
@@ -223,6 +231,36 @@ eMBTCPInit( USHORT ucTCPPort )
 }
 #endif
 
+#if MB_UDP_ENABLED > 0
+eMBErrorCode
+eMBUDPInit( USHORT ucUDPPort )
+{
+    eMBErrorCode    eStatus = MB_ENOERR;
+
+    if( ( eStatus = eMBUDPDoInit( ucUDPPort ) ) != MB_ENOERR )
+    {
+        eMBState = STATE_DISABLED;
+    }
+    else if( !xMBPortEventInit(  ) )
+    {
+        /* Port dependent event module initalization failed. */
+        eStatus = MB_EPORTERR;
+    }
+    else
+    {
+        pvMBFrameStartCur = eMBUDPStart;
+        pvMBFrameStopCur = eMBUDPStop;
+        peMBFrameReceiveCur = eMBUDPReceive;
+        peMBFrameSendCur = eMBUDPSend;
+        pvMBFrameCloseCur = MB_PORT_HAS_CLOSE ? vMBUDPPortClose : NULL;
+        ucMBAddress = MB_TCP_PSEUDO_ADDRESS;
+        eMBCurrentMode = MB_UDP;
+        eMBState = STATE_DISABLED;
+    }
+    return eStatus;
+}
+#endif
+
 eMBErrorCode
 eMBRegisterCB( UCHAR ucFunctionCode, pxMBFunctionHandler pxHandler )
 {
@@ -329,6 +367,26 @@ eMBDisable( void )
     return eStatus;
 }
 
+eMBErrorCode
+eMBSetUnitFilter( pxMBUnitFilter pxFilter )
+{
+#if MB_MULTI_UNIT_ENABLED > 0
+    ENTER_CRITICAL_SECTION(  );
+    pxMBUnitAccept = pxFilter;
+    EXIT_CRITICAL_SECTION(  );
+    return MB_ENOERR;
+#else
+    ( void )pxFilter;
+    return MB_EILLSTATE;
+#endif
+}
+
+UCHAR
+ucMBGetCurrentUnit( void )
+{
+    return ucMBCurrentUnit;
+}
+
 eMBErrorCode
 eMBPoll( void )
 {
@@ -363,6 +421,26 @@ eMBPoll( void )
             eStatus = peMBFrameReceiveCur( &ucRcvAddress, &ucMBFrame, &usLength );
             if( eStatus == MB_ENOERR )
             {
+                ucMBCurrentUnit = ucMBAddress;
+                ucMBReplyAddress = ucMBAddress;
+#if MB_MULTI_UNIT_ENABLED > 0
+                if( pxMBUnitAccept != NULL )
+                {
+                    /* In Modbus TCP/UDP mode the frame layer returns the
+                     * pseudo address, the unit identifier is the last byte
+                     * of the MBAP header right before the PDU. */
+                    BOOL            xIsNetwork = ( eMBCurrentMode == MB_TCP ) || ( eMBCurrentMode == MB_UDP );
+                    UCHAR           ucUnit = xIsNetwork ? ucMBFrame[-1] : ucRcvAddress;
+
+                    if( ( ucUnit != MB_ADDRESS_BROADCAST ) && pxMBUnitAccept( ucUnit ) )
+                    {
+                        ucMBCurrentUnit = ucUnit;
+                        ucMBReplyAddress = xIsNetwork ? ucMBAddress : ucUnit;
+                        ( void )xMBPortEventPost( EV_EXECUTE );
+                        break;
+                    }
+                }
+#endif
                 /* Check if the frame is for us. If not ignore the frame. */
                 if( ( ucRcvAddress == ucMBAddress ) || ( ucRcvAddress == MB_ADDRESS_BROADCAST ) )
                 {
@@ -404,7 +482,7 @@ eMBPoll( void )
                 {
                     vMBPortTimersDelay( MB_ASCII_TIMEOUT_WAIT_BEFORE_SEND_MS );
                 }                
-                eStatus = peMBFrameSendCur( ucMBAddress, ucMBFrame, usLength );
+                eStatus = peMBFrameSendCur( ucMBReplyAddress, ucMBFrame, usLength );
             }
             break;
 
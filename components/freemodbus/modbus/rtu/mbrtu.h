@@ -45,6 +45,17 @@ BOOL            xMBRTUTransmitFSM( void );
 BOOL            xMBRTUTimerT15Expired( void );
 BOOL            xMBRTUTimerT35Expired( void );
 
+#if MB_MASTER_RTU_ENABLED > 0
+eMBErrorCode    eMBMasterRTUInit( UCHAR ucPort, ULONG ulBaudRate, eMBParity eParity );
+void            eMBMasterRTUStart( void );
+void            eMBMasterRTUStop( void );
+eMBErrorCode    eMBMasterRTUReceive( UCHAR * pucRcvAddress, UCHAR ** pucFrame, USHORT * pusLength );
+eMBErrorCode    eMBMasterRTUSend( UCHAR ucSlaveAddress, const UCHAR * pucFrame, USHORT usLength );
+BOOL            xMBMasterRTUReceiveFSM( void );
+BOOL            xMBMasterRTUTransmitFSM( void );
+BOOL            xMBMasterRTUTimerExpired( void );
+#endif
+
 #ifdef __cplusplus
 PR_END_EXTERN_C
 #endif
@@ -0,0 +1,230 @@
+/* 
+ * FreeModbus Libary: A portable Modbus implementation for Modbus ASCII/RTU.
+ * Copyright (c) 2006 Christian Walter <wolti@sil.at>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * File: $Id: mbudp.c,v 1.0 $
+ */
+
+/* ----------------------- System includes ----------------------------------*/
+#include "stdlib.h"
+#include "string.h"
+
+/* ----------------------- Platform includes --------------------------------*/
+#include "port.h"
+
+/* ----------------------- Modbus includes ----------------------------------*/
+#include "mb.h"
+#include "mbconfig.h"
+#include "mbtcp.h"
+#include "mbudp.h"
+#include "mbframe.h"
+#include "mbport.h"
+
+#if MB_UDP_ENABLED > 0
+
+#if MB_UDP_DUP_CACHE_SIZE < MB_UDP_MASTER_PENDING_MAX
+#error "MB_UDP_DUP_CACHE_SIZE must not be smaller than MB_UDP_MASTER_PENDING_MAX"
+#endif
+
+/* ----------------------- Type definitions ---------------------------------*/
+
+/* A response sent recently, used to answer retransmitted requests. */
+typedef struct
+{
+    BOOL            xValid;
+    ULONG           ulPeerAddr;
+    USHORT          usPeerPort;
+    USHORT          usTID;
+    USHORT          usRequestLength;
+    ULONG           ulRequestHash;
+    ULONG           ulSentMs;
+    USHORT          usLength;
+    UCHAR           aucFrame[MB_TCP_BUF_SIZE_MAX];
+} xMBUDPResponse;
+
+/* ----------------------- Static variables ---------------------------------*/
+static xMBUDPResponse xResponseCache[MB_UDP_DUP_CACHE_SIZE];
+static USHORT   usResponseCacheNext;
+
+/* Source of the request which is currently processed. */
+static ULONG    ulRequestPeerAddr;
+static USHORT   usRequestPeerPort;
+static USHORT   usRequestTID;
+static USHORT   usRequestLength;
+static ULONG    ulRequestHash;
+
+/* ----------------------- Static functions ---------------------------------*/
+/* FNV-1a hash of the request, the response buffer overwrites it later. */
+static ULONG
+prvulMBUDPHash( const UCHAR * pucData, USHORT usLength )
+{
+    ULONG           ulHash = 2166136261UL;
+
+    while( usLength-- )
+    {
+        ulHash ^= *pucData++;
+        ulHash *= 16777619UL;
+    }
+    return ulHash;
+}
+
+/* A response is replayed only for the same request from the same peer
+ * within the retransmission window of the master. */
+static xMBUDPResponse *
+prvxMBUDPFindResponse( ULONG ulPeerAddr, USHORT usPeerPort, USHORT usTID,
+                       USHORT usLength, ULONG ulHash )
+{
+    USHORT          i;
+    ULONG           ulNowMs = ulMBUDPPortGetTimeMs(  );
+
+    for( i = 0; i < MB_UDP_DUP_CACHE_SIZE; i++ )
+    {
+        if( !xResponseCache[i].xValid )
+        {
+            continue;
+        }
+        if( ( ULONG )( ulNowMs - xResponseCache[i].ulSentMs ) >= MB_UDP_DUP_CACHE_TIMEOUT_MS )
+        {
+            xResponseCache[i].xValid = FALSE;
+            continue;
+        }
+        if( ( xResponseCache[i].usTID == usTID ) &&
+            ( xResponseCache[i].ulPeerAddr == ulPeerAddr ) &&
+            ( xResponseCache[i].usPeerPort == usPeerPort ) &&
+            ( xResponseCache[i].usRequestLength == usLength ) &&
+            ( xResponseCache[i].ulRequestHash == ulHash ) )
+        {
+            return &xResponseCache[i];
+        }
+    }
+    return NULL;
+}
+
+/* ----------------------- Start implementation -----------------------------*/
+eMBErrorCode
+eMBUDPDoInit( USHORT ucUDPPort )
+{
+    eMBErrorCode    eStatus = MB_ENOERR;
+
+    if( xMBUDPPortInit( ucUDPPort ) == FALSE )
+    {
+        eStatus = MB_EPORTERR;
+    }
+    return eStatus;
+}
+
+void
+eMBUDPStart( void )
+{
+    memset( xResponseCache, 0, sizeof( xResponseCache ) );
+    usResponseCacheNext = 0;
+}
+
+void
+eMBUDPStop( void )
+{
+    /* Datagram transport, there are no connections to release. */
+}
+
+eMBErrorCode
+eMBUDPReceive( UCHAR * pucRcvAddress, UCHAR ** ppucFrame, USHORT * pusLength )
+{
+    eMBErrorCode    eStatus = MB_EIO;
+    UCHAR          *pucMBUDPFrame;
+    USHORT          usLength;
+    USHORT          usPID;
+    xMBUDPResponse *pxResponse;
+
+    if( xMBUDPPortGetRequest( &pucMBUDPFrame, &usLength,
+                              &ulRequestPeerAddr, &usRequestPeerPort ) != FALSE )
+    {
+        usPID = pucMBUDPFrame[MB_TCP_PID] << 8U;
+        usPID |= pucMBUDPFrame[MB_TCP_PID + 1];
+        usRequestTID = pucMBUDPFrame[MB_TCP_TID] << 8U;
+        usRequestTID |= pucMBUDPFrame[MB_TCP_TID + 1];
+
+        if( ( usPID == MB_TCP_PROTOCOL_ID ) && ( usLength > MB_TCP_FUNC ) )
+        {
+            /* The unit identifier and the PDU identify the request. */
+            usRequestLength = usLength;
+            ulRequestHash = prvulMBUDPHash( &pucMBUDPFrame[MB_TCP_UID], usLength - MB_TCP_UID );
+            pxResponse = prvxMBUDPFindResponse( ulRequestPeerAddr, usRequestPeerPort,
+                                                usRequestTID, usRequestLength, ulRequestHash );
+            if( pxResponse != NULL )
+            {
+                /* Retransmitted request. Repeat the response instead of
+                 * executing a possibly non idempotent request twice. */
+                ( void )xMBUDPPortSendResponse( pxResponse->aucFrame, pxResponse->usLength );
+            }
+            else
+            {
+                *ppucFrame = &pucMBUDPFrame[MB_TCP_FUNC];
+                *pusLength = usLength - MB_TCP_FUNC;
+                eStatus = MB_ENOERR;
+
+                /* Modbus UDP does not use any addresses. Fake the source address
+                 * such that the processing part deals with this frame.
+                 */
+                *pucRcvAddress = MB_TCP_PSEUDO_ADDRESS;
+            }
+        }
+    }
+    return eStatus;
+}
+
+eMBErrorCode
+eMBUDPSend( UCHAR _unused, const UCHAR * pucFrame, USHORT usLength )
+{
+    eMBErrorCode    eStatus = MB_ENOERR;
+    UCHAR          *pucMBUDPFrame = ( UCHAR * ) pucFrame - MB_TCP_FUNC;
+    USHORT          usUDPLength = usLength + MB_TCP_FUNC;
+    xMBUDPResponse *pxResponse;
+
+    /* The MBAP header of the request is reused, only the length is updated. */
+    pucMBUDPFrame[MB_TCP_LEN] = ( usLength + 1 ) >> 8U;
+    pucMBUDPFrame[MB_TCP_LEN + 1] = ( usLength + 1 ) & 0xFF;
+    if( xMBUDPPortSendResponse( pucMBUDPFrame, usUDPLength ) == FALSE )
+    {
+        eStatus = MB_EIO;
+    }
+    else if( usUDPLength <= MB_TCP_BUF_SIZE_MAX )
+    {
+        pxResponse = &xResponseCache[usResponseCacheNext];
+        usResponseCacheNext = ( usResponseCacheNext + 1 ) % MB_UDP_DUP_CACHE_SIZE;
+        pxResponse->ulPeerAddr = ulRequestPeerAddr;
+        pxResponse->usPeerPort = usRequestPeerPort;
+        pxResponse->usTID = usRequestTID;
+        pxResponse->usRequestLength = usRequestLength;
+        pxResponse->ulRequestHash = ulRequestHash;
+        pxResponse->ulSentMs = ulMBUDPPortGetTimeMs(  );
+        pxResponse->usLength = usUDPLength;
+        memcpy( pxResponse->aucFrame, pucMBUDPFrame, usUDPLength );
+        pxResponse->xValid = TRUE;
+    }
+    return eStatus;
+}
+
+#endif
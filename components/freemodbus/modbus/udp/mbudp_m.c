@@ -0,0 +1,287 @@
+/* 
+ * FreeModbus Libary: A portable Modbus implementation for Modbus ASCII/RTU.
+ * Copyright (c) 2006 Christian Walter <wolti@sil.at>
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *    notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *    notice, this list of conditions and the following disclaimer in the
+ *    documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *    derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * File: $Id: mbudp_m.c,v 1.0 $
+ */
+
+/* ----------------------- System includes ----------------------------------*/
+#include "stdlib.h"
+#include "string.h"
+
+/* ----------------------- Platform includes --------------------------------*/
+#include "port.h"
+
+/* ----------------------- Modbus includes ----------------------------------*/
+#include "mb.h"
+#include "mbconfig.h"
+#include "mbtcp.h"
+#include "mbudp.h"
+#include "mbframe.h"
+#include "mbport.h"
+
+#if MB_UDP_ENABLED > 0
+
+#if ( MB_UDP_MASTER_PENDING_MAX & ( MB_UDP_MASTER_PENDING_MAX - 1 ) ) != 0
+#error "MB_UDP_MASTER_PENDING_MAX must be a power of two"
+#endif
+
+/* ----------------------- Defines ------------------------------------------*/
+/* The transaction identifier selects the slot, so a response is matched
+ * to its request without searching the pending table. */
+#define MB_UDP_SLOT( usTID )    ( ( usTID ) & ( MB_UDP_MASTER_PENDING_MAX - 1 ) )
+
+/* ----------------------- Type definitions ---------------------------------*/
+typedef struct
+{
+    BOOL            xInUse;
+    USHORT          usTID;
+    ULONG           ulPeerAddr;
+    USHORT          usPeerPort;
+    UCHAR           ucRetriesLeft;
+    ULONG           ulDeadlineMs;
+    pvMBMasterUDPCallback pvCallback;
+    void           *pvArg;
+    USHORT          usLength;
+    UCHAR           aucFrame[MB_TCP_BUF_SIZE_MAX]; /* Request ADU kept for retransmission. */
+} xMBMasterUDPTransaction;
+
+/* ----------------------- Static variables ---------------------------------*/
+static xMBMasterUDPTransaction xTransactions[MB_UDP_MASTER_PENDING_MAX];
+static USHORT   usNextTID;
+static USHORT   usPending;
+static BOOL     xMasterUDPInitialized = FALSE;
+static UCHAR    aucRcvBuf[MB_TCP_BUF_SIZE_MAX];
+
+/* ----------------------- Static functions ---------------------------------*/
+static void
+prvvMBMasterUDPComplete( xMBMasterUDPTransaction * pxTrans, eMBErrorCode eStatus,
+                         UCHAR ucUnitID, const UCHAR * pucPDU, USHORT usLength )
+{
+    pvMBMasterUDPCallback pvCallback = pxTrans->pvCallback;
+    void           *pvArg = pxTrans->pvArg;
+
+    /* Free the slot first such that the callback can issue a new request. */
+    pxTrans->xInUse = FALSE;
+    usPending--;
+    if( pvCallback != NULL )
+    {
+        pvCallback( eStatus, ucUnitID, pucPDU, usLength, pvArg );
+    }
+}
+
+static void
+prvvMBMasterUDPHandleResponse( const UCHAR * pucFrame, USHORT usLength,
+                               ULONG ulPeerAddr, USHORT usPeerPort )
+{
+    xMBMasterUDPTransaction *pxTrans;
+    USHORT          usTID;
+    USHORT          usPID;
+    USHORT          usMBAPLength;
+
+    if( usLength <= MB_TCP_FUNC )
+    {
+        return;
+    }
+    usTID = pucFrame[MB_TCP_TID] << 8U;
+    usTID |= pucFrame[MB_TCP_TID + 1];
+    usPID = pucFrame[MB_TCP_PID] << 8U;
+    usPID |= pucFrame[MB_TCP_PID + 1];
+    usMBAPLength = pucFrame[MB_TCP_LEN] << 8U;
+    usMBAPLength |= pucFrame[MB_TCP_LEN + 1];
+
+    if( ( usPID != MB_TCP_PROTOCOL_ID ) || ( usMBAPLength != ( usLength - MB_TCP_UID ) ) )
+    {
+        return;
+    }
+    pxTrans = &xTransactions[MB_UDP_SLOT( usTID )];
+    /* Responses to completed transactions (duplicates or answers to an
+     * already answered retransmission) are dropped here. */
+    if( pxTrans->xInUse && ( pxTrans->usTID == usTID ) &&
+        ( pxTrans->ulPeerAddr == ulPeerAddr ) && ( pxTrans->usPeerPort == usPeerPort ) )
+    {
+        prvvMBMasterUDPComplete( pxTrans, MB_ENOERR, pucFrame[MB_TCP_UID],
+                                 &pucFrame[MB_TCP_FUNC], usLength - MB_TCP_FUNC );
+    }
+}
+
+static void
+prvvMBMasterUDPCheckTimeouts( ULONG ulNowMs )
+{
+    xMBMasterUDPTransaction *pxTrans;
+    USHORT          i;
+
+    for( i = 0; ( i < MB_UDP_MASTER_PENDING_MAX ) && ( usPending > 0 ); i++ )
+    {
+        pxTrans = &xTransactions[i];
+        if( !pxTrans->xInUse || ( ( LONG )( ulNowMs - pxTrans->ulDeadlineMs ) < 0 ) )
+        {
+            continue;
+        }
+        if( pxTrans->ucRetriesLeft > 0 )
+        {
+            /* Retransmit with the same transaction identifier such that the
+             * slave can detect the duplicate. */
+            pxTrans->ucRetriesLeft--;
+            pxTrans->ulDeadlineMs = ulNowMs + MB_UDP_MASTER_RETRY_TIMEOUT_MS;
+            ( void )xMBMasterUDPPortSend( pxTrans->ulPeerAddr, pxTrans->usPeerPort,
+                                          pxTrans->aucFrame, pxTrans->usLength );
+        }
+        else
+        {
+            prvvMBMasterUDPComplete( pxTrans, MB_ETIMEDOUT,
+                                     pxTrans->aucFrame[MB_TCP_UID], NULL, 0 );
+        }
+    }
+}
+
+/* ----------------------- Start implementation -----------------------------*/
+eMBErrorCode
+eMBMasterUDPInit( USHORT usLocalPort )
+{
+    eMBErrorCode    eStatus = MB_ENOERR;
+
+    if( xMasterUDPInitialized )
+    {
+        eStatus = MB_EILLSTATE;
+    }
+    else if( xMBMasterUDPPortInit( usLocalPort ) == FALSE )
+    {
+        eStatus = MB_EPORTERR;
+    }
+    else
+    {
+        memset( xTransactions, 0, sizeof( xTransactions ) );
+        usPending = 0;
+        usNextTID = ( USHORT )ulMBUDPPortGetTimeMs(  );
+        xMasterUDPInitialized = TRUE;
+    }
+    return eStatus;
+}
+
+eMBErrorCode
+eMBMasterUDPRequest( ULONG ulPeerAddr, USHORT usPeerPort, UCHAR ucUnitID,
+                     const UCHAR * pucPDU, USHORT usLength,
+                     pvMBMasterUDPCallback pvCallback, void *pvArg )
+{
+    xMBMasterUDPTransaction *pxTrans = NULL;
+    USHORT          usTID = 0;
+    USHORT          i;
+
+    if( !xMasterUDPInitialized )
+    {
+        return MB_EILLSTATE;
+    }
+    if( ( pucPDU == NULL ) || ( usLength == 0 ) || ( usLength > MB_PDU_SIZE_MAX ) )
+    {
+        return MB_EINVAL;
+    }
+    /* Take the next free slot, the transaction identifier follows from it. */
+    for( i = 0; i < MB_UDP_MASTER_PENDING_MAX; i++ )
+    {
+        usTID = usNextTID++;
+        if( !xTransactions[MB_UDP_SLOT( usTID )].xInUse )
+        {
+            pxTrans = &xTransactions[MB_UDP_SLOT( usTID )];
+            break;
+        }
+    }
+    if( pxTrans == NULL )
+    {
+        return MB_ENORES;
+    }
+
+    pxTrans->usTID = usTID;
+    pxTrans->ulPeerAddr = ulPeerAddr;
+    pxTrans->usPeerPort = ( usPeerPort == 0 ) ? MB_UDP_DEFAULT_PORT : usPeerPort;
+    pxTrans->ucRetriesLeft = MB_UDP_MASTER_RETRIES;
+    pxTrans->pvCallback = pvCallback;
+    pxTrans->pvArg = pvArg;
+
+    pxTrans->aucFrame[MB_TCP_TID] = usTID >> 8U;
+    pxTrans->aucFrame[MB_TCP_TID + 1] = usTID & 0xFF;
+    pxTrans->aucFrame[MB_TCP_PID] = MB_TCP_PROTOCOL_ID >> 8U;
+    pxTrans->aucFrame[MB_TCP_PID + 1] = MB_TCP_PROTOCOL_ID & 0xFF;
+    pxTrans->aucFrame[MB_TCP_LEN] = ( usLength + 1 ) >> 8U;
+    pxTrans->aucFrame[MB_TCP_LEN + 1] = ( usLength + 1 ) & 0xFF;
+    pxTrans->aucFrame[MB_TCP_UID] = ucUnitID;
+    memcpy( &pxTrans->aucFrame[MB_TCP_FUNC], pucPDU, usLength );
+    pxTrans->usLength = usLength + MB_TCP_FUNC;
+
+    if( xMBMasterUDPPortSend( pxTrans->ulPeerAddr, pxTrans->usPeerPort,
+                              pxTrans->aucFrame, pxTrans->usLength ) == FALSE )
+    {
+        return MB_EIO;
+    }
+    pxTrans->ulDeadlineMs = ulMBUDPPortGetTimeMs(  ) + MB_UDP_MASTER_RETRY_TIMEOUT_MS;
+    pxTrans->xInUse = TRUE;
+    usPending++;
+    return MB_ENOERR;
+}
+
+eMBErrorCode
+eMBMasterUDPPoll( USHORT usTimeoutMS )
+{
+    USHORT          usLength;
+    ULONG           ulPeerAddr;
+    USHORT          usPeerPort;
+    USHORT          usWaitMS = usTimeoutMS;
+
+    if( !xMasterUDPInitialized )
+    {
+        return MB_EILLSTATE;
+    }
+    /* Do not sleep past the next retransmission. */
+    if( ( usPending > 0 ) && ( usWaitMS > MB_UDP_MASTER_RETRY_TIMEOUT_MS ) )
+    {
+        usWaitMS = MB_UDP_MASTER_RETRY_TIMEOUT_MS;
+    }
+    /* Drain all datagrams which are already queued. */
+    while( xMBMasterUDPPortReceive( aucRcvBuf, sizeof( aucRcvBuf ), &usLength,
+                                    &ulPeerAddr, &usPeerPort, usWaitMS ) != FALSE )
+    {
+        prvvMBMasterUDPHandleResponse( aucRcvBuf, usLength, ulPeerAddr, usPeerPort );
+        usWaitMS = 0;
+    }
+    prvvMBMasterUDPCheckTimeouts( ulMBUDPPortGetTimeMs(  ) );
+    return MB_ENOERR;
+}
+
+eMBErrorCode
+eMBMasterUDPClose( void )
+{
+    if( !xMasterUDPInitialized )
+    {
+        return MB_EILLSTATE;
+    }
+    vMBMasterUDPPortClose(  );
+    memset( xTransactions, 0, sizeof( xTransactions ) );
+    usPending = 0;
+    xMasterUDPInitialized = FALSE;
+    return MB_ENOERR;
+}
+
+#endif
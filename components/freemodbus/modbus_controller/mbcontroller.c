@@ -94,6 +94,42 @@ static uint16_t mb_parity = 0;
 // This is array of Modbus address area descriptors
 static mb_register_area_descriptor_t mb_area_descriptors[MB_PARAM_COUNT] = { 0 };
 
+#if CONFIG_MB_CONTROLLER_UNITS_MAX > 0
+// Register area descriptors of one virtual unit
+typedef struct {
+    mb_register_area_descriptor_t descriptors[MB_PARAM_COUNT];
+} mb_unit_t;
+
+// Unit ID to (slot + 1) in mb_units, zero if the unit is not hosted
+static uint8_t mb_unit_index[256] = { 0 };
+static mb_unit_t mb_units[CONFIG_MB_CONTROLLER_UNITS_MAX];
+static uint8_t mb_unit_count = 0;
+
+#if CONFIG_MB_CONTROLLER_UNIT_POOL_SIZE > 0
+// Register storage shared by all virtual units
+static uint8_t mb_unit_pool[CONFIG_MB_CONTROLLER_UNIT_POOL_SIZE] __attribute__((aligned(4)));
+static size_t mb_unit_pool_used = 0;
+#endif
+
+// Unit filter called by the stack for each received frame
+static BOOL mb_unit_filter(UCHAR unit_id)
+{
+    return (mb_unit_index[unit_id] != 0) ? TRUE : FALSE;
+}
+#endif
+
+// Get the area descriptor of the unit the current request is addressed to
+static mb_register_area_descriptor_t* get_area_descriptor(mb_param_type_t type)
+{
+#if CONFIG_MB_CONTROLLER_UNITS_MAX > 0
+    uint8_t slot = mb_unit_index[ucMBGetCurrentUnit()];
+    if (slot != 0) {
+        return &mb_units[slot - 1].descriptors[type];
+    }
+#endif
+    return &mb_area_descriptors[type];
+}
+
 // The helper function to get time stamp in microseconds
 static uint64_t get_time_stamp()
 {
@@ -113,6 +149,7 @@ static esp_err_t send_param_info(mb_event_group_t par_type, uint16_t mb_offset,
     par_info.address = par_address;
     par_info.time_stamp = get_time_stamp();
     par_info.mb_offset = mb_offset;
+    par_info.unit_id = (uint8_t)ucMBGetCurrentUnit();
     BaseType_t status = xQueueSend(mb_controller_notification_queue_handle, &par_info, MB_PAR_INFO_TOUT);
     if (pdTRUE == status) {
         ESP_LOGD(TAG, "Queue send parameter info (type, address, size): %d, 0x%.4x, %d",
@@ -181,6 +218,82 @@ esp_err_t mbcontroller_set_descriptor(const mb_register_area_descriptor_t descr_
     return ESP_OK;
 }
 
+esp_err_t mbcontroller_set_unit_descriptor(uint8_t unit_id, const mb_register_area_descriptor_t* descr_data)
+{
+#if CONFIG_MB_CONTROLLER_UNITS_MAX > 0
+    MB_CHECK((descr_data != NULL), ESP_ERR_INVALID_ARG, "mb descriptor pointer is NULL.");
+    MB_CHECK(((unit_id > 0) && (unit_id <= MB_ADDRESS_MAX)),
+                ESP_ERR_INVALID_ARG, "mb incorrect unit id = (0x%x).", (uint32_t)unit_id);
+    MB_CHECK(((descr_data->type < MB_PARAM_COUNT) && (descr_data->type >= MB_PARAM_HOLDING)),
+                ESP_ERR_INVALID_ARG, "mb incorrect modbus instance type = (0x%x).",
+                (uint32_t)descr_data->type);
+    MB_CHECK((descr_data->size >= MB_INST_MIN_SIZE) && (descr_data->size < (MB_INST_MAX_SIZE)),
+                ESP_ERR_INVALID_ARG, "mb instance size is incorrect = (0x%x).",
+                (uint32_t)descr_data->size);
+    uint8_t slot = mb_unit_index[unit_id];
+    if (slot == 0) {
+        MB_CHECK((mb_unit_count < CONFIG_MB_CONTROLLER_UNITS_MAX),
+                    ESP_ERR_NO_MEM, "mb no free unit for id = (0x%x).", (uint32_t)unit_id);
+        // The slot is taken only once the descriptor is set below
+        slot = mb_unit_count + 1;
+    }
+    mb_register_area_descriptor_t* descr = &mb_units[slot - 1].descriptors[descr_data->type];
+    mb_register_area_descriptor_t new_descr = *descr_data;
+    if (new_descr.address == NULL) {
+#if CONFIG_MB_CONTROLLER_UNIT_POOL_SIZE > 0
+        uint8_t* old_address = (uint8_t*)descr->address;
+        if ((old_address >= mb_unit_pool) && (old_address < &mb_unit_pool[sizeof(mb_unit_pool)])) {
+            // Pool space is never released, keep the area allocated before
+            MB_CHECK((descr->size == new_descr.size), ESP_ERR_INVALID_STATE,
+                        "mb unit (0x%x) area is already allocated with size (0x%x).",
+                        (uint32_t)unit_id, (uint32_t)descr->size);
+            new_descr.address = old_address;
+        } else {
+            size_t size = (new_descr.size + 3) & ~3;
+            MB_CHECK((size <= (sizeof(mb_unit_pool) - mb_unit_pool_used)),
+                        ESP_ERR_NO_MEM, "mb unit register pool is exhausted.");
+            new_descr.address = &mb_unit_pool[mb_unit_pool_used];
+            mb_unit_pool_used += size;
+        }
+#else
+        ESP_LOGE(TAG, "mb unit register pool is disabled, instance address is NULL.");
+        return ESP_ERR_INVALID_ARG;
+#endif
+    }
+    *descr = new_descr;
+    if (slot > mb_unit_count) {
+        mb_unit_count = slot;
+    }
+    // Publish the unit only when its descriptor is complete
+    mb_unit_index[unit_id] = slot;
+    (void)eMBSetUnitFilter(mb_unit_filter);
+    return ESP_OK;
+#else
+    ESP_LOGE(TAG, "mb virtual units are disabled.");
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+esp_err_t mbcontroller_get_unit_descriptor(uint8_t unit_id, mb_param_type_t type,
+                                            mb_register_area_descriptor_t* descr_data)
+{
+#if CONFIG_MB_CONTROLLER_UNITS_MAX > 0
+    MB_CHECK((descr_data != NULL), ESP_ERR_INVALID_ARG, "mb descriptor pointer is NULL.");
+    MB_CHECK(((type < MB_PARAM_COUNT) && (type >= MB_PARAM_HOLDING)),
+                ESP_ERR_INVALID_ARG, "mb incorrect modbus instance type = (0x%x).",
+                (uint32_t)type);
+    uint8_t slot = mb_unit_index[unit_id];
+    MB_CHECK((slot != 0), ESP_ERR_NOT_FOUND, "mb unit (0x%x) is not hosted.", (uint32_t)unit_id);
+    MB_CHECK((mb_units[slot - 1].descriptors[type].address != NULL), ESP_ERR_NOT_FOUND,
+                "mb unit (0x%x) has no area of type (0x%x).", (uint32_t)unit_id, (uint32_t)type);
+    *descr_data = mb_units[slot - 1].descriptors[type];
+    return ESP_OK;
+#else
+    ESP_LOGE(TAG, "mb virtual units are disabled.");
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
 // Initialization of Modbus controller
 esp_err_t mbcontroller_init(void) {
 //    mb_type = MB_MODE_RTU;
@@ -314,9 +427,10 @@ eMBErrorCode eMBRegInputCB(UCHAR * pucRegBuffer, USHORT usAddress,
                                 USHORT usNRegs)
 {
     assert(pucRegBuffer != NULL);
-    USHORT usRegInputNregs = (USHORT)(mb_area_descriptors[MB_PARAM_INPUT].size >> 1); // Number of input registers
-    USHORT usInputRegStart = (USHORT)mb_area_descriptors[MB_PARAM_INPUT].start_offset; // Get Modbus start address
-    UCHAR* pucInputBuffer = (UCHAR*)mb_area_descriptors[MB_PARAM_INPUT].address; // Get instance address
+    mb_register_area_descriptor_t* pxArea = get_area_descriptor(MB_PARAM_INPUT);
+    USHORT usRegInputNregs = (USHORT)(pxArea->size >> 1); // Number of input registers
+    USHORT usInputRegStart = (USHORT)pxArea->start_offset; // Get Modbus start address
+    UCHAR* pucInputBuffer = (UCHAR*)pxArea->address; // Get instance address
     USHORT usRegs = usNRegs;
     eMBErrorCode eStatus = MB_ENOERR;
     USHORT iRegIndex;
@@ -352,9 +466,10 @@ eMBErrorCode eMBRegHoldingCB(UCHAR * pucRegBuffer, USHORT usAddress,
         USHORT usNRegs, eMBRegisterMode eMode)
 {
     assert(pucRegBuffer != NULL);
-    USHORT usRegHoldingNregs = (USHORT)(mb_area_descriptors[MB_PARAM_HOLDING].size >> 1);
-    USHORT usRegHoldingStart = (USHORT)mb_area_descriptors[MB_PARAM_HOLDING].start_offset;
-    UCHAR* pucHoldingBuffer = (UCHAR*)mb_area_descriptors[MB_PARAM_HOLDING].address;
+    mb_register_area_descriptor_t* pxArea = get_area_descriptor(MB_PARAM_HOLDING);
+    USHORT usRegHoldingNregs = (USHORT)(pxArea->size >> 1);
+    USHORT usRegHoldingStart = (USHORT)pxArea->start_offset;
+    UCHAR* pucHoldingBuffer = (UCHAR*)pxArea->address;
     eMBErrorCode eStatus = MB_ENOERR;
     USHORT iRegIndex;
     USHORT usRegs = usNRegs;
@@ -406,9 +521,10 @@ eMBErrorCode eMBRegCoilsCB(UCHAR* pucRegBuffer, USHORT usAddress,
         USHORT usNCoils, eMBRegisterMode eMode)
 {
     assert(NULL != pucRegBuffer);
-    USHORT usRegCoilNregs = (USHORT)(mb_area_descriptors[MB_PARAM_COIL].size >> 1); // number of registers in storage area
-    USHORT usRegCoilsStart = (USHORT)mb_area_descriptors[MB_PARAM_COIL].start_offset; // MB offset of coils registers
-    UCHAR* pucRegCoilsBuf = (UCHAR*)mb_area_descriptors[MB_PARAM_COIL].address;
+    mb_register_area_descriptor_t* pxArea = get_area_descriptor(MB_PARAM_COIL);
+    USHORT usRegCoilNregs = (USHORT)(pxArea->size >> 1); // number of registers in storage area
+    USHORT usRegCoilsStart = (USHORT)pxArea->start_offset; // MB offset of coils registers
+    UCHAR* pucRegCoilsBuf = (UCHAR*)pxArea->address;
     eMBErrorCode eStatus = MB_ENOERR;
     USHORT iRegIndex;
     USHORT usCoils = usNCoils;
@@ -459,9 +575,10 @@ eMBErrorCode eMBRegDiscreteCB(UCHAR * pucRegBuffer, USHORT usAddress,
                             USHORT usNDiscrete)
 {
     assert(pucRegBuffer != NULL);
-    USHORT usRegDiscreteNregs = (USHORT)(mb_area_descriptors[MB_PARAM_DISCRETE].size >> 1); // number of registers in storage area
-    USHORT usRegDiscreteStart = (USHORT)mb_area_descriptors[MB_PARAM_DISCRETE].start_offset; // MB offset of registers
-    UCHAR* pucRegDiscreteBuf = (UCHAR*)mb_area_descriptors[MB_PARAM_DISCRETE].address; // the storage address
+    mb_register_area_descriptor_t* pxArea = get_area_descriptor(MB_PARAM_DISCRETE);
+    USHORT usRegDiscreteNregs = (USHORT)(pxArea->size >> 1); // number of registers in storage area
+    USHORT usRegDiscreteStart = (USHORT)pxArea->start_offset; // MB offset of registers
+    UCHAR* pucRegDiscreteBuf = (UCHAR*)pxArea->address; // the storage address
     eMBErrorCode eStatus = MB_ENOERR;
     USHORT iRegIndex, iRegBitIndex, iNReg;
     UCHAR* pucDiscreteInputBuf;
@@ -87,6 +87,7 @@ typedef struct {
     mb_event_group_t type;                  /*!< Modbus event type */
     uint8_t* address;                       /*!< Modbus data storage address */
     size_t size;                            /*!< Modbus event register size (number of registers)*/
+    uint8_t unit_id;                        /*!< Modbus unit the request was addressed to */
 } mb_param_info_t;
 
 /**
@@ -182,5 +183,42 @@ esp_err_t mbcontroller_get_param_info(mb_param_info_t* reg_info, uint32_t timeou
  */
 esp_err_t mbcontroller_set_descriptor(mb_register_area_descriptor_t descr_data);
 
+/**
+ * @brief Set Modbus area descriptor for a virtual unit
+ *
+ * The slave answers requests addressed to the unit ID (serial slave address or
+ * TCP/UDP unit identifier) with the register areas of this unit. If the address
+ * field of the descriptor is NULL the area is allocated from the register pool
+ * shared by all units, use mbcontroller_get_unit_descriptor() to get its address.
+ * Pool space is not released: setting the descriptor again with a NULL address
+ * keeps the area allocated before, which must have the same size.
+ * Units should be configured before mbcontroller_start() is called.
+ *
+ * @param unit_id Virtual unit ID (1 - 247)
+ * @param descr_data Modbus registers area descriptor structure
+ *
+ * @return
+ *     - ESP_OK: The appropriate descriptor is set
+ *     - ESP_ERR_INVALID_ARG: The argument is incorrect
+ *     - ESP_ERR_INVALID_STATE: The area is already allocated from the pool with another size
+ *     - ESP_ERR_NO_MEM: No free unit or not enough space in the register pool
+ */
+esp_err_t mbcontroller_set_unit_descriptor(uint8_t unit_id, const mb_register_area_descriptor_t* descr_data);
+
+/**
+ * @brief Get Modbus area descriptor of a virtual unit
+ *
+ * @param unit_id Virtual unit ID (1 - 247)
+ * @param type Type of the register area
+ * @param[out] descr_data Modbus registers area descriptor structure
+ *
+ * @return
+ *     - ESP_OK: The descriptor is returned
+ *     - ESP_ERR_INVALID_ARG: The argument is incorrect
+ *     - ESP_ERR_NOT_FOUND: The unit or its area of this type is not set
+ */
+esp_err_t mbcontroller_get_unit_descriptor(uint8_t unit_id, mb_param_type_t type,
+                                            mb_register_area_descriptor_t* descr_data);
+
 #endif
 
@@ -94,6 +94,14 @@ void vMBPortExitCritical(void);
 
 BOOL xMBPortSerialTxPoll();
 
+BOOL xMBMasterPortSerialTxPoll(void);
+
+BOOL xMBPortTCPPool(void);
+
+BOOL xMBPortUDPPool(void);
+
+void vMBPortEventSetPool(BOOL (*pxPool)(void));
+
 
 #ifdef __cplusplus
 }
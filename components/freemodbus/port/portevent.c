@@ -33,8 +33,8 @@
 static eMBEventType eQueuedEvent;
 static BOOL     xEventInQueue;
 
-/* ----------------------- Function prototypes ------------------------------*/
-BOOL            xMBPortTCPPool( void );
+/* Network transport polled while no event is queued (TCP unless changed). */
+static BOOL     ( *pxMBPortPool ) ( void ) = xMBPortTCPPool;
 
 /* ----------------------- Start implementation -----------------------------*/
 BOOL
@@ -66,8 +66,13 @@ xMBPortEventGet( eMBEventType * eEvent )
     else
     {
         /* We can't do anything with errors from the pooling module. */
-        ( void )xMBPortTCPPool(  );
+        ( void )pxMBPortPool(  );
     }
     return xEventHappened;
 }
 
+void
+vMBPortEventSetPool( BOOL ( *pxPool ) ( void ) )
+{
+    pxMBPortPool = pxPool;
+}
@@ -0,0 +1,156 @@
+/*
+ * FreeModbus Libary: ESP32 Port Demo Application
+ * Copyright (C) 2010 Christian Walter <cwalter@embedded-solutions.at>
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * IF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * File: $Id: portevent_m.c,v 1.60 2013/08/13 15:07:05 Armink Add Master Functions$
+ */
+
+/* ----------------------- System includes ----------------------------------*/
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/semphr.h"
+
+/* ----------------------- Platform includes --------------------------------*/
+#include "port.h"
+
+/* ----------------------- Modbus includes ----------------------------------*/
+#include "mb.h"
+#include "mb_m.h"
+#include "mbport.h"
+
+// Events processed by eMBMasterPoll()
+#define MB_EVENT_POLL_MASK      (EV_MASTER_READY | EV_MASTER_FRAME_RECEIVED | EV_MASTER_EXECUTE | \
+                                    EV_MASTER_FRAME_SENT | EV_MASTER_ERROR_PROCESS)
+// Events which finish a request, waited for by eMBMasterWaitRequestFinish()
+#define MB_EVENT_REQ_MASK       (EV_MASTER_PROCESS_SUCESS | EV_MASTER_ERROR_RESPOND_TIMEOUT | \
+                                    EV_MASTER_ERROR_RECEIVE_DATA | EV_MASTER_ERROR_EXECUTE_FUNCTION)
+
+static EventGroupHandle_t xMasterEventHandle = NULL;
+static SemaphoreHandle_t xMasterRunRes = NULL;
+
+/* ----------------------- Start implementation -----------------------------*/
+BOOL xMBMasterPortEventInit(void)
+{
+    if (xMasterEventHandle == NULL) {
+        xMasterEventHandle = xEventGroupCreate();
+        MB_PORT_CHECK((xMasterEventHandle != NULL), FALSE, "mb stack event group creation error.");
+    }
+    (void)xEventGroupClearBits(xMasterEventHandle, MB_EVENT_POLL_MASK | MB_EVENT_REQ_MASK);
+    return TRUE;
+}
+
+void vMBMasterPortEventClose(void)
+{
+    if (xMasterEventHandle != NULL) {
+        vEventGroupDelete(xMasterEventHandle);
+        xMasterEventHandle = NULL;
+    }
+    if (xMasterRunRes != NULL) {
+        vSemaphoreDelete(xMasterRunRes);
+        xMasterRunRes = NULL;
+    }
+}
+
+BOOL xMBMasterPortEventPost(eMBMasterEventType eEvent)
+{
+    // Events are posted from the poll, serial and timer tasks, never from an ISR
+    (void)xEventGroupSetBits(xMasterEventHandle, (EventBits_t)eEvent);
+    return TRUE;
+}
+
+BOOL xMBMasterPortEventGet(eMBMasterEventType* eEvent)
+{
+    EventBits_t uxBits = xEventGroupWaitBits(xMasterEventHandle, MB_EVENT_POLL_MASK,
+                                                pdFALSE, pdFALSE, portMAX_DELAY);
+    uxBits &= MB_EVENT_POLL_MASK;
+    if (uxBits == 0) {
+        return FALSE;
+    }
+    // Process one event per call in the order of the bits, the others stay pending
+    uxBits &= -uxBits;
+    (void)xEventGroupClearBits(xMasterEventHandle, uxBits);
+    *eEvent = (eMBMasterEventType)uxBits;
+    return TRUE;
+}
+
+void vMBMasterOsResInit(void)
+{
+    if (xMasterRunRes == NULL) {
+        xMasterRunRes = xSemaphoreCreateBinary();
+    }
+    if (xMasterRunRes == NULL) {
+        ESP_LOGE(MB_PORT_TAG, "%s: mb stack resource semaphore creation error.", __func__);
+        return;
+    }
+    (void)xSemaphoreGive(xMasterRunRes);
+}
+
+BOOL xMBMasterRunResTake(LONG lTimeOut)
+{
+    TickType_t xTicks = (lTimeOut < 0) ? portMAX_DELAY : pdMS_TO_TICKS(lTimeOut);
+    return (xSemaphoreTake(xMasterRunRes, xTicks) == pdTRUE);
+}
+
+void vMBMasterRunResRelease(void)
+{
+    (void)xSemaphoreGive(xMasterRunRes);
+}
+
+void vMBMasterErrorCBRespondTimeout(UCHAR ucDestAddress, const UCHAR* pucPDUData, USHORT usPDULength)
+{
+    (void)xEventGroupSetBits(xMasterEventHandle, EV_MASTER_ERROR_RESPOND_TIMEOUT);
+}
+
+void vMBMasterErrorCBReceiveData(UCHAR ucDestAddress, const UCHAR* pucPDUData, USHORT usPDULength)
+{
+    (void)xEventGroupSetBits(xMasterEventHandle, EV_MASTER_ERROR_RECEIVE_DATA);
+}
+
+void vMBMasterErrorCBExecuteFunction(UCHAR ucDestAddress, const UCHAR* pucPDUData, USHORT usPDULength)
+{
+    (void)xEventGroupSetBits(xMasterEventHandle, EV_MASTER_ERROR_EXECUTE_FUNCTION);
+}
+
+void vMBMasterCBRequestScuuess(void)
+{
+    (void)xEventGroupSetBits(xMasterEventHandle, EV_MASTER_PROCESS_SUCESS);
+}
+
+eMBMasterReqErrCode eMBMasterWaitRequestFinish(void)
+{
+    eMBMasterReqErrCode eErrStatus = MB_MRE_NO_ERR;
+    EventBits_t uxBits = xEventGroupWaitBits(xMasterEventHandle, MB_EVENT_REQ_MASK,
+                                                pdTRUE, pdFALSE, portMAX_DELAY);
+    if (uxBits & EV_MASTER_ERROR_RESPOND_TIMEOUT) {
+        eErrStatus = MB_MRE_TIMEDOUT;
+    } else if (uxBits & EV_MASTER_ERROR_RECEIVE_DATA) {
+        eErrStatus = MB_MRE_REV_DATA;
+    } else if (uxBits & EV_MASTER_ERROR_EXECUTE_FUNCTION) {
+        eErrStatus = MB_MRE_EXE_FUN;
+    }
+    return eErrStatus;
+}
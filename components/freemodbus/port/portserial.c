@@ -281,6 +281,13 @@ BOOL xMBPortSerialPutByte(CHAR ucByte)
     return (ucLength == 1);
 }
 
+// Send a complete frame to UART transmission buffer in one write
+BOOL xMBPortSerialPutBuffer(const CHAR* pucBuffer, USHORT usLength)
+{
+    int iLength = uart_write_bytes(ucUartNumber, pucBuffer, usLength);
+    return (iLength == usLength);
+}
+
 // Get one byte from intermediate RX buffer
 BOOL xMBPortSerialGetByte(CHAR* pucByte)
 {
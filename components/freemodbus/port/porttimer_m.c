@@ -0,0 +1,113 @@
+/*
+ * FreeModbus Libary: ESP32 Port Demo Application
+ * Copyright (C) 2010 Christian Walter <cwalter@embedded-solutions.at>
+ *
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions
+ * are met:
+ * 1. Redistributions of source code must retain the above copyright
+ *   notice, this list of conditions and the following disclaimer.
+ * 2. Redistributions in binary form must reproduce the above copyright
+ *   notice, this list of conditions and the following disclaimer in the
+ *   documentation and/or other materials provided with the distribution.
+ * 3. The name of the author may not be used to endorse or promote products
+ *   derived from this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE AUTHOR ``AS IS'' AND ANY EXPRESS OR
+ * IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES
+ * IF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED.
+ * IN NO EVENT SHALL THE AUTHOR BE LIABLE FOR ANY DIRECT, INDIRECT,
+ * INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT
+ * NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF
+ * THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * File: $Id: porttimer_m.c,v 1.1 2010/06/06 13:07:20 wolti Exp $
+ */
+
+/* ----------------------- Platform includes --------------------------------*/
+#include "port.h"
+#include "esp_timer.h"
+
+/* ----------------------- Modbus includes ----------------------------------*/
+#include "mb.h"
+#include "mb_m.h"
+#include "mbconfig.h"
+#include "mbport.h"
+#include "sdkconfig.h"
+
+// The master timers are software esp_timer instances so no timer group is consumed.
+// When CONFIG_MB_TIMER_PORT_ENABLED is not set the T3.5 timer is only armed once
+// at stack start, the end of frame is reported by the UART TOUT (see portserial_m.c).
+
+#define MB_DISCR_TIME_US        (50)    // 50uS = one discreet for timer
+
+static esp_timer_handle_t xMbMasterTimer = NULL;
+static uint64_t ullT35TimeoutUs = 0;    // T3.5 time in microseconds
+
+/* ----------------------- Start implementation -----------------------------*/
+static void vMBMasterTimerCallback(void *param)
+{
+    (void)pxMBMasterPortCBTimerExpired(); // Timer callback function
+}
+
+static void vMBMasterPortTimersStart(uint64_t ullTimeoutUs)
+{
+    // The timer has to be stopped before restart, ignore the error if it is not active
+    (void)esp_timer_stop(xMbMasterTimer);
+    ESP_ERROR_CHECK(esp_timer_start_once(xMbMasterTimer, ullTimeoutUs));
+}
+
+BOOL xMBMasterPortTimersInit(USHORT usTimeOut50us)
+{
+    MB_PORT_CHECK((usTimeOut50us > 0), FALSE,
+            "Modbus timeout discreet is incorrect.");
+    ullT35TimeoutUs = (uint64_t)usTimeOut50us * MB_DISCR_TIME_US;
+    if (xMbMasterTimer == NULL) {
+        const esp_timer_create_args_t xTimerConf = {
+            .callback = vMBMasterTimerCallback,
+            .arg = NULL,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = "mb_master_timer"
+        };
+        esp_err_t xErr = esp_timer_create(&xTimerConf, &xMbMasterTimer);
+        MB_PORT_CHECK((xErr == ESP_OK), FALSE,
+                "timer create failure, esp_timer_create() returned (0x%x).", (uint32_t)xErr);
+    }
+    return TRUE;
+}
+
+void vMBMasterPortTimersT35Enable(void)
+{
+    vMBMasterSetCurTimerMode(MB_TMODE_T35);
+    vMBMasterPortTimersStart(ullT35TimeoutUs);
+}
+
+void vMBMasterPortTimersConvertDelayEnable(void)
+{
+    vMBMasterSetCurTimerMode(MB_TMODE_CONVERT_DELAY);
+    vMBMasterPortTimersStart((uint64_t)MB_MASTER_DELAY_MS_CONVERT * 1000);
+}
+
+void vMBMasterPortTimersRespondTimeoutEnable(void)
+{
+    vMBMasterSetCurTimerMode(MB_TMODE_RESPOND_TIMEOUT);
+    vMBMasterPortTimersStart((uint64_t)MB_MASTER_TIMEOUT_MS_RESPOND * 1000);
+}
+
+void vMBMasterPortTimersDisable(void)
+{
+    (void)esp_timer_stop(xMbMasterTimer);
+}
+
+void xMBMasterPortTimersClose(void)
+{
+    if (xMbMasterTimer != NULL) {
+        (void)esp_timer_stop(xMbMasterTimer);
+        ESP_ERROR_CHECK(esp_timer_delete(xMbMasterTimer));
+        xMbMasterTimer = NULL;
+    }
+}
@@ -0,0 +1,249 @@
+/*
+ * FreeModbus Libary: ESP32 UDP Port
+ *
+ * This library is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * This library is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with this library; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA  02110-1301  USA
+ *
+ * File: $Id: portudp.c,v 1.0 $
+ */
+
+/*
+ * Design Notes:
+ *
+ * The slave socket is bound to all interfaces and polled from the event
+ * module like the TCP port. One datagram is one Modbus UDP ADU, the source
+ * address of the last request is kept to send the response back.
+ *
+ * The master uses its own socket so that a single socket serves any number
+ * of slaves and outstanding requests.
+ */
+
+#include <stdio.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <string.h>
+#include <netinet/in.h>
+#include <unistd.h>
+#include <errno.h>
+
+#include "port.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+
+/* ----------------------- Modbus includes ----------------------------------*/
+#include "mb.h"
+#include "mbport.h"
+#include "mbtcp.h"
+#include "mbudp.h"
+
+static const char *TAG = "MB_UDP_PORT";
+
+/* ----------------------- Defines  -----------------------------------------*/
+#define MB_UDP_POOL_TIMEOUT 50  /* pool timeout for event waiting (ms). */
+
+/* ----------------------- Static variables ---------------------------------*/
+static SOCKET   xUDPSocket = INVALID_SOCKET;
+static SOCKET   xMasterUDPSocket = INVALID_SOCKET;
+
+static UCHAR    aucUDPBuf[MB_TCP_BUF_SIZE_MAX];
+static USHORT   usUDPBufLen;
+static struct sockaddr_in xRequestPeer;
+
+/* ----------------------- Static functions ---------------------------------*/
+static SOCKET
+prvxMBUDPPortOpen( USHORT usPort )
+{
+    SOCKET          xSocket;
+    struct sockaddr_in xAddr;
+
+    memset( &xAddr, 0, sizeof( xAddr ) );
+    xAddr.sin_family = AF_INET;
+    xAddr.sin_addr.s_addr = htonl( INADDR_ANY );
+    xAddr.sin_port = htons( usPort );
+    if( ( xSocket = socket( AF_INET, SOCK_DGRAM, IPPROTO_UDP ) ) == -1 )
+    {
+        ESP_LOGE( TAG, "Create socket failed." );
+        return INVALID_SOCKET;
+    }
+    if( bind( xSocket, ( struct sockaddr * )&xAddr, sizeof( xAddr ) ) == -1 )
+    {
+        ESP_LOGE( TAG, "Bind socket failed, port %u.", usPort );
+        close( xSocket );
+        return INVALID_SOCKET;
+    }
+    return xSocket;
+}
+
+/* Waits at most usTimeoutMS for a datagram on the socket and reads it. */
+static int
+prviMBUDPPortRecv( SOCKET xSocket, UCHAR * pucBuf, USHORT usBufSize,
+                   struct sockaddr_in *pxPeer, USHORT usTimeoutMS )
+{
+    fd_set          fread;
+    struct timeval  tval;
+    socklen_t       xPeerLen = sizeof( *pxPeer );
+
+    tval.tv_sec = usTimeoutMS / 1000;
+    tval.tv_usec = ( usTimeoutMS % 1000 ) * 1000;
+    FD_ZERO( &fread );
+    FD_SET( xSocket, &fread );
+    if( select( xSocket + 1, &fread, NULL, NULL, &tval ) <= 0 )
+    {
+        return -1;
+    }
+    return recvfrom( xSocket, pucBuf, usBufSize, 0, ( struct sockaddr * )pxPeer, &xPeerLen );
+}
+
+/* ----------------------- Begin implementation -----------------------------*/
+ULONG
+ulMBUDPPortGetTimeMs( void )
+{
+    return ( ULONG )( esp_timer_get_time(  ) / 1000 );
+}
+
+BOOL
+xMBUDPPortInit( USHORT usUDPPort )
+{
+    xUDPSocket = prvxMBUDPPortOpen( ( usUDPPort == 0 ) ? MB_UDP_DEFAULT_PORT : usUDPPort );
+    if( xUDPSocket == INVALID_SOCKET )
+    {
+        return FALSE;
+    }
+    usUDPBufLen = 0;
+    vMBPortEventSetPool( xMBPortUDPPool );
+    return TRUE;
+}
+
+void
+vMBUDPPortClose( void )
+{
+    if( xUDPSocket != INVALID_SOCKET )
+    {
+        close( xUDPSocket );
+        xUDPSocket = INVALID_SOCKET;
+    }
+}
+
+/*! \ingroup port_udp
+ *
+ * \brief Pool the slave socket for a new request.
+ * \internal
+ *
+ * Reads one datagram and notifies the protocol stack if it holds a complete
+ * Modbus UDP frame (the MBAP length matches the datagram size).
+ */
+BOOL
+xMBPortUDPPool( void )
+{
+    int             iLen;
+    USHORT          usLength;
+
+    if( xUDPSocket == INVALID_SOCKET )
+    {
+        return FALSE;
+    }
+    iLen = prviMBUDPPortRecv( xUDPSocket, aucUDPBuf, sizeof( aucUDPBuf ),
+                              &xRequestPeer, MB_UDP_POOL_TIMEOUT );
+    if( iLen <= MB_TCP_FUNC )
+    {
+        return TRUE;
+    }
+    /* Length is a byte count of Modbus PDU (function code + data) and the
+     * unit identifier. */
+    usLength = aucUDPBuf[MB_TCP_LEN] << 8U;
+    usLength |= aucUDPBuf[MB_TCP_LEN + 1];
+    if( iLen == ( MB_TCP_UID + usLength ) )
+    {
+        usUDPBufLen = ( USHORT )iLen;
+        ( void )xMBPortEventPost( EV_FRAME_RECEIVED );
+    }
+    return TRUE;
+}
+
+BOOL
+xMBUDPPortGetRequest( UCHAR ** ppucMBUDPFrame, USHORT * usUDPLength,
+                      ULONG * pulPeerAddr, USHORT * pusPeerPort )
+{
+    if( usUDPBufLen == 0 )
+    {
+        return FALSE;
+    }
+    *ppucMBUDPFrame = &aucUDPBuf[0];
+    *usUDPLength = usUDPBufLen;
+    *pulPeerAddr = xRequestPeer.sin_addr.s_addr;
+    *pusPeerPort = ntohs( xRequestPeer.sin_port );
+    usUDPBufLen = 0;
+    return TRUE;
+}
+
+BOOL
+xMBUDPPortSendResponse( const UCHAR * pucMBUDPFrame, USHORT usUDPLength )
+{
+    int             res;
+
+    res = sendto( xUDPSocket, pucMBUDPFrame, usUDPLength, 0,
+                  ( struct sockaddr * )&xRequestPeer, sizeof( xRequestPeer ) );
+    return ( res == usUDPLength ) ? TRUE : FALSE;
+}
+
+BOOL
+xMBMasterUDPPortInit( USHORT usLocalPort )
+{
+    xMasterUDPSocket = prvxMBUDPPortOpen( usLocalPort );
+    return ( xMasterUDPSocket != INVALID_SOCKET ) ? TRUE : FALSE;
+}
+
+void
+vMBMasterUDPPortClose( void )
+{
+    if( xMasterUDPSocket != INVALID_SOCKET )
+    {
+        close( xMasterUDPSocket );
+        xMasterUDPSocket = INVALID_SOCKET;
+    }
+}
+
+BOOL
+xMBMasterUDPPortSend( ULONG ulPeerAddr, USHORT usPeerPort,
+                      const UCHAR * pucMBUDPFrame, USHORT usUDPLength )
+{
+    struct sockaddr_in xPeer;
+    int             res;
+
+    memset( &xPeer, 0, sizeof( xPeer ) );
+    xPeer.sin_family = AF_INET;
+    xPeer.sin_addr.s_addr = ulPeerAddr;
+    xPeer.sin_port = htons( usPeerPort );
+    res = sendto( xMasterUDPSocket, pucMBUDPFrame, usUDPLength, 0,
+                  ( struct sockaddr * )&xPeer, sizeof( xPeer ) );
+    return ( res == usUDPLength ) ? TRUE : FALSE;
+}
+
+BOOL
+xMBMasterUDPPortReceive( UCHAR * pucMBUDPFrame, USHORT usBufSize, USHORT * pusUDPLength,
+                         ULONG * pulPeerAddr, USHORT * pusPeerPort, USHORT usTimeoutMS )
+{
+    struct sockaddr_in xPeer;
+    int             iLen;
+
+    iLen = prviMBUDPPortRecv( xMasterUDPSocket, pucMBUDPFrame, usBufSize, &xPeer, usTimeoutMS );
+    if( iLen <= 0 )
+    {
+        return FALSE;
+    }
+    *pusUDPLength = ( USHORT )iLen;
+    *pulPeerAddr = xPeer.sin_addr.s_addr;
+    *pusPeerPort = ntohs( xPeer.sin_port );
+    return TRUE;
+}
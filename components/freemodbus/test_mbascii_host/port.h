@@ -0,0 +1,19 @@
+/* Host replacement of the ESP32 port header, only the types used by the
+ * platform independent parts of the stack. */
+#ifndef _PORT_H
+#define _PORT_H
+
+#include <stdint.h>
+
+#define TRUE            1
+#define FALSE           0
+
+typedef char    BOOL;
+typedef unsigned char UCHAR;
+typedef char    CHAR;
+typedef uint16_t USHORT;
+typedef int16_t SHORT;
+typedef uint32_t ULONG;
+typedef int32_t LONG;
+
+#endif
@@ -0,0 +1,159 @@
+#include "catch.hpp"
+#include <string.h>
+#include <chrono>
+#include <sstream>
+#include <iostream>
+
+extern "C" {
+#include "port.h"
+#include "mbasciicodec.h"
+}
+
+static std::stringstream s_perf;
+
+/* Character at a time path as done by the former ASCII FSMs, kept here as
+ * the benchmark baseline: branchy nibble conversion, LRC in a separate
+ * pass and one port call per character. */
+static UCHAR legacy_bin2char(UCHAR ucByte)
+{
+    if (ucByte <= 0x09) {
+        return (UCHAR)('0' + ucByte);
+    }
+    return (UCHAR)(ucByte - 0x0A + 'A');
+}
+
+static UCHAR legacy_char2bin(UCHAR ucCharacter)
+{
+    if ((ucCharacter >= '0') && (ucCharacter <= '9')) {
+        return (UCHAR)(ucCharacter - '0');
+    } else if ((ucCharacter >= 'A') && (ucCharacter <= 'F')) {
+        return (UCHAR)(ucCharacter - 'A' + 0x0A);
+    }
+    return 0xFF;
+}
+
+static UCHAR legacy_lrc(const UCHAR *pucFrame, USHORT usLen)
+{
+    UCHAR ucLRC = 0;
+    while (usLen--) {
+        ucLRC += *pucFrame++;
+    }
+    return (UCHAR)(-((CHAR)ucLRC));
+}
+
+static UCHAR s_port_buf[MB_ASCII_FRAME_SIZE(256)];
+static size_t s_port_pos;
+
+static void __attribute__((noinline)) port_put_byte(CHAR c)
+{
+    s_port_buf[s_port_pos++] = (UCHAR)c;
+}
+
+static void __attribute__((noinline)) port_put_buffer(const UCHAR *buf, USHORT len)
+{
+    memcpy(s_port_buf, buf, len);
+    s_port_pos = len;
+}
+
+static void legacy_send(const UCHAR *pdu, USHORT len)
+{
+    UCHAR lrc = legacy_lrc(pdu, len);
+    s_port_pos = 0;
+    port_put_byte(':');
+    for (USHORT i = 0; i <= len; i++) {
+        UCHAR b = (i < len) ? pdu[i] : lrc;
+        port_put_byte(legacy_bin2char(b >> 4));
+        port_put_byte(legacy_bin2char(b & 0x0F));
+    }
+    port_put_byte('\r');
+    port_put_byte('\n');
+}
+
+static bool legacy_receive(UCHAR *dst, const UCHAR *chars, USHORT n, USHORT *len)
+{
+    USHORT pos = 0;
+    for (USHORT i = 0; i < n; i += 2) {
+        dst[pos] = (UCHAR)(legacy_char2bin(chars[i]) << 4);
+        dst[pos++] |= legacy_char2bin(chars[i + 1]);
+    }
+    *len = pos - 1;
+    return legacy_lrc(dst, pos) == 0;
+}
+
+TEST_CASE("ascii frame is encoded with LRC", "[mbascii]")
+{
+    const UCHAR pdu[] = {0x01, 0x03, 0x00, 0x6B, 0x00, 0x03};
+    UCHAR frame[MB_ASCII_FRAME_SIZE(sizeof(pdu))];
+    USHORT n = usMBASCIIEncode(frame, pdu, sizeof(pdu), '\n');
+    CHECK(n == sizeof(frame));
+    CHECK(memcmp(frame, ":0103006B00038E\r\n", n) == 0);
+}
+
+TEST_CASE("ascii frame is decoded and LRC verified", "[mbascii]")
+{
+    const char *chars = "0103006B00038E";
+    UCHAR pdu[16];
+    USHORT len = 0;
+    REQUIRE(xMBASCIIDecode(pdu, (const UCHAR *)chars, strlen(chars), &len));
+    CHECK(len == 6);
+    CHECK(pdu[3] == 0x6B);
+
+    CHECK(!xMBASCIIDecode(pdu, (const UCHAR *)"0103006B00038F", 14, &len));  // bad LRC
+    CHECK(!xMBASCIIDecode(pdu, (const UCHAR *)"0103006b00038E", 14, &len));  // lower case
+    CHECK(!xMBASCIIDecode(pdu, (const UCHAR *)"0103006B00038", 13, &len));   // odd count
+    CHECK(!xMBASCIIDecode(pdu, (const UCHAR *)"", 0, &len));
+}
+
+TEST_CASE("ascii codec round trip of all byte values", "[mbascii]")
+{
+    UCHAR pdu[256];
+    UCHAR out[256];
+    UCHAR frame[MB_ASCII_FRAME_SIZE(sizeof(pdu))];
+    for (int i = 0; i < 256; i++) {
+        pdu[i] = (UCHAR)i;
+    }
+    USHORT n = usMBASCIIEncode(frame, pdu, 255, '\n');
+    CHECK(frame[0] == ':');
+    CHECK(frame[n - 2] == '\r');
+    USHORT len = 0;
+    REQUIRE(xMBASCIIDecode(out, frame + 1, n - 3, &len));
+    CHECK(len == 255);
+    CHECK(memcmp(out, pdu, len) == 0);
+
+    legacy_send(pdu, 255);
+    CHECK(s_port_pos == n);
+    CHECK(memcmp(s_port_buf, frame, n) == 0);
+}
+
+TEST_CASE("ascii codec benchmark", "[mbascii][.][benchmark]")
+{
+    const int iterations = 20000;
+    UCHAR pdu[253];
+    UCHAR out[256];
+    UCHAR frame[MB_ASCII_FRAME_SIZE(sizeof(pdu))];
+    USHORT len = 0;
+    for (size_t i = 0; i < sizeof(pdu); i++) {
+        pdu[i] = (UCHAR)(i * 7);
+    }
+    USHORT n = usMBASCIIEncode(frame, pdu, sizeof(pdu), '\n');
+
+    auto t0 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        legacy_send(pdu, sizeof(pdu));
+        REQUIRE(legacy_receive(out, s_port_buf + 1, n - 3, &len));
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    for (int i = 0; i < iterations; i++) {
+        USHORT chars = usMBASCIIEncode(frame, pdu, sizeof(pdu), '\n');
+        port_put_buffer(frame, chars);
+        REQUIRE(xMBASCIIDecode(out, s_port_buf + 1, chars - 3, &len));
+    }
+    auto t2 = std::chrono::steady_clock::now();
+
+    double legacy_ns = std::chrono::duration<double, std::nano>(t1 - t0).count() / iterations;
+    double codec_ns = std::chrono::duration<double, std::nano>(t2 - t1).count() / iterations;
+    s_perf << "encode+decode of a " << sizeof(pdu) << " byte Ser-PDU" << std::endl;
+    s_perf << "  per character: " << legacy_ns << " ns/frame" << std::endl;
+    s_perf << "  frame codec:   " << codec_ns << " ns/frame" << std::endl;
+    std::cout << s_perf.str();
+}
@@ -18,6 +18,7 @@
 #include <sys/param.h>
 #include "esp_attr.h"
 #include "esp_heap_caps.h"
+#include "esp_heap_pool.h"
 #include "multi_heap.h"
 #include "esp_log.h"
 #include "heap_private.h"
@@ -399,6 +400,7 @@ void heap_caps_print_heap_info( uint32_t caps )
     heap_caps_get_info(&info, caps);
 
     printf("    free %d allocated %d min_free %d largest_free_block %d\n", info.total_free_bytes, info.total_allocated_bytes, info.minimum_free_bytes, info.largest_free_block);
+    heap_pool_print_info(caps);
 }
 
 bool heap_caps_check_integrity(uint32_t caps, bool print_errors)
@@ -0,0 +1,296 @@
+// Copyright 2015-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <stdbool.h>
+#include <string.h>
+#include <assert.h>
+#include <stdio.h>
+#include <sdkconfig.h>
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "esp_heap_pool.h"
+#include "freertos/FreeRTOS.h"
+#include "heap_private.h"
+
+/*
+Fixed size object pools, layered on heap_caps_malloc().
+
+Memory is taken from the heap in slabs of 'objects_per_slab' objects. Free objects are kept in two levels:
+
+- A magazine per CPU core: a small stack of free objects, only used by its core. Allocating from it or freeing to it
+  just needs interrupts disabled on the core, so that the running task isn't preempted by another one using the same
+  magazine. No lock is taken, and the other core is never waited for.
+
+- The depot: a list of free objects shared by both cores, linked through their first word and protected by the pool
+  spinlock. An empty magazine is refilled to half its size from the depot, a full one is emptied to half its size into
+  the depot. A core switching between allocations and frees of a few objects then works on its magazine only.
+
+Slabs are never returned to the heap before the pool is deleted, objects freed on a core may be reused on the other.
+*/
+
+#define DEFAULT_OBJECTS_PER_SLAB 16
+#define DEFAULT_MAGAZINE_SIZE 8
+
+typedef struct {
+    size_t count;
+    void *objs[HEAP_POOL_MAX_MAGAZINE_SIZE];
+} magazine_t;
+
+typedef struct slab_ {
+    struct slab_ *next;
+    /* objects follow */
+} slab_t;
+
+struct heap_pool {
+    const char *name;
+    size_t object_size;
+    uint32_t caps;
+    size_t objects_per_slab;
+    size_t magazine_size;
+    portMUX_TYPE mux;
+    void *free_list;       ///< depot, free objects not in a magazine
+    size_t free_count;
+    slab_t *slabs;
+    size_t slab_count;
+    magazine_t magazines[portNUM_PROCESSORS];
+    SLIST_ENTRY(heap_pool) next;
+};
+
+/* All pools, for heap_pool_print_info() */
+static SLIST_HEAD(pool_ll, heap_pool) pools = SLIST_HEAD_INITIALIZER(pools);
+static portMUX_TYPE pools_mux = portMUX_INITIALIZER_UNLOCKED;
+
+heap_pool_handle_t heap_pool_create(const heap_pool_config_t *config)
+{
+    if (config == NULL || config->object_size == 0 || config->magazine_size > HEAP_POOL_MAX_MAGAZINE_SIZE) {
+        return NULL;
+    }
+
+    heap_pool_handle_t pool = heap_caps_calloc(1, sizeof(struct heap_pool), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (pool == NULL) {
+        return NULL;
+    }
+    pool->name = config->name;
+    pool->object_size = (config->object_size + 3) & ~3;
+    pool->caps = config->caps;
+    pool->objects_per_slab = config->objects_per_slab ? config->objects_per_slab : DEFAULT_OBJECTS_PER_SLAB;
+    pool->magazine_size = config->magazine_size ? config->magazine_size : DEFAULT_MAGAZINE_SIZE;
+    vPortCPUInitializeMutex(&pool->mux);
+
+    portENTER_CRITICAL(&pools_mux);
+    SLIST_INSERT_HEAD(&pools, pool, next);
+    portEXIT_CRITICAL(&pools_mux);
+    return pool;
+}
+
+void heap_pool_delete(heap_pool_handle_t pool)
+{
+    if (pool == NULL) {
+        return;
+    }
+
+    portENTER_CRITICAL(&pools_mux);
+    SLIST_REMOVE(&pools, pool, heap_pool, next);
+    portEXIT_CRITICAL(&pools_mux);
+
+    while (pool->slabs != NULL) {
+        slab_t *slab = pool->slabs;
+        pool->slabs = slab->next;
+        heap_caps_free(slab);
+    }
+    heap_caps_free(pool);
+}
+
+static inline void *pop_free(heap_pool_handle_t pool)
+{
+    void *obj = pool->free_list;
+    pool->free_list = *(void **)obj;
+    pool->free_count--;
+    return obj;
+}
+
+static inline void push_free(heap_pool_handle_t pool, void *obj)
+{
+    *(void **)obj = pool->free_list;
+    pool->free_list = obj;
+    pool->free_count++;
+}
+
+/* Allocate a new slab and put its objects in the depot. Called without the pool lock. */
+static bool add_slab(heap_pool_handle_t pool)
+{
+    uint32_t caps = pool->caps ? pool->caps : MALLOC_CAP_DEFAULT;
+    slab_t *slab = heap_caps_malloc(sizeof(slab_t) + pool->object_size * pool->objects_per_slab, caps);
+    if (slab == NULL) {
+        return false;
+    }
+
+    portENTER_CRITICAL(&pool->mux);
+    slab->next = pool->slabs;
+    pool->slabs = slab;
+    pool->slab_count++;
+    uint8_t *obj = (uint8_t *)(slab + 1);
+    for (size_t i = 0; i < pool->objects_per_slab; i++, obj += pool->object_size) {
+        push_free(pool, obj);
+    }
+    portEXIT_CRITICAL(&pool->mux);
+    return true;
+}
+
+/* The magazine of the core is empty: take an object from the depot and refill the magazine to half its size */
+static IRAM_ATTR void *alloc_from_depot(heap_pool_handle_t pool)
+{
+    void *obj = NULL;
+
+    while (obj == NULL) {
+        portENTER_CRITICAL(&pool->mux);
+        if (pool->free_list != NULL) {
+            magazine_t *mag = &pool->magazines[xPortGetCoreID()];
+            obj = pop_free(pool);
+            while (mag->count < pool->magazine_size / 2 && pool->free_list != NULL) {
+                mag->objs[mag->count++] = pop_free(pool);
+            }
+        }
+        portEXIT_CRITICAL(&pool->mux);
+
+        if (obj == NULL && !add_slab(pool)) {
+            return NULL;
+        }
+    }
+    return obj;
+}
+
+/* The magazine of the core is full: empty it to half its size and put 'obj' in the depot */
+static IRAM_ATTR void free_to_depot(heap_pool_handle_t pool, void *obj)
+{
+    portENTER_CRITICAL(&pool->mux);
+    magazine_t *mag = &pool->magazines[xPortGetCoreID()];
+    while (mag->count > pool->magazine_size / 2) {
+        push_free(pool, mag->objs[--mag->count]);
+    }
+    push_free(pool, obj);
+    portEXIT_CRITICAL(&pool->mux);
+}
+
+IRAM_ATTR void *heap_pool_alloc(heap_pool_handle_t pool)
+{
+    void *obj = NULL;
+
+    unsigned state = portENTER_CRITICAL_NESTED();
+    magazine_t *mag = &pool->magazines[xPortGetCoreID()];
+    if (mag->count > 0) {
+        obj = mag->objs[--mag->count];
+    }
+    portEXIT_CRITICAL_NESTED(state);
+
+    if (obj == NULL) {
+        obj = alloc_from_depot(pool);
+    }
+#ifdef CONFIG_HEAP_TRACING
+    if (obj != NULL) {
+        heap_trace_record_pool_alloc(obj, pool->object_size);
+    }
+#endif
+    return obj;
+}
+
+IRAM_ATTR void heap_pool_free(heap_pool_handle_t pool, void *obj)
+{
+    bool cached = false;
+
+    if (obj == NULL) {
+        return;
+    }
+#ifdef CONFIG_HEAP_TRACING
+    heap_trace_record_pool_free(obj);
+#endif
+
+    unsigned state = portENTER_CRITICAL_NESTED();
+    magazine_t *mag = &pool->magazines[xPortGetCoreID()];
+    if (mag->count < pool->magazine_size) {
+        mag->objs[mag->count++] = obj;
+        cached = true;
+    }
+    portEXIT_CRITICAL_NESTED(state);
+
+    if (!cached) {
+        free_to_depot(pool, obj);
+    }
+}
+
+void heap_pool_get_info(heap_pool_handle_t pool, heap_pool_info_t *info)
+{
+    bzero(info, sizeof(heap_pool_info_t));
+
+    portENTER_CRITICAL(&pool->mux);
+    info->object_size = pool->object_size;
+    info->slabs = pool->slab_count;
+    info->slab_bytes = pool->slab_count * (sizeof(slab_t) + pool->object_size * pool->objects_per_slab);
+    info->total_objects = pool->slab_count * pool->objects_per_slab;
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        info->cached_objects += pool->magazines[i].count;
+    }
+    info->allocated_objects = info->total_objects - pool->free_count - info->cached_objects;
+    portEXIT_CRITICAL(&pool->mux);
+}
+
+/* Return true if the slabs of the pool are in a heap with the given capabilities. Called with pools_mux held. */
+static bool pool_matches_caps(heap_pool_handle_t pool, uint32_t caps)
+{
+    intptr_t slab = (intptr_t)pool->slabs;
+    heap_t *heap;
+
+    if (slab == 0) {
+        return false;
+    }
+    SLIST_FOREACH(heap, &registered_heaps, next) {
+        if (heap->heap != NULL && slab >= heap->start && slab < heap->end) {
+            return heap_caps_match(heap, caps);
+        }
+    }
+    return false;
+}
+
+void heap_pool_print_info(uint32_t caps)
+{
+    /* Look the pools up one at a time, so printing isn't done with the lock held */
+    for (int index = 0; ; index++) {
+        const char *name = NULL;
+        bool found = false;
+        heap_pool_info_t info;
+        heap_pool_handle_t pool;
+        int i = 0;
+
+        portENTER_CRITICAL(&pools_mux);
+        SLIST_FOREACH(pool, &pools, next) {
+            if (i++ == index) {
+                found = true;
+                if (pool_matches_caps(pool, caps)) {
+                    name = pool->name ? pool->name : "(unnamed)";
+                    heap_pool_get_info(pool, &info);
+                }
+                break;
+            }
+        }
+        portEXIT_CRITICAL(&pools_mux);
+
+        if (!found) {
+            break;
+        }
+        if (name != NULL) {
+            printf("  Pool %s object size %d slabs %d (%d bytes) objects %d allocated %d cached %d\n",
+                   name, info.object_size, info.slabs, info.slab_bytes, info.total_objects,
+                   info.allocated_objects, info.cached_objects);
+        }
+    }
+}
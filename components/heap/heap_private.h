@@ -69,6 +69,12 @@ inline static IRAM_ATTR uint32_t get_all_caps(const heap_t *heap)
 void *heap_caps_realloc_default(void *p, size_t size);
 void *heap_caps_malloc_default(size_t size);
 
+#ifdef CONFIG_HEAP_TRACING
+/* Record allocations from heap_pool, see heap_trace.c */
+void heap_trace_record_pool_alloc(void *p, size_t size);
+void heap_trace_record_pool_free(void *p);
+#endif
+
 
 #ifdef __cplusplus
 }
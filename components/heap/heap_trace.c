@@ -351,6 +351,30 @@ static IRAM_ATTR __attribute__((noinline)) void trace_free(void *p)
     __real_heap_caps_free(p);
 }
 
+/* Objects of heap_pool are carved from slabs allocated with heap_caps_malloc(), record them as allocations of their own.
+   Called directly from heap_pool_alloc()/heap_pool_free(), so the call stack depth is the same as for trace_malloc(). */
+IRAM_ATTR __attribute__((noinline)) void heap_trace_record_pool_alloc(void *p, size_t size)
+{
+    if (tracing) {
+        heap_trace_record_t rec = {
+            .address = p,
+            .ccount = get_ccount(),
+            .size = size,
+        };
+        get_call_stack(rec.alloced_by);
+        record_allocation(&rec);
+    }
+}
+
+IRAM_ATTR __attribute__((noinline)) void heap_trace_record_pool_free(void *p)
+{
+    if (tracing) {
+        void *callers[STACK_DEPTH];
+        get_call_stack(callers);
+        record_free(p, callers);
+    }
+}
+
 void * __real_heap_caps_realloc(void *p, size_t size, uint32_t caps);
 
 /* trace any 'realloc' event */
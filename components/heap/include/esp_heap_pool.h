@@ -0,0 +1,124 @@
+// Copyright 2015-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Maximum number of free objects cached per CPU core by a pool
+ */
+#define HEAP_POOL_MAX_MAGAZINE_SIZE 32
+
+/**
+ * @brief Opaque handle to an object pool
+ */
+typedef struct heap_pool *heap_pool_handle_t;
+
+/**
+ * @brief Configuration of an object pool, passed to heap_pool_create()
+ */
+typedef struct {
+    const char *name;           ///< Name of the pool, shown by heap_caps_print_heap_info(). Not copied, may be NULL.
+    size_t object_size;         ///< Size of the objects, rounded up to a multiple of 4 bytes
+    uint32_t caps;              ///< Capabilities of the memory to allocate slabs from, 0 for the same memory as malloc()
+    size_t objects_per_slab;    ///< Number of objects allocated together from the heap when the pool is empty, 0 for 16
+    size_t magazine_size;       ///< Number of free objects cached per CPU core, 0 for 8, at most HEAP_POOL_MAX_MAGAZINE_SIZE
+} heap_pool_config_t;
+
+/**
+ * @brief Statistics of an object pool, see heap_pool_get_info()
+ */
+typedef struct {
+    size_t object_size;         ///< Size of the objects, after rounding up
+    size_t slabs;               ///< Number of slabs allocated from the heap
+    size_t slab_bytes;          ///< Total size of the slabs, in bytes
+    size_t total_objects;       ///< Number of objects in all slabs
+    size_t allocated_objects;   ///< Number of objects currently allocated from the pool
+    size_t cached_objects;      ///< Number of free objects cached by CPU cores
+} heap_pool_info_t;
+
+/**
+ * @brief Create a pool of objects of a single size
+ *
+ * A pool allocates memory from the heap in slabs of several objects, with heap_caps_malloc(), and never returns it to
+ * the heap until the pool is deleted. Objects freed to the pool are kept for the next allocations, first in a small
+ * cache ("magazine") of the CPU core, then in a free list shared by both cores.
+ *
+ * heap_pool_alloc() and heap_pool_free() only disable interrupts on the current core while they use its magazine,
+ * they take the pool lock only when the magazine is empty or full. This is faster than heap_caps_malloc() and
+ * heap_caps_free() for objects which are allocated and freed frequently, and doesn't fragment the heap.
+ *
+ * @param config Configuration of the pool
+ *
+ * @return Handle of the new pool, or NULL if the configuration is invalid or there is not enough memory
+ */
+heap_pool_handle_t heap_pool_create(const heap_pool_config_t *config);
+
+/**
+ * @brief Delete a pool and free its slabs
+ *
+ * All objects allocated from the pool must have been freed, and the pool must not be used by other tasks anymore.
+ *
+ * @param pool Pool to delete, can be NULL
+ */
+void heap_pool_delete(heap_pool_handle_t pool);
+
+/**
+ * @brief Allocate an object from a pool
+ *
+ * The content of the object is undefined. This function can be called from an ISR only if the magazine of the core
+ * is not empty, which can't be known in advance, so it shouldn't be.
+ *
+ * @param pool Pool to allocate from
+ *
+ * @return Pointer to the object, or NULL if the pool is empty and no slab can be allocated from the heap
+ */
+void *heap_pool_alloc(heap_pool_handle_t pool);
+
+/**
+ * @brief Free an object allocated from a pool
+ *
+ * @param pool Pool the object was allocated from
+ * @param obj Object to free, can be NULL
+ */
+void heap_pool_free(heap_pool_handle_t pool, void *obj);
+
+/**
+ * @brief Get statistics of a pool
+ *
+ * Counts are a snapshot, they can be slightly off if the pool is used by the other core at the same time.
+ *
+ * @param pool Pool to get statistics of
+ * @param info Pointer to a structure to be filled with the statistics
+ */
+void heap_pool_get_info(heap_pool_handle_t pool, heap_pool_info_t *info);
+
+/**
+ * @brief Print a summary of the pools using memory with the given capabilities
+ *
+ * Called by heap_caps_print_heap_info(). The slabs of a pool are counted as allocated memory by
+ * heap_caps_get_info(), this shows how much of it is actually in use.
+ *
+ * @param caps Bitwise OR of MALLOC_CAP_* flags, pools with slabs in matching memory are printed
+ */
+void heap_pool_print_info(uint32_t caps);
+
+#ifdef __cplusplus
+}
+#endif
@@ -28,6 +28,8 @@
 /* Defines compile-time configuration macros */
 #include "multi_heap_config.h"
 
+#ifndef MULTI_HEAP_TLSF /* see multi_heap_tlsf.c */
+
 #ifndef MULTI_HEAP_POISONING
 /* if no heap poisoning, public API aliases directly to these implementations */
 void *multi_heap_malloc(multi_heap_handle_t heap, size_t size)
@@ -743,3 +745,5 @@ void multi_heap_get_info_impl(multi_heap_handle_t heap, multi_heap_info_t *info)
     multi_heap_internal_unlock(heap);
 
 }
+
+#endif // MULTI_HEAP_TLSF
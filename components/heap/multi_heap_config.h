@@ -19,6 +19,10 @@
 
 /* Configuration macros for multi-heap */
 
+#ifdef CONFIG_HEAP_ALLOCATOR_TLSF
+#define MULTI_HEAP_TLSF
+#endif
+
 #ifdef CONFIG_HEAP_POISONING_LIGHT
 #define MULTI_HEAP_POISONING
 #endif
@@ -0,0 +1,895 @@
+// Copyright 2015-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#include <stdint.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <assert.h>
+#include <string.h>
+#include <stddef.h>
+#include <stdio.h>
+#include <multi_heap.h>
+#include "multi_heap_internal.h"
+
+/* Note: Keep platform-specific parts in this header, this source
+   file should depend on libc only */
+#include "multi_heap_platform.h"
+
+/* Defines compile-time configuration macros */
+#include "multi_heap_config.h"
+
+#ifdef MULTI_HEAP_TLSF
+
+/* Two-level segregated fit (TLSF) implementation of the multi_heap "impl" API.
+
+   This is an alternative to the address ordered free list of multi_heap.c, selected with
+   CONFIG_HEAP_ALLOCATOR_TLSF. Blocks have the same layout in the heap (one word of header per
+   block, pointing to the next block), so the block walking functions and heap poisoning work
+   the same way. Only the handling of free blocks differs:
+
+   - Free blocks are kept in doubly linked lists, one per size class. Size classes are split
+     logarithmically (first level, power of two) then linearly (second level,
+     SL_INDEX_COUNT subdivisions). Bitmaps of non-empty lists allow finding a suitable free
+     block with a couple of bit scans, whatever the number of free blocks.
+
+   - The last word of a free block (its "footer") points back to the start of the block, and
+     the following block has PREV_FREE_FLAG set in its header. Freeing a block finds the
+     previous block to merge with from there, instead of walking the heap.
+
+   malloc, free and realloc take a bounded time, independent of fragmentation.
+*/
+
+#ifndef MULTI_HEAP_POISONING
+/* if no heap poisoning, public API aliases directly to these implementations */
+void *multi_heap_malloc(multi_heap_handle_t heap, size_t size)
+    __attribute__((alias("multi_heap_malloc_impl")));
+
+void multi_heap_free(multi_heap_handle_t heap, void *p)
+    __attribute__((alias("multi_heap_free_impl")));
+
+void *multi_heap_realloc(multi_heap_handle_t heap, void *p, size_t size)
+    __attribute__((alias("multi_heap_realloc_impl")));
+
+size_t multi_heap_get_allocated_size(multi_heap_handle_t heap, void *p)
+    __attribute__((alias("multi_heap_get_allocated_size_impl")));
+
+multi_heap_handle_t multi_heap_register(void *start, size_t size)
+    __attribute__((alias("multi_heap_register_impl")));
+
+void multi_heap_get_info(multi_heap_handle_t heap, multi_heap_info_t *info)
+    __attribute__((alias("multi_heap_get_info_impl")));
+
+size_t multi_heap_free_size(multi_heap_handle_t heap)
+    __attribute__((alias("multi_heap_free_size_impl")));
+
+size_t multi_heap_minimum_free_size(multi_heap_handle_t heap)
+    __attribute__((alias("multi_heap_minimum_free_size_impl")));
+
+void *multi_heap_get_block_address(multi_heap_block_handle_t block)
+    __attribute__((alias("multi_heap_get_block_address_impl")));
+
+void *multi_heap_get_block_owner(multi_heap_block_handle_t block)
+{
+    return NULL;
+}
+
+#endif
+
+#define ALIGN(X) ((X) & ~(sizeof(void *)-1))
+#define ALIGN_UP(X) ALIGN((X)+sizeof(void *)-1)
+
+#if UINTPTR_MAX > 0xFFFFFFFF
+#define ALIGN_SIZE_LOG2 3
+#else
+#define ALIGN_SIZE_LOG2 2
+#endif
+
+/* Number of second level lists per first level (power of two) is 1 << SL_INDEX_COUNT_LOG2.
+   Each list of a first level then covers 1/8th of its power of two range.
+*/
+#define SL_INDEX_COUNT_LOG2 3
+#define SL_INDEX_COUNT (1 << SL_INDEX_COUNT_LOG2)
+
+/* Blocks smaller than SMALL_BLOCK_SIZE all go to first level 0, in lists of exactly one size each */
+#define FL_INDEX_SHIFT (SL_INDEX_COUNT_LOG2 + ALIGN_SIZE_LOG2)
+#define SMALL_BLOCK_SIZE (1 << FL_INDEX_SHIFT)
+
+struct heap_block;
+
+/* Block in the heap
+
+   'header' holds a pointer to the next block (used or free) ORed with a free flag (the LSB of the pointer) and a flag
+   telling if the previous block is free (bit 1).
+
+   'next_free' and 'prev_free' are valid if the block is free, they link the blocks of the same size class.
+
+   A free block also holds a pointer to itself in its last word (the footer, see get_prev_free_block()).
+*/
+typedef struct heap_block {
+    intptr_t header;                      /* Encodes next block in heap (used or unused) and the flags */
+    union {
+        uint8_t data[1];                  /* First byte of data, valid if block is used. Actual size of data is 'block_data_size(block)' */
+        struct {
+            struct heap_block *next_free; /* Next free block of the same size class, valid if block is free */
+            struct heap_block *prev_free; /* Previous free block of the same size class, valid if block is free */
+        };
+    };
+} heap_block_t;
+
+/* These masks apply to the 'header' field of heap_block_t */
+#define BLOCK_FREE_FLAG 0x1  /* If set, this block is free & next_free/prev_free pointers are valid */
+#define PREV_FREE_FLAG 0x2   /* If set, the previous block is free & the word before this block points to it */
+#define NEXT_BLOCK_MASK (~3) /* AND header with this mask to get pointer to next block (free or used) */
+
+/* Smallest data size of a block: a free block holds its list pointers and its footer */
+#define MIN_BLOCK_DATA_SIZE (sizeof(heap_block_t) - sizeof(intptr_t) + sizeof(heap_block_t *))
+
+/* Metadata header for the heap, stored at the beginning of heap space.
+
+   'first_block' is a "fake" first block, minimum length, used to provide a pointer to the first used & free block in
+   the heap. This block is never allocated or merged into an adjacent block.
+
+   'last_block' is a pointer to a final free block of length 0, which is added at the end of the heap when it is
+   registered. This block is also never allocated or merged into an adjacent block.
+
+   'free_lists' (fl_count * SL_INDEX_COUNT heads) and 'sl_bitmap' (fl_count bytes) are stored after 'last_block', at
+   the end of heap space, as their size depends on the size of the heap.
+ */
+typedef struct multi_heap_info {
+    void *lock;
+    size_t free_bytes;
+    size_t minimum_free_bytes;
+    heap_block_t *last_block;
+    uint32_t fl_bitmap;               /* bit n is set if sl_bitmap[n] isn't 0 */
+    uint32_t fl_count;                /* number of first levels, enough for the largest possible block */
+    uint8_t *sl_bitmap;               /* bit n of sl_bitmap[fl] is set if the list (fl, n) isn't empty */
+    heap_block_t **free_lists;
+    heap_block_t first_block; /* initial 'free block', never allocated */
+} heap_t;
+
+/* Given a pointer to the 'data' field of a block (ie the previous malloc/realloc result), return a pointer to the
+   containing block.
+*/
+static inline heap_block_t *get_block(const void *data_ptr)
+{
+    return (heap_block_t *)((char *)data_ptr - offsetof(heap_block_t, data));
+}
+
+/* Return the next sequential block in the heap.
+ */
+static inline heap_block_t *get_next_block(const heap_block_t *block)
+{
+    intptr_t next = block->header & NEXT_BLOCK_MASK;
+    if (next == 0) {
+        return NULL; /* last_block */
+    }
+    assert(next > (intptr_t)block);
+    return (heap_block_t *)next;
+}
+
+/* Return true if this block is free. */
+static inline bool is_free(const heap_block_t *block)
+{
+    return block->header & BLOCK_FREE_FLAG;
+}
+
+/* Return true if this block is the first in the heap */
+static inline bool is_first_block(const heap_t *heap, const heap_block_t *block)
+{
+    return (block == &heap->first_block);
+}
+
+/* Return true if this block is the last_block in the heap
+   (the only block with no next pointer) */
+static inline bool is_last_block(const heap_block_t *block)
+{
+    return (block->header & NEXT_BLOCK_MASK) == 0;
+}
+
+/* Data size of the block (excludes this block's header) */
+static inline size_t block_data_size(const heap_block_t *block)
+{
+    intptr_t next = (intptr_t)block->header & NEXT_BLOCK_MASK;
+    intptr_t this = (intptr_t)block;
+    if (next == 0) {
+        return 0; /* this is the last block in the heap */
+    }
+    return next - this - sizeof(block->header);
+}
+
+/* Set the next block pointer of the header, keeping the flags */
+static inline void set_next_block(heap_block_t *block, heap_block_t *next)
+{
+    block->header = (intptr_t)next | (block->header & ~NEXT_BLOCK_MASK);
+}
+
+/* Location of the footer of a free block, ie the last word before the next block */
+static inline heap_block_t **get_footer(const heap_block_t *block)
+{
+    return (heap_block_t **)get_next_block(block) - 1;
+}
+
+/* Write the footer of a free block, and flag it in the header of the next block */
+static inline void set_footer(heap_block_t *block)
+{
+    *get_footer(block) = block;
+    get_next_block(block)->header |= PREV_FREE_FLAG;
+}
+
+/* Return the free block just before 'block' in the heap, or NULL if the previous block is in use.
+   (The first block of the heap never has PREV_FREE_FLAG set.)
+*/
+static inline heap_block_t *get_prev_free_block(const heap_block_t *block)
+{
+    if (!(block->header & PREV_FREE_FLAG)) {
+        return NULL;
+    }
+    heap_block_t *prev = ((heap_block_t **)block)[-1];
+    MULTI_HEAP_ASSERT(prev < block && get_next_block(prev) == block && is_free(prev), &((heap_block_t **)block)[-1]); // footer should point to the previous block
+    return prev;
+}
+
+/* Check a block is valid for this heap. Used to verify parameters. */
+static void assert_valid_block(const heap_t *heap, const heap_block_t *block)
+{
+    MULTI_HEAP_ASSERT(block >= &heap->first_block && block <= heap->last_block,
+                      block); // block not in heap
+    if (heap < (const heap_t *)heap->last_block) {
+        const heap_block_t *next = get_next_block(block);
+        MULTI_HEAP_ASSERT(next >= &heap->first_block && next <= heap->last_block, block); // Next block not in heap
+        if (is_free(block)) {
+            // Check block->next_free is valid
+            MULTI_HEAP_ASSERT(block->next_free == NULL || (block->next_free >= &heap->first_block && block->next_free <= heap->last_block), &block->next_free);
+        }
+    }
+}
+
+/* Index of the most significant bit set, 'x' can't be 0 */
+static inline int fls_size(size_t x)
+{
+    return (int)(sizeof(unsigned long) * 8) - 1 - __builtin_clzl(x);
+}
+
+/* Get the size class (first level, second level) of a block data size */
+static inline void mapping(size_t size, int *fl, int *sl)
+{
+    if (size < SMALL_BLOCK_SIZE) {
+        *fl = 0;
+        *sl = (int)(size >> ALIGN_SIZE_LOG2);
+    } else {
+        int t = fls_size(size);
+        *sl = (int)(size >> (t - SL_INDEX_COUNT_LOG2)) ^ SL_INDEX_COUNT;
+        *fl = t - FL_INDEX_SHIFT + 1;
+    }
+}
+
+static void insert_free_block(heap_t *heap, heap_block_t *block)
+{
+    int fl, sl;
+    mapping(block_data_size(block), &fl, &sl);
+    heap_block_t **head = &heap->free_lists[fl * SL_INDEX_COUNT + sl];
+
+    block->prev_free = NULL;
+    block->next_free = *head;
+    if (*head != NULL) {
+        (*head)->prev_free = block;
+    }
+    *head = block;
+    heap->fl_bitmap |= 1UL << fl;
+    heap->sl_bitmap[fl] |= 1 << sl;
+}
+
+/* Take a free block out of its list. Must be called before the size of the block changes. */
+static void remove_free_block(heap_t *heap, heap_block_t *block)
+{
+    int fl, sl;
+    mapping(block_data_size(block), &fl, &sl);
+    heap_block_t **head = &heap->free_lists[fl * SL_INDEX_COUNT + sl];
+
+    MULTI_HEAP_ASSERT(is_free(block), block); // block should be free
+    if (block->next_free != NULL) {
+        MULTI_HEAP_ASSERT(block->next_free->prev_free == block, &block->next_free->prev_free); // list should be consistent
+        block->next_free->prev_free = block->prev_free;
+    }
+    if (block->prev_free != NULL) {
+        MULTI_HEAP_ASSERT(block->prev_free->next_free == block, &block->prev_free->next_free); // list should be consistent
+        block->prev_free->next_free = block->next_free;
+    } else {
+        MULTI_HEAP_ASSERT(*head == block, head); // first block of the list should be the list head
+        *head = block->next_free;
+        if (*head == NULL) {
+            heap->sl_bitmap[fl] &= ~(1 << sl);
+            if (heap->sl_bitmap[fl] == 0) {
+                heap->fl_bitmap &= ~(1UL << fl);
+            }
+        }
+    }
+}
+
+/* Find a free block of at least 'size' bytes, or NULL.
+
+   The first block of the list of 'size' is taken if it is large enough. Otherwise any block of the following size
+   classes is large enough, the first one of the smallest non empty class is taken.
+*/
+static heap_block_t *find_free_block(heap_t *heap, size_t size)
+{
+    int fl, sl;
+    mapping(size, &fl, &sl);
+
+    if (fl >= heap->fl_count) {
+        return NULL;
+    }
+    heap_block_t *block = heap->free_lists[fl * SL_INDEX_COUNT + sl];
+    if (block != NULL && block_data_size(block) >= size) {
+        return block;
+    }
+
+    if (++sl == SL_INDEX_COUNT) {
+        sl = 0;
+        if (++fl == heap->fl_count) {
+            return NULL;
+        }
+    }
+    uint32_t sl_map = heap->sl_bitmap[fl] & (~0U << sl);
+    if (sl_map == 0) {
+        uint32_t fl_map = heap->fl_bitmap & (~0UL << (fl + 1));
+        if (fl_map == 0) {
+            return NULL;
+        }
+        fl = __builtin_ctz(fl_map);
+        sl_map = heap->sl_bitmap[fl];
+    }
+    sl = __builtin_ctz(sl_map);
+    return heap->free_lists[fl * SL_INDEX_COUNT + sl];
+}
+
+/* Mark a free block (already out of its list) in use */
+static inline void mark_used(heap_block_t *block)
+{
+    heap_block_t *next = get_next_block(block);
+    block->header &= ~BLOCK_FREE_FLAG;
+    next->header &= ~PREV_FREE_FLAG;
+#ifdef MULTI_HEAP_POISONING_SLOW
+    /* the footer is now part of the block's data */
+    multi_heap_internal_poison_fill_region(get_footer(block), sizeof(heap_block_t *), true);
+#endif
+}
+
+/* Merge free block 'b' into the free block 'a' just before it. Neither block should be in a free list.
+ */
+static heap_block_t *merge_free(heap_t *heap, heap_block_t *a, heap_block_t *b)
+{
+    MULTI_HEAP_ASSERT(get_next_block(a) == b, a); // Blocks should be in order
+    assert(is_free(a) && is_free(b) && !is_last_block(b));
+
+    set_next_block(a, get_next_block(b));
+    /* b's header can be put into the pool of free bytes */
+    heap->free_bytes += sizeof(a->header);
+
+#ifdef MULTI_HEAP_POISONING_SLOW
+    /* a's former footer and b's former block header need to be replaced with a fill pattern */
+    multi_heap_internal_poison_fill_region((heap_block_t **)b - 1, sizeof(heap_block_t *), true);
+    multi_heap_internal_poison_fill_region(b, sizeof(heap_block_t), true);
+#endif
+
+    return a;
+}
+
+/* Split a block so it can hold at least 'size' bytes of data, making any spare
+   space into a new free block (or adding it to the following free block).
+
+   'block' should be marked in-use when this function is called.
+*/
+static void split_if_necessary(heap_t *heap, heap_block_t *block, size_t size)
+{
+    const size_t block_size = block_data_size(block);
+    MULTI_HEAP_ASSERT(!is_free(block), block); // split block shouldn't be free
+    MULTI_HEAP_ASSERT(size <= block_size, block); // size should be valid
+
+    /* can't split the head or tail block */
+    assert(!is_first_block(heap, block));
+    assert(!is_last_block(block));
+
+    heap_block_t *new_block = (heap_block_t *)(block->data + size);
+    heap_block_t *next_block = get_next_block(block);
+
+    if (is_free(next_block) && !is_last_block(next_block)) {
+        /* The next block is free, just extend it downwards. */
+        if (block_size == size) {
+            return;
+        }
+        remove_free_block(heap, next_block);
+        intptr_t next_header = next_block->header;
+#ifdef MULTI_HEAP_POISONING_SLOW
+        /* next_block header needs to be replaced with a fill pattern */
+        multi_heap_internal_poison_fill_region(next_block, sizeof(heap_block_t), true /* free */);
+#endif
+        new_block->header = next_header;
+        heap->free_bytes += block_size - size;
+    } else {
+        /* Insert a free block between the current and the next one. */
+        if (block_size < size + sizeof(new_block->header) + MIN_BLOCK_DATA_SIZE) {
+            /* Can't split 'block' if we're not going to get a usable free block afterwards */
+            return;
+        }
+        new_block->header = (intptr_t)next_block | BLOCK_FREE_FLAG;
+        heap->free_bytes += block_data_size(new_block);
+    }
+    set_next_block(block, new_block);
+    insert_free_block(heap, new_block);
+    set_footer(new_block);
+}
+
+void *multi_heap_get_block_address_impl(multi_heap_block_handle_t block)
+{
+    return ((char *)block + offsetof(heap_block_t, data));
+}
+
+size_t multi_heap_get_allocated_size_impl(multi_heap_handle_t heap, void *p)
+{
+    heap_block_t *pb = get_block(p);
+
+    assert_valid_block(heap, pb);
+    MULTI_HEAP_ASSERT(!is_free(pb), pb); // block shouldn't be free
+    return block_data_size(pb);
+}
+
+multi_heap_handle_t multi_heap_register_impl(void *start, size_t size)
+{
+    heap_t *heap = (heap_t *)ALIGN_UP((intptr_t)start);
+    uintptr_t end = ALIGN((uintptr_t)start + size);
+    int fl, sl;
+
+    if (end < (uintptr_t)(heap + 1)) {
+        return NULL;
+    }
+    /* The free lists must be able to hold a block as large as the whole heap */
+    mapping(end - (uintptr_t)heap, &fl, &sl);
+    size_t fl_count = fl + 1;
+    size_t lists_size = ALIGN_UP(fl_count * SL_INDEX_COUNT * sizeof(heap_block_t *) + fl_count);
+
+    if (end - (uintptr_t)(heap + 1) < lists_size + sizeof(intptr_t) + MIN_BLOCK_DATA_SIZE + sizeof(heap_block_t)) {
+        return NULL; /* 'size' is too small to fit a heap here */
+    }
+    end -= lists_size;
+    heap->free_lists = (heap_block_t **)end;
+    heap->sl_bitmap = (uint8_t *)(heap->free_lists + fl_count * SL_INDEX_COUNT);
+    memset(heap->free_lists, 0, lists_size);
+    heap->fl_bitmap = 0;
+    heap->fl_count = fl_count;
+
+    heap->lock = NULL;
+    heap->last_block = (heap_block_t *)(end - sizeof(heap_block_t));
+
+    /* first 'real' (allocatable) free block goes after the heap structure */
+    heap_block_t *first_free_block = (heap_block_t *)(heap + 1);
+    first_free_block->header = (intptr_t)heap->last_block | BLOCK_FREE_FLAG;
+
+    /* last block is 'free' but has a NULL next pointer */
+    heap->last_block->header = BLOCK_FREE_FLAG;
+    heap->last_block->next_free = NULL;
+    heap->last_block->prev_free = NULL;
+
+    /* first block also 'free' but has legitimate length,
+       malloc will never allocate into this block. */
+    heap->first_block.header = (intptr_t)first_free_block | BLOCK_FREE_FLAG;
+    heap->first_block.next_free = NULL;
+    heap->first_block.prev_free = NULL;
+
+    heap->free_bytes = block_data_size(first_free_block);
+    heap->minimum_free_bytes = heap->free_bytes;
+    insert_free_block(heap, first_free_block);
+    set_footer(first_free_block);
+
+    return heap;
+}
+
+void multi_heap_set_lock(multi_heap_handle_t heap, void *lock)
+{
+    heap->lock = lock;
+}
+
+void inline multi_heap_internal_lock(multi_heap_handle_t heap)
+{
+    MULTI_HEAP_LOCK(heap->lock);
+}
+
+void inline multi_heap_internal_unlock(multi_heap_handle_t heap)
+{
+    MULTI_HEAP_UNLOCK(heap->lock);
+}
+
+multi_heap_block_handle_t multi_heap_get_first_block(multi_heap_handle_t heap)
+{
+    return &heap->first_block;
+}
+
+multi_heap_block_handle_t multi_heap_get_next_block(multi_heap_handle_t heap, multi_heap_block_handle_t block)
+{
+    heap_block_t *next = get_next_block(block);
+    /* check for valid free last block to avoid assert in assert_valid_block */
+    if (next == heap->last_block && is_last_block(next) && is_free(next)) {
+        return NULL;
+    }
+    assert_valid_block(heap, next);
+    return next;
+}
+
+bool multi_heap_is_free(multi_heap_block_handle_t block)
+{
+    return is_free(block);
+}
+
+void *multi_heap_malloc_impl(multi_heap_handle_t heap, size_t size)
+{
+    size = ALIGN_UP(size);
+
+    if (size == 0 || heap == NULL) {
+        return NULL;
+    }
+    if (size < MIN_BLOCK_DATA_SIZE) {
+        size = MIN_BLOCK_DATA_SIZE;
+    }
+
+    multi_heap_internal_lock(heap);
+
+    if (heap->free_bytes < size) {
+        multi_heap_internal_unlock(heap);
+        return NULL;
+    }
+
+    heap_block_t *block = find_free_block(heap, size);
+    if (block == NULL) {
+        multi_heap_internal_unlock(heap);
+        return NULL; /* No room in heap */
+    }
+
+    remove_free_block(heap, block);
+    mark_used(block);
+    heap->free_bytes -= block_data_size(block);
+
+    split_if_necessary(heap, block, size);
+
+    if (heap->free_bytes < heap->minimum_free_bytes) {
+        heap->minimum_free_bytes = heap->free_bytes;
+    }
+
+    multi_heap_internal_unlock(heap);
+
+    return block->data;
+}
+
+void multi_heap_free_impl(multi_heap_handle_t heap, void *p)
+{
+    heap_block_t *pb = get_block(p);
+
+    if (heap == NULL || p == NULL) {
+        return;
+    }
+
+    multi_heap_internal_lock(heap);
+
+    assert_valid_block(heap, pb);
+    MULTI_HEAP_ASSERT(!is_free(pb), pb); // block should not be free
+    MULTI_HEAP_ASSERT(!is_last_block(pb), pb); // block should not be last block
+    MULTI_HEAP_ASSERT(!is_first_block(heap, pb), pb); // block should not be first block
+
+    heap_block_t *next = get_next_block(pb);
+    heap_block_t *prev = get_prev_free_block(pb);
+
+    /* Mark this block as free */
+    pb->header |= BLOCK_FREE_FLAG;
+    heap->free_bytes += block_data_size(pb);
+
+    /* Merge into the previous block if it is free */
+    if (prev != NULL) {
+        remove_free_block(heap, prev);
+        pb = merge_free(heap, prev, pb);
+    }
+
+    /* If next block is free, merge the two */
+    if (is_free(next) && !is_last_block(next)) {
+        remove_free_block(heap, next);
+        pb = merge_free(heap, pb, next);
+    }
+
+    insert_free_block(heap, pb);
+    set_footer(pb);
+
+    multi_heap_internal_unlock(heap);
+}
+
+void *multi_heap_realloc_impl(multi_heap_handle_t heap, void *p, size_t size)
+{
+    heap_block_t *pb = get_block(p);
+    void *result;
+    size = ALIGN_UP(size);
+
+    assert(heap != NULL);
+
+    if (p == NULL) {
+        return multi_heap_malloc_impl(heap, size);
+    }
+
+    assert_valid_block(heap, pb);
+    // non-null realloc arg should be allocated
+    MULTI_HEAP_ASSERT(!is_free(pb), pb);
+
+    if (size == 0) {
+        /* note: calling multi_free_impl() here as we've already been
+           through any poison-unwrapping */
+        multi_heap_free_impl(heap, p);
+        return NULL;
+    }
+
+    if (heap == NULL) {
+        return NULL;
+    }
+    if (size < MIN_BLOCK_DATA_SIZE) {
+        size = MIN_BLOCK_DATA_SIZE;
+    }
+
+    multi_heap_internal_lock(heap);
+    result = NULL;
+
+    if (size <= block_data_size(pb)) {
+        // Shrinking....
+        split_if_necessary(heap, pb, size);
+        result = pb->data;
+    }
+    else if (heap->free_bytes < size - block_data_size(pb)) {
+        // Growing, but there's not enough total free space in the heap
+        multi_heap_internal_unlock(heap);
+        return NULL;
+    }
+
+    // New size is larger than existing block
+    if (result == NULL) {
+        // See if we can grow into one or both adjacent blocks
+        heap_block_t *orig_pb = pb;
+        size_t orig_size = block_data_size(orig_pb);
+        heap_block_t *next = get_next_block(pb);
+        heap_block_t *prev = get_prev_free_block(pb);
+
+        size_t prev_grow_size = (prev != NULL) ? block_data_size(prev) + sizeof(pb->header) : 0;
+        size_t next_grow_size = (is_free(next) && !is_last_block(next)) ? block_data_size(next) + sizeof(next->header) : 0;
+
+        // Can grow into next block? (we may also need to grow into 'prev' to get to our desired size)
+        if (next_grow_size > 0 && (orig_size + next_grow_size + prev_grow_size >= size)) {
+            remove_free_block(heap, next);
+            heap->free_bytes -= block_data_size(next);
+            mark_used(next);
+            set_next_block(pb, get_next_block(next));
+        }
+
+        // Can grow into previous block?
+        // (try this even if we're already big enough from growing into 'next', as it reduces fragmentation)
+        if (prev_grow_size > 0 && (block_data_size(pb) + prev_grow_size >= size)) {
+            remove_free_block(heap, prev);
+            heap->free_bytes -= block_data_size(prev);
+            mark_used(prev);
+            set_next_block(prev, get_next_block(pb));
+            pb = prev;
+        }
+
+        if (block_data_size(pb) >= size) {
+            memmove(pb->data, orig_pb->data, orig_size);
+            split_if_necessary(heap, pb, size);
+            result = pb->data;
+        }
+    }
+
+    if (result == NULL) {
+        // Need to allocate elsewhere and copy data over
+        //
+        // (Calling _impl versions here as we've already been through any
+        // unwrapping for heap poisoning features.)
+        result = multi_heap_malloc_impl(heap, size);
+        if (result != NULL) {
+            memcpy(result, pb->data, block_data_size(pb));
+            multi_heap_free_impl(heap, pb->data);
+        }
+    }
+
+    if (heap->free_bytes < heap->minimum_free_bytes) {
+        heap->minimum_free_bytes = heap->free_bytes;
+    }
+
+    multi_heap_internal_unlock(heap);
+    return result;
+}
+
+#define FAIL_PRINT(MSG, ...) do {                                       \
+        if (print_errors) {                                             \
+            MULTI_HEAP_STDERR_PRINTF(MSG, __VA_ARGS__);                 \
+        }                                                               \
+        valid = false;                                                  \
+    }                                                                   \
+    while(0)
+
+bool multi_heap_check(multi_heap_handle_t heap, bool print_errors)
+{
+    bool valid = true;
+    size_t total_free_bytes = 0;
+    size_t free_blocks = 0;
+    assert(heap != NULL);
+
+    multi_heap_internal_lock(heap);
+
+    heap_block_t *prev = NULL;
+
+    /* note: not using get_next_block() in loop, so that assertions aren't checked here */
+    for(heap_block_t *b = &heap->first_block; b != NULL; b = (heap_block_t *)(b->header & NEXT_BLOCK_MASK)) {
+        if (b == prev) {
+            FAIL_PRINT("CORRUPT HEAP: Block %p points to itself\n", b);
+            goto done;
+        }
+        if (b < prev) {
+            FAIL_PRINT("CORRUPT HEAP: Block %p is before prev block %p\n", b, prev);
+            goto done;
+        }
+        if (b > heap->last_block || b < &heap->first_block) {
+            FAIL_PRINT("CORRUPT HEAP: Block %p is outside heap (last valid block %p)\n", b, prev);
+            goto done;
+        }
+        bool prev_free = prev != NULL && is_free(prev) && !is_first_block(heap, prev);
+        if (prev_free != ((b->header & PREV_FREE_FLAG) != 0)) {
+            FAIL_PRINT("CORRUPT HEAP: Block %p previous block free flag doesn't match block %p\n", b, prev);
+        }
+        if (is_free(b)) {
+            if (prev_free && !is_last_block(b)) {
+                FAIL_PRINT("CORRUPT HEAP: Two adjacent free blocks found, %p and %p\n", prev, b);
+            }
+            if (!is_first_block(heap, b) && !is_last_block(b)) {
+                if (*get_footer(b) != b) {
+                    FAIL_PRINT("CORRUPT HEAP: Free block %p footer points to %p\n", b, *get_footer(b));
+                }
+                total_free_bytes += block_data_size(b);
+                free_blocks++;
+            }
+        }
+        prev = b;
+
+#ifdef MULTI_HEAP_POISONING
+        if (!is_last_block(b)) {
+            /* For slow heap poisoning, any block should contain correct poisoning patterns and/or fills */
+            bool poison_ok = true;
+            if (is_free(b)) {
+                if (!is_first_block(heap, b)) {
+                    uint32_t block_len = (intptr_t)get_footer(b) - (intptr_t)&b[1];
+                    poison_ok = multi_heap_internal_check_block_poisoning(&b[1], block_len, true, print_errors);
+                }
+            }
+            else {
+                poison_ok = multi_heap_internal_check_block_poisoning(b->data, block_data_size(b), false, print_errors);
+            }
+            valid = poison_ok && valid;
+        }
+#endif
+
+    } /* for(heap_block_t b = ... */
+
+    if (prev != heap->last_block) {
+        FAIL_PRINT("CORRUPT HEAP: Last block %p not %p\n", prev, heap->last_block);
+    }
+    if (!is_free(heap->last_block)) {
+        FAIL_PRINT("CORRUPT HEAP: Expected prev block %p to be free\n", heap->last_block);
+    }
+
+    if (heap->free_bytes != total_free_bytes) {
+        FAIL_PRINT("CORRUPT HEAP: Expected %u free bytes counted %u\n", (unsigned)heap->free_bytes, (unsigned)total_free_bytes);
+    }
+
+    /* Every free block should be in the list of its size class, once */
+    for (int fl = 0; fl < heap->fl_count; fl++) {
+        if (((heap->fl_bitmap >> fl) & 1) != (heap->sl_bitmap[fl] != 0)) {
+            FAIL_PRINT("CORRUPT HEAP: First level bitmap 0x%08x doesn't match level %d\n", (unsigned)heap->fl_bitmap, fl);
+        }
+        for (int sl = 0; sl < SL_INDEX_COUNT; sl++) {
+            heap_block_t *b = heap->free_lists[fl * SL_INDEX_COUNT + sl];
+            if (((heap->sl_bitmap[fl] >> sl) & 1) != (b != NULL)) {
+                FAIL_PRINT("CORRUPT HEAP: Second level bitmap 0x%02x doesn't match list %d\n", heap->sl_bitmap[fl], sl);
+            }
+            for (heap_block_t *p = NULL; b != NULL; p = b, b = b->next_free) {
+                int b_fl, b_sl;
+                if (b > heap->last_block || b <= &heap->first_block || !is_free(b) || b->prev_free != p) {
+                    FAIL_PRINT("CORRUPT HEAP: Bad free block %p after %p\n", b, p);
+                    goto done;
+                }
+                mapping(block_data_size(b), &b_fl, &b_sl);
+                if (b_fl != fl || b_sl != sl) {
+                    FAIL_PRINT("CORRUPT HEAP: Free block %p in the list of another size (%d)\n", b, fl * SL_INDEX_COUNT + sl);
+                }
+                if (free_blocks-- == 0) {
+                    FAIL_PRINT("CORRUPT HEAP: More blocks in free lists than free blocks (%p)\n", b);
+                    goto done;
+                }
+            }
+        }
+    }
+    if (free_blocks != 0) {
+        FAIL_PRINT("CORRUPT HEAP: %u free blocks missing from free lists\n", (unsigned)free_blocks);
+    }
+
+ done:
+    multi_heap_internal_unlock(heap);
+
+    return valid;
+}
+
+void multi_heap_dump(multi_heap_handle_t heap)
+{
+    assert(heap != NULL);
+
+    multi_heap_internal_lock(heap);
+    MULTI_HEAP_STDERR_PRINTF("Heap start %p end %p\nFirst level bitmap 0x%08x\n", &heap->first_block, heap->last_block, (unsigned)heap->fl_bitmap);
+    for(heap_block_t *b = &heap->first_block; b != NULL; b = get_next_block(b)) {
+        MULTI_HEAP_STDERR_PRINTF("Block %p data size 0x%08x bytes next block %p", b, block_data_size(b), get_next_block(b));
+        if (is_free(b)) {
+            MULTI_HEAP_STDERR_PRINTF(" FREE. Next free %p\n", b->next_free);
+        } else {
+            MULTI_HEAP_STDERR_PRINTF("%s", "\n"); /* C macros & optional __VA_ARGS__ */
+        }
+    }
+    multi_heap_internal_unlock(heap);
+}
+
+size_t multi_heap_free_size_impl(multi_heap_handle_t heap)
+{
+    if (heap == NULL) {
+        return 0;
+    }
+    return heap->free_bytes;
+}
+
+size_t multi_heap_minimum_free_size_impl(multi_heap_handle_t heap)
+{
+    if (heap == NULL) {
+        return 0;
+    }
+    return heap->minimum_free_bytes;
+}
+
+void multi_heap_get_info_impl(multi_heap_handle_t heap, multi_heap_info_t *info)
+{
+    memset(info, 0, sizeof(multi_heap_info_t));
+
+    if (heap == NULL) {
+        return;
+    }
+
+    multi_heap_internal_lock(heap);
+    for(heap_block_t *b = get_next_block(&heap->first_block); !is_last_block(b); b = get_next_block(b)) {
+        info->total_blocks++;
+        if (is_free(b)) {
+            size_t s = block_data_size(b);
+            info->total_free_bytes += s;
+            if (s > info->largest_free_block) {
+                info->largest_free_block = s;
+            }
+            info->free_blocks++;
+        } else {
+            info->total_allocated_bytes += block_data_size(b);
+            info->allocated_blocks++;
+        }
+    }
+
+    info->minimum_free_bytes = heap->minimum_free_bytes;
+    // heap has wrong total size (address printed here is not indicative of the real error)
+    MULTI_HEAP_ASSERT(info->total_free_bytes == heap->free_bytes, heap);
+
+    multi_heap_internal_unlock(heap);
+
+}
+
+#endif // MULTI_HEAP_TLSF
@@ -0,0 +1,215 @@
+/*
+ Tests for the fixed size object pools
+*/
+
+#include <esp_types.h>
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "unity.h"
+#include "esp_heap_caps.h"
+#include "esp_heap_pool.h"
+#include "esp_timer.h"
+#include "soc/soc_memory_layout.h"
+#include "sdkconfig.h"
+
+TEST_CASE("heap_pool allocates distinct objects and reuses freed ones", "[heap][pool]")
+{
+    heap_pool_config_t config = {
+        .name = "test",
+        .object_size = 30,
+        .objects_per_slab = 4,
+        .magazine_size = 2,
+    };
+    heap_pool_handle_t pool = heap_pool_create(&config);
+    TEST_ASSERT_NOT_NULL(pool);
+
+    uint8_t *objs[10];
+    for (int i = 0; i < 10; i++) {
+        objs[i] = heap_pool_alloc(pool);
+        TEST_ASSERT_NOT_NULL(objs[i]);
+        TEST_ASSERT_EQUAL(0, (intptr_t)objs[i] & 3);
+        memset(objs[i], i, 32);
+    }
+    for (int i = 0; i < 10; i++) {
+        for (int j = 0; j < 32; j++) {
+            TEST_ASSERT_EQUAL(i, objs[i][j]);
+        }
+    }
+
+    heap_pool_info_t info;
+    heap_pool_get_info(pool, &info);
+    TEST_ASSERT_EQUAL(32, info.object_size);
+    TEST_ASSERT_EQUAL(3, info.slabs);
+    TEST_ASSERT_EQUAL(12, info.total_objects);
+    TEST_ASSERT_EQUAL(10, info.allocated_objects);
+
+    /* freed objects are reused before any new slab is allocated */
+    for (int i = 0; i < 10; i++) {
+        heap_pool_free(pool, objs[i]);
+    }
+    heap_pool_get_info(pool, &info);
+    TEST_ASSERT_EQUAL(0, info.allocated_objects);
+    TEST_ASSERT(info.cached_objects <= 2);
+    for (int i = 0; i < 12; i++) {
+        TEST_ASSERT_NOT_NULL(heap_pool_alloc(pool));
+    }
+    heap_pool_get_info(pool, &info);
+    TEST_ASSERT_EQUAL(3, info.slabs);
+    TEST_ASSERT_EQUAL(12, info.allocated_objects);
+
+    heap_pool_print_info(MALLOC_CAP_8BIT);
+    heap_pool_delete(pool);
+}
+
+TEST_CASE("heap_pool allocates slabs with the requested capabilities", "[heap][pool]")
+{
+    heap_pool_config_t config = {
+        .object_size = 64,
+        .caps = MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT,
+    };
+    TEST_ASSERT_NULL(heap_pool_create(NULL));
+    config.object_size = 0;
+    TEST_ASSERT_NULL(heap_pool_create(&config));
+    config.object_size = 64;
+    config.magazine_size = HEAP_POOL_MAX_MAGAZINE_SIZE + 1;
+    TEST_ASSERT_NULL(heap_pool_create(&config));
+    config.magazine_size = 0;
+
+    heap_pool_handle_t pool = heap_pool_create(&config);
+    TEST_ASSERT_NOT_NULL(pool);
+    void *obj = heap_pool_alloc(pool);
+    TEST_ASSERT(esp_ptr_internal(obj));
+    heap_pool_free(pool, obj);
+    heap_pool_delete(pool);
+
+#if CONFIG_SPIRAM_USE_CAPS_ALLOC || CONFIG_SPIRAM_USE_MALLOC
+    config.caps = MALLOC_CAP_SPIRAM;
+    pool = heap_pool_create(&config);
+    TEST_ASSERT_NOT_NULL(pool);
+    obj = heap_pool_alloc(pool);
+    TEST_ASSERT(esp_ptr_external_ram(obj));
+    heap_pool_free(pool, obj);
+    heap_pool_delete(pool);
+#endif
+}
+
+TEST_CASE("heap_pool doesn't leak heap memory", "[heap][pool]")
+{
+    heap_pool_config_t config = {
+        .object_size = 100,
+    };
+    /* create a pool once, so one-off allocations made on first use don't count */
+    heap_pool_delete(heap_pool_create(&config));
+
+    size_t before = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    heap_pool_handle_t pool = heap_pool_create(&config);
+    void *objs[40];
+    for (int i = 0; i < 40; i++) {
+        objs[i] = heap_pool_alloc(pool);
+    }
+    for (int i = 0; i < 40; i++) {
+        heap_pool_free(pool, objs[i]);
+    }
+    heap_pool_delete(pool);
+    TEST_ASSERT_EQUAL(before, heap_caps_get_free_size(MALLOC_CAP_8BIT));
+}
+
+#if portNUM_PROCESSORS == 2
+
+typedef struct {
+    heap_pool_handle_t pool;
+    SemaphoreHandle_t done;
+    bool ok;
+} pool_task_args_t;
+
+static void pool_task(void *arg)
+{
+    pool_task_args_t *args = (pool_task_args_t *)arg;
+    uint32_t *objs[20];
+    uint32_t tag = (uint32_t)xTaskGetCurrentTaskHandle();
+
+    args->ok = true;
+    for (int round = 0; round < 2000 && args->ok; round++) {
+        int n = 1 + round % 20;
+        for (int i = 0; i < n; i++) {
+            objs[i] = heap_pool_alloc(args->pool);
+            if (objs[i] == NULL) {
+                args->ok = false;
+                n = i;
+                break;
+            }
+            objs[i][0] = tag;
+            objs[i][1] = i;
+        }
+        for (int i = 0; i < n; i++) {
+            if (objs[i][0] != tag || objs[i][1] != i) {
+                args->ok = false;
+            }
+            heap_pool_free(args->pool, objs[i]);
+        }
+    }
+    xSemaphoreGive(args->done);
+    vTaskDelete(NULL);
+}
+
+TEST_CASE("heap_pool can be used by both cores at the same time", "[heap][pool]")
+{
+    heap_pool_config_t config = {
+        .object_size = 16,
+        .objects_per_slab = 8,
+        .magazine_size = 4,
+    };
+    pool_task_args_t args[2];
+    SemaphoreHandle_t done = xSemaphoreCreateCounting(2, 0);
+    heap_pool_handle_t pool = heap_pool_create(&config);
+    TEST_ASSERT_NOT_NULL(pool);
+
+    for (int i = 0; i < 2; i++) {
+        args[i].pool = pool;
+        args[i].done = done;
+        xTaskCreatePinnedToCore(pool_task, "pool_task", 2048, &args[i], UNITY_FREERTOS_PRIORITY - 1, NULL, i);
+    }
+    for (int i = 0; i < 2; i++) {
+        TEST_ASSERT(xSemaphoreTake(done, 5000 / portTICK_PERIOD_MS));
+    }
+    TEST_ASSERT(args[0].ok);
+    TEST_ASSERT(args[1].ok);
+
+    heap_pool_info_t info;
+    heap_pool_get_info(pool, &info);
+    TEST_ASSERT_EQUAL(0, info.allocated_objects);
+
+    heap_pool_delete(pool);
+    vSemaphoreDelete(done);
+}
+
+#endif
+
+TEST_CASE("heap_pool allocation is faster than heap_caps_malloc", "[heap][pool]")
+{
+    const int COUNT = 1000;
+    heap_pool_config_t config = {
+        .object_size = 64,
+    };
+    heap_pool_handle_t pool = heap_pool_create(&config);
+    heap_pool_free(pool, heap_pool_alloc(pool));
+
+    int64_t start = esp_timer_get_time();
+    for (int i = 0; i < COUNT; i++) {
+        heap_pool_free(pool, heap_pool_alloc(pool));
+    }
+    int64_t pool_time = esp_timer_get_time() - start;
+
+    start = esp_timer_get_time();
+    for (int i = 0; i < COUNT; i++) {
+        heap_caps_free(heap_caps_malloc(64, MALLOC_CAP_8BIT));
+    }
+    int64_t heap_time = esp_timer_get_time() - start;
+
+    printf("%d alloc/free: heap_pool %d us, heap_caps %d us\n", COUNT, (int)pool_time, (int)heap_time);
+    TEST_ASSERT(pool_time < heap_time);
+    heap_pool_delete(pool);
+}
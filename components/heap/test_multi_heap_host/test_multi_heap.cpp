@@ -16,9 +16,17 @@
 #undef realloc
 #define realloc #error
 
+#ifdef MULTI_HEAP_TLSF
+/* TLSF free lists are stored in the heap region, leave them room in the small test heaps */
+#define TEST_HEAP_EXTRA 1024
+#else
+#define TEST_HEAP_EXTRA 0
+#endif
+#define TEST_HEAP_SIZE(X) ((X) + TEST_HEAP_EXTRA)
+
 TEST_CASE("multi_heap simple allocations", "[multi_heap]")
 {
-    uint8_t small_heap[128];
+    uint8_t small_heap[TEST_HEAP_SIZE(128)];
 
     multi_heap_handle_t heap = multi_heap_register(small_heap, sizeof(small_heap));
 
@@ -59,7 +67,7 @@ TEST_CASE("multi_heap simple allocations", "[multi_heap]")
 
 TEST_CASE("multi_heap fragmentation", "[multi_heap]")
 {
-    uint8_t small_heap[256];
+    uint8_t small_heap[TEST_HEAP_SIZE(256)];
     multi_heap_handle_t heap = multi_heap_register(small_heap, sizeof(small_heap));
 
     const size_t alloc_size = 24;
@@ -76,7 +84,7 @@ TEST_CASE("multi_heap fragmentation", "[multi_heap]")
 
     printf("allocated %p %p %p %p\n", p[0], p[1], p[2], p[3]);
 
-    REQUIRE( multi_heap_malloc(heap, alloc_size * 5) == NULL ); /* no room to allocate 5*alloc_size now */
+    REQUIRE( multi_heap_malloc(heap, alloc_size * 5 + TEST_HEAP_EXTRA) == NULL ); /* no room to allocate 5*alloc_size now */
 
     printf("4 allocations:\n");
     multi_heap_dump(heap);
@@ -91,7 +99,10 @@ TEST_CASE("multi_heap fragmentation", "[multi_heap]")
     printf("****************\n");
 
     void *big = multi_heap_malloc(heap, alloc_size * 3);
+#ifndef MULTI_HEAP_TLSF
+    /* TLSF takes any block of a large enough size class, not the best fit */
     REQUIRE( p[3] == big ); /* big should go where p[3] was freed from */
+#endif
     multi_heap_free(heap, big);
 
     multi_heap_free(heap, p[2]);
@@ -109,7 +120,7 @@ TEST_CASE("multi_heap fragmentation", "[multi_heap]")
 TEST_CASE("multi_heap defrag", "[multi_heap]")
 {
     void *p[4];
-    uint8_t small_heap[512];
+    uint8_t small_heap[TEST_HEAP_SIZE(512)];
     multi_heap_info_t info, info2;
     multi_heap_handle_t heap = multi_heap_register(small_heap, sizeof(small_heap));
 
@@ -159,7 +170,7 @@ TEST_CASE("multi_heap defrag", "[multi_heap]")
 TEST_CASE("multi_heap defrag realloc", "[multi_heap]")
 {
     void *p[4];
-    uint8_t small_heap[512];
+    uint8_t small_heap[TEST_HEAP_SIZE(512)];
     multi_heap_info_t info, info2;
     multi_heap_handle_t heap = multi_heap_register(small_heap, sizeof(small_heap));
 
@@ -204,7 +215,7 @@ TEST_CASE("multi_heap defrag realloc", "[multi_heap]")
 
 TEST_CASE("multi_heap many random allocations", "[multi_heap]")
 {
-    uint8_t big_heap[1024];
+    uint8_t big_heap[TEST_HEAP_SIZE(1024)];
     const int NUM_POINTERS = 64;
 
     printf("Running multi-allocation test...\n");
@@ -296,7 +307,7 @@ TEST_CASE("multi_heap many random allocations", "[multi_heap]")
 
 TEST_CASE("multi_heap_get_info() function", "[multi_heap]")
 {
-    uint8_t heapdata[256];
+    uint8_t heapdata[TEST_HEAP_SIZE(256)];
     multi_heap_handle_t heap = multi_heap_register(heapdata, sizeof(heapdata));
     multi_heap_info_t before, after, freed;
 
@@ -391,7 +402,7 @@ TEST_CASE("multi_heap minimum-size allocations", "[multi_heap]")
 TEST_CASE("multi_heap_realloc()", "[multi_heap]")
 {
     const uint32_t PATTERN = 0xABABDADA;
-    uint8_t small_heap[300];
+    uint8_t small_heap[TEST_HEAP_SIZE(300)];
     multi_heap_handle_t heap = multi_heap_register(small_heap, sizeof(small_heap));
 
     uint32_t *a = (uint32_t *)multi_heap_malloc(heap, 64);
@@ -427,9 +438,9 @@ TEST_CASE("multi_heap_realloc()", "[multi_heap]")
     REQUIRE( f == b ); /* 'b' should be extended in-place, over space formerly occupied by 'd' */
 
 #ifdef MULTI_HEAP_POISONING
-#define TOO_MUCH 92 + 1
+#define TOO_MUCH (92 + 1 + TEST_HEAP_EXTRA)
 #else
-#define TOO_MUCH 128 + 1
+#define TOO_MUCH (128 + 1 + TEST_HEAP_EXTRA)
 #endif
     /* not enough contiguous space left in the heap */
     uint32_t *g = (uint32_t *)multi_heap_realloc(heap, e, TOO_MUCH);
@@ -445,7 +456,7 @@ TEST_CASE("multi_heap_realloc()", "[multi_heap]")
 
 TEST_CASE("corrupt heap block", "[multi_heap]")
 {
-    uint8_t small_heap[256];
+    uint8_t small_heap[TEST_HEAP_SIZE(256)];
     multi_heap_handle_t heap = multi_heap_register(small_heap, sizeof(small_heap));
 
     void *a = multi_heap_malloc(heap, 32);
@@ -0,0 +1,229 @@
+// Copyright 2015-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks of multi_heap allocation latency and fragmentation. They are
+// hidden from the default test run, use "make benchmark" or
+// "./test_multi_heap [benchmark]".
+//
+// The allocator is chosen at build time, compare the two with:
+//   make clean benchmark
+//   CPPFLAGS=-DCONFIG_HEAP_ALLOCATOR_TLSF make clean benchmark
+//
+// Latencies are host times of single calls, so they are only comparable
+// between runs on the same machine. Workloads use a fixed seed.
+
+#include "catch.hpp"
+#include "multi_heap.h"
+
+#include "../multi_heap_config.h"
+
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+using namespace std;
+
+namespace
+{
+
+#ifdef MULTI_HEAP_TLSF
+const char* ALLOCATOR_NAME = "tlsf";
+#else
+const char* ALLOCATOR_NAME = "best fit";
+#endif
+
+/**
+ * Host time of single calls, in nanoseconds.
+ */
+class Latency
+{
+public:
+    template<typename TFunc>
+    void run(TFunc func)
+    {
+        auto start = chrono::steady_clock::now();
+        func();
+        mSamples.push_back(chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count());
+    }
+
+    void report(const char* name)
+    {
+        if (mSamples.empty()) {
+            return;
+        }
+        sort(mSamples.begin(), mSamples.end());
+        printf("  %-10s %8zu calls  p50 %6u ns  p99 %6u ns  p99.9 %7u ns  max %8u ns\n", name, mSamples.size(),
+               percentile(50, 100), percentile(99, 100), percentile(999, 1000), mSamples.back());
+    }
+
+protected:
+    uint32_t percentile(size_t p, size_t scale) const
+    {
+        return mSamples[(mSamples.size() - 1) * p / scale];
+    }
+
+    vector<uint32_t> mSamples;
+};
+
+/**
+ * Tracks how much of the free memory can't be used for large blocks.
+ */
+class Fragmentation
+{
+public:
+    void sample(multi_heap_handle_t heap)
+    {
+        multi_heap_info_t info;
+        multi_heap_get_info(heap, &info);
+        if (info.total_free_bytes == 0) {
+            return;
+        }
+        double frag = 1.0 - static_cast<double>(info.largest_free_block) / info.total_free_bytes;
+        mSum += frag;
+        mWorst = max(mWorst, frag);
+        mMaxFreeBlocks = max(mMaxFreeBlocks, info.free_blocks);
+        ++mCount;
+    }
+
+    void report(size_t failures, size_t attempts)
+    {
+        printf("  fragmentation (1 - largest free / free)  mean %5.1f%%  worst %5.1f%%  max free blocks %zu\n",
+               mCount ? mSum * 100 / mCount : 0.0, mWorst * 100, mMaxFreeBlocks);
+        printf("  mallocs failed with enough total free bytes: %zu of %zu\n", failures, attempts);
+    }
+
+protected:
+    double mSum = 0;
+    double mWorst = 0;
+    size_t mMaxFreeBlocks = 0;
+    size_t mCount = 0;
+};
+
+/* Mix of sizes seen on a device: many small control blocks, network buffers, a few large buffers */
+size_t randomSize(mt19937& gen)
+{
+    uint32_t kind = gen() % 100;
+    if (kind < 60) {
+        return 8 + gen() % 57;
+    } else if (kind < 90) {
+        return 64 + gen() % 449;
+    } else if (kind < 99) {
+        return 512 + gen() % 1089;
+    }
+    return 2048 + gen() % 6145;
+}
+
+} // namespace
+
+TEST_CASE("multi_heap random workload latency and fragmentation", "[multi_heap][benchmark]")
+{
+    static uint8_t heapdata[96 * 1024] __attribute__((aligned(8)));
+    multi_heap_handle_t heap = multi_heap_register(heapdata, sizeof(heapdata));
+    REQUIRE( heap != NULL );
+
+    const size_t SLOTS = 512;
+    const size_t STEPS = 400000;
+    vector<void*> p(SLOTS, nullptr);
+    mt19937 gen(0x4ea9);
+    Latency mallocs, frees, reallocs;
+    Fragmentation frag;
+    size_t failures = 0, attempts = 0;
+
+    for (size_t step = 0; step < STEPS; ++step) {
+        size_t n = gen() % SLOTS;
+        if (p[n] == nullptr) {
+            size_t size = randomSize(gen);
+            size_t free_bytes = multi_heap_free_size(heap);
+            mallocs.run([&]() {
+                p[n] = multi_heap_malloc(heap, size);
+            });
+            ++attempts;
+            if (p[n] == nullptr && free_bytes >= size + 64) {
+                ++failures;
+            }
+        } else if (gen() % 8 == 0) {
+            size_t size = randomSize(gen);
+            void* r;
+            reallocs.run([&]() {
+                r = multi_heap_realloc(heap, p[n], size);
+            });
+            if (r != nullptr) {
+                p[n] = r;
+            }
+        } else {
+            frees.run([&]() {
+                multi_heap_free(heap, p[n]);
+            });
+            p[n] = nullptr;
+        }
+        if (step % 1000 == 0) {
+            frag.sample(heap);
+        }
+    }
+    REQUIRE( multi_heap_check(heap, true) );
+
+    printf("%s allocator, %zu byte heap, %zu random operations:\n", ALLOCATOR_NAME, sizeof(heapdata), STEPS);
+    mallocs.report("malloc");
+    reallocs.report("realloc");
+    frees.report("free");
+    frag.report(failures, attempts);
+
+    for (auto ptr : p) {
+        multi_heap_free(heap, ptr);
+    }
+}
+
+TEST_CASE("multi_heap large malloc with many small free blocks", "[multi_heap][benchmark]")
+{
+    static uint8_t heapdata[96 * 1024] __attribute__((aligned(8)));
+    multi_heap_handle_t heap = multi_heap_register(heapdata, sizeof(heapdata));
+    REQUIRE( heap != NULL );
+
+    /* Fill the heap with small blocks, then free every other one: the free
+       space is split into many blocks too small for the large allocations */
+    vector<void*> small;
+    for (void* ptr; (ptr = multi_heap_malloc(heap, 32)) != nullptr;) {
+        small.push_back(ptr);
+    }
+    for (size_t i = 0; i < small.size(); i += 2) {
+        multi_heap_free(heap, small[i]);
+        small[i] = nullptr;
+    }
+    /* Free a few adjacent blocks at the end, so large allocations can succeed */
+    for (size_t i = small.size() - 64; i < small.size(); ++i) {
+        multi_heap_free(heap, small[i]);
+        small[i] = nullptr;
+    }
+
+    multi_heap_info_t info;
+    multi_heap_get_info(heap, &info);
+    Latency large;
+    for (int i = 0; i < 10000; ++i) {
+        void* ptr;
+        large.run([&]() {
+            ptr = multi_heap_malloc(heap, 1024);
+        });
+        REQUIRE( ptr != NULL );
+        multi_heap_free(heap, ptr);
+    }
+    REQUIRE( multi_heap_check(heap, true) );
+
+    printf("%s allocator, 1024 byte malloc with %zu free blocks:\n", ALLOCATOR_NAME, info.free_blocks);
+    large.report("malloc");
+
+    for (auto ptr : small) {
+        multi_heap_free(heap, ptr);
+    }
+}
@@ -19,6 +19,9 @@
 #include <stdarg.h>
 #include "sdkconfig.h"
 #include <rom/ets_sys.h>
+#if CONFIG_LOG_DEFERRED
+#include "esp_err.h"
+#endif
 
 #ifdef __cplusplus
 extern "C" {
@@ -45,7 +48,8 @@ typedef int (*vprintf_like_t)(const char *, va_list);
  * If logging for given component has already been enabled, changes previous setting.
  *
  * Note that this function can not raise log level above the level set using
- * CONFIG_LOG_DEFAULT_LEVEL setting in menuconfig.
+ * CONFIG_LOG_MAXIMUM_LEVEL setting in menuconfig, log statements more verbose
+ * than this level are removed at compile time.
  *
  * To raise log level above the default one for a given file, define
  * LOG_LOCAL_LEVEL to one of the ESP_LOG_* values, before including
@@ -59,6 +63,15 @@ typedef int (*vprintf_like_t)(const char *, va_list);
  */
 void esp_log_level_set(const char* tag, esp_log_level_t level);
 
+/**
+ * @brief Get log level for given tag
+ *
+ * @param tag Tag of the log entries. Must be a non-NULL zero terminated string.
+ *
+ * @return the level set for this tag with esp_log_level_set, or the default level
+ */
+esp_log_level_t esp_log_level_get(const char* tag);
+
 /**
  * @brief Set function used to output log entries
  *
@@ -106,13 +119,45 @@ uint32_t esp_log_early_timestamp(void);
  */
 void esp_log_write(esp_log_level_t level, const char* tag, const char* format, ...) __attribute__ ((format (printf, 3, 4)));
 
+#if CONFIG_LOG_DEFERRED
+/**
+ * @brief Start the task printing deferred log messages
+ *
+ * Called during startup when CONFIG_LOG_DEFERRED is enabled. Messages logged
+ * before are kept in the buffers until the task runs, or printed directly if
+ * the scheduler isn't running yet.
+ *
+ * @return
+ *      - ESP_OK on success
+ *      - ESP_ERR_INVALID_STATE if the task is already running
+ *      - ESP_ERR_NO_MEM if the task can't be created
+ */
+esp_err_t esp_log_deferred_init(void);
+
+/**
+ * @brief Print all deferred log messages now
+ *
+ * Waits until the messages buffered by all CPU cores are printed. Call it
+ * before a planned restart or deep sleep, buffered messages are lost otherwise.
+ * Must be called from a task.
+ */
+void esp_log_deferred_flush(void);
+
+/**
+ * @brief Get the number of log messages dropped because a buffer was full
+ *
+ * @return total number of messages dropped since startup, by all CPU cores
+ */
+uint32_t esp_log_deferred_get_dropped(void);
+#endif // CONFIG_LOG_DEFERRED
+
 /** @cond */
 
 #include "esp_log_internal.h"
 
 #ifndef LOG_LOCAL_LEVEL
 #ifndef BOOTLOADER_BUILD
-#define LOG_LOCAL_LEVEL  CONFIG_LOG_DEFAULT_LEVEL
+#define LOG_LOCAL_LEVEL  CONFIG_LOG_MAXIMUM_LEVEL
 #else
 #define LOG_LOCAL_LEVEL  CONFIG_LOG_BOOTLOADER_LEVEL
 #endif
@@ -15,24 +15,24 @@
 /*
  * Log library implementation notes.
  *
- * Log library stores all tags provided to esp_log_level_set as a linked
- * list. See uncached_tag_entry_t structure.
+ * Log library stores all tags provided to esp_log_level_set in a hash
+ * table. See uncached_tag_entry_t structure. The hash of the tag string
+ * is computed once, when the entry is created, so a lookup only compares
+ * the strings of entries with the same hash.
  *
  * To avoid looking up log level for given tag each time message is
- * printed, this library caches pointers to tags. Because the suggested
- * way of creating tags uses one 'TAG' constant per file, this caching
- * should be effective. Cache is a binary min-heap of cached_tag_entry_t
- * items, ordering is done on 'generation' member. In this context,
- * generation is an integer which is incremented each time an operation
- * with cache is performed. When cache is full, new item is inserted in
- * place of an oldest item (that is, with smallest 'generation' value).
- * After that, bubble-down operation is performed to fix ordering in the
- * min-heap.
+ * printed, this library caches levels by tag pointer. Because the
+ * suggested way of creating tags uses one 'TAG' constant per file, the
+ * same pointer is passed for every message of a file. Cache is direct
+ * mapped: the entry is chosen from the pointer value, and a new tag
+ * replaces the tag cached in its entry. Cache is read without taking
+ * the mutex, so a message from a cached tag costs a load and a compare.
+ * Writers hold the mutex and increment s_log_cache_seq before and after
+ * changing entries, readers which see it odd or changed take the slow
+ * path instead.
  *
- * The potential problem with wrap-around of cache generation counter is
- * ignored for now. This will happen if someone happens to output more
- * than 4 billion log entries, at which point wrap-around will not be
- * the biggest problem.
+ * Messages more verbose than the levels of all tags (s_log_max_level)
+ * are dropped before the tag is looked up.
  *
  */
 
@@ -55,6 +55,7 @@
 #include <ctype.h>
 
 #include "esp_log.h"
+#include "log_private.h"
 
 #include "rom/queue.h"
 #include "soc/soc_memory_layout.h"
@@ -64,33 +65,45 @@
 
 #ifndef BOOTLOADER_BUILD
 
-// Number of tags to be cached. Must be 2**n - 1, n >= 2.
-#define TAG_CACHE_SIZE 31
+// Number of tag levels cached by tag pointer. Must be a power of 2.
+#define TAG_CACHE_SIZE 64
+
+// Number of buckets of the hash table of tags. Must be a power of 2.
+#define TAG_HASH_BUCKETS 16
 
 // Maximum time to wait for the mutex in a logging statement.
 #define MAX_MUTEX_WAIT_MS 10
 #define MAX_MUTEX_WAIT_TICKS ((MAX_MUTEX_WAIT_MS + portTICK_PERIOD_MS - 1) / portTICK_PERIOD_MS)
 
+// Level of tags not set with esp_log_level_set. When the maximum level is the
+// default one, all statements compiled in are printed, as LOG_LOCAL_LEVEL may
+// have been raised for some files.
+#if CONFIG_LOG_MAXIMUM_LEVEL > CONFIG_LOG_DEFAULT_LEVEL
+#define LOG_RUNTIME_DEFAULT_LEVEL CONFIG_LOG_DEFAULT_LEVEL
+#else
+#define LOG_RUNTIME_DEFAULT_LEVEL ESP_LOG_VERBOSE
+#endif
+
 // Uncomment this to enable consistency checks and cache statistics in this file.
 // #define LOG_BUILTIN_CHECKS
 
 typedef struct {
     const char* tag;
-    uint32_t level : 3;
-    uint32_t generation : 29;
+    uint32_t level;
 } cached_tag_entry_t;
 
 typedef struct uncached_tag_entry_{
     SLIST_ENTRY(uncached_tag_entry_) entries; 
+    uint32_t hash;  // tag_hash() of the tag
     uint8_t level;  // esp_log_level_t as uint8_t
     char tag[0];    // beginning of a zero-terminated string
 } uncached_tag_entry_t;
 
-static esp_log_level_t s_log_default_level = ESP_LOG_VERBOSE;
-static SLIST_HEAD(log_tags_head , uncached_tag_entry_) s_log_tags = SLIST_HEAD_INITIALIZER(s_log_tags);
-static cached_tag_entry_t s_log_cache[TAG_CACHE_SIZE];
-static uint32_t s_log_cache_max_generation = 0;
-static uint32_t s_log_cache_entry_count = 0;
+static esp_log_level_t s_log_default_level = LOG_RUNTIME_DEFAULT_LEVEL;
+static esp_log_level_t s_log_max_level = LOG_RUNTIME_DEFAULT_LEVEL;
+static SLIST_HEAD(log_tags_head , uncached_tag_entry_) s_log_tags[TAG_HASH_BUCKETS];
+static volatile cached_tag_entry_t s_log_cache[TAG_CACHE_SIZE];
+static volatile uint32_t s_log_cache_seq = 0;
 static vprintf_like_t s_log_print_func = &vprintf;
 static SemaphoreHandle_t s_log_mutex = NULL;
 
@@ -101,10 +114,11 @@ static uint32_t s_log_cache_misses = 0;
 static inline bool get_cached_log_level(const char* tag, esp_log_level_t* level);
 static inline bool get_uncached_log_level(const char* tag, esp_log_level_t* level);
 static inline void add_to_cache(const char* tag, esp_log_level_t level);
-static void heap_bubble_down(int index);
-static inline void heap_swap(int i, int j);
+static inline void clear_cache();
+static inline uint32_t tag_hash(const char* tag);
 static inline bool should_output(esp_log_level_t level_for_message, esp_log_level_t level_for_tag);
 static inline void clear_log_level_list();
+static void update_max_level();
 
 vprintf_like_t esp_log_set_vprintf(vprintf_like_t func)
 {
@@ -127,19 +141,22 @@ void esp_log_level_set(const char* tag, esp_log_level_t level)
     }
     xSemaphoreTake(s_log_mutex, portMAX_DELAY);
 
-    // for wildcard tag, remove all linked list items and clear the cache
+    // for wildcard tag, remove all hash table items and clear the cache
     if (strcmp(tag, "*") == 0) {
         s_log_default_level = level;
         clear_log_level_list();
+        update_max_level();
         xSemaphoreGive(s_log_mutex);
         return;
     }
 
     //searching exist tag
+    uint32_t hash = tag_hash(tag);
+    struct log_tags_head* bucket = &s_log_tags[hash & (TAG_HASH_BUCKETS - 1)];
     uncached_tag_entry_t *it = NULL;
-    SLIST_FOREACH( it, &s_log_tags, entries ) {
-        if ( strcmp(it->tag, tag)==0 ) {
-            //one tag in the linked list match, update the level
+    SLIST_FOREACH( it, bucket, entries ) {
+        if ( it->hash == hash && strcmp(it->tag, tag)==0 ) {
+            //one tag in the bucket match, update the level
             it->level = level;
             //quit with it != NULL
             break;
@@ -147,140 +164,175 @@ void esp_log_level_set(const char* tag, esp_log_level_t level)
     }
     //no exist tag, append new one
     if ( it == NULL ) {
-        // allocate new linked list entry and append it to the head of the list
+        // allocate new entry and insert it at the head of the bucket
         size_t entry_size = offsetof(uncached_tag_entry_t, tag) + strlen(tag) + 1;
         uncached_tag_entry_t* new_entry = (uncached_tag_entry_t*) malloc(entry_size);
         if (!new_entry) {
             xSemaphoreGive(s_log_mutex);
             return;
         }
+        new_entry->hash = hash;
         new_entry->level = (uint8_t) level;
         strcpy(new_entry->tag, tag);
-        SLIST_INSERT_HEAD( &s_log_tags, new_entry, entries );
+        SLIST_INSERT_HEAD( bucket, new_entry, entries );
     }
 
-    //search in the cache and update it if exist         
-    for (int i = 0; i < s_log_cache_entry_count; ++i) {
-#ifdef LOG_BUILTIN_CHECKS
-        assert(i == 0 || s_log_cache[(i - 1) / 2].generation < s_log_cache[i].generation);
-#endif
-        if (strcmp(s_log_cache[i].tag,tag) == 0) {
-            s_log_cache[i].level = level;
-            break;
-        }
-    }
+    // cached levels may come from other pointers to the same tag string, drop them all
+    clear_cache();
+    update_max_level();
     xSemaphoreGive(s_log_mutex);
 }
 
 void clear_log_level_list()
 {
-    while( !SLIST_EMPTY(&s_log_tags)) {
-        SLIST_REMOVE_HEAD(&s_log_tags, entries );
+    for (int i = 0; i < TAG_HASH_BUCKETS; ++i) {
+        while( !SLIST_EMPTY(&s_log_tags[i])) {
+            uncached_tag_entry_t *it = SLIST_FIRST(&s_log_tags[i]);
+            SLIST_REMOVE_HEAD(&s_log_tags[i], entries );
+            free(it);
+        }
     }
-    s_log_cache_entry_count = 0;
-    s_log_cache_max_generation = 0;
+    clear_cache();
 #ifdef LOG_BUILTIN_CHECKS
     s_log_cache_misses = 0;
 #endif
 }
 
-void IRAM_ATTR esp_log_write(esp_log_level_t level,
-        const char* tag,
-        const char* format, ...)
+// Look up the level of a tag, in the cache first, then in the hash table of all tags.
+// Only takes the mutex on a cache miss, returns false if it can't be taken in time.
+static inline bool get_log_level(const char* tag, esp_log_level_t* level, TickType_t wait)
 {
+    if (get_cached_log_level(tag, level)) {
+        return true;
+    }
     if (!s_log_mutex) {
         s_log_mutex = xSemaphoreCreateMutex();
     }
-    if (xSemaphoreTake(s_log_mutex, MAX_MUTEX_WAIT_TICKS) == pdFALSE) {
-        return;
+    if (xSemaphoreTake(s_log_mutex, wait) == pdFALSE) {
+        return false;
     }
-    esp_log_level_t level_for_tag;
-    // Look for the tag in cache first, then in the linked list of all tags
-    if (!get_cached_log_level(tag, &level_for_tag)) {
-        if (!get_uncached_log_level(tag, &level_for_tag)) {
-            level_for_tag = s_log_default_level;
-        }
-        add_to_cache(tag, level_for_tag);
+    if (!get_uncached_log_level(tag, level)) {
+        *level = s_log_default_level;
+    }
+    add_to_cache(tag, *level);
 #ifdef LOG_BUILTIN_CHECKS
-        ++s_log_cache_misses;
+    ++s_log_cache_misses;
 #endif
-    }
     xSemaphoreGive(s_log_mutex);
+    return true;
+}
+
+esp_log_level_t esp_log_level_get(const char* tag)
+{
+    esp_log_level_t level;
+    get_log_level(tag, &level, portMAX_DELAY);
+    return level;
+}
+
+void IRAM_ATTR esp_log_write(esp_log_level_t level,
+        const char* tag,
+        const char* format, ...)
+{
+    // messages more verbose than all tags are dropped without looking the tag up
+    if (!should_output(level, s_log_max_level)) {
+        return;
+    }
+    esp_log_level_t level_for_tag;
+    if (!get_log_level(tag, &level_for_tag, MAX_MUTEX_WAIT_TICKS)) {
+        return;
+    }
     if (!should_output(level, level_for_tag)) {
         return;
     }
 
     va_list list;
     va_start(list, format);
+#if CONFIG_LOG_DEFERRED
+    if (esp_log_deferred_write(format, list)) {
+        va_end(list);
+        return;
+    }
+#endif
+    (*s_log_print_func)(format, list);
+    va_end(list);
+}
+
+void esp_log_print(const char* format, ...)
+{
+    va_list list;
+    va_start(list, format);
     (*s_log_print_func)(format, list);
     va_end(list);
 }
 
+static inline volatile cached_tag_entry_t* cache_entry(const char* tag)
+{
+    // tags are strings of any alignment, mix in higher bits of the pointer
+    uintptr_t p = (uintptr_t) tag;
+    return &s_log_cache[(p ^ (p >> 6)) & (TAG_CACHE_SIZE - 1)];
+}
+
 static inline bool get_cached_log_level(const char* tag, esp_log_level_t* level)
 {
-    // Look for `tag` in cache
-    int i;
-    for (i = 0; i < s_log_cache_entry_count; ++i) {
-#ifdef LOG_BUILTIN_CHECKS
-        assert(i == 0 || s_log_cache[(i - 1) / 2].generation < s_log_cache[i].generation);
-#endif
-        if (s_log_cache[i].tag == tag) {
-            break;
-        }
-    }
-    if (i == s_log_cache_entry_count) { // Not found in cache
+    // The cache is read without the mutex: if s_log_cache_seq is odd, or
+    // changes while reading the entry, a writer may be changing the entry.
+    uint32_t seq = s_log_cache_seq;
+    if (seq & 1) {
         return false;
     }
-    // Return level from cache
-    *level = (esp_log_level_t) s_log_cache[i].level;
-    // If cache has been filled, start taking ordering into account
-    // (other options are: dynamically resize cache, add "dummy" entries
-    //  to the cache; this option was chosen because code is much simpler,
-    //  and the unfair behavior of cache will show it self at most once, when
-    //  it has just been filled)
-    if (s_log_cache_entry_count == TAG_CACHE_SIZE) {
-        // Update item generation
-        s_log_cache[i].generation = s_log_cache_max_generation++;
-        // Restore heap ordering
-        heap_bubble_down(i);
+    volatile cached_tag_entry_t* entry = cache_entry(tag);
+    const char* cached_tag = entry->tag;
+    uint32_t cached_level = entry->level;
+    if (cached_tag != tag || s_log_cache_seq != seq) {
+        return false;
     }
+    *level = (esp_log_level_t) cached_level;
     return true;
 }
 
+// Called with the mutex held
 static inline void add_to_cache(const char* tag, esp_log_level_t level)
 {
-    uint32_t generation = s_log_cache_max_generation++;
-    // First consider the case when cache is not filled yet.
-    // In this case, just add new entry at the end.
-    // This happens to satisfy binary min-heap ordering.
-    if (s_log_cache_entry_count < TAG_CACHE_SIZE) {
-        s_log_cache[s_log_cache_entry_count] = (cached_tag_entry_t) {
-            .generation = generation,
-            .level = level,
-            .tag = tag
-        };
-        ++s_log_cache_entry_count;
-        return;
+    volatile cached_tag_entry_t* entry = cache_entry(tag);
+    ++s_log_cache_seq;
+    __sync_synchronize();
+    // replaces whatever tag was cached in this entry
+    entry->tag = tag;
+    entry->level = level;
+    __sync_synchronize();
+    ++s_log_cache_seq;
+}
+
+// Called with the mutex held
+static inline void clear_cache()
+{
+    ++s_log_cache_seq;
+    __sync_synchronize();
+    for (int i = 0; i < TAG_CACHE_SIZE; ++i) {
+        s_log_cache[i].tag = NULL;
     }
+    __sync_synchronize();
+    ++s_log_cache_seq;
+}
 
-    // Cache is full, so we replace the oldest entry (which is at index 0
-    // because this is a min-heap) with the new one, and do bubble-down
-    // operation to restore min-heap ordering.
-    s_log_cache[0] = (cached_tag_entry_t) {
-        .tag = tag,
-        .level = level,
-        .generation = generation
-    };
-    heap_bubble_down(0);
+// FNV-1a hash of the tag string
+static inline uint32_t tag_hash(const char* tag)
+{
+    uint32_t hash = 2166136261u;
+    while (*tag) {
+        hash = (hash ^ (uint8_t) *tag++) * 16777619u;
+    }
+    return hash;
 }
 
 static inline bool get_uncached_log_level(const char* tag, esp_log_level_t* level)
 {
-    // Walk the linked list of all tags and see if given tag is present in the list.
-    // This is slow because tags are compared as strings.
+    // Look for the tag in its bucket of the hash table. Strings are only
+    // compared for entries with the same hash.
+    uint32_t hash = tag_hash(tag);
     uncached_tag_entry_t *it;
-    SLIST_FOREACH( it, &s_log_tags, entries ) {
-        if (strcmp(tag, it->tag) == 0) {
+    SLIST_FOREACH( it, &s_log_tags[hash & (TAG_HASH_BUCKETS - 1)], entries ) {
+        if (it->hash == hash && strcmp(tag, it->tag) == 0) {
             *level = it->level;
             return true;
         }
@@ -288,27 +340,24 @@ static inline bool get_uncached_log_level(const char* tag, esp_log_level_t* leve
     return false;
 }
 
-static inline bool should_output(esp_log_level_t level_for_message, esp_log_level_t level_for_tag)
+// Called with the mutex held, after any level change
+static void update_max_level()
 {
-    return level_for_message <= level_for_tag;
-}
-
-static void heap_bubble_down(int index)
-{
-    while (index < TAG_CACHE_SIZE / 2) {
-        int left_index = index * 2 + 1;
-        int right_index = left_index + 1;
-        int next = (s_log_cache[left_index].generation < s_log_cache[right_index].generation) ? left_index : right_index;
-        heap_swap(index, next);
-        index = next;
+    esp_log_level_t max_level = s_log_default_level;
+    for (int i = 0; i < TAG_HASH_BUCKETS; ++i) {
+        uncached_tag_entry_t *it;
+        SLIST_FOREACH( it, &s_log_tags[i], entries ) {
+            if (it->level > max_level) {
+                max_level = it->level;
+            }
+        }
     }
+    s_log_max_level = max_level;
 }
 
-static inline void heap_swap(int i, int j)
+static inline bool should_output(esp_log_level_t level_for_message, esp_log_level_t level_for_tag)
 {
-    cached_tag_entry_t tmp = s_log_cache[i];
-    s_log_cache[i] = s_log_cache[j];
-    s_log_cache[j] = tmp;
+    return level_for_message <= level_for_tag;
 }
 #endif //BOOTLOADER_BUILD
 
@@ -0,0 +1,207 @@
+#!/usr/bin/env python
+#
+# Decode the output of deferred logging in binary mode (CONFIG_LOG_DEFERRED_OUTPUT_BINARY).
+#
+# Log records are printed by the app as "#L" followed by the record bytes in hexadecimal.
+# A record holds the address of the format string and the raw values of the arguments,
+# format strings are read from the ELF file of the app. Other lines are printed unchanged.
+#
+# Usage:
+#   log_decode.py build/app.elf [log_file]
+#
+# The log is read from standard input when no file is given, e.g.:
+#   cat /dev/ttyUSB0 | log_decode.py build/app.elf
+#
+# Copyright 2015-2019 Espressif Systems (Shanghai) PTE LTD
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#     http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+from __future__ import print_function
+from __future__ import unicode_literals
+import argparse
+import binascii
+import io
+import re
+import struct
+import sys
+
+RECORD_PREFIX = "#L"
+RECORD_HEADER = struct.Struct("<HBBII")   # size, core, flags, timestamp, format address
+RECORD_TRUNCATED = 0x01
+
+SHF_ALLOC = 0x2
+SHT_NOBITS = 8
+
+# Same parsing rules as next_conversion() in log_deferred.c
+CONVERSION_RE = re.compile(r"%(?P<flags>[-+ #0]*)(?P<width>\*|\d*)(?:\.(?P<precision>\*|\d*))?"
+                           r"(?P<length>[hljztqL]*)(?P<conv>.?)", re.DOTALL)
+
+
+class ElfStrings(object):
+    """ Reads strings at given addresses from the allocated sections of an ELF32 file """
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self.data = f.read()
+        if self.data[:4] != b"\x7fELF" or self.data[4:5] != b"\x01":
+            raise ValueError("%s is not an ELF32 file" % path)
+        (e_shoff,) = struct.unpack_from("<I", self.data, 0x20)
+        e_shentsize, e_shnum = struct.unpack_from("<HH", self.data, 0x2E)
+        self.sections = []
+        for i in range(e_shnum):
+            (sh_name, sh_type, sh_flags, sh_addr, sh_offset,
+             sh_size) = struct.unpack_from("<IIIIII", self.data, e_shoff + i * e_shentsize)
+            if sh_flags & SHF_ALLOC and sh_type != SHT_NOBITS and sh_size > 0:
+                self.sections.append((sh_addr, sh_offset, sh_size))
+        self.cache = {}
+
+    def get(self, address):
+        if address not in self.cache:
+            self.cache[address] = self._read(address)
+        return self.cache[address]
+
+    def _read(self, address):
+        for (sh_addr, sh_offset, sh_size) in self.sections:
+            if sh_addr <= address < sh_addr + sh_size:
+                start = sh_offset + address - sh_addr
+                end = self.data.find(b"\0", start, sh_offset + sh_size)
+                if end < 0:
+                    end = sh_offset + sh_size
+                return self.data[start:end].decode("utf-8", "replace")
+        return None
+
+
+def arg_type(m):
+    """ Returns the type of the argument of a conversion, None if unsupported """
+    conv = m.group("conv")
+    length = m.group("length")
+    if conv in "diuoxXc" and conv != "":
+        return "int64" if length.count("l") >= 2 or "j" in length or "q" in length else "int"
+    if conv == "p":
+        return "int"
+    if conv in "fFeEgGaA" and conv != "":
+        return None if "L" in length else "double"
+    if conv == "s":
+        return "string"
+    return None
+
+
+def format_arg(m, stars, value):
+    """ Formats one argument the way the C library does """
+    flags = m.group("flags")
+    width = m.group("width")
+    precision = m.group("precision")
+    conv = m.group("conv")
+    if width == "*":
+        width = str(stars.pop(0))
+        if width.startswith("-"):
+            flags += "-"
+            width = width[1:]
+    if precision == "*":
+        precision = str(stars.pop(0))
+        if precision.startswith("-"):
+            precision = None
+    spec = "%" + flags + width + ("." + precision if precision is not None else "")
+    if conv in "di":
+        return (spec + "d") % value
+    if conv == "u":
+        return (spec + "d") % value
+    if conv == "c":
+        return (spec + "c") % chr(value & 0xFF)
+    if conv == "p":
+        return (spec + "s") % ("0x%x" % value)
+    if conv in "aA":
+        text = float.hex(value)
+        return (spec + "s") % (text.upper() if conv == "A" else text)
+    return (spec + conv) % value
+
+
+def decode_record(record, strings):
+    size, core, flags, timestamp, address = RECORD_HEADER.unpack_from(record)
+    fmt = strings.get(address)
+    if fmt is None:
+        return "log record from CPU %d at %d ms: format string 0x%08x not found in the ELF file\n" % (
+            core, timestamp, address)
+    args = record[RECORD_HEADER.size:size]
+    pos = 0
+    out = []
+    last = 0
+    for m in CONVERSION_RE.finditer(fmt):
+        out.append(fmt[last:m.start()])
+        last = m.start()
+        if m.group(0) == "%%":
+            out.append("%")
+            last = m.end()
+            continue
+        typ = arg_type(m)
+        if typ is None:
+            break
+        stars = []
+        try:
+            for _ in range(m.group(0).count("*")):
+                stars.append(struct.unpack_from("<i", args, pos)[0])
+                pos += 4
+            if typ == "int":
+                (value,) = struct.unpack_from("<I" if m.group("conv") in "uoxXp" else "<i", args, pos)
+                pos += 4
+            elif typ == "int64":
+                (value,) = struct.unpack_from("<Q" if m.group("conv") in "uoxX" else "<q", args, pos)
+                pos += 8
+            elif typ == "double":
+                (value,) = struct.unpack_from("<d", args, pos)
+                pos += 8
+            else:
+                length = bytearray(args[pos:pos + 1])[0]
+                value = args[pos + 1:pos + 1 + length].decode("utf-8", "replace")
+                pos += 1 + length
+        except (struct.error, IndexError):
+            break   # truncated record
+        out.append(format_arg(m, stars, value))
+        last = m.end()
+    # rest of the format, as is if arguments are missing
+    out.append(fmt[last:])
+    return "".join(out)
+
+
+def decode_line(line, strings):
+    stripped = line.rstrip("\r\n")
+    if not stripped.startswith(RECORD_PREFIX):
+        return line
+    try:
+        record = binascii.unhexlify(stripped[len(RECORD_PREFIX):])
+        if len(record) < RECORD_HEADER.size:
+            return line
+        return decode_record(record, strings)
+    except (TypeError, ValueError, binascii.Error):
+        return line
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode binary deferred log output of an ESP-IDF app")
+    parser.add_argument("elf", help="ELF file of the app")
+    parser.add_argument("log", nargs="?", help="Log to decode, standard input if not given")
+    args = parser.parse_args()
+
+    strings = ElfStrings(args.elf)
+    if args.log:
+        source = io.open(args.log, "r", encoding="utf-8", errors="replace", newline="")
+    else:
+        source = io.open(sys.stdin.fileno(), "r", encoding="utf-8", errors="replace", newline="")
+    with source:
+        for line in source:
+            sys.stdout.write(decode_line(line, strings))
+            sys.stdout.flush()
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,526 @@
+// Copyright 2015-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * Deferred logging.
+ *
+ * esp_log_write() doesn't format messages which passed the level check,
+ * it encodes them as a record: a header with the format string pointer and
+ * the timestamp, followed by the raw argument values. Format strings of
+ * ESP_LOGx are literals, so the pointer stays valid. String arguments may
+ * not, they are copied, up to the precision of the conversion and at most
+ * MAX_STRING_ARG characters.
+ *
+ * Each CPU core has its own ring buffer of records. The core writes its
+ * ring with interrupts disabled, the log task is the only reader, so no
+ * lock is needed between them. A record never wraps around the end of the
+ * ring: if it doesn't fit at the end, a record of size 0 is written there
+ * and the record goes at the start. When there is no room, the record is
+ * dropped and counted.
+ *
+ * The log task merges the records of both cores by timestamp, then either
+ * formats them (one snprintf per conversion, with the argument from the
+ * record) or prints them as hexadecimal, for log_decode.py.
+ *
+ * Arguments are encoded according to the conversions of the format:
+ * 4 bytes for integers, characters, pointers and '*' widths, 8 bytes for
+ * "ll" integers and doubles, a length byte followed by the characters for
+ * strings. Log_decode.py must follow the same rules.
+ */
+
+#include "sdkconfig.h"
+
+#if CONFIG_LOG_DEFERRED && !defined(BOOTLOADER_BUILD)
+
+#include <stdbool.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_err.h"
+#include "esp_log.h"
+#include "log_private.h"
+
+#define BUFFER_SIZE (CONFIG_LOG_DEFERRED_BUFFER_SIZE & ~3)
+#define MAX_RECORD_SIZE 192
+#define MAX_STRING_ARG 64
+#define MAX_LINE_LENGTH 256
+#define POLL_PERIOD_MS 10
+
+#define RECORD_TRUNCATED 0x01   // arguments were left out: no room in the record, or unsupported conversion
+
+#define PRECISION_NONE (-1)
+#define PRECISION_STAR (-2)     // precision is the last '*' argument
+
+typedef struct {
+    uint16_t size;          // size of the record including the header, multiple of 4. 0: skip to the start of the ring
+    uint8_t core;
+    uint8_t flags;
+    uint32_t timestamp;
+    const char* format;
+} record_header_t;
+
+typedef struct {
+    volatile size_t head;   // next record is written here, only changed by the core owning the ring
+    volatile size_t tail;   // next record is read from here, only changed by the log task
+    volatile uint32_t dropped;
+    uint32_t dropped_reported;
+    uint8_t data[BUFFER_SIZE] __attribute__((aligned(4)));
+} log_ring_t;
+
+typedef enum {
+    ARG_END,                // no more conversions
+    ARG_UNSUPPORTED,        // size of the argument isn't known ("%n", "%Lf", ...)
+    ARG_INT,
+    ARG_INT64,
+    ARG_DOUBLE,
+    ARG_STRING,
+} arg_type_t;
+
+static const char* TAG = "log";
+
+static log_ring_t s_log_rings[portNUM_PROCESSORS];
+static SemaphoreHandle_t s_reader_mutex = NULL;
+static TaskHandle_t s_log_task = NULL;
+
+/* Find the next conversion in 'format'. Returns a pointer to its '%', or to the end of the string.
+ * *end is set after the conversion, *stars to the number of '*' width or precision arguments it takes,
+ * *precision to the precision given in the format (values above MAX_STRING_ARG are not kept exactly),
+ * PRECISION_STAR or PRECISION_NONE.
+ */
+static const char* next_conversion(const char* format, const char** end, arg_type_t* type, int* stars, int* precision)
+{
+    const char* p = format;
+
+    while ((p = strchr(p, '%')) != NULL) {
+        if (p[1] == '%') {
+            p += 2;
+            continue;
+        }
+        const char* s = p + 1;
+        int longs = 0;
+        bool wide = false;
+        *stars = 0;
+        *precision = PRECISION_NONE;
+        while (*s != '\0' && strchr("-+ #0", *s) != NULL) {
+            ++s;
+        }
+        for (int i = 0; i < 2; ++i) {   // width, then precision
+            int value = PRECISION_STAR;
+            if (*s == '*') {
+                ++*stars;
+                ++s;
+            } else {
+                value = 0;
+                while (isdigit((unsigned char) *s)) {
+                    if (value <= MAX_STRING_ARG) {
+                        value = value * 10 + (*s - '0');
+                    }
+                    ++s;
+                }
+            }
+            if (i == 1) {
+                *precision = value;
+            }
+            if (i == 0 && *s == '.') {
+                ++s;
+            } else {
+                break;
+            }
+        }
+        while (*s != '\0' && strchr("hljztqL", *s) != NULL) {
+            if (*s == 'l') {
+                ++longs;
+            } else if (*s == 'j' || *s == 'q') {
+                longs = 2;
+            } else if (*s == 'L') {
+                wide = true;
+            }
+            ++s;
+        }
+        *end = (*s != '\0') ? s + 1 : s;
+        switch (*s) {
+        case 'd': case 'i': case 'u': case 'o': case 'x': case 'X': case 'c':
+            *type = (longs >= 2) ? ARG_INT64 : ARG_INT;
+            break;
+        case 'p':
+            *type = ARG_INT;
+            break;
+        case 'f': case 'F': case 'e': case 'E': case 'g': case 'G': case 'a': case 'A':
+            *type = wide ? ARG_UNSUPPORTED : ARG_DOUBLE;
+            break;
+        case 's':
+            *type = ARG_STRING;
+            break;
+        default:
+            *type = ARG_UNSUPPORTED;
+            break;
+        }
+        return p;
+    }
+    *end = format + strlen(format);
+    *type = ARG_END;
+    return *end;
+}
+
+/* Encode a message as a record in 'rec', which has room for MAX_RECORD_SIZE bytes. Returns the size of the record. */
+static size_t encode_record(uint8_t* rec, const char* format, va_list args)
+{
+    record_header_t* hdr = (record_header_t*) rec;
+    uint8_t* p = rec + sizeof(record_header_t);
+    uint8_t* rec_end = rec + MAX_RECORD_SIZE;
+    const char* f = format;
+
+    hdr->flags = 0;
+    hdr->timestamp = esp_log_timestamp();
+    hdr->format = format;
+    for (;;) {
+        const char* end;
+        arg_type_t type;
+        int stars;
+        int precision;
+        int star = 0;
+        next_conversion(f, &end, &type, &stars, &precision);
+        f = end;
+        if (type == ARG_END) {
+            break;
+        }
+        if (type == ARG_UNSUPPORTED || rec_end - p < 4 * stars + 8) {
+            hdr->flags |= RECORD_TRUNCATED;
+            break;
+        }
+        for (int i = 0; i < stars; ++i) {
+            star = va_arg(args, int);
+            memcpy(p, &star, 4);
+            p += 4;
+        }
+        if (type == ARG_INT) {
+            uint32_t value = va_arg(args, unsigned int);
+            memcpy(p, &value, 4);
+            p += 4;
+        } else if (type == ARG_INT64) {
+            uint64_t value = va_arg(args, unsigned long long);
+            memcpy(p, &value, 8);
+            p += 8;
+        } else if (type == ARG_DOUBLE) {
+            double value = va_arg(args, double);
+            memcpy(p, &value, 8);
+            p += 8;
+        } else {
+            const char* str = va_arg(args, const char*);
+            if (str == NULL) {
+                str = "(null)";
+            }
+            // the string may not be terminated within the precision, e.g. "%.*s"
+            if (precision == PRECISION_STAR) {
+                precision = (star >= 0) ? star : PRECISION_NONE;
+            }
+            size_t max_len = MAX_STRING_ARG;
+            if (precision >= 0 && precision < MAX_STRING_ARG) {
+                max_len = precision;
+            }
+            size_t len = strnlen(str, max_len);
+            if (len > (size_t) (rec_end - p - 1)) {
+                len = rec_end - p - 1;
+            }
+            *p++ = len;
+            memcpy(p, str, len);
+            p += len;
+        }
+    }
+    hdr->size = (p - rec + 3) & ~3;
+    return hdr->size;
+}
+
+/* Copy a record into the ring. Called by the core owning the ring, with interrupts disabled. */
+static bool ring_write(log_ring_t* ring, const uint8_t* rec, size_t size)
+{
+    size_t head = ring->head;
+    size_t tail = ring->tail;
+    size_t pos = head;
+
+    if (head >= tail) {
+        if (BUFFER_SIZE - head < size || (BUFFER_SIZE - head == size && tail == 0)) {
+            // no room at the end of the ring, the record goes at the start
+            if (size >= tail) {
+                return false;
+            }
+            ((record_header_t*) &ring->data[head])->size = 0;
+            pos = 0;
+        }
+    } else if (tail - head <= size) {
+        return false;
+    }
+    memcpy(&ring->data[pos], rec, size);
+    __sync_synchronize();   // record is complete before the reader sees it
+    ring->head = (pos + size == BUFFER_SIZE) ? 0 : pos + size;
+    return true;
+}
+
+/* Return the next record of the ring, or NULL if it is empty. Called by the reader. */
+static const record_header_t* ring_peek(log_ring_t* ring)
+{
+    if (ring->tail == ring->head) {
+        return NULL;
+    }
+    __sync_synchronize();
+    const record_header_t* hdr = (const record_header_t*) &ring->data[ring->tail];
+    if (hdr->size == 0) {
+        ring->tail = 0;
+        if (ring->head == 0) {
+            return NULL;
+        }
+        hdr = (const record_header_t*) &ring->data[0];
+    }
+    return hdr;
+}
+
+static void ring_consume(log_ring_t* ring, const record_header_t* hdr)
+{
+    size_t tail = (const uint8_t*) hdr - ring->data + hdr->size;
+    __sync_synchronize();   // record is read before the writer may reuse its space
+    ring->tail = (tail == BUFFER_SIZE) ? 0 : tail;
+}
+
+bool esp_log_deferred_write(const char* format, va_list args)
+{
+    uint32_t rec[MAX_RECORD_SIZE / 4];
+
+    if (xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED) {
+        return false;
+    }
+    size_t size = encode_record((uint8_t*) rec, format, args);
+
+    unsigned state = portENTER_CRITICAL_NESTED();
+    int core = xPortGetCoreID();
+    log_ring_t* ring = &s_log_rings[core];
+    ((record_header_t*) rec)->core = core;
+    if (!ring_write(ring, (const uint8_t*) rec, size)) {
+        ring->dropped++;
+    }
+    portEXIT_CRITICAL_NESTED(state);
+    return true;
+}
+
+#if !CONFIG_LOG_DEFERRED_OUTPUT_BINARY
+
+/* Copy format text up to 'text_end' into the line, replacing "%%" by "%". Returns the new length of the line. */
+static size_t append_text(char* line, size_t len, const char* text, const char* text_end)
+{
+    while (text < text_end && len < MAX_LINE_LENGTH - 1) {
+        if (text[0] == '%' && text + 1 < text_end && text[1] == '%') {
+            ++text;
+        }
+        line[len++] = *text++;
+    }
+    line[len] = '\0';
+    return len;
+}
+
+#define FORMAT_ARG(buf, size, spec, stars, star, value) \
+    ((stars) == 0 ? snprintf(buf, size, spec, value) : \
+     (stars) == 1 ? snprintf(buf, size, spec, star[0], value) : \
+                    snprintf(buf, size, spec, star[0], star[1], value))
+
+/* Format a record as printf would have done. Returns the length of the line. */
+static size_t format_record(const record_header_t* hdr, char* line)
+{
+    const uint8_t* p = (const uint8_t*) (hdr + 1);
+    const uint8_t* rec_end = (const uint8_t*) hdr + hdr->size;
+    const char* f = hdr->format;
+    size_t len = 0;
+
+    line[0] = '\0';
+    for (;;) {
+        const char* end;
+        arg_type_t type;
+        int stars;
+        int precision;
+        const char* conv = next_conversion(f, &end, &type, &stars, &precision);
+        len = append_text(line, len, f, conv);
+        f = conv;
+        if (type == ARG_END || type == ARG_UNSUPPORTED || end - conv >= 16) {
+            break;
+        }
+        size_t arg_size = (type == ARG_INT) ? 4 : (type == ARG_STRING) ? 1 : 8;
+        if (rec_end - p < 4 * stars + arg_size
+                || (type == ARG_STRING && rec_end - p < 1 + p[4 * stars])) {
+            break;  // truncated record
+        }
+
+        char spec[16];
+        int star[2];
+        memcpy(spec, conv, end - conv);
+        spec[end - conv] = '\0';
+        for (int i = 0; i < stars; ++i) {
+            memcpy(&star[i], p, 4);
+            p += 4;
+        }
+        size_t room = MAX_LINE_LENGTH - len;
+        int n;
+        if (type == ARG_INT) {
+            uint32_t value;
+            memcpy(&value, p, 4);
+            p += 4;
+            if (end[-1] == 'p') {
+                n = FORMAT_ARG(line + len, room, spec, stars, star, (void*) (uintptr_t) value);
+            } else {
+                n = FORMAT_ARG(line + len, room, spec, stars, star, value);
+            }
+        } else if (type == ARG_INT64) {
+            uint64_t value;
+            memcpy(&value, p, 8);
+            p += 8;
+            n = FORMAT_ARG(line + len, room, spec, stars, star, value);
+        } else if (type == ARG_DOUBLE) {
+            double value;
+            memcpy(&value, p, 8);
+            p += 8;
+            n = FORMAT_ARG(line + len, room, spec, stars, star, value);
+        } else {
+            char str[MAX_STRING_ARG + 1];
+            size_t str_len = *p++;
+            memcpy(str, p, str_len);
+            str[str_len] = '\0';
+            p += str_len;
+            n = FORMAT_ARG(line + len, room, spec, stars, star, str);
+        }
+        if (n < 0) {
+            break;
+        }
+        len += (n < room) ? n : room - 1;
+        f = end;
+    }
+    if (*f != '\0' || (hdr->flags & RECORD_TRUNCATED)) {
+        // arguments are missing, print the rest of the format as is
+        while (*f != '\0' && len < MAX_LINE_LENGTH - 1) {
+            line[len++] = *f++;
+        }
+        line[len] = '\0';
+    }
+    if (len == MAX_LINE_LENGTH - 1) {
+        line[len - 1] = '\n';  // line truncated
+    }
+    return len;
+}
+
+static void print_record(const record_header_t* hdr)
+{
+    static char line[MAX_LINE_LENGTH];
+    format_record(hdr, line);
+    esp_log_print("%s", line);
+}
+
+#else // CONFIG_LOG_DEFERRED_OUTPUT_BINARY
+
+/* Print the record as "#L" followed by its bytes in hexadecimal, text lines go through any UART translation unharmed */
+static void print_record(const record_header_t* hdr)
+{
+    static const char hex[] = "0123456789abcdef";
+    static char line[2 + 2 * MAX_RECORD_SIZE + 2];
+    const uint8_t* rec = (const uint8_t*) hdr;
+    size_t len = 0;
+
+    line[len++] = '#';
+    line[len++] = 'L';
+    for (size_t i = 0; i < hdr->size; ++i) {
+        line[len++] = hex[rec[i] >> 4];
+        line[len++] = hex[rec[i] & 0xf];
+    }
+    line[len++] = '\n';
+    line[len] = '\0';
+    esp_log_print("%s", line);
+}
+
+#endif // CONFIG_LOG_DEFERRED_OUTPUT_BINARY
+
+/* Print all records in the rings, oldest first. Called with s_reader_mutex held. */
+static void print_records(void)
+{
+    for (;;) {
+        const record_header_t* oldest = NULL;
+        log_ring_t* oldest_ring = NULL;
+
+        for (int i = 0; i < portNUM_PROCESSORS; ++i) {
+            log_ring_t* ring = &s_log_rings[i];
+            uint32_t dropped = ring->dropped;
+            if (dropped != ring->dropped_reported) {
+                esp_log_print(LOG_FORMAT(W, "%u messages dropped on CPU %d"), esp_log_timestamp(), TAG,
+                              dropped - ring->dropped_reported, i);
+                ring->dropped_reported = dropped;
+            }
+            const record_header_t* hdr = ring_peek(ring);
+            // compare the difference, timestamps wrap around
+            if (hdr != NULL && (oldest == NULL || (int32_t) (hdr->timestamp - oldest->timestamp) < 0)) {
+                oldest = hdr;
+                oldest_ring = ring;
+            }
+        }
+        if (oldest == NULL) {
+            break;
+        }
+        print_record(oldest);
+        ring_consume(oldest_ring, oldest);
+    }
+}
+
+void esp_log_deferred_flush(void)
+{
+    if (s_reader_mutex == NULL) {
+        return;
+    }
+    xSemaphoreTake(s_reader_mutex, portMAX_DELAY);
+    print_records();
+    xSemaphoreGive(s_reader_mutex);
+}
+
+uint32_t esp_log_deferred_get_dropped(void)
+{
+    uint32_t dropped = 0;
+    for (int i = 0; i < portNUM_PROCESSORS; ++i) {
+        dropped += s_log_rings[i].dropped;
+    }
+    return dropped;
+}
+
+static void log_task(void* arg)
+{
+    for (;;) {
+        esp_log_deferred_flush();
+        vTaskDelay(POLL_PERIOD_MS / portTICK_PERIOD_MS ? POLL_PERIOD_MS / portTICK_PERIOD_MS : 1);
+    }
+}
+
+esp_err_t esp_log_deferred_init(void)
+{
+    if (s_log_task != NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_reader_mutex = xSemaphoreCreateMutex();
+    if (s_reader_mutex == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreate(log_task, "log", CONFIG_LOG_DEFERRED_TASK_STACK_SIZE, NULL,
+                    CONFIG_LOG_DEFERRED_TASK_PRIORITY, &s_log_task) != pdPASS) {
+        vSemaphoreDelete(s_reader_mutex);
+        s_reader_mutex = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+#endif // CONFIG_LOG_DEFERRED && !BOOTLOADER_BUILD
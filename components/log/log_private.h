@@ -0,0 +1,25 @@
+// Copyright 2015-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+#pragma once
+
+#include <stdarg.h>
+#include <stdbool.h>
+
+/* Print with the function set by esp_log_set_vprintf(), without any level check. Defined in log.c. */
+void esp_log_print(const char* format, ...) __attribute__ ((format (printf, 1, 2)));
+
+/* Queue a message which passed the level check, to be printed by the log task. Defined in log_deferred.c.
+
+   Returns false if the message can't be deferred (the scheduler isn't running yet), the caller prints it then. */
+bool esp_log_deferred_write(const char* format, va_list args);
@@ -0,0 +1,14 @@
+/* Host replacement of FreeRTOS, only what log_deferred.c uses. The test
+ * runs on one core with the scheduler running, the log task is not run. */
+#pragma once
+
+#include <stdint.h>
+
+#define pdPASS                              1
+#define portMAX_DELAY                       0xFFFFFFFF
+#define portTICK_PERIOD_MS                  10
+#define portNUM_PROCESSORS                  2
+
+#define portENTER_CRITICAL_NESTED()         0
+#define portEXIT_CRITICAL_NESTED(state)     ((void) (state))
+#define xPortGetCoreID()                    0
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+typedef void* SemaphoreHandle_t;
+
+static inline SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    return (SemaphoreHandle_t) 1;
+}
+
+static inline int xSemaphoreTake(SemaphoreHandle_t sem, uint32_t ticks)
+{
+    return pdPASS;
+}
+
+static inline int xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    return pdPASS;
+}
+
+static inline void vSemaphoreDelete(SemaphoreHandle_t sem)
+{
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+
+typedef void* TaskHandle_t;
+
+#define taskSCHEDULER_NOT_STARTED           1
+#define taskSCHEDULER_RUNNING               2
+
+#define xTaskGetSchedulerState()            taskSCHEDULER_RUNNING
+#define xTaskCreate(fn, name, stack, arg, prio, handle)     ((void) (fn), *(handle) = (TaskHandle_t) 1, pdPASS)
+#define vTaskDelay(ticks)
@@ -0,0 +1,9 @@
+#pragma once
+
+#define CONFIG_LOG_DEFAULT_LEVEL 3
+#define CONFIG_LOG_MAXIMUM_LEVEL 3
+#define CONFIG_LOG_DEFERRED 1
+#define CONFIG_LOG_DEFERRED_OUTPUT_BINARY 1
+#define CONFIG_LOG_DEFERRED_BUFFER_SIZE 4096
+#define CONFIG_LOG_DEFERRED_TASK_PRIORITY 1
+#define CONFIG_LOG_DEFERRED_TASK_STACK_SIZE 2048
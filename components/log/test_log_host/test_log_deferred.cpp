@@ -0,0 +1,135 @@
+#include "catch.hpp"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "esp_log.h"
+#include "log_private.h"
+}
+
+static std::string s_output;
+static std::string s_expected;
+static std::vector<size_t> s_sizes;
+
+extern "C" void esp_log_print(const char* format, ...)
+{
+    char line[1024];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    s_output += line;
+}
+
+extern "C" uint32_t esp_log_timestamp(void)
+{
+    static uint32_t s_timestamp;
+    return ++s_timestamp;
+}
+
+/* Defer a message, and format it with vsnprintf as the reference */
+static void log_deferred(const char* format, ...)
+{
+    char line[1024];
+    va_list args;
+    va_start(args, format);
+    REQUIRE(esp_log_deferred_write(format, args));
+    va_end(args);
+    va_start(args, format);
+    vsnprintf(line, sizeof(line), format, args);
+    va_end(args);
+    s_expected += line;
+}
+
+/* Print the deferred records as hexadecimal lines and decode them with log_decode.py */
+static std::string flush_and_decode(void)
+{
+    s_output.clear();
+    esp_log_deferred_flush();
+
+    // size of each record, from its first two bytes
+    s_sizes.clear();
+    for (size_t pos = 0; (pos = s_output.find("#L", pos)) != std::string::npos; pos += 2) {
+        unsigned lo, hi;
+        REQUIRE(sscanf(s_output.c_str() + pos + 2, "%2x%2x", &lo, &hi) == 2);
+        s_sizes.push_back(lo | (hi << 8));
+    }
+
+    char log_path[] = "/tmp/test_log_XXXXXX";
+    int fd = mkstemp(log_path);
+    REQUIRE(fd >= 0);
+    REQUIRE(write(fd, s_output.data(), s_output.size()) == (ssize_t) s_output.size());
+    close(fd);
+
+    char elf_path[256];
+    ssize_t len = readlink("/proc/self/exe", elf_path, sizeof(elf_path) - 1);
+    REQUIRE(len > 0);
+    elf_path[len] = '\0';
+
+    std::string cmd = std::string(PYTHON) + " " + LOG_DECODE + " " + elf_path + " " + log_path;
+    FILE* decoder = popen(cmd.c_str(), "r");
+    REQUIRE(decoder != NULL);
+    std::string decoded;
+    char buf[256];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), decoder)) > 0) {
+        decoded.append(buf, n);
+    }
+    REQUIRE(pclose(decoder) == 0);
+    unlink(log_path);
+    return decoded;
+}
+
+/* Size of a record with the given size of the arguments */
+static size_t record_size(size_t args_size)
+{
+    return (8 + sizeof(const char*) + args_size + 3) & ~3;
+}
+
+TEST_CASE("deferred records decode as vsnprintf formats them", "[log]")
+{
+    static bool s_init;
+    if (!s_init) {
+        REQUIRE(esp_log_deferred_init() == ESP_OK);
+        s_init = true;
+    }
+    s_expected.clear();
+
+    log_deferred("plain text, 100%% literal\n");
+    log_deferred("int %d %i %u %x %X %o %c\n", -42, 17, 3000000000u, 0xbeef, 0xCAFE, 8, 'z');
+    log_deferred("width [%5d] [%-5d] [%05d] [%+d] [% d] [%#x]\n", 42, 42, 42, 42, 42, 255);
+    log_deferred("star [%*d] [%-*d] [%*d] [%.*d]\n", 6, 1, 6, 2, -6, 3, 4, 5);
+    log_deferred("long long %lld %llu %llx\n", -1234567890123LL, 18446744073709551615ULL, 0x123456789abcULL);
+    log_deferred("double %f %.2f %e %g %10.3f\n", 3.25, -1.005, 12345.678, 0.0001, 2.5);
+    log_deferred("string [%s] [%10s] [%-10s] [%.3s] [%.0s] [%*s]\n", "abc", "right", "left", "truncated", "gone", 8, "star");
+    log_deferred("precision star [%.*s] [%*.*s] [%.*s]\n", 2, "abcdef", 6, 3, "abcdef", -1, "negative");
+
+    REQUIRE(flush_and_decode() == s_expected);
+}
+
+TEST_CASE("deferred string arguments are read up to the precision", "[log]")
+{
+    // Slices of a buffer without a terminator within the precision, as
+    // logged by the HTTP server for the parsed request fields
+    static const char buffer[] = "GET /index.html HTTP/1.1 and more text following the slices";
+    s_expected.clear();
+
+    log_deferred("%.*s\n", 3, buffer);
+    log_deferred("%.*s\n", 11, buffer + 4);
+    log_deferred("%.8s\n", buffer + 16);
+    log_deferred("[%10.*s]\n", 4, buffer);
+    log_deferred("%.*s\n", 0, buffer);
+    log_deferred("%.*s\n", -1, "terminated");
+
+    REQUIRE(flush_and_decode() == s_expected);
+    REQUIRE(s_sizes.size() == 6);
+    CHECK(s_sizes[0] == record_size(4 + 1 + 3));
+    CHECK(s_sizes[1] == record_size(4 + 1 + 11));
+    CHECK(s_sizes[2] == record_size(1 + 8));
+    CHECK(s_sizes[3] == record_size(4 + 1 + 4));
+    CHECK(s_sizes[4] == record_size(4 + 1));
+    CHECK(s_sizes[5] == record_size(4 + 1 + 10));
+}
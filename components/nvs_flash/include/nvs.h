@@ -65,6 +65,38 @@ typedef enum {
 	NVS_READWRITE  /*!< Read and write */
 } nvs_open_mode;
 
+/**
+ * @brief Types of variables
+ *
+ */
+typedef enum {
+    NVS_TYPE_U8    = 0x01,  /*!< Type uint8_t */
+    NVS_TYPE_I8    = 0x11,  /*!< Type int8_t */
+    NVS_TYPE_U16   = 0x02,  /*!< Type uint16_t */
+    NVS_TYPE_I16   = 0x12,  /*!< Type int16_t */
+    NVS_TYPE_U32   = 0x04,  /*!< Type uint32_t */
+    NVS_TYPE_I32   = 0x14,  /*!< Type int32_t */
+    NVS_TYPE_U64   = 0x08,  /*!< Type uint64_t */
+    NVS_TYPE_I64   = 0x18,  /*!< Type int64_t */
+    NVS_TYPE_STR   = 0x21,  /*!< Type string */
+    NVS_TYPE_BLOB  = 0x42,  /*!< Type blob */
+    NVS_TYPE_ANY   = 0xff   /*!< Must be last */
+} nvs_type_t;
+
+/**
+ * @brief information about entry obtained from nvs_entry_info function
+ */
+typedef struct {
+    char namespace_name[16];    /*!< Namespace to which key-value belong */
+    char key[16];               /*!< Key of stored key-value pair */
+    nvs_type_t type;            /*!< Type of stored key-value pair */
+} nvs_entry_info_t;
+
+/**
+ * Opaque pointer type representing iterator to nvs entries
+ */
+typedef struct nvs_opaque_iterator_t *nvs_iterator_t;
+
 /**
  * @brief      Open non-volatile storage with a given namespace from the default NVS partition
  *
@@ -344,16 +376,110 @@ esp_err_t nvs_erase_all(nvs_handle handle);
  * to non-volatile storage. Individual implementations may write to storage at other times,
  * but this is not guaranteed.
  *
+ * If a batch was started with nvs_batch_begin(), the values set since then are
+ * written and become visible all at once. The batch is closed, even if it
+ * couldn't be written.
+ *
  * @param[in]  handle  Storage handle obtained with nvs_open.
  *                     Handles that were opened read only cannot be used.
  *
  * @return
  *             - ESP_OK if the changes have been written successfully
  *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_NVS_NOT_ENOUGH_SPACE if there is not enough space in the
+ *               underlying storage to save the batch
  *             - other error codes from the underlying storage driver
  */
 esp_err_t nvs_commit(nvs_handle handle);
 
+/**
+ * @brief      Start a batch of values to be written together
+ *
+ * Until nvs_commit() is called, nvs_set_* functions called with this handle only
+ * record the values, and nvs_get_* functions still return the stored values.
+ * nvs_commit() then writes all of them into consecutive entries of one page,
+ * so that either all or none of them are stored if power is lost.
+ * Integer and string values can be part of a batch, nvs_set_blob and
+ * nvs_erase_key return ESP_ERR_NOT_SUPPORTED while a batch is open.
+ * The total size of a batch is limited to one page, i.e. 126 entries of
+ * 32 bytes, an integer value takes one entry and a string one entry more
+ * than its length rounded up to 32 bytes.
+ *
+ * @param[in]  handle  Storage handle obtained with nvs_open.
+ *                     Handles that were opened read only cannot be used.
+ *
+ * @return
+ *             - ESP_OK if the batch was started
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_NVS_READ_ONLY if storage handle was opened as read only
+ *             - ESP_ERR_INVALID_STATE if a batch has already been started
+ *             - ESP_ERR_NO_MEM if memory for the batch couldn't be allocated
+ */
+esp_err_t nvs_batch_begin(nvs_handle handle);
+
+/**
+ * @brief      Drop the values of a batch started with nvs_batch_begin()
+ *
+ * @param[in]  handle  Storage handle obtained with nvs_open.
+ */
+void nvs_batch_abort(nvs_handle handle);
+
+/**
+ * @brief      Keep values set for a key in RAM until they are flushed
+ *
+ * With write-back enabled, integer values set for the key (or for any key of
+ * the namespace if key is NULL) update a RAM cache shared by all handles of
+ * the partition. Reads return the cached values. Setting a value several times
+ * between two flushes writes it to flash only once, which suits counters and
+ * statistics updated often.
+ *
+ * Cached values are written when:
+ *   - nvs_commit() is called on any handle of the partition, which guarantees
+ *     that they are stored when it returns ESP_OK
+ *   - nvs_flush_write_back() is called, e.g. before entering deep sleep
+ *   - the cache is full, it holds at most CONFIG_NVS_WRITE_BACK_ENTRIES values
+ *   - every CONFIG_NVS_WRITE_BACK_FLUSH_INTERVAL milliseconds, if not 0
+ *   - esp_restart() is called
+ *
+ * Values not flushed yet are lost on power failure or reset. Values of each
+ * namespace are flushed together, so that either all or none of them are
+ * stored. Strings and blobs are never cached.
+ *
+ * @param[in]  handle  Storage handle obtained with nvs_open.
+ *                     Handles that were opened read only cannot be used.
+ * @param[in]  key     Key name, or NULL for all keys of the namespace
+ *
+ * @return
+ *             - ESP_OK if write-back was enabled
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - ESP_ERR_NVS_READ_ONLY if storage handle was opened as read only
+ *             - ESP_ERR_NVS_KEY_TOO_LONG if the key name is too long
+ *             - ESP_ERR_NO_MEM if memory for the cache couldn't be allocated
+ */
+esp_err_t nvs_enable_write_back(nvs_handle handle, const char* key);
+
+/**
+ * @brief      Flush cached values and write values of the key directly again
+ *
+ * @param[in]  handle  Storage handle obtained with nvs_open.
+ * @param[in]  key     Key name, or NULL to disable all keys of the namespace
+ *
+ * @return
+ *             - ESP_OK if write-back was disabled
+ *             - ESP_ERR_NVS_INVALID_HANDLE if handle has been closed or is NULL
+ *             - other error codes from the underlying storage driver
+ */
+esp_err_t nvs_disable_write_back(nvs_handle handle, const char* key);
+
+/**
+ * @brief      Write the cached values of all partitions to flash
+ *
+ * @return
+ *             - ESP_OK if all cached values have been written
+ *             - other error codes from the underlying storage driver
+ */
+esp_err_t nvs_flush_write_back(void);
+
 /**
  * @brief      Close the storage handle and free any allocated resources
  *
@@ -377,6 +503,30 @@ typedef struct {
     size_t namespace_count;   /**< Amount name space. */
 } nvs_stats_t;
 
+/**
+ * @note Info about the write-back cache of a partition.
+ */
+typedef struct {
+    size_t dirty_entries;       /**< Values held in RAM, which would be lost on power failure. */
+    size_t max_dirty_entries;   /**< Values which may be held before the cache is flushed. */
+    size_t set_count;           /**< Values set in the cache. */
+    size_t flushed_count;       /**< Values written to flash by flushes. */
+} nvs_write_back_stats_t;
+
+/**
+ * @brief      Get the state of the write-back cache of a partition
+ *
+ * @param[in]   part_name   Partition name NVS in the partition table.
+ *                          If pass a NULL than will use NVS_DEFAULT_PART_NAME ("nvs").
+ * @param[out]  stats       Returns filled structure nvs_write_back_stats_t.
+ *
+ * @return
+ *             - ESP_OK if stats have been filled
+ *             - ESP_ERR_NVS_NOT_INITIALIZED if the storage driver is not initialized
+ *             - ESP_ERR_INVALID_ARG if stats equal to NULL
+ */
+esp_err_t nvs_get_write_back_stats(const char* part_name, nvs_write_back_stats_t* stats);
+
 /**
  * @brief      Fill structure nvs_stats_t. It provides info about used memory the partition.
  *
@@ -450,6 +600,75 @@ esp_err_t nvs_get_stats(const char* part_name, nvs_stats_t* nvs_stats);
  */
 esp_err_t nvs_get_used_entry_count(nvs_handle handle, size_t* used_entries);
 
+/**
+ * @brief       Create an iterator to enumerate NVS entries based on one or more parameters
+ *
+ * Entries are found by walking the entry state tables of the pages and reading
+ * the headers of written entries, values are not read. The iterator takes a
+ * fixed amount of memory, whatever the number of entries.
+ *
+ * \code{c}
+ * // Example of listing all the key-value pairs of any type under specified partition and namespace
+ * nvs_iterator_t it = nvs_entry_find(partition, namespace, NVS_TYPE_ANY);
+ * while (it != NULL) {
+ *         nvs_entry_info_t info;
+ *         nvs_entry_info(it, &info);
+ *         it = nvs_entry_next(it);
+ *         printf("key '%s', type '%d' \n", info.key, info.type);
+ * }
+ * // Note: no need to release iterator obtained from nvs_entry_find function when
+ * //       nvs_entry_find or nvs_entry_next function return NULL, indicating no other
+ * //       element for specified criteria was found.
+ * \endcode
+ *
+ * Values held by the write-back cache (see nvs_enable_write_back()) are
+ * enumerated as well. Setting or erasing values of the partition while an
+ * iterator exists invalidates it, the iterator then has to be released.
+ *
+ * @param[in]   part_name       Partition name. If NULL, NVS_DEFAULT_PART_NAME ("nvs") is used.
+ *
+ * @param[in]   namespace_name  Set this value if looking for entries with
+ *                              a specific namespace. Pass NULL otherwise.
+ *
+ * @param[in]   type            One of nvs_type_t values.
+ *
+ * @return
+ *          Iterator used to enumerate all the entries found,
+ *          or NULL if no entry satisfying criteria was found.
+ *          Iterator obtained through this function has to be released
+ *          using nvs_release_iterator when not used any more.
+ */
+nvs_iterator_t nvs_entry_find(const char *part_name, const char *namespace_name, nvs_type_t type);
+
+/**
+ * @brief       Returns next item matching the iterator criteria, NULL if no such item exists.
+ *
+ * Note that any copies of the iterator will be invalid after this call.
+ *
+ * @param[in]   iterator     Iterator obtained from nvs_entry_find function. Must be non-NULL.
+ *
+ * @return
+ *          NULL if no entry was found, valid nvs_iterator_t otherwise.
+ */
+nvs_iterator_t nvs_entry_next(nvs_iterator_t iterator);
+
+/**
+ * @brief       Fills nvs_entry_info_t structure with information about entry pointed to by the iterator.
+ *
+ * @param[in]   iterator     Iterator obtained from nvs_entry_find or nvs_entry_next function. Must be non-NULL.
+ *
+ * @param[out]  out_info     Structure to which entry information is copied.
+ */
+void nvs_entry_info(nvs_iterator_t iterator, nvs_entry_info_t *out_info);
+
+/**
+ * @brief       Release iterator
+ *
+ * @param[in]   iterator    Release iterator obtained from nvs_entry_find function. NULL argument is allowed.
+ *
+ */
+void nvs_release_iterator(nvs_iterator_t iterator);
+
 #ifdef __cplusplus
 } // extern "C"
 #endif
@@ -28,6 +28,8 @@
 // Uncomment this line to force output from this module
 // #define LOG_LOCAL_LEVEL ESP_LOG_DEBUG
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_system.h"
 static const char* TAG = "nvs";
 #else
 #include "crc.h"
@@ -59,6 +61,7 @@ public:
     uint8_t mReadOnly;
     uint8_t mNsIndex;
     nvs::Storage* mStoragePtr;
+    nvs::WriteBatch* mBatch = nullptr;
 };
 
 #ifdef ESP_PLATFORM
@@ -68,6 +71,12 @@ SemaphoreHandle_t nvs::Lock::mSemaphore = NULL;
 using namespace std;
 using namespace nvs;
 
+#ifdef CONFIG_NVS_WRITE_BACK_ENTRIES
+static const size_t s_write_back_entries = CONFIG_NVS_WRITE_BACK_ENTRIES;
+#else
+static const size_t s_write_back_entries = 16;
+#endif
+
 static intrusive_list<HandleEntry> s_nvs_handles;
 uint32_t HandleEntry::s_nvs_next_handle;
 static intrusive_list<nvs::Storage> s_nvs_storage_list;
@@ -109,7 +118,12 @@ extern "C" esp_err_t nvs_flash_init_custom(const char *partName, uint32_t baseSe
         storage = new_storage;
     }
 
-    esp_err_t err = storage->init(baseSector, sectorCount);
+#ifdef CONFIG_NVS_FAST_MOUNT
+    const bool fastMount = true;
+#else
+    const bool fastMount = false;
+#endif
+    esp_err_t err = storage->init(baseSector, sectorCount, fastMount);
     if (new_storage != NULL) {
         if (err == ESP_OK) {
             s_nvs_storage_list.push_back(new_storage);
@@ -220,6 +234,8 @@ extern "C" esp_err_t nvs_flash_deinit_partition(const char* partition_name)
         return ESP_ERR_NVS_NOT_INITIALIZED;
     }
 
+    storage->flushWriteBack();
+
 #ifdef CONFIG_NVS_ENCRYPTION
     if(EncrMgr::isEncrActive()) {
         auto encrMgr = EncrMgr::getInstance();
@@ -236,6 +252,7 @@ extern "C" esp_err_t nvs_flash_deinit_partition(const char* partition_name)
             ESP_LOGD(TAG, "Deleting handle %d (ns=%d) related to partition \"%s\" (missing call to nvs_close?)",
                      it->mHandle, it->mNsIndex, partition_name);
             s_nvs_handles.erase(it);
+            delete it->mBatch;
             delete static_cast<HandleEntry*>(it);
         }
         it = next;
@@ -253,15 +270,24 @@ extern "C" esp_err_t nvs_flash_deinit(void)
     return nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME);
 }
 
-static esp_err_t nvs_find_ns_handle(nvs_handle handle, HandleEntry& entry)
+static HandleEntry* nvs_find_handle_entry(nvs_handle handle)
 {
     auto it = find_if(begin(s_nvs_handles), end(s_nvs_handles), [=](HandleEntry& e) -> bool {
         return e.mHandle == handle;
     });
     if (it == end(s_nvs_handles)) {
+        return NULL;
+    }
+    return it;
+}
+
+static esp_err_t nvs_find_ns_handle(nvs_handle handle, HandleEntry& entry)
+{
+    HandleEntry* found = nvs_find_handle_entry(handle);
+    if (found == NULL) {
         return ESP_ERR_NVS_INVALID_HANDLE;
     }
-    entry = *it;
+    entry = *found;
     return ESP_OK;
 }
 
@@ -303,14 +329,13 @@ extern "C" void nvs_close(nvs_handle handle)
 {
     Lock lock;
     ESP_LOGD(TAG, "%s %d", __func__, handle);
-    auto it = find_if(begin(s_nvs_handles), end(s_nvs_handles), [=](HandleEntry& e) -> bool {
-        return e.mHandle == handle;
-    });
-    if (it == end(s_nvs_handles)) {
+    HandleEntry* entry = nvs_find_handle_entry(handle);
+    if (entry == NULL) {
         return;
     }
-    s_nvs_handles.erase(it);
-    delete static_cast<HandleEntry*>(it);
+    s_nvs_handles.erase(entry);
+    delete entry->mBatch;
+    delete entry;
 }
 
 extern "C" esp_err_t nvs_erase_key(nvs_handle handle, const char* key)
@@ -325,6 +350,9 @@ extern "C" esp_err_t nvs_erase_key(nvs_handle handle, const char* key)
     if (entry.mReadOnly) {
         return ESP_ERR_NVS_READ_ONLY;
     }
+    if (entry.mBatch) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
     return entry.mStoragePtr->eraseItem(entry.mNsIndex, key);
 }
 
@@ -356,6 +384,9 @@ static esp_err_t nvs_set(nvs_handle handle, const char* key, T value)
     if (entry.mReadOnly) {
         return ESP_ERR_NVS_READ_ONLY;
     }
+    if (entry.mBatch) {
+        return entry.mBatch->add(itemTypeOf(value), key, &value, sizeof(value));
+    }
     return entry.mStoragePtr->writeItem(entry.mNsIndex, key, value);
 }
 
@@ -402,9 +433,172 @@ extern "C" esp_err_t nvs_set_u64 (nvs_handle handle, const char* key, uint64_t v
 extern "C" esp_err_t nvs_commit(nvs_handle handle)
 {
     Lock lock;
-    // no-op for now, to be used when intermediate cache is added
     HandleEntry entry;
-    return nvs_find_ns_handle(handle, entry);
+    auto err = nvs_find_ns_handle(handle, entry);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (entry.mBatch) {
+        // the batch is closed even if it couldn't be written
+        err = entry.mStoragePtr->writeBatch(entry.mNsIndex, *entry.mBatch);
+        delete entry.mBatch;
+        nvs_find_handle_entry(handle)->mBatch = nullptr;
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    err = entry.mStoragePtr->flushWriteBack();
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (!entry.mReadOnly) {
+        // other values are already written, only save the snapshots used by a fast mount
+        entry.mStoragePtr->writeSnapshots();
+    }
+    return ESP_OK;
+}
+
+extern "C" esp_err_t nvs_flush_write_back(void)
+{
+    Lock lock;
+    esp_err_t result = ESP_OK;
+    for (auto it = s_nvs_storage_list.begin(); it != s_nvs_storage_list.end(); ++it) {
+        auto err = it->flushWriteBack();
+        if (err != ESP_OK && result == ESP_OK) {
+            result = err;
+        }
+    }
+    return result;
+}
+
+#ifdef ESP_PLATFORM
+static bool s_write_back_started = false;
+
+#if CONFIG_NVS_WRITE_BACK_FLUSH_INTERVAL > 0
+static void nvs_write_back_flush_cb(void* arg)
+{
+    nvs_flush_write_back();
+}
+#endif
+
+static void nvs_write_back_shutdown(void)
+{
+    nvs_flush_write_back();
+}
+
+/* Flush cached values on restart and, if configured, periodically */
+static esp_err_t nvs_write_back_start(void)
+{
+    if (s_write_back_started) {
+        return ESP_OK;
+    }
+    esp_err_t err = esp_register_shutdown_handler(nvs_write_back_shutdown);
+    if (err != ESP_OK) {
+        return err;
+    }
+#if CONFIG_NVS_WRITE_BACK_FLUSH_INTERVAL > 0
+    esp_timer_create_args_t timer_args = {};
+    timer_args.callback = &nvs_write_back_flush_cb;
+    timer_args.dispatch_method = ESP_TIMER_TASK;
+    timer_args.name = "nvs_write_back";
+    esp_timer_handle_t timer;
+    err = esp_timer_create(&timer_args, &timer);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = esp_timer_start_periodic(timer, CONFIG_NVS_WRITE_BACK_FLUSH_INTERVAL * 1000ULL);
+    if (err != ESP_OK) {
+        esp_timer_delete(timer);
+        return err;
+    }
+#endif
+    s_write_back_started = true;
+    return ESP_OK;
+}
+#endif // ESP_PLATFORM
+
+extern "C" esp_err_t nvs_enable_write_back(nvs_handle handle, const char* key)
+{
+    Lock lock;
+    ESP_LOGD(TAG, "%s %s", __func__, key ? key : "*");
+    HandleEntry entry;
+    auto err = nvs_find_ns_handle(handle, entry);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (entry.mReadOnly) {
+        return ESP_ERR_NVS_READ_ONLY;
+    }
+#ifdef ESP_PLATFORM
+    err = nvs_write_back_start();
+    if (err != ESP_OK) {
+        return err;
+    }
+#endif
+    return entry.mStoragePtr->enableWriteBack(entry.mNsIndex, key, s_write_back_entries);
+}
+
+extern "C" esp_err_t nvs_disable_write_back(nvs_handle handle, const char* key)
+{
+    Lock lock;
+    ESP_LOGD(TAG, "%s %s", __func__, key ? key : "*");
+    HandleEntry entry;
+    auto err = nvs_find_ns_handle(handle, entry);
+    if (err != ESP_OK) {
+        return err;
+    }
+    return entry.mStoragePtr->disableWriteBack(entry.mNsIndex, key);
+}
+
+extern "C" esp_err_t nvs_get_write_back_stats(const char* part_name, nvs_write_back_stats_t* stats)
+{
+    Lock lock;
+    if (stats == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    nvs::Storage* pStorage = lookup_storage_from_name((part_name == NULL) ? NVS_DEFAULT_PART_NAME : part_name);
+    if (pStorage == NULL) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+    const nvs::WriteCache& cache = pStorage->getWriteCache();
+    stats->dirty_entries = cache.size();
+    stats->max_dirty_entries = cache.capacity();
+    stats->set_count = cache.getSetCount();
+    stats->flushed_count = cache.getFlushedCount();
+    return ESP_OK;
+}
+
+extern "C" esp_err_t nvs_batch_begin(nvs_handle handle)
+{
+    Lock lock;
+    ESP_LOGD(TAG, "%s %d", __func__, handle);
+    HandleEntry* entry = nvs_find_handle_entry(handle);
+    if (entry == NULL) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    if (entry->mReadOnly) {
+        return ESP_ERR_NVS_READ_ONLY;
+    }
+    if (entry->mBatch) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    entry->mBatch = new (std::nothrow) nvs::WriteBatch;
+    if (entry->mBatch == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+extern "C" void nvs_batch_abort(nvs_handle handle)
+{
+    Lock lock;
+    ESP_LOGD(TAG, "%s %d", __func__, handle);
+    HandleEntry* entry = nvs_find_handle_entry(handle);
+    if (entry == NULL) {
+        return;
+    }
+    delete entry->mBatch;
+    entry->mBatch = nullptr;
 }
 
 extern "C" esp_err_t nvs_set_str(nvs_handle handle, const char* key, const char* value)
@@ -416,6 +610,9 @@ extern "C" esp_err_t nvs_set_str(nvs_handle handle, const char* key, const char*
     if (err != ESP_OK) {
         return err;
     }
+    if (entry.mBatch) {
+        return entry.mBatch->add(nvs::ItemType::SZ, key, value, strlen(value) + 1);
+    }
     return entry.mStoragePtr->writeItem(entry.mNsIndex, nvs::ItemType::SZ, key, value, strlen(value) + 1);
 }
 
@@ -428,6 +625,9 @@ extern "C" esp_err_t nvs_set_blob(nvs_handle handle, const char* key, const void
     if (err != ESP_OK) {
         return err;
     }
+    if (entry.mBatch) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
     return entry.mStoragePtr->writeItem(entry.mNsIndex, nvs::ItemType::BLOB, key, value, length);
 }
 
@@ -572,6 +772,50 @@ extern "C" esp_err_t nvs_get_used_entry_count(nvs_handle handle, size_t* used_en
     return err;
 }
 
+extern "C" nvs_iterator_t nvs_entry_find(const char *part_name, const char *namespace_name, nvs_type_t type)
+{
+    Lock lock;
+    nvs::Storage* pStorage = lookup_storage_from_name((part_name == NULL) ? NVS_DEFAULT_PART_NAME : part_name);
+    if (pStorage == NULL || !pStorage->isValid()) {
+        return NULL;
+    }
+
+    nvs_iterator_t it = new (std::nothrow) nvs_opaque_iterator_t;
+    if (it == NULL) {
+        return NULL;
+    }
+    it->type = type;
+    it->storage = pStorage;
+
+    if (!pStorage->findEntry(it, namespace_name)) {
+        delete it;
+        return NULL;
+    }
+    return it;
+}
+
+extern "C" nvs_iterator_t nvs_entry_next(nvs_iterator_t it)
+{
+    Lock lock;
+    assert(it);
+
+    if (!it->storage->nextEntry(it)) {
+        delete it;
+        return NULL;
+    }
+    return it;
+}
+
+extern "C" void nvs_entry_info(nvs_iterator_t it, nvs_entry_info_t *out_info)
+{
+    *out_info = it->entry_info;
+}
+
+extern "C" void nvs_release_iterator(nvs_iterator_t it)
+{
+    delete it;
+}
+
 #if (defined CONFIG_NVS_ENCRYPTION) && (defined ESP_PLATFORM)
 
 extern "C" esp_err_t nvs_flash_generate_keys(const esp_partition_t* partition, nvs_sec_cfg_t* cfg)
@@ -0,0 +1,194 @@
+// Copyright 2015-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <new>
+#include "nvs_item_index.hpp"
+
+namespace nvs
+{
+
+ItemIndex::ItemIndex()
+{
+}
+
+ItemIndex::~ItemIndex()
+{
+    delete[] mNodes;
+}
+
+void ItemIndex::clear()
+{
+    delete[] mNodes;
+    mNodes = nullptr;
+    mCapacity = 0;
+    mCount = 0;
+    mDeleted = 0;
+    mValid = true;
+}
+
+bool ItemIndex::reserve(size_t count)
+{
+    // keep the load factor (including erased nodes) below 3/4
+    if ((count + mDeleted) * 4 <= mCapacity * 3) {
+        return true;
+    }
+    size_t capacity = MIN_CAPACITY;
+    while (count * 2 > capacity) {
+        capacity *= 2;
+    }
+
+    Node* nodes = new (std::nothrow) Node[capacity];
+    if (nodes == nullptr) {
+        return false;
+    }
+    for (size_t i = 0; i < capacity; ++i) {
+        nodes[i].mIndex = 0;
+        nodes[i].mHash = 0;
+        nodes[i].mPage = nullptr;
+    }
+    for (size_t i = 0; i < mCapacity; ++i) {
+        const Node& node = mNodes[i];
+        if (node.mPage == nullptr) {
+            continue;
+        }
+        size_t pos = node.mHash & (capacity - 1);
+        while (nodes[pos].mPage != nullptr) {
+            pos = (pos + 1) & (capacity - 1);
+        }
+        nodes[pos] = node;
+    }
+    delete[] mNodes;
+    mNodes = nodes;
+    mCapacity = capacity;
+    mDeleted = 0;
+    return true;
+}
+
+void ItemIndex::insert(const Item& item, Page* page, size_t index)
+{
+    insert(item.calculateCrc32WithoutValue(), page, index);
+}
+
+void ItemIndex::insert(uint32_t hash, Page* page, size_t index)
+{
+    if (!mValid) {
+        return;
+    }
+    if (!reserve(mCount + 1)) {
+        // out of memory: stop indexing, lookups go through the pages
+        delete[] mNodes;
+        mNodes = nullptr;
+        mCapacity = 0;
+        mCount = 0;
+        mDeleted = 0;
+        mValid = false;
+        return;
+    }
+    const uint32_t hash_24 = hash & 0xffffff;
+    size_t pos = hash_24 & (mCapacity - 1);
+    while (mNodes[pos].mPage != nullptr) {
+        pos = (pos + 1) & (mCapacity - 1);
+    }
+    if (!mNodes[pos].isEmpty()) {
+        --mDeleted;
+    }
+    mNodes[pos].mIndex = (uint32_t) index;
+    mNodes[pos].mHash = hash_24;
+    mNodes[pos].mPage = page;
+    ++mCount;
+}
+
+void ItemIndex::remove(Node& node)
+{
+    node.mPage = nullptr;
+    node.mIndex = DELETED;
+    --mCount;
+    ++mDeleted;
+}
+
+void ItemIndex::erase(const Item& item, Page* page, size_t index)
+{
+    if (mCapacity == 0) {
+        return;
+    }
+    const uint32_t hash_24 = hashOf(item);
+    for (size_t pos = hash_24 & (mCapacity - 1); !mNodes[pos].isEmpty(); pos = (pos + 1) & (mCapacity - 1)) {
+        Node& node = mNodes[pos];
+        if (node.mPage == page && node.mIndex == index) {
+            remove(node);
+            return;
+        }
+    }
+}
+
+void ItemIndex::erase(Page* page, size_t index)
+{
+    // hash of the item is not known, e.g. if its header got corrupted
+    for (size_t pos = 0; pos < mCapacity; ++pos) {
+        Node& node = mNodes[pos];
+        if (node.mPage == page && node.mIndex == index) {
+            remove(node);
+            return;
+        }
+    }
+}
+
+void ItemIndex::erasePage(Page* page)
+{
+    for (size_t pos = 0; pos < mCapacity && mCount > 0; ++pos) {
+        Node& node = mNodes[pos];
+        if (node.mPage == page) {
+            remove(node);
+        }
+    }
+}
+
+bool ItemIndex::find(const Item& item, size_t& pos, Page* &page, size_t& index) const
+{
+    if (mCapacity == 0) {
+        return false;
+    }
+    const uint32_t hash_24 = hashOf(item);
+    // pos counts probed nodes, starting from the home node of the hash
+    for (; pos < mCapacity; ++pos) {
+        const Node& node = mNodes[(hash_24 + pos) & (mCapacity - 1)];
+        if (node.isEmpty()) {
+            break;
+        }
+        if (node.mPage != nullptr && node.mHash == hash_24) {
+            page = node.mPage;
+            index = node.mIndex;
+            ++pos;
+            return true;
+        }
+    }
+    pos = mCapacity;
+    return false;
+}
+
+bool ItemIndex::contains(const Item& item, const Page* page, size_t index) const
+{
+    size_t pos = 0;
+    Page* foundPage;
+    size_t foundIndex;
+    while (find(item, pos, foundPage, foundIndex)) {
+        if (foundPage == page && foundIndex == index) {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+} // namespace nvs
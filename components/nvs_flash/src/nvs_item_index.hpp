@@ -0,0 +1,110 @@
+// Copyright 2015-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef nvs_item_index_h
+#define nvs_item_index_h
+
+#include "nvs.h"
+#include "nvs_types.hpp"
+
+namespace nvs
+{
+
+class Page;
+
+/**
+ * Storage-wide index of items, mapping <namespace, key, chunk> to the page
+ * and entry holding the item. It mirrors the HashList of every page, using
+ * the same 24-bit hash, so that Storage does not have to visit each page to
+ * look up a key.
+ *
+ * The table uses open addressing with linear probing. If the table can not
+ * be grown, the index switches itself off and Storage falls back to the
+ * per-page search until the next PageManager::load.
+ */
+class ItemIndex
+{
+public:
+    ItemIndex();
+    ~ItemIndex();
+
+    void insert(const Item& item, Page* page, size_t index);
+    void insert(uint32_t hash, Page* page, size_t index);
+    void erase(const Item& item, Page* page, size_t index);
+    void erase(Page* page, size_t index);
+    void erasePage(Page* page);
+    void clear();
+
+    bool isValid() const
+    {
+        return mValid;
+    }
+
+    size_t size() const
+    {
+        return mCount;
+    }
+
+    /**
+     * Iterate over the candidate locations of an item. Start with pos = 0,
+     * the returned pos is to be passed to the next call.
+     * Candidates may be hash collisions, the caller has to check the item.
+     *
+     * @return true if a candidate was found
+     */
+    bool find(const Item& item, size_t& pos, Page* &page, size_t& index) const;
+
+    bool contains(const Item& item, const Page* page, size_t index) const;
+
+private:
+    ItemIndex(const ItemIndex& other);
+    const ItemIndex& operator= (const ItemIndex& rhs);
+
+protected:
+
+    struct Node {
+        uint32_t mIndex : 8;
+        uint32_t mHash  : 24;
+        Page* mPage;
+
+        // nodes without a page are free, 0xff marks a node which was erased
+        // and must not stop the probe sequence
+        bool isEmpty() const
+        {
+            return mPage == nullptr && mIndex != DELETED;
+        }
+    };
+
+    static const uint32_t DELETED = 0xff;
+    static const size_t MIN_CAPACITY = 64;
+
+    static uint32_t hashOf(const Item& item)
+    {
+        return item.calculateCrc32WithoutValue() & 0xffffff;
+    }
+
+    bool reserve(size_t count);
+    void remove(Node& node);
+
+    Node* mNodes = nullptr;
+    size_t mCapacity = 0;
+    size_t mCount = 0;
+    size_t mDeleted = 0;
+    bool mValid = true;
+}; // class ItemIndex
+
+} // namespace nvs
+
+
+#endif /* nvs_item_index_h */
@@ -19,6 +19,7 @@
 #endif
 #include <cstdio>
 #include <cstring>
+#include <new>
 
 #include "nvs_ops.hpp"
 
@@ -32,11 +33,13 @@ uint32_t Page::Header::calculateCrc32()
                     offsetof(Header, mCrc32) - offsetof(Header, mSeqNumber));
 }
 
-esp_err_t Page::load(uint32_t sectorNumber)
+esp_err_t Page::load(uint32_t sectorNumber, bool deferEntries)
 {
     mBaseAddress = sectorNumber * SEC_SIZE;
     mUsedEntryCount = 0;
     mErasedEntryCount = 0;
+    mLoadDeferred = false;
+    mCheckDeferred = false;
 
     Header header;
     auto rc = spi_flash_read(mBaseAddress, &header, sizeof(header));
@@ -46,20 +49,14 @@ esp_err_t Page::load(uint32_t sectorNumber)
     }
     if (header.mState == PageState::UNINITIALIZED) {
         mState = header.mState;
-        // check if the whole page is really empty
-        // reading the whole page takes ~40 times less than erasing it
-        uint32_t line[8];
-        for (uint32_t i = 0; i < SPI_FLASH_SEC_SIZE; i += sizeof(line)) {
-            rc = spi_flash_read(mBaseAddress + i, line, sizeof(line));
+        if (deferEntries) {
+            // checked when the page gets activated
+            mLoadDeferred = true;
+        } else {
+            rc = mCheckErased();
             if (rc != ESP_OK) {
-                mState = PageState::INVALID;
                 return rc;
             }
-            if (std::any_of(line, line + 4, [](uint32_t val) -> bool { return val != 0xffffffff; })) {
-                // page isn't as empty after all, mark it as corrupted
-                mState = PageState::CORRUPT;
-                break;
-            }
         }
     } else if (header.mCrc32 != header.calculateCrc32()) {
         header.mState = PageState::CORRUPT;
@@ -78,6 +75,12 @@ esp_err_t Page::load(uint32_t sectorNumber)
         break;
 
     case PageState::FULL:
+        // items of a full page are only ever erased, the entry state table
+        // is enough until the hash list gets loaded
+        mLoadDeferred = deferEntries;
+        mLoadEntryTable();
+        break;
+
     case PageState::ACTIVE:
     case PageState::FREEING:
         mLoadEntryTable();
@@ -91,20 +94,83 @@ esp_err_t Page::load(uint32_t sectorNumber)
     return ESP_OK;
 }
 
+esp_err_t Page::loadEntries()
+{
+    if (!mLoadDeferred) {
+        return ESP_OK;
+    }
+    mLoadDeferred = false;
+    if (mState == PageState::UNINITIALIZED) {
+        return mCheckErased();
+    }
+    if (mState == PageState::FULL) {
+        return mLoadItems(true);
+    }
+    return ESP_OK;
+}
+
+esp_err_t Page::loadHashList(const uint32_t* nodes, size_t count)
+{
+    if (!mLoadDeferred || mState != PageState::FULL) {
+        return ESP_ERR_NVS_INVALID_STATE;
+    }
+    for (size_t i = 0; i < count; ++i) {
+        const uint32_t hash_24 = nodes[i] & 0xffffff;
+        const size_t index = nodes[i] >> 24;
+        // skip items erased after the hash list was saved
+        if (index >= ENTRY_COUNT || mEntryTable.get(index) != EntryState::WRITTEN) {
+            continue;
+        }
+        mHashList.insert(hash_24, index);
+        if (mItemIndex) {
+            mItemIndex->insert(hash_24, this, index);
+        }
+    }
+    mLoadDeferred = false;
+    mCheckDeferred = true;
+    return ESP_OK;
+}
+
+esp_err_t Page::mCheckErased()
+{
+    // check if the whole page is really empty
+    // reading the whole page takes ~40 times less than erasing it
+    uint32_t line[8];
+    for (uint32_t i = 0; i < SPI_FLASH_SEC_SIZE; i += sizeof(line)) {
+        auto rc = spi_flash_read(mBaseAddress + i, line, sizeof(line));
+        if (rc != ESP_OK) {
+            mState = PageState::INVALID;
+            return rc;
+        }
+        if (std::any_of(line, line + 4, [](uint32_t val) -> bool { return val != 0xffffffff; })) {
+            // page isn't as empty after all, mark it as corrupted
+            mState = PageState::CORRUPT;
+            break;
+        }
+    }
+    return ESP_OK;
+}
+
 esp_err_t Page::writeEntry(const Item& item)
 {
     esp_err_t err;
 
-    err = nvs_flash_write(getEntryAddress(mNextFreeEntry), &item, sizeof(item));
+    if (mBatchStart != INVALID_ENTRY) {
+        assert(mNextFreeEntry < mBatchEnd);
+        memcpy(&mBatchData[(mNextFreeEntry - mBatchStart) * ENTRY_SIZE], &item, sizeof(item));
+        mEntryTable.set(mNextFreeEntry, EntryState::WRITTEN);
+    } else {
+        err = nvs_flash_write(getEntryAddress(mNextFreeEntry), &item, sizeof(item));
 
-    if (err != ESP_OK) {
-        mState = PageState::INVALID;
-        return err;
-    }
+        if (err != ESP_OK) {
+            mState = PageState::INVALID;
+            return err;
+        }
 
-    err = alterEntryState(mNextFreeEntry, EntryState::WRITTEN);
-    if (err != ESP_OK) {
-        return err;
+        err = alterEntryState(mNextFreeEntry, EntryState::WRITTEN);
+        if (err != ESP_OK) {
+            return err;
+        }
     }
 
     if (mFirstUsedEntry == INVALID_ENTRY) {
@@ -124,6 +190,17 @@ esp_err_t Page::writeEntryData(const uint8_t* data, size_t size)
     assert(mFirstUsedEntry != INVALID_ENTRY);
     const uint16_t count = size / ENTRY_SIZE;
 
+    if (mBatchStart != INVALID_ENTRY) {
+        assert(mNextFreeEntry + count <= mBatchEnd);
+        memcpy(&mBatchData[(mNextFreeEntry - mBatchStart) * ENTRY_SIZE], data, size);
+        for (size_t i = mNextFreeEntry; i < mNextFreeEntry + count; ++i) {
+            mEntryTable.set(i, EntryState::WRITTEN);
+        }
+        mUsedEntryCount += count;
+        mNextFreeEntry += count;
+        return ESP_OK;
+    }
+
     const uint8_t* buf = data;
 
 #ifdef ESP_PLATFORM
@@ -213,6 +290,9 @@ esp_err_t Page::writeItem(uint8_t nsIndex, ItemType datatype, const char* key, c
     size_t span = (totalSize + ENTRY_SIZE - 1) / ENTRY_SIZE;
     item = Item(nsIndex, datatype, span, key, chunkIdx);
     mHashList.insert(item, mNextFreeEntry);
+    if (mItemIndex) {
+        mItemIndex->insert(item, this, mNextFreeEntry);
+    }
 
     if (!isVariableLengthType(datatype)) {
         memcpy(item.data, data, dataSize);
@@ -254,6 +334,87 @@ esp_err_t Page::writeItem(uint8_t nsIndex, ItemType datatype, const char* key, c
     return ESP_OK;
 }
 
+esp_err_t Page::beginBatch(size_t entryCount)
+{
+    if (mState == PageState::INVALID) {
+        return ESP_ERR_NVS_INVALID_STATE;
+    }
+
+    if (mState == PageState::UNINITIALIZED) {
+        auto err = initialize();
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
+    if (mState == PageState::FULL || mNextFreeEntry == INVALID_ENTRY ||
+            mNextFreeEntry + entryCount > ENTRY_COUNT) {
+        return ESP_ERR_NVS_PAGE_FULL;
+    }
+
+    assert(mBatchStart == INVALID_ENTRY);
+    mBatchData.reset(new (std::nothrow) uint8_t[entryCount * ENTRY_SIZE]);
+    if (!mBatchData) {
+        return ESP_ERR_NO_MEM;
+    }
+    mBatchStart = mNextFreeEntry;
+    mBatchEnd = mNextFreeEntry + entryCount;
+    return ESP_OK;
+}
+
+esp_err_t Page::commitBatch()
+{
+    assert(mBatchStart != INVALID_ENTRY);
+    size_t begin = mBatchStart;
+    std::unique_ptr<uint8_t[]> data(std::move(mBatchData));
+    mBatchStart = INVALID_ENTRY;
+    if (mNextFreeEntry == begin) {
+        return ESP_OK;
+    }
+
+    auto err = nvs_flash_write(getEntryAddress(begin), data.get(), (mNextFreeEntry - begin) * ENTRY_SIZE);
+    if (err != ESP_OK) {
+        mState = PageState::INVALID;
+        return err;
+    }
+    // states are written from the last word to the first one, the word of the
+    // first entry makes the whole batch visible
+    err = alterEntryRangeState(begin, mNextFreeEntry, EntryState::WRITTEN);
+    if (err != ESP_OK) {
+        mState = PageState::INVALID;
+        return err;
+    }
+    return ESP_OK;
+}
+
+void Page::abortBatch()
+{
+    assert(mBatchStart != INVALID_ENTRY);
+    size_t begin = mBatchStart;
+    std::unique_ptr<uint8_t[]> data(std::move(mBatchData));
+    mBatchStart = INVALID_ENTRY;
+
+    // nothing has been written to flash yet
+    size_t span;
+    for (size_t i = begin; i < mNextFreeEntry; i += span) {
+        Item item;
+        memcpy(&item, &data[(i - begin) * ENTRY_SIZE], sizeof(item));
+        mHashList.erase(i);
+        if (mItemIndex) {
+            mItemIndex->erase(item, this, i);
+        }
+        span = (item.span > 0) ? item.span : 1;
+    }
+    for (size_t i = begin; i < mNextFreeEntry; ++i) {
+        mEntryTable.set(i, EntryState::EMPTY);
+    }
+    mUsedEntryCount -= mNextFreeEntry - begin;
+    if (mFirstUsedEntry == begin) {
+        mFirstUsedEntry = INVALID_ENTRY;
+    }
+    mNextFreeEntry = begin;
+}
+
 esp_err_t Page::readItem(uint8_t nsIndex, ItemType datatype, const char* key, void* data, size_t dataSize, uint8_t chunkIdx, VerOffset chunkStart)
 {
     size_t index = 0;
@@ -337,6 +498,9 @@ esp_err_t Page::eraseEntryAndSpan(size_t index)
         }
         if (item.calculateCrc32() != item.crc32) {
             mHashList.erase(index, false);
+            if (mItemIndex) {
+                mItemIndex->erase(this, index);
+            }
             rc = alterEntryState(index, EntryState::ERASED);
             --mUsedEntryCount;
             ++mErasedEntryCount;
@@ -345,6 +509,9 @@ esp_err_t Page::eraseEntryAndSpan(size_t index)
             }
         } else {
             mHashList.erase(index);
+            if (mItemIndex) {
+                mItemIndex->erase(item, this, index);
+            }
             span = item.span;
             for (ptrdiff_t i = index + span - 1; i >= static_cast<ptrdiff_t>(index); --i) {
                 if (mEntryTable.get(i) == EntryState::WRITTEN) {
@@ -401,6 +568,15 @@ esp_err_t Page::copyItems(Page& other)
         return ESP_ERR_NVS_NOT_FOUND;
     }
 
+    if (mCheckDeferred) {
+        // hash list came from a snapshot, don't move items which are not intact
+        mCheckDeferred = false;
+        auto err = mLoadItems(false);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+
     if (other.mState == PageState::UNINITIALIZED) {
         auto err = other.initialize();
         if (err != ESP_OK) {
@@ -424,6 +600,9 @@ esp_err_t Page::copyItems(Page& other)
         }
 
         other.mHashList.insert(entry, other.mNextFreeEntry);
+        if (other.mItemIndex) {
+            other.mItemIndex->insert(entry, &other, other.mNextFreeEntry);
+        }
         err = other.writeEntry(entry);
         if (err != ESP_OK) {
             return err;
@@ -514,6 +693,30 @@ esp_err_t Page::mLoadEntryTable()
             }
         }
 
+        // a batch may have been interrupted while its entry states were written,
+        // leaving written states after an entry which looks empty
+        size_t batchEnd = mNextFreeEntry;
+        for (size_t i = mNextFreeEntry; i < ENTRY_COUNT; ++i) {
+            if (mEntryTable.get(i) != EntryState::EMPTY) {
+                batchEnd = i + 1;
+            }
+        }
+        for (; mNextFreeEntry < batchEnd; ++mNextFreeEntry) {
+            auto oldState = mEntryTable.get(mNextFreeEntry);
+            if (oldState == EntryState::ERASED) {
+                continue;
+            }
+            auto err = alterEntryState(mNextFreeEntry, EntryState::ERASED);
+            if (err != ESP_OK) {
+                mState = PageState::INVALID;
+                return err;
+            }
+            if (oldState == EntryState::WRITTEN) {
+                --mUsedEntryCount;
+            }
+            ++mErasedEntryCount;
+        }
+
         // check that all variable-length items are written or erased fully
         Item item;
         size_t lastItemIndex = INVALID_ENTRY;
@@ -547,6 +750,9 @@ esp_err_t Page::mLoadEntryTable()
             }
 
             mHashList.insert(item, i);
+            if (mItemIndex) {
+                mItemIndex->insert(item, this, i);
+            }
 
             // search for potential duplicate item
             size_t duplicateIndex = mHashList.find(0, item);
@@ -590,48 +796,59 @@ esp_err_t Page::mLoadEntryTable()
                 }
             }
         }
-    } else if (mState == PageState::FULL || mState == PageState::FREEING) {
+    } else if ((mState == PageState::FULL && !mLoadDeferred) || mState == PageState::FREEING) {
         // We have already filled mHashList for page in active state.
         // Do the same for the case when page is in full or freeing state.
-        Item item;
-        for (size_t i = mFirstUsedEntry; i < ENTRY_COUNT; ++i) {
-            if (mEntryTable.get(i) != EntryState::WRITTEN) {
-                continue;
-            }
+        return mLoadItems(true);
+    }
 
-            auto err = readEntry(i, item);
+    return ESP_OK;
+}
+
+esp_err_t Page::mLoadItems(bool fillHashList)
+{
+    Item item;
+    for (size_t i = mFirstUsedEntry; i < ENTRY_COUNT; ++i) {
+        if (mEntryTable.get(i) != EntryState::WRITTEN) {
+            continue;
+        }
+
+        auto err = readEntry(i, item);
+        if (err != ESP_OK) {
+            mState = PageState::INVALID;
+            return err;
+        }
+
+        if (item.crc32 != item.calculateCrc32()) {
+            err = eraseEntryAndSpan(i);
             if (err != ESP_OK) {
                 mState = PageState::INVALID;
                 return err;
             }
+            continue;
+        }
 
-            if (item.crc32 != item.calculateCrc32()) {
-                err = eraseEntryAndSpan(i);
-                if (err != ESP_OK) {
-                    mState = PageState::INVALID;
-                    return err;
-                }
-                continue;
-            }
-
-            assert(item.span > 0);
+        assert(item.span > 0);
 
+        if (fillHashList) {
             mHashList.insert(item, i);
+            if (mItemIndex) {
+                mItemIndex->insert(item, this, i);
+            }
+        }
 
-            size_t span = item.span;
+        size_t span = item.span;
 
-            if (isVariableLengthType(item.datatype)) {
-                for (size_t j = i + 1; j < i + span; ++j) {
-                    if (mEntryTable.get(j) != EntryState::WRITTEN) {
-                        eraseEntryAndSpan(i);
-                        break;
-                    }
+        if (isVariableLengthType(item.datatype)) {
+            for (size_t j = i + 1; j < i + span; ++j) {
+                if (mEntryTable.get(j) != EntryState::WRITTEN) {
+                    eraseEntryAndSpan(i);
+                    break;
                 }
             }
-
-            i += span - 1;
         }
 
+        i += span - 1;
     }
 
     return ESP_OK;
@@ -723,7 +940,7 @@ esp_err_t Page::readEntry(size_t index, Item& dst) const
 
 esp_err_t Page::findItem(uint8_t nsIndex, ItemType datatype, const char* key, size_t &itemIndex, Item& item, uint8_t chunkIdx, VerOffset chunkStart)
 {
-    if (mState == PageState::CORRUPT || mState == PageState::INVALID || mState == PageState::UNINITIALIZED) {
+    if (mState == PageState::CORRUPT || mState == PageState::INVALID || mState == PageState::UNINITIALIZED || mLoadDeferred) {
         return ESP_ERR_NVS_NOT_FOUND;
     }
 
@@ -861,7 +1078,12 @@ esp_err_t Page::erase()
     mFirstUsedEntry = INVALID_ENTRY;
     mNextFreeEntry = INVALID_ENTRY;
     mState = PageState::UNINITIALIZED;
+    mLoadDeferred = false;
+    mCheckDeferred = false;
     mHashList.clear();
+    if (mItemIndex) {
+        mItemIndex->erasePage(this);
+    }
     return ESP_OK;
 }
 
@@ -20,10 +20,12 @@
 #include <type_traits>
 #include <cstring>
 #include <algorithm>
+#include <memory>
 #include "esp_spi_flash.h"
 #include "compressed_enum_table.hpp"
 #include "intrusive_list.h"
 #include "nvs_item_hash_list.hpp"
+#include "nvs_item_index.hpp"
 
 namespace nvs
 {
@@ -82,7 +84,33 @@ public:
         return mState;
     }
 
-    esp_err_t load(uint32_t sectorNumber);
+    esp_err_t load(uint32_t sectorNumber, bool deferEntries = false);
+
+    /**
+     * With deferEntries, load() only reads the entry state table of a full page
+     * and does not check that a free page is really empty.
+     * loadEntries() does the remaining work, loadHashList() instead fills the
+     * hash list from <24-bit hash | entry index << 24> nodes saved before,
+     * leaving the items to be checked before they get moved to another page.
+     */
+    esp_err_t loadEntries();
+
+    esp_err_t loadHashList(const uint32_t* nodes, size_t count);
+
+    bool isLoadDeferred() const
+    {
+        return mLoadDeferred;
+    }
+
+    uint32_t getSectorNumber() const
+    {
+        return mBaseAddress / SEC_SIZE;
+    }
+
+    void setItemIndex(ItemIndex* itemIndex)
+    {
+        mItemIndex = itemIndex;
+    }
 
     esp_err_t getSeqNumber(uint32_t& seqNumber) const;
 
@@ -133,6 +161,18 @@ public:
 
     esp_err_t markFreeing();
 
+    /**
+     * Items written between beginBatch() and commitBatch() take consecutive entries.
+     * They are kept in RAM and written to flash by commitBatch(), followed by their
+     * entry states. Until the state of the first entry is written, the whole batch
+     * is discarded when the page is loaded again.
+     */
+    esp_err_t beginBatch(size_t entryCount);
+
+    esp_err_t commitBatch();
+
+    void abortBatch();
+
     esp_err_t copyItems(Page& other);
 
     esp_err_t erase();
@@ -169,6 +209,10 @@ protected:
 
     esp_err_t mLoadEntryTable();
 
+    esp_err_t mLoadItems(bool fillHashList);
+
+    esp_err_t mCheckErased();
+
     esp_err_t initialize();
 
     esp_err_t alterEntryState(size_t index, EntryState state);
@@ -214,6 +258,12 @@ protected:
     uint16_t mErasedEntryCount = 0;
 
     HashList mHashList;
+    ItemIndex* mItemIndex = nullptr;
+    bool mLoadDeferred = false;
+    bool mCheckDeferred = false;
+    size_t mBatchStart = INVALID_ENTRY;
+    size_t mBatchEnd = INVALID_ENTRY;
+    std::unique_ptr<uint8_t[]> mBatchData;
 
     static const uint32_t HEADER_OFFSET = 0;
     static const uint32_t ENTRY_TABLE_OFFSET = HEADER_OFFSET + 32;
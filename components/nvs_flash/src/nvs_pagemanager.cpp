@@ -15,16 +15,20 @@
 
 namespace nvs
 {
-esp_err_t PageManager::load(uint32_t baseSector, uint32_t sectorCount)
+esp_err_t PageManager::load(uint32_t baseSector, uint32_t sectorCount, ItemIndex* index, bool deferEntries)
 {
     mBaseSector = baseSector;
     mPageCount = sectorCount;
     mPageList.clear();
     mFreePageList.clear();
     mPages.reset(new Page[sectorCount]);
+    if (index) {
+        index->clear();
+    }
 
     for (uint32_t i = 0; i < sectorCount; ++i) {
-        auto err = mPages[i].load(baseSector + i);
+        mPages[i].setItemIndex(index);
+        auto err = mPages[i].load(baseSector + i, deferEntries);
         if (err != ESP_OK) {
             return err;
         }
@@ -53,19 +57,38 @@ esp_err_t PageManager::load(uint32_t baseSector, uint32_t sectorCount)
         mSeqNumber = lastSeqNo + 1;
     }
 
+    if (deferEntries) {
+        return ESP_OK;
+    }
+    return completeLoad();
+}
+
+esp_err_t PageManager::completeLoad()
+{
     // if power went out after a new item for the given key was written,
-    // but before the old one was erased, we end up with a duplicate item
+    // but before the old one was erased, we end up with a duplicate item.
+    // A batch of items may leave such duplicates for all of its items.
     Page& lastPage = back();
+    auto last = PageManager::TPageListIterator(&lastPage);
     size_t lastItemIndex = SIZE_MAX;
     Item item;
     size_t itemIndex = 0;
     while (lastPage.findItem(Page::NS_ANY, ItemType::ANY, nullptr, itemIndex, item) == ESP_OK) {
         itemIndex += item.span;
         lastItemIndex = itemIndex;
+        if (item.datatype == ItemType::BLOB_IDX || item.datatype == ItemType::BLOB_DATA) {
+            continue;
+        }
+        for (auto it = begin(); it != last; ++it) {
+            if ((it->state() != Page::PageState::FREEING) &&
+                    (it->eraseItem(item.nsIndex, item.datatype, item.key, item.chunkIndex) == ESP_OK)) {
+                break;
+            }
+        }
     }
 
-    if (lastItemIndex != SIZE_MAX) {
-        auto last = PageManager::TPageListIterator(&lastPage);
+    if (lastItemIndex != SIZE_MAX &&
+            (item.datatype == ItemType::BLOB_IDX || item.datatype == ItemType::BLOB_DATA)) {
         TPageListIterator it;
 
         for (it = begin(); it != last; ++it) {
@@ -200,6 +223,12 @@ esp_err_t PageManager::activatePage()
         return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
     }
     Page* p = &mFreePageList.front();
+    if (p->isLoadDeferred()) {
+        auto err = p->loadEntries();
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
     if (p->state() == Page::PageState::CORRUPT) {
         auto err = p->erase();
         if (err != ESP_OK) {
@@ -31,7 +31,13 @@ public:
 
     PageManager() {}
 
-    esp_err_t load(uint32_t baseSector, uint32_t sectorCount);
+    /**
+     * With deferEntries, pages are only partially loaded (see Page::load) and
+     * the caller has to finish loading the full pages, then call completeLoad().
+     */
+    esp_err_t load(uint32_t baseSector, uint32_t sectorCount, ItemIndex* index = nullptr, bool deferEntries = false);
+
+    esp_err_t completeLoad();
 
     TPageListIterator begin()
     {
@@ -12,6 +12,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 #include "nvs_storage.hpp"
+#include <new>
 
 #ifndef ESP_PLATFORM
 #include <map>
@@ -21,6 +22,68 @@
 namespace nvs
 {
 
+esp_err_t WriteBatch::add(ItemType datatype, const char* key, const void* data, size_t dataSize)
+{
+    if (datatype == ItemType::BLOB || datatype == ItemType::BLOB_DATA || datatype == ItemType::BLOB_IDX) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (strlen(key) > Item::MAX_KEY_LENGTH) {
+        return ESP_ERR_NVS_KEY_TOO_LONG;
+    }
+    if (dataSize > Page::CHUNK_MAX_SIZE) {
+        return ESP_ERR_NVS_VALUE_TOO_LONG;
+    }
+
+    size_t entryCount = 1;
+    if (isVariableLengthType(datatype)) {
+        entryCount += (dataSize + Page::ENTRY_SIZE - 1) / Page::ENTRY_SIZE;
+    }
+
+    // setting a key again replaces its value in the batch
+    BatchItem* old = nullptr;
+    for (auto it = mItems.begin(); it != mItems.end(); ++it) {
+        if (it->mDatatype == datatype && strcmp(it->mKey, key) == 0) {
+            old = it;
+            break;
+        }
+    }
+    size_t newEntryCount = mEntryCount + entryCount - (old ? old->mEntryCount : 0);
+    if (newEntryCount > Page::ENTRY_COUNT) {
+        return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    }
+
+    BatchItem* entry = new (std::nothrow) BatchItem;
+    if (entry == nullptr) {
+        return ESP_ERR_NO_MEM;
+    }
+    entry->mData.reset(new (std::nothrow) uint8_t[dataSize]);
+    if (!entry->mData) {
+        delete entry;
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(entry->mData.get(), data, dataSize);
+    entry->mDatatype = datatype;
+    strncpy(entry->mKey, key, sizeof(entry->mKey) - 1);
+    entry->mKey[sizeof(entry->mKey) - 1] = 0;
+    entry->mDataSize = dataSize;
+    entry->mEntryCount = entryCount;
+    entry->mOldPage = nullptr;
+
+    if (old) {
+        mItems.erase(old);
+        delete old;
+    }
+    mItems.push_back(entry);
+    mEntryCount = newEntryCount;
+    return ESP_OK;
+}
+
+void WriteBatch::clear()
+{
+    mItems.clearAndFreeNodes();
+    mEntryCount = 0;
+}
+
 Storage::~Storage()
 {
     clearNamespaces();
@@ -84,43 +147,66 @@ void Storage::eraseOrphanDataBlobs(TBlobIndexList& blobIdxList)
     }
 }
 
-esp_err_t Storage::init(uint32_t baseSector, uint32_t sectorCount)
+esp_err_t Storage::init(uint32_t baseSector, uint32_t sectorCount, bool fastMount)
 {
-    auto err = mPageManager.load(baseSector, sectorCount);
+    clearNamespaces();
+    std::fill_n(mNamespaceUsage.data(), mNamespaceUsage.byteSize() / 4, 0);
+    mWriteCache.clear();
+    mFastMount = fastMount;
+    mSnapshotSeq.reset();
+
+    TBlobChunkList chunkList;
+    auto err = mPageManager.load(baseSector, sectorCount, &mItemIndex, fastMount);
+    if (err == ESP_OK && fastMount) {
+        err = loadSnapshots(chunkList);
+        if (err == ESP_OK) {
+            err = mPageManager.completeLoad();
+        }
+    }
     if (err != ESP_OK) {
+        chunkList.clearAndFreeNodes();
         mState = StorageState::INVALID;
         return err;
     }
 
-    // load namespaces list
-    clearNamespaces();
-    std::fill_n(mNamespaceUsage.data(), mNamespaceUsage.byteSize() / 4, 0);
+    // load namespaces list, entries of pages loaded from a snapshot are already known
     for (auto it = mPageManager.begin(); it != mPageManager.end(); ++it) {
         Page& p = *it;
+        if (hasCurrentSnapshot(p)) {
+            continue;
+        }
         size_t itemIndex = 0;
         Item item;
         while (p.findItem(Page::NS_INDEX, ItemType::U8, nullptr, itemIndex, item) == ESP_OK) {
-            NamespaceEntry* entry = new NamespaceEntry;
-            item.getKey(entry->mName, sizeof(entry->mName) - 1);
-            item.getValue(entry->mIndex);
-            mNamespaces.push_back(entry);
-            mNamespaceUsage.set(entry->mIndex, true);
+            loadNamespace(item);
             itemIndex += item.span;
         }
     }
     mNamespaceUsage.set(0, true);
     mNamespaceUsage.set(255, true);
+    if (mFastMount) {
+        if (mNamespaceUsage.get(NS_SNAPSHOT)) {
+            // taken by a namespace created without fast mount
+            mFastMount = false;
+        }
+        mNamespaceUsage.set(NS_SNAPSHOT, true);
+    }
     mState = StorageState::ACTIVE;
 
-    // Populate list of multi-page index entries.
-    TBlobIndexList blobIdxList;
-    populateBlobIndices(blobIdxList);
+    if (fastMount) {
+        // Remove data chunks without parent multi-page index, looking the index up
+        eraseOrphanDataChunks(chunkList);
+    } else {
+        // Populate list of multi-page index entries.
+        TBlobIndexList blobIdxList;
+        populateBlobIndices(blobIdxList);
 
-    // Remove the entries for which there is no parent multi-page index.
-    eraseOrphanDataBlobs(blobIdxList);
+        // Remove the entries for which there is no parent multi-page index.
+        eraseOrphanDataBlobs(blobIdxList);
 
-    // Purge the blob index list
-    blobIdxList.clearAndFreeNodes();
+        // Purge the blob index list
+        blobIdxList.clearAndFreeNodes();
+    }
 
 #ifndef ESP_PLATFORM
     debugCheck();
@@ -128,6 +214,242 @@ esp_err_t Storage::init(uint32_t baseSector, uint32_t sectorCount)
     return ESP_OK;
 }
 
+void Storage::loadNamespace(Item& item)
+{
+    NamespaceEntry* entry = new NamespaceEntry;
+    item.getKey(entry->mName, sizeof(entry->mName) - 1);
+    item.getValue(entry->mIndex);
+    mNamespaces.push_back(entry);
+    mNamespaceUsage.set(entry->mIndex, true);
+}
+
+esp_err_t Storage::loadSnapshots(TBlobChunkList& chunkList)
+{
+    mSnapshotSeq.reset(new uint32_t[mPageManager.getPageCount()]);
+    std::fill_n(mSnapshotSeq.get(), mPageManager.getPageCount(), UINT32_MAX);
+
+    // The snapshot of a page is written after the page got full, so it is on a newer page.
+    // Going from the newest page, it is always on a page which has been loaded already.
+    for (auto it = intrusive_list<Page>::iterator(&mPageManager.back()); it != mPageManager.end(); --it) {
+        Page& p = *it;
+        if (!p.isLoadDeferred()) {
+            continue;
+        }
+        auto err = loadSnapshot(p, chunkList);
+        if (err == ESP_ERR_NVS_NOT_FOUND) {
+            err = p.loadEntries();
+        }
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t Storage::loadSnapshot(Page& page, TBlobChunkList& chunkList)
+{
+    uint32_t seqNumber;
+    if (page.getSeqNumber(seqNumber) != ESP_OK) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+
+    char key[Item::MAX_KEY_LENGTH + 1];
+    getSnapshotKey(page, key);
+    Page* findPage = nullptr;
+    Item item;
+    auto err = findItem(NS_SNAPSHOT, ItemType::BLOB_IDX, key, findPage, item);
+    if (err != ESP_OK) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    size_t size = item.blobIndex.dataSize;
+    if (size < sizeof(SnapshotHeader) || size > SNAPSHOT_MAX_SIZE) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    std::unique_ptr<uint32_t[]> buf(new (std::nothrow) uint32_t[size / sizeof(uint32_t) + 1]);
+    if (!buf) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    err = readMultiPageBlob(NS_SNAPSHOT, key, buf.get(), size);
+    if (err != ESP_OK) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+
+    // page sequence numbers are never reused, a snapshot of an erased page doesn't match
+    SnapshotHeader header;
+    memcpy(&header, buf.get(), sizeof(header));
+    if (header.mSeqNumber != seqNumber || header.mVersion != SNAPSHOT_VERSION ||
+            size != sizeof(header) + header.mNodeCount * sizeof(uint32_t) + header.mNsCount + header.mChunkCount) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    const uint32_t* nodes = buf.get() + sizeof(header) / sizeof(uint32_t);
+    const uint8_t* nsEntries = reinterpret_cast<const uint8_t*>(nodes + header.mNodeCount);
+    const uint8_t* chunkEntries = nsEntries + header.mNsCount;
+
+    err = page.loadHashList(nodes, header.mNodeCount);
+    if (err != ESP_OK) {
+        return err;
+    }
+    mSnapshotSeq[page.getSectorNumber() - mPageManager.getBaseSector()] = seqNumber;
+
+    for (size_t i = 0; i < header.mNsCount; ++i) {
+        size_t itemIndex = nsEntries[i];
+        if (page.findItem(Page::NS_INDEX, ItemType::U8, nullptr, itemIndex, item) == ESP_OK && itemIndex == nsEntries[i]) {
+            loadNamespace(item);
+        }
+    }
+    for (size_t i = 0; i < header.mChunkCount; ++i) {
+        BlobChunkNode* entry = new BlobChunkNode;
+        entry->mPage = &page;
+        entry->mIndex = chunkEntries[i];
+        chunkList.push_back(entry);
+    }
+    return ESP_OK;
+}
+
+esp_err_t Storage::writeSnapshot(Page& page)
+{
+    uint32_t seqNumber;
+    auto err = page.getSeqNumber(seqNumber);
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    std::unique_ptr<uint32_t[]> buf(new (std::nothrow) uint32_t[SNAPSHOT_MAX_SIZE / sizeof(uint32_t) + 1]);
+    if (!buf) {
+        return ESP_ERR_NO_MEM;
+    }
+    uint32_t* nodes = buf.get() + sizeof(SnapshotHeader) / sizeof(uint32_t);
+    uint8_t nsEntries[Page::ENTRY_COUNT];
+    uint8_t chunkEntries[Page::ENTRY_COUNT];
+    SnapshotHeader header;
+    header.mSeqNumber = seqNumber;
+    header.mVersion = SNAPSHOT_VERSION;
+    header.mNodeCount = 0;
+    header.mNsCount = 0;
+    header.mChunkCount = 0;
+
+    size_t itemIndex = 0;
+    Item item;
+    while (page.findItem(Page::NS_ANY, ItemType::ANY, nullptr, itemIndex, item) == ESP_OK) {
+        nodes[header.mNodeCount++] = (item.calculateCrc32WithoutValue() & 0xffffff) | (itemIndex << 24);
+        if (item.nsIndex == Page::NS_INDEX) {
+            nsEntries[header.mNsCount++] = itemIndex;
+        } else if (item.datatype == ItemType::BLOB_DATA) {
+            chunkEntries[header.mChunkCount++] = itemIndex;
+        }
+        itemIndex += item.span;
+    }
+    memcpy(buf.get(), &header, sizeof(header));
+    uint8_t* tail = reinterpret_cast<uint8_t*>(nodes + header.mNodeCount);
+    memcpy(tail, nsEntries, header.mNsCount);
+    memcpy(tail + header.mNsCount, chunkEntries, header.mChunkCount);
+    size_t size = tail + header.mNsCount + header.mChunkCount - reinterpret_cast<uint8_t*>(buf.get());
+
+    char key[Item::MAX_KEY_LENGTH + 1];
+    getSnapshotKey(page, key);
+    const uint32_t pageIndex = page.getSectorNumber() - mPageManager.getBaseSector();
+    err = writeItem(NS_SNAPSHOT, ItemType::BLOB, key, buf.get(), size);
+    if (err != ESP_OK) {
+        return err;
+    }
+    mSnapshotSeq[pageIndex] = seqNumber;
+    return ESP_OK;
+}
+
+esp_err_t Storage::writeSnapshots()
+{
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+    if (!mFastMount) {
+        return ESP_OK;
+    }
+
+    // Writing snapshots may fill up pages which need a snapshot in turn
+    for (uint32_t n = 0; n < mPageManager.getPageCount(); ++n) {
+        Page* page = nullptr;
+        for (auto it = mPageManager.begin(); it != mPageManager.end(); ++it) {
+            if (it->state() == Page::PageState::FULL && !hasCurrentSnapshot(*it)) {
+                page = it;
+                break;
+            }
+        }
+        if (page == nullptr) {
+            break;
+        }
+
+        // leave the last free pages to the application, pages without snapshot are loaded in full
+        nvs_stats_t stats = {};
+        auto err = mPageManager.fillStats(stats);
+        if (err != ESP_OK) {
+            return err;
+        }
+        if (stats.free_entries < Page::ENTRY_COUNT * 2 + SNAPSHOT_MAX_SIZE / Page::ENTRY_SIZE) {
+            break;
+        }
+
+        err = writeSnapshot(*page);
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    return ESP_OK;
+}
+
+bool Storage::hasCurrentSnapshot(const Page& page)
+{
+    uint32_t seqNumber;
+    return mSnapshotSeq && page.getSeqNumber(seqNumber) == ESP_OK &&
+           mSnapshotSeq[page.getSectorNumber() - mPageManager.getBaseSector()] == seqNumber;
+}
+
+void Storage::getSnapshotKey(const Page& page, char* key)
+{
+    snprintf(key, Item::MAX_KEY_LENGTH + 1, "%u",
+             static_cast<unsigned>(page.getSectorNumber() - mPageManager.getBaseSector()));
+}
+
+bool Storage::hasBlobIndex(const Item& item)
+{
+    VerOffset chunkStart = (item.chunkIndex >= static_cast<uint8_t>(VerOffset::VER_1_OFFSET)) ?
+                           VerOffset::VER_1_OFFSET : VerOffset::VER_0_OFFSET;
+    Page* findPage = nullptr;
+    Item blobIndex;
+    if (findItem(item.nsIndex, ItemType::BLOB_IDX, item.key, findPage, blobIndex, Page::CHUNK_ANY, chunkStart) != ESP_OK) {
+        return false;
+    }
+    return item.chunkIndex < static_cast<uint8_t>(chunkStart) + blobIndex.blobIndex.chunkCount;
+}
+
+void Storage::eraseOrphanDataChunks(TBlobChunkList& chunkList)
+{
+    for (auto it = mPageManager.begin(); it != mPageManager.end(); ++it) {
+        Page& p = *it;
+        if (hasCurrentSnapshot(p)) {
+            continue;
+        }
+        size_t itemIndex = 0;
+        Item item;
+        while (p.findItem(Page::NS_ANY, ItemType::BLOB_DATA, nullptr, itemIndex, item) == ESP_OK) {
+            if (!hasBlobIndex(item)) {
+                p.eraseItem(item.nsIndex, item.datatype, item.key, item.chunkIndex);
+            }
+            itemIndex += item.span;
+        }
+    }
+
+    // data chunks of the pages loaded from a snapshot are listed in the snapshot
+    for (auto it = chunkList.begin(); it != chunkList.end(); ++it) {
+        size_t itemIndex = it->mIndex;
+        Item item;
+        if (it->mPage->findItem(Page::NS_ANY, ItemType::BLOB_DATA, nullptr, itemIndex, item) == ESP_OK &&
+                itemIndex == it->mIndex && !hasBlobIndex(item)) {
+            it->mPage->eraseItem(item.nsIndex, item.datatype, item.key, item.chunkIndex);
+        }
+    }
+    chunkList.clearAndFreeNodes();
+}
+
 bool Storage::isValid() const
 {
     return mState == StorageState::ACTIVE;
@@ -135,6 +457,34 @@ bool Storage::isValid() const
 
 esp_err_t Storage::findItem(uint8_t nsIndex, ItemType datatype, const char* key, Page* &page, Item& item, uint8_t chunkIdx, VerOffset chunkStart)
 {
+    // the index only knows the exact <namespace, key, chunk>, same as the page hash lists
+    if (mItemIndex.isValid() && nsIndex != Page::NS_ANY && datatype != ItemType::ANY && key != nullptr) {
+        Page* foundPage = nullptr;
+        uint32_t foundSeqNumber = 0;
+        size_t pos = 0;
+        Page* candidate;
+        size_t candidateIndex;
+        Item candidateItem;
+        while (mItemIndex.find(Item(nsIndex, datatype, 0, key, chunkIdx), pos, candidate, candidateIndex)) {
+            uint32_t seqNumber;
+            if (candidate->getSeqNumber(seqNumber) != ESP_OK || (foundPage && seqNumber >= foundSeqNumber)) {
+                continue;
+            }
+            // pages are searched oldest first, keep this order if the key is present twice
+            auto err = candidate->findItem(nsIndex, datatype, key, candidateIndex, candidateItem, chunkIdx, chunkStart);
+            if (err == ESP_OK) {
+                foundPage = candidate;
+                foundSeqNumber = seqNumber;
+                item = candidateItem;
+            }
+        }
+        if (foundPage == nullptr) {
+            return ESP_ERR_NVS_NOT_FOUND;
+        }
+        page = foundPage;
+        return ESP_OK;
+    }
+
     for (auto it = std::begin(mPageManager); it != std::end(mPageManager); ++it) {
         size_t itemIndex = 0;
         auto err = it->findItem(nsIndex, datatype, key, itemIndex, item, chunkIdx, chunkStart);
@@ -251,6 +601,18 @@ esp_err_t Storage::writeItem(uint8_t nsIndex, ItemType datatype, const char* key
         return ESP_ERR_NVS_NOT_INITIALIZED;
     }
 
+    if (!isVariableLengthType(datatype) && mWriteCache.isEnabled(nsIndex, key)) {
+        auto err = mWriteCache.write(nsIndex, datatype, key, data, dataSize);
+        if (err == ESP_ERR_NVS_NOT_ENOUGH_SPACE) {
+            err = flushWriteBack();
+            if (err != ESP_OK) {
+                return err;
+            }
+            err = mWriteCache.write(nsIndex, datatype, key, data, dataSize);
+        }
+        return err;
+    }
+
     Page* findPage = nullptr;
     Item item;
 
@@ -357,6 +719,136 @@ esp_err_t Storage::writeItem(uint8_t nsIndex, ItemType datatype, const char* key
     return ESP_OK;
 }
 
+esp_err_t Storage::writeBatch(uint8_t nsIndex, WriteBatch& batch)
+{
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+    if (batch.empty()) {
+        return ESP_OK;
+    }
+
+    // make room before looking up the old values, so that they are not moved by a page erase
+    Page* page = &getCurrentPage();
+    auto err = page->beginBatch(batch.getEntryCount());
+    for (size_t i = 0; err == ESP_ERR_NVS_PAGE_FULL && i < mPageManager.getPageCount(); ++i) {
+        if (page->state() != Page::PageState::FULL) {
+            err = page->markFull();
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+        err = mPageManager.requestNewPage();
+        if (err != ESP_OK) {
+            return err;
+        }
+        page = &getCurrentPage();
+        err = page->beginBatch(batch.getEntryCount());
+    }
+    if (err == ESP_ERR_NVS_PAGE_FULL) {
+        return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    }
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    for (auto it = batch.mItems.begin(); it != batch.mItems.end(); ++it) {
+        Item item;
+        it->mOldPage = nullptr;
+        err = findItem(nsIndex, it->mDatatype, it->mKey, it->mOldPage, item);
+        if (err != ESP_OK && err != ESP_ERR_NVS_NOT_FOUND) {
+            page->abortBatch();
+            return err;
+        }
+    }
+    for (auto it = batch.mItems.begin(); it != batch.mItems.end(); ++it) {
+        err = page->writeItem(nsIndex, it->mDatatype, it->mKey, it->mData.get(), it->mDataSize);
+        if (err != ESP_OK) {
+            page->abortBatch();
+            return err;
+        }
+    }
+    err = page->commitBatch();
+    if (err != ESP_OK) {
+        return err;
+    }
+
+    // old values on the batch page come first, eraseItem doesn't find the new ones
+    for (auto it = batch.mItems.begin(); it != batch.mItems.end(); ++it) {
+        mWriteCache.erase(nsIndex, it->mDatatype, it->mKey);
+        if (it->mOldPage == nullptr) {
+            continue;
+        }
+        err = it->mOldPage->eraseItem(nsIndex, it->mDatatype, it->mKey);
+        if (err == ESP_ERR_FLASH_OP_FAIL) {
+            return ESP_ERR_NVS_REMOVE_FAILED;
+        }
+        if (err != ESP_OK) {
+            return err;
+        }
+    }
+    batch.clear();
+#ifndef ESP_PLATFORM
+    debugCheck();
+#endif
+    return ESP_OK;
+}
+
+esp_err_t Storage::enableWriteBack(uint8_t nsIndex, const char* key, size_t capacity)
+{
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+    // all values of a namespace have to fit into one batch
+    if (capacity > Page::ENTRY_COUNT) {
+        capacity = Page::ENTRY_COUNT;
+    }
+    return mWriteCache.enable(nsIndex, key, capacity);
+}
+
+esp_err_t Storage::disableWriteBack(uint8_t nsIndex, const char* key)
+{
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+    auto err = flushWriteBack();
+    if (err != ESP_OK) {
+        return err;
+    }
+    mWriteCache.disable(nsIndex, key);
+    return ESP_OK;
+}
+
+esp_err_t Storage::flushWriteBack()
+{
+    if (mState != StorageState::ACTIVE) {
+        return ESP_ERR_NVS_NOT_INITIALIZED;
+    }
+
+    // one batch per namespace, values are dropped from the cache once written
+    while (mWriteCache.size() > 0) {
+        const uint8_t nsIndex = mWriteCache[0].mNsIndex;
+        WriteBatch batch;
+        for (size_t i = 0; i < mWriteCache.size(); ++i) {
+            const WriteCache::Entry& e = mWriteCache[i];
+            if (e.mNsIndex != nsIndex) {
+                continue;
+            }
+            auto err = batch.add(e.mDatatype, e.mKey, e.mData, e.mDataSize);
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+        const size_t count = batch.getEntryCount();
+        auto err = writeBatch(nsIndex, batch);
+        if (err != ESP_OK) {
+            return err;
+        }
+        mWriteCache.addFlushedCount(count);
+    }
+    return ESP_OK;
+}
+
 esp_err_t Storage::createOrOpenNamespace(const char* nsName, bool canCreate, uint8_t& nsIndex)
 {
     if (mState != StorageState::ACTIVE) {
@@ -449,6 +941,13 @@ esp_err_t Storage::readItem(uint8_t nsIndex, ItemType datatype, const char* key,
         return ESP_ERR_NVS_NOT_INITIALIZED;
     }
 
+    if (!isVariableLengthType(datatype) && mWriteCache.size() > 0) {
+        auto err = mWriteCache.read(nsIndex, datatype, key, data, dataSize);
+        if (err != ESP_ERR_NVS_NOT_FOUND) {
+            return err;
+        }
+    }
+
     Item item;
     Page* findPage = nullptr;
     if (datatype == ItemType::BLOB) {
@@ -521,9 +1020,14 @@ esp_err_t Storage::eraseItem(uint8_t nsIndex, ItemType datatype, const char* key
         return eraseMultiPageBlob(nsIndex, key);
     }
 
+    bool cached = mWriteCache.erase(nsIndex, datatype, key);
+
     Item item;
     Page* findPage = nullptr;
     auto err = findItem(nsIndex, datatype, key, findPage, item);
+    if (err == ESP_ERR_NVS_NOT_FOUND && cached) {
+        return ESP_OK;
+    }
     if (err != ESP_OK) {
         return err;
     }
@@ -537,6 +1041,8 @@ esp_err_t Storage::eraseNamespace(uint8_t nsIndex)
         return ESP_ERR_NVS_NOT_INITIALIZED;
     }
 
+    mWriteCache.eraseNamespace(nsIndex);
+
     for (auto it = std::begin(mPageManager); it != std::end(mPageManager); ++it) {
         while (true) {
             auto err = it->eraseItem(nsIndex, ItemType::ANY, nullptr);
@@ -603,11 +1109,13 @@ void Storage::debugCheck()
                 assert(0);
             }
             keys.insert(std::make_pair(keystr, static_cast<Page*>(p)));
+            assert(!mItemIndex.isValid() || mItemIndex.contains(item, static_cast<Page*>(p), itemIndex));
             itemIndex += item.span;
             usedCount += item.span;
         }
         assert(usedCount == p->getUsedEntryCount());
     }
+    assert(!mItemIndex.isValid() || mItemIndex.size() == keys.size());
 }
 #endif //ESP_PLATFORM
 
@@ -644,4 +1152,78 @@ esp_err_t Storage::calcEntriesInNamespace(uint8_t nsIndex, size_t& usedEntries)
     return ESP_OK;
 }
 
+bool Storage::findEntry(nvs_opaque_iterator_t* it, const char* nsName)
+{
+    it->nsIndex = Page::NS_ANY;
+    it->entryIndex = 0;
+    it->cacheIndex = 0;
+    it->page = mPageManager.begin();
+
+    if (nsName != nullptr && createOrOpenNamespace(nsName, false, it->nsIndex) != ESP_OK) {
+        return false;
+    }
+    return nextEntry(it);
+}
+
+bool Storage::nextEntry(nvs_opaque_iterator_t* it)
+{
+    Item item;
+    for (; it->page != mPageManager.end(); ++it->page, it->entryIndex = 0) {
+        // only the entry headers get read, values are left in flash
+        while (it->page->findItem(it->nsIndex, ItemType::ANY, nullptr, it->entryIndex, item) == ESP_OK) {
+            it->entryIndex += item.span;
+            if (fillEntryInfo(it, item.nsIndex, item.datatype, item.key)) {
+                return true;
+            }
+        }
+    }
+
+    // values set while writing back, which are not in flash yet
+    while (it->cacheIndex < mWriteCache.size()) {
+        const WriteCache::Entry& entry = mWriteCache[it->cacheIndex++];
+        Page* page;
+        if ((it->nsIndex == Page::NS_ANY || entry.mNsIndex == it->nsIndex)
+                && findItem(entry.mNsIndex, entry.mDatatype, entry.mKey, page, item) == ESP_ERR_NVS_NOT_FOUND
+                && fillEntryInfo(it, entry.mNsIndex, entry.mDatatype, entry.mKey)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Storage::fillEntryInfo(nvs_opaque_iterator_t* it, uint8_t nsIndex, ItemType datatype, const char* key)
+{
+    nvs_type_t type;
+    switch (datatype) {
+    case ItemType::BLOB_DATA:
+        // chunks are listed by their blob index
+        return false;
+    case ItemType::BLOB:
+    case ItemType::BLOB_IDX:
+        type = NVS_TYPE_BLOB;
+        break;
+    default:
+        type = static_cast<nvs_type_t>(datatype);
+        break;
+    }
+    if (it->type != NVS_TYPE_ANY && it->type != type) {
+        return false;
+    }
+
+    // namespace entries themselves and internal items have no namespace name
+    auto ns = std::find_if(mNamespaces.begin(), mNamespaces.end(), [=] (const NamespaceEntry& e) -> bool {
+        return e.mIndex == nsIndex;
+    });
+    if (nsIndex == Page::NS_INDEX || ns == std::end(mNamespaces)) {
+        return false;
+    }
+
+    strncpy(it->entry_info.namespace_name, ns->mName, sizeof(it->entry_info.namespace_name) - 1);
+    it->entry_info.namespace_name[sizeof(it->entry_info.namespace_name) - 1] = 0;
+    strncpy(it->entry_info.key, key, sizeof(it->entry_info.key) - 1);
+    it->entry_info.key[sizeof(it->entry_info.key) - 1] = 0;
+    it->entry_info.type = type;
+    return true;
+}
+
 }
@@ -21,12 +21,56 @@
 #include "nvs_types.hpp"
 #include "nvs_page.hpp"
 #include "nvs_pagemanager.hpp"
+#include "nvs_write_cache.hpp"
 
 //extern void dumpBytes(const uint8_t* data, size_t count);
 
 namespace nvs
 {
 
+/**
+ * Items of a namespace which are written together by Storage::writeBatch().
+ * Only fixed size items and strings can be part of a batch, and all of them
+ * have to fit into a single page.
+ */
+class WriteBatch
+{
+public:
+    ~WriteBatch()
+    {
+        clear();
+    }
+
+    esp_err_t add(ItemType datatype, const char* key, const void* data, size_t dataSize);
+
+    void clear();
+
+    size_t getEntryCount() const
+    {
+        return mEntryCount;
+    }
+
+    bool empty() const
+    {
+        return mItems.empty();
+    }
+
+protected:
+    friend class Storage;
+
+    struct BatchItem : public intrusive_list_node<BatchItem> {
+        ItemType mDatatype;
+        char mKey[Item::MAX_KEY_LENGTH + 1];
+        size_t mDataSize;
+        size_t mEntryCount;
+        std::unique_ptr<uint8_t[]> mData;
+        Page* mOldPage;
+    };
+
+    intrusive_list<BatchItem> mItems;
+    size_t mEntryCount = 0;
+};
+
 class Storage : public intrusive_list_node<Storage>
 {
     enum class StorageState : uint32_t {
@@ -58,12 +102,34 @@ class Storage : public intrusive_list_node<Storage>
 
     typedef intrusive_list<BlobIndexNode> TBlobIndexList;
 
+    struct BlobChunkNode: public intrusive_list_node<BlobChunkNode> {
+        public:
+            Page* mPage;
+            size_t mIndex;
+    };
+
+    typedef intrusive_list<BlobChunkNode> TBlobChunkList;
+
+    /* Hash list of a full page, saved as blob "<page number>" in namespace NS_SNAPSHOT,
+     * followed by the nodes, the entry indices of namespace entries and those of blob data chunks */
+    struct SnapshotHeader {
+        uint32_t mSeqNumber;
+        uint8_t mVersion;
+        uint8_t mNodeCount;
+        uint8_t mNsCount;
+        uint8_t mChunkCount;
+    };
+
 public:
     ~Storage();
 
     Storage(const char *pName = NVS_DEFAULT_PART_NAME) : mPartitionName(pName) { };
 
-    esp_err_t init(uint32_t baseSector, uint32_t sectorCount);
+    /**
+     * With fastMount, full pages which have a snapshot of their hash list
+     * are not read at init. Snapshots are saved by writeSnapshots().
+     */
+    esp_err_t init(uint32_t baseSector, uint32_t sectorCount, bool fastMount = false);
 
     bool isValid() const;
 
@@ -71,6 +137,12 @@ public:
 
     esp_err_t writeItem(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize);
 
+    /**
+     * Write all items of the batch into consecutive entries of one page, which
+     * become visible at once. Replaced values are erased afterwards.
+     */
+    esp_err_t writeBatch(uint8_t nsIndex, WriteBatch& batch);
+
     esp_err_t readItem(uint8_t nsIndex, ItemType datatype, const char* key, void* data, size_t dataSize);
 
     esp_err_t getItemDataSize(uint8_t nsIndex, ItemType datatype, const char* key, size_t& dataSize);
@@ -119,6 +191,34 @@ public:
 
     esp_err_t calcEntriesInNamespace(uint8_t nsIndex, size_t& usedEntries);
 
+    esp_err_t writeSnapshots();
+
+    /**
+     * Keep values of fixed size types set for the key, or for the whole namespace
+     * if key is nullptr, in RAM until flushWriteBack() is called. Up to capacity
+     * values may be held, setting more flushes them.
+     */
+    esp_err_t enableWriteBack(uint8_t nsIndex, const char* key, size_t capacity);
+
+    esp_err_t disableWriteBack(uint8_t nsIndex, const char* key);
+
+    esp_err_t flushWriteBack();
+
+    const WriteCache& getWriteCache() const
+    {
+        return mWriteCache;
+    }
+
+    /**
+     * Position the iterator on the first item of the namespace, or of any
+     * namespace if nsName is nullptr.
+     *
+     * @return false if there is no such item
+     */
+    bool findEntry(nvs_opaque_iterator_t* it, const char* nsName);
+
+    bool nextEntry(nvs_opaque_iterator_t* it);
+
 protected:
 
     Page& getCurrentPage()
@@ -132,20 +232,60 @@ protected:
 
     void eraseOrphanDataBlobs(TBlobIndexList&);
 
+    void loadNamespace(Item& item);
+
+    esp_err_t loadSnapshots(TBlobChunkList& chunkList);
+
+    esp_err_t loadSnapshot(Page& page, TBlobChunkList& chunkList);
+
+    esp_err_t writeSnapshot(Page& page);
+
+    bool hasCurrentSnapshot(const Page& page);
+
+    void getSnapshotKey(const Page& page, char* key);
+
+    bool hasBlobIndex(const Item& item);
+
+    void eraseOrphanDataChunks(TBlobChunkList& chunkList);
 
     esp_err_t findItem(uint8_t nsIndex, ItemType datatype, const char* key, Page* &page, Item& item, uint8_t chunkIdx = Page::CHUNK_ANY, VerOffset chunkStart = VerOffset::VER_ANY);
 
+    bool fillEntryInfo(nvs_opaque_iterator_t* it, uint8_t nsIndex, ItemType datatype, const char* key);
+
 protected:
     const char *mPartitionName;
     size_t mPageCount;
     PageManager mPageManager;
+    ItemIndex mItemIndex;
+    WriteCache mWriteCache;
     TNamespaces mNamespaces;
     CompressedEnumTable<bool, 1, 256> mNamespaceUsage;
     StorageState mState = StorageState::INVALID;
+    bool mFastMount = false;
+    std::unique_ptr<uint32_t[]> mSnapshotSeq;
+
+    static const uint8_t NS_SNAPSHOT = 254;
+    static const uint8_t SNAPSHOT_VERSION = 1;
+    static const size_t SNAPSHOT_MAX_SIZE = sizeof(SnapshotHeader) + Page::ENTRY_COUNT * (sizeof(uint32_t) + 1);
 };
 
 } // namespace nvs
 
+/**
+ * Position of an iteration over the items of a storage: entries of the pages
+ * first, then values only held by the write-back cache.
+ */
+struct nvs_opaque_iterator_t
+{
+    nvs_type_t type;
+    uint8_t nsIndex;
+    size_t entryIndex;
+    size_t cacheIndex;
+    nvs::Storage *storage;
+    intrusive_list<nvs::Page>::iterator page;
+    nvs_entry_info_t entry_info;
+};
+
 
 
 #endif /* nvs_storage_hpp */
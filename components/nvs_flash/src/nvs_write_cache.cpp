@@ -0,0 +1,162 @@
+// Copyright 2015-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <new>
+#include <cstring>
+#include <cassert>
+#include "nvs_write_cache.hpp"
+
+namespace nvs
+{
+
+esp_err_t WriteCache::enable(uint8_t nsIndex, const char* key, size_t capacity)
+{
+    if (key != nullptr && strlen(key) > Item::MAX_KEY_LENGTH) {
+        return ESP_ERR_NVS_KEY_TOO_LONG;
+    }
+    if (!mEntries) {
+        if (capacity == 0) {
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+        mEntries.reset(new (std::nothrow) Entry[capacity]);
+        if (!mEntries) {
+            return ESP_ERR_NO_MEM;
+        }
+        mCapacity = capacity;
+    }
+    if (isEnabled(nsIndex, key)) {
+        return ESP_OK;
+    }
+
+    Rule* rule = new (std::nothrow) Rule;
+    if (rule == nullptr) {
+        return ESP_ERR_NO_MEM;
+    }
+    rule->mNsIndex = nsIndex;
+    rule->mKey[0] = 0;
+    if (key != nullptr) {
+        strncpy(rule->mKey, key, sizeof(rule->mKey) - 1);
+        rule->mKey[sizeof(rule->mKey) - 1] = 0;
+    }
+    mRules.push_back(rule);
+    return ESP_OK;
+}
+
+void WriteCache::disable(uint8_t nsIndex, const char* key)
+{
+    for (auto it = mRules.begin(); it != mRules.end();) {
+        auto rule = it++;
+        if (rule->mNsIndex == nsIndex &&
+                (key == nullptr || strncmp(rule->mKey, key, sizeof(rule->mKey)) == 0)) {
+            mRules.erase(rule);
+            delete static_cast<Rule*>(rule);
+        }
+    }
+}
+
+bool WriteCache::isEnabled(uint8_t nsIndex, const char* key)
+{
+    for (auto it = mRules.begin(); it != mRules.end(); ++it) {
+        if (it->mNsIndex == nsIndex &&
+                (it->mKey[0] == 0 || (key != nullptr && strncmp(it->mKey, key, sizeof(it->mKey)) == 0))) {
+            return true;
+        }
+    }
+    return false;
+}
+
+WriteCache::Entry* WriteCache::find(uint8_t nsIndex, ItemType datatype, const char* key) const
+{
+    for (size_t i = 0; i < mCount; ++i) {
+        Entry& e = mEntries[i];
+        if (e.mNsIndex == nsIndex && (datatype == ItemType::ANY || e.mDatatype == datatype) &&
+                strncmp(e.mKey, key, sizeof(e.mKey)) == 0) {
+            return &e;
+        }
+    }
+    return nullptr;
+}
+
+void WriteCache::remove(size_t i)
+{
+    // entries are kept packed, order doesn't matter
+    mEntries[i] = mEntries[mCount - 1];
+    --mCount;
+}
+
+esp_err_t WriteCache::write(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize)
+{
+    if (strlen(key) > Item::MAX_KEY_LENGTH) {
+        return ESP_ERR_NVS_KEY_TOO_LONG;
+    }
+    assert(dataSize <= sizeof(Entry::mData));
+
+    Entry* e = find(nsIndex, datatype, key);
+    if (e == nullptr) {
+        if (mCount == mCapacity) {
+            return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+        }
+        e = &mEntries[mCount++];
+        e->mNsIndex = nsIndex;
+        e->mDatatype = datatype;
+        strncpy(e->mKey, key, sizeof(e->mKey) - 1);
+        e->mKey[sizeof(e->mKey) - 1] = 0;
+    }
+    memcpy(e->mData, data, dataSize);
+    e->mDataSize = dataSize;
+    ++mSetCount;
+    return ESP_OK;
+}
+
+esp_err_t WriteCache::read(uint8_t nsIndex, ItemType datatype, const char* key, void* data, size_t dataSize) const
+{
+    Entry* e = find(nsIndex, datatype, key);
+    if (e == nullptr) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (dataSize != e->mDataSize) {
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    memcpy(data, e->mData, dataSize);
+    return ESP_OK;
+}
+
+bool WriteCache::erase(uint8_t nsIndex, ItemType datatype, const char* key)
+{
+    bool found = false;
+    for (size_t i = 0; i < mCount;) {
+        Entry& e = mEntries[i];
+        if (e.mNsIndex == nsIndex && (datatype == ItemType::ANY || e.mDatatype == datatype) &&
+                strncmp(e.mKey, key, sizeof(e.mKey)) == 0) {
+            remove(i);
+            found = true;
+        } else {
+            ++i;
+        }
+    }
+    return found;
+}
+
+void WriteCache::eraseNamespace(uint8_t nsIndex)
+{
+    for (size_t i = 0; i < mCount;) {
+        if (mEntries[i].mNsIndex == nsIndex) {
+            remove(i);
+        } else {
+            ++i;
+        }
+    }
+}
+
+} // namespace nvs
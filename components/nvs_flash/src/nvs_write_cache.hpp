@@ -0,0 +1,139 @@
+// Copyright 2015-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef nvs_write_cache_h
+#define nvs_write_cache_h
+
+#include <memory>
+#include "nvs.h"
+#include "nvs_types.hpp"
+#include "intrusive_list.h"
+
+namespace nvs
+{
+
+/**
+ * Write-back cache for values of fixed size types. Caching is enabled for a
+ * whole namespace or for single keys. Values set for these keys are kept in
+ * RAM, replacing the ones in flash for reads, until Storage flushes them.
+ * A value set several times between two flushes is written only once.
+ *
+ * Only dirty values are held, so the capacity is the limit of values which
+ * may be lost on power failure.
+ */
+class WriteCache
+{
+public:
+    struct Entry {
+        uint8_t mNsIndex;
+        ItemType mDatatype;
+        char mKey[Item::MAX_KEY_LENGTH + 1];
+        uint8_t mData[8];
+        uint8_t mDataSize;
+    };
+
+    ~WriteCache()
+    {
+        mRules.clearAndFreeNodes();
+    }
+
+    /**
+     * Cache values of the given key, or of the whole namespace if key is nullptr.
+     * Entries are allocated by the first call, with the given capacity.
+     */
+    esp_err_t enable(uint8_t nsIndex, const char* key, size_t capacity);
+
+    /**
+     * Stop caching values of the key or namespace. Values of these keys
+     * have to be flushed first.
+     */
+    void disable(uint8_t nsIndex, const char* key);
+
+    bool isEnabled(uint8_t nsIndex, const char* key);
+
+    /**
+     * @return ESP_ERR_NVS_NOT_ENOUGH_SPACE if all entries are taken by other keys
+     */
+    esp_err_t write(uint8_t nsIndex, ItemType datatype, const char* key, const void* data, size_t dataSize);
+
+    /**
+     * @return ESP_ERR_NVS_NOT_FOUND if the value isn't in the cache
+     */
+    esp_err_t read(uint8_t nsIndex, ItemType datatype, const char* key, void* data, size_t dataSize) const;
+
+    /**
+     * Drop the value of the key, of any type if datatype is ItemType::ANY.
+     *
+     * @return true if a value has been dropped
+     */
+    bool erase(uint8_t nsIndex, ItemType datatype, const char* key);
+
+    void eraseNamespace(uint8_t nsIndex);
+
+    void clear()
+    {
+        mCount = 0;
+    }
+
+    size_t size() const
+    {
+        return mCount;
+    }
+
+    size_t capacity() const
+    {
+        return mCapacity;
+    }
+
+    const Entry& operator[](size_t i) const
+    {
+        return mEntries[i];
+    }
+
+    size_t getSetCount() const
+    {
+        return mSetCount;
+    }
+
+    size_t getFlushedCount() const
+    {
+        return mFlushedCount;
+    }
+
+    void addFlushedCount(size_t count)
+    {
+        mFlushedCount += count;
+    }
+
+protected:
+    struct Rule : public intrusive_list_node<Rule> {
+        uint8_t mNsIndex;
+        char mKey[Item::MAX_KEY_LENGTH + 1];
+    };
+
+    Entry* find(uint8_t nsIndex, ItemType datatype, const char* key) const;
+
+    void remove(size_t i);
+
+    std::unique_ptr<Entry[]> mEntries;
+    size_t mCapacity = 0;
+    size_t mCount = 0;
+    size_t mSetCount = 0;
+    size_t mFlushedCount = 0;
+    intrusive_list<Rule> mRules;
+};
+
+} // namespace nvs
+
+#endif /* nvs_write_cache_h */
@@ -397,6 +397,377 @@ TEST_CASE("storage can find items on second page if first is not fully written a
 }
 
 
+TEST_CASE("storage item index follows items moved to other pages", "[nvs]")
+{
+    const size_t pageCount = 16;
+    const size_t keyCount = Page::ENTRY_COUNT * (pageCount - 4);
+    SpiFlashEmulator emu(pageCount);
+    Storage storage;
+    CHECK(storage.init(0, pageCount) == ESP_OK);
+    char name[Item::MAX_KEY_LENGTH + 1];
+    for (size_t i = 0; i < keyCount; ++i) {
+        snprintf(name, sizeof(name), "key%05d", static_cast<int>(i));
+        REQUIRE(storage.writeItem(1, name, static_cast<int>(i)) == ESP_OK);
+    }
+    // rewrite keys of the first pages so that they get moved by page erase
+    for (size_t i = 0; i < Page::ENTRY_COUNT * 3; ++i) {
+        snprintf(name, sizeof(name), "key%05d", static_cast<int>(i % 64));
+        REQUIRE(storage.writeItem(1, name, static_cast<int>(i % 64 + 1)) == ESP_OK);
+    }
+
+    int val;
+    CHECK(storage.readItem(1, "missing", val) == ESP_ERR_NVS_NOT_FOUND);
+    CHECK(storage.readItem(2, "key00001", val) == ESP_ERR_NVS_NOT_FOUND);
+
+    for (size_t i = 0; i < keyCount; ++i) {
+        snprintf(name, sizeof(name), "key%05d", static_cast<int>(i));
+        REQUIRE(storage.readItem(1, name, val) == ESP_OK);
+        CHECK(val == static_cast<int>(i < 64 ? i + 1 : i));
+    }
+
+    // index is rebuilt when storage is loaded again
+    Storage storage2;
+    CHECK(storage2.init(0, pageCount) == ESP_OK);
+    REQUIRE(storage2.readItem(1, "key00063", val) == ESP_OK);
+    CHECK(val == 64);
+    CHECK(storage2.readItem(1, "missing", val) == ESP_ERR_NVS_NOT_FOUND);
+}
+
+TEST_CASE("storage fast mount loads full pages from snapshots", "[nvs]")
+{
+    const size_t pageCount = 16;
+    const size_t keyCount = Page::ENTRY_COUNT * 6;
+    SpiFlashEmulator emu(pageCount);
+    uint8_t nsIndex;
+    uint8_t blob[Page::CHUNK_MAX_SIZE * 2];
+    for (size_t i = 0; i < sizeof(blob); ++i) {
+        blob[i] = static_cast<uint8_t>(i);
+    }
+    char name[Item::MAX_KEY_LENGTH + 1];
+    {
+        Storage storage;
+        CHECK(storage.init(0, pageCount, true) == ESP_OK);
+        CHECK(storage.createOrOpenNamespace("fast", true, nsIndex) == ESP_OK);
+        for (size_t i = 0; i < keyCount; ++i) {
+            snprintf(name, sizeof(name), "key%05d", static_cast<int>(i));
+            REQUIRE(storage.writeItem(nsIndex, name, static_cast<int>(i)) == ESP_OK);
+        }
+        REQUIRE(storage.writeItem(nsIndex, ItemType::BLOB, "blob", blob, sizeof(blob)) == ESP_OK);
+        CHECK(storage.writeSnapshots() == ESP_OK);
+    }
+
+    emu.clearStats();
+    {
+        Storage storage;
+        CHECK(storage.init(0, pageCount) == ESP_OK);
+    }
+    const size_t fullReadBytes = emu.getReadBytes();
+
+    emu.clearStats();
+    Storage storage;
+    CHECK(storage.init(0, pageCount, true) == ESP_OK);
+    CHECK(emu.getReadBytes() < fullReadBytes / 2);
+    uint8_t ns2;
+    CHECK(storage.createOrOpenNamespace("fast", false, ns2) == ESP_OK);
+    CHECK(ns2 == nsIndex);
+    int val;
+    for (size_t i = 0; i < keyCount; ++i) {
+        snprintf(name, sizeof(name), "key%05d", static_cast<int>(i));
+        REQUIRE(storage.readItem(nsIndex, name, val) == ESP_OK);
+        CHECK(val == static_cast<int>(i));
+    }
+    uint8_t readBlob[sizeof(blob)];
+    REQUIRE(storage.readItem(nsIndex, ItemType::BLOB, "blob", readBlob, sizeof(readBlob)) == ESP_OK);
+    CHECK(memcmp(blob, readBlob, sizeof(blob)) == 0);
+
+    // overwriting all keys recycles the pages, old snapshots must not be applied to them
+    for (size_t i = 0; i < keyCount; ++i) {
+        snprintf(name, sizeof(name), "key%05d", static_cast<int>(i));
+        REQUIRE(storage.writeItem(nsIndex, name, static_cast<int>(i + 1)) == ESP_OK);
+    }
+    CHECK(storage.writeSnapshots() == ESP_OK);
+    Storage storage2;
+    CHECK(storage2.init(0, pageCount, true) == ESP_OK);
+    for (size_t i = 0; i < keyCount; ++i) {
+        snprintf(name, sizeof(name), "key%05d", static_cast<int>(i));
+        REQUIRE(storage2.readItem(nsIndex, name, val) == ESP_OK);
+        CHECK(val == static_cast<int>(i + 1));
+    }
+    REQUIRE(storage2.readItem(nsIndex, ItemType::BLOB, "blob", readBlob, sizeof(readBlob)) == ESP_OK);
+    CHECK(memcmp(blob, readBlob, sizeof(blob)) == 0);
+}
+
+TEST_CASE("storage batch writes all its entries at once", "[nvs]")
+{
+    SpiFlashEmulator emu(4);
+    Storage storage;
+    CHECK(storage.init(0, 4) == ESP_OK);
+    CHECK(storage.writeItem(1, "first", 1) == ESP_OK);
+    WriteBatch batch;
+    char name[Item::MAX_KEY_LENGTH + 1];
+    for (int i = 0; i < 16; ++i) {
+        snprintf(name, sizeof(name), "key%d", i);
+        REQUIRE(batch.add(ItemType::I32, name, &i, sizeof(i)) == ESP_OK);
+    }
+    const char str[] = "batched string value, longer than one entry";
+    REQUIRE(batch.add(ItemType::SZ, "str", str, sizeof(str)) == ESP_OK);
+    int replaced = 100;
+    REQUIRE(batch.add(ItemType::I32, "key0", &replaced, sizeof(replaced)) == ESP_OK);
+    CHECK(batch.getEntryCount() == 16 + 3);
+    uint8_t blob = 1;
+    CHECK(batch.add(ItemType::BLOB, "blob", &blob, sizeof(blob)) == ESP_ERR_NOT_SUPPORTED);
+
+    emu.clearStats();
+    REQUIRE(storage.writeBatch(1, batch) == ESP_OK);
+    // entries, then the two words of the state table they span
+    CHECK(emu.getWriteOps() == 3);
+    CHECK(batch.empty());
+
+    int val;
+    CHECK(storage.readItem(1, "key0", val) == ESP_OK);
+    CHECK(val == 100);
+    CHECK(storage.readItem(1, "key15", val) == ESP_OK);
+    CHECK(val == 15);
+    char buf[sizeof(str)];
+    CHECK(storage.readItem(1, ItemType::SZ, "str", buf, sizeof(buf)) == ESP_OK);
+    CHECK(strcmp(buf, str) == 0);
+
+    // a batch doesn't fit in a page
+    for (int i = 0; i < 42; ++i) {
+        snprintf(name, sizeof(name), "long%d", i);
+        REQUIRE(batch.add(ItemType::SZ, name, str, sizeof(str)) == ESP_OK);
+    }
+    CHECK(batch.add(ItemType::SZ, "long42", str, sizeof(str)) == ESP_ERR_NVS_NOT_ENOUGH_SPACE);
+}
+
+TEST_CASE("storage batch is either fully written or not at all after power off", "[nvs]")
+{
+    const int keyCount = 40;
+    const int fillCount = 70;
+    char name[Item::MAX_KEY_LENGTH + 1];
+    const char str[] = "string value which takes several entries in the page";
+    for (uint32_t errDelay = 0; ; ++errDelay) {
+        INFO(errDelay);
+        SpiFlashEmulator emu(4);
+        esp_err_t err;
+        {
+            Storage storage;
+            REQUIRE(storage.init(0, 4) == ESP_OK);
+            for (int i = 0; i < keyCount; ++i) {
+                snprintf(name, sizeof(name), "key%d", i);
+                REQUIRE(storage.writeItem(1, name, i) == ESP_OK);
+            }
+            // the batch doesn't fit in the rest of this page
+            for (int i = 0; i < fillCount; ++i) {
+                snprintf(name, sizeof(name), "fill%d", i);
+                REQUIRE(storage.writeItem(2, name, i) == ESP_OK);
+            }
+            WriteBatch batch;
+            for (int i = 0; i < keyCount; ++i) {
+                snprintf(name, sizeof(name), "key%d", i);
+                int val = i + 1000;
+                REQUIRE(batch.add(ItemType::I32, name, &val, sizeof(val)) == ESP_OK);
+            }
+            REQUIRE(batch.add(ItemType::SZ, "str", str, sizeof(str)) == ESP_OK);
+
+            emu.failAfter(errDelay);
+            err = storage.writeBatch(1, batch);
+            emu.failAfter(UINT32_MAX);
+        }
+
+        Storage storage;
+        REQUIRE(storage.init(0, 4) == ESP_OK);
+        int newCount = 0;
+        for (int i = 0; i < keyCount; ++i) {
+            snprintf(name, sizeof(name), "key%d", i);
+            int val;
+            REQUIRE(storage.readItem(1, name, val) == ESP_OK);
+            if (val == i + 1000) {
+                ++newCount;
+            } else {
+                REQUIRE(val == i);
+            }
+        }
+        char buf[sizeof(str)];
+        if (storage.readItem(1, ItemType::SZ, "str", buf, sizeof(buf)) == ESP_OK) {
+            CHECK(strcmp(buf, str) == 0);
+            CHECK(newCount == keyCount);
+        } else {
+            CHECK(newCount == 0);
+        }
+        if (err == ESP_OK) {
+            CHECK(newCount == keyCount);
+            break;
+        }
+    }
+}
+
+TEST_CASE("nvs api batch is written by nvs_commit", "[nvs]")
+{
+    SpiFlashEmulator emu(10);
+    const uint32_t NVS_FLASH_SECTOR = 6;
+    const uint32_t NVS_FLASH_SECTOR_COUNT_MIN = 3;
+    emu.setBounds(NVS_FLASH_SECTOR, NVS_FLASH_SECTOR + NVS_FLASH_SECTOR_COUNT_MIN);
+    TEST_ESP_OK(nvs_flash_init_custom(NVS_DEFAULT_PART_NAME, NVS_FLASH_SECTOR, NVS_FLASH_SECTOR_COUNT_MIN));
+
+    nvs_handle handle;
+    TEST_ESP_OK(nvs_open("profile", NVS_READWRITE, &handle));
+    TEST_ESP_OK(nvs_set_i32(handle, "baud", 9600));
+
+    TEST_ESP_OK(nvs_batch_begin(handle));
+    TEST_ESP_ERR(nvs_batch_begin(handle), ESP_ERR_INVALID_STATE);
+    TEST_ESP_OK(nvs_set_i32(handle, "baud", 115200));
+    TEST_ESP_OK(nvs_set_u8(handle, "addr", 17));
+    TEST_ESP_OK(nvs_set_str(handle, "name", "pump"));
+    TEST_ESP_ERR(nvs_set_blob(handle, "blob", "x", 1), ESP_ERR_NOT_SUPPORTED);
+    TEST_ESP_ERR(nvs_erase_key(handle, "baud"), ESP_ERR_NOT_SUPPORTED);
+
+    // values are not visible before commit
+    int32_t baud;
+    uint8_t addr;
+    TEST_ESP_OK(nvs_get_i32(handle, "baud", &baud));
+    CHECK(baud == 9600);
+    TEST_ESP_ERR(nvs_get_u8(handle, "addr", &addr), ESP_ERR_NVS_NOT_FOUND);
+
+    TEST_ESP_OK(nvs_commit(handle));
+    TEST_ESP_OK(nvs_get_i32(handle, "baud", &baud));
+    CHECK(baud == 115200);
+    TEST_ESP_OK(nvs_get_u8(handle, "addr", &addr));
+    CHECK(addr == 17);
+    char name[8];
+    size_t len = sizeof(name);
+    TEST_ESP_OK(nvs_get_str(handle, "name", name, &len));
+    CHECK(strcmp(name, "pump") == 0);
+
+    // aborted batch is dropped
+    TEST_ESP_OK(nvs_batch_begin(handle));
+    TEST_ESP_OK(nvs_set_u8(handle, "addr", 18));
+    nvs_batch_abort(handle);
+    TEST_ESP_OK(nvs_commit(handle));
+    TEST_ESP_OK(nvs_get_u8(handle, "addr", &addr));
+    CHECK(addr == 17);
+
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+}
+
+TEST_CASE("storage write-back cache coalesces writes until flushed", "[nvs]")
+{
+    SpiFlashEmulator emu(4);
+    {
+        Storage storage;
+        CHECK(storage.init(0, 4) == ESP_OK);
+        CHECK(storage.writeItem(1, "counter", 0) == ESP_OK);
+        CHECK(storage.writeItem(1, "other", 7) == ESP_OK);
+        CHECK(storage.enableWriteBack(1, "counter", 4) == ESP_OK);
+
+        emu.clearStats();
+        for (int i = 1; i <= 1000; ++i) {
+            REQUIRE(storage.writeItem(1, "counter", i) == ESP_OK);
+        }
+        CHECK(emu.getWriteOps() == 0);
+        int val;
+        CHECK(storage.readItem(1, "counter", val) == ESP_OK);
+        CHECK(val == 1000);
+        // other keys and types are written directly
+        CHECK(storage.writeItem(1, "other", 8) == ESP_OK);
+        CHECK(emu.getWriteOps() > 0);
+        CHECK(storage.writeItem(1, ItemType::SZ, "counter", "str", 4) == ESP_OK);
+
+        CHECK(storage.flushWriteBack() == ESP_OK);
+        CHECK(storage.getWriteCache().size() == 0);
+        CHECK(storage.getWriteCache().getSetCount() == 1000);
+        CHECK(storage.getWriteCache().getFlushedCount() == 1);
+        CHECK(storage.writeItem(1, "counter", 1001) == ESP_OK);
+    }
+    {
+        // values not flushed are lost
+        Storage storage;
+        CHECK(storage.init(0, 4) == ESP_OK);
+        int val;
+        CHECK(storage.readItem(1, "counter", val) == ESP_OK);
+        CHECK(val == 1000);
+        CHECK(storage.readItem(1, "other", val) == ESP_OK);
+        CHECK(val == 8);
+    }
+}
+
+TEST_CASE("storage write-back cache flushes when full and drops erased values", "[nvs]")
+{
+    SpiFlashEmulator emu(4);
+    Storage storage;
+    CHECK(storage.init(0, 4) == ESP_OK);
+    CHECK(storage.enableWriteBack(2, nullptr, 4) == ESP_OK);
+    CHECK(storage.enableWriteBack(3, nullptr, 100) == ESP_OK);
+    CHECK(storage.getWriteCache().capacity() == 4);
+
+    char name[Item::MAX_KEY_LENGTH + 1];
+    for (int i = 0; i < 4; ++i) {
+        snprintf(name, sizeof(name), "key%d", i);
+        REQUIRE(storage.writeItem(2, name, i) == ESP_OK);
+    }
+    CHECK(storage.getWriteCache().size() == 4);
+    CHECK(storage.writeItem(3, "key4", 4) == ESP_OK);
+    CHECK(storage.getWriteCache().size() == 1);
+    int val;
+    CHECK(storage.readItem(2, "key3", val) == ESP_OK);
+    CHECK(val == 3);
+
+    // value only held in the cache
+    CHECK(storage.eraseItem(3, ItemType::ANY, "key4") == ESP_OK);
+    CHECK(storage.readItem(3, "key4", val) == ESP_ERR_NVS_NOT_FOUND);
+    // value in flash and in the cache
+    CHECK(storage.writeItem(2, "key0", 10) == ESP_OK);
+    CHECK(storage.eraseItem(2, ItemType::ANY, "key0") == ESP_OK);
+    CHECK(storage.readItem(2, "key0", val) == ESP_ERR_NVS_NOT_FOUND);
+    CHECK(storage.writeItem(2, "key1", 11) == ESP_OK);
+    CHECK(storage.eraseNamespace(2) == ESP_OK);
+    CHECK(storage.readItem(2, "key1", val) == ESP_ERR_NVS_NOT_FOUND);
+
+    CHECK(storage.writeItem(2, "key2", 12) == ESP_OK);
+    CHECK(storage.disableWriteBack(2, nullptr) == ESP_OK);
+    CHECK(storage.getWriteCache().size() == 0);
+    emu.clearStats();
+    CHECK(storage.writeItem(2, "key2", 13) == ESP_OK);
+    CHECK(emu.getWriteOps() > 0);
+}
+
+TEST_CASE("nvs api write-back values are stored by nvs_commit", "[nvs]")
+{
+    SpiFlashEmulator emu(10);
+    const uint32_t NVS_FLASH_SECTOR = 6;
+    const uint32_t NVS_FLASH_SECTOR_COUNT_MIN = 3;
+    emu.setBounds(NVS_FLASH_SECTOR, NVS_FLASH_SECTOR + NVS_FLASH_SECTOR_COUNT_MIN);
+    TEST_ESP_OK(nvs_flash_init_custom(NVS_DEFAULT_PART_NAME, NVS_FLASH_SECTOR, NVS_FLASH_SECTOR_COUNT_MIN));
+
+    nvs_handle handle;
+    TEST_ESP_OK(nvs_open("telemetry", NVS_READWRITE, &handle));
+    TEST_ESP_OK(nvs_enable_write_back(handle, NULL));
+    for (uint32_t i = 0; i < 100; ++i) {
+        TEST_ESP_OK(nvs_set_u32(handle, "uptime", i));
+        TEST_ESP_OK(nvs_set_u16(handle, "resets", 3));
+    }
+    nvs_write_back_stats_t stats;
+    TEST_ESP_OK(nvs_get_write_back_stats(NULL, &stats));
+    CHECK(stats.dirty_entries == 2);
+    CHECK(stats.max_dirty_entries == 16);
+    CHECK(stats.set_count == 200);
+    TEST_ESP_OK(nvs_commit(handle));
+    TEST_ESP_OK(nvs_get_write_back_stats(NULL, &stats));
+    CHECK(stats.dirty_entries == 0);
+    CHECK(stats.flushed_count == 2);
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+
+    TEST_ESP_OK(nvs_flash_init_custom(NVS_DEFAULT_PART_NAME, NVS_FLASH_SECTOR, NVS_FLASH_SECTOR_COUNT_MIN));
+    TEST_ESP_OK(nvs_open("telemetry", NVS_READONLY, &handle));
+    uint32_t uptime;
+    TEST_ESP_OK(nvs_get_u32(handle, "uptime", &uptime));
+    CHECK(uptime == 99);
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_flash_deinit_partition(NVS_DEFAULT_PART_NAME));
+}
+
 TEST_CASE("can write and read variable length data lots of times", "[nvs]")
 {
     SpiFlashEmulator emu(8);
@@ -1995,6 +2366,96 @@ TEST_CASE("Recovery from power-off during modification of blob present in old-fo
 }
 
 
+static size_t count_entries(const char* part_name, const char* namespace_name, nvs_type_t type)
+{
+    size_t count = 0;
+    nvs_iterator_t it = nvs_entry_find(part_name, namespace_name, type);
+    while (it != NULL) {
+        ++count;
+        it = nvs_entry_next(it);
+    }
+    return count;
+}
+
+TEST_CASE("nvs iterators enumerate keys by namespace and type", "[nvs]")
+{
+    SpiFlashEmulator emu(8);
+    TEST_ESP_OK(nvs_flash_init_custom(NVS_DEFAULT_PART_NAME, 0, 8));
+
+    nvs_handle handle_1;
+    nvs_handle handle_2;
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle_1));
+    TEST_ESP_OK(nvs_open("namespace2", NVS_READWRITE, &handle_2));
+
+    TEST_ESP_OK(nvs_set_u8(handle_1, "value1", 1));
+    TEST_ESP_OK(nvs_set_i32(handle_1, "value2", -2));
+    TEST_ESP_OK(nvs_set_str(handle_1, "value3", "three"));
+    TEST_ESP_OK(nvs_set_u32(handle_2, "value1", 1));
+    uint8_t blob[Page::CHUNK_MAX_SIZE * 2] = {0};
+    TEST_ESP_OK(nvs_set_blob(handle_2, "blob", blob, sizeof(blob)));
+    TEST_ESP_OK(nvs_commit(handle_1));
+    TEST_ESP_OK(nvs_commit(handle_2));
+
+    CHECK(count_entries(NULL, NULL, NVS_TYPE_ANY) == 5);
+    CHECK(count_entries(NVS_DEFAULT_PART_NAME, "namespace1", NVS_TYPE_ANY) == 3);
+    CHECK(count_entries(NVS_DEFAULT_PART_NAME, "namespace2", NVS_TYPE_ANY) == 2);
+    CHECK(count_entries(NULL, NULL, NVS_TYPE_STR) == 1);
+    CHECK(count_entries(NULL, NULL, NVS_TYPE_I32) == 1);
+    CHECK(count_entries(NULL, "namespace2", NVS_TYPE_U8) == 0);
+    CHECK(nvs_entry_find(NULL, "namespace3", NVS_TYPE_ANY) == NULL);
+    CHECK(nvs_entry_find("other_part", NULL, NVS_TYPE_ANY) == NULL);
+
+    // multi-page blobs are listed once, by their index
+    nvs_iterator_t it = nvs_entry_find(NULL, "namespace2", NVS_TYPE_BLOB);
+    REQUIRE(it != NULL);
+    nvs_entry_info_t info;
+    nvs_entry_info(it, &info);
+    CHECK(strcmp(info.namespace_name, "namespace2") == 0);
+    CHECK(strcmp(info.key, "blob") == 0);
+    CHECK(info.type == NVS_TYPE_BLOB);
+    CHECK(nvs_entry_next(it) == NULL);
+
+    it = nvs_entry_find(NULL, "namespace1", NVS_TYPE_ANY);
+    REQUIRE(it != NULL);
+    nvs_release_iterator(it);
+
+    TEST_ESP_OK(nvs_erase_key(handle_1, "value2"));
+    TEST_ESP_OK(nvs_set_u8(handle_1, "value1", 2));
+    CHECK(count_entries(NULL, "namespace1", NVS_TYPE_ANY) == 2);
+    TEST_ESP_OK(nvs_erase_all(handle_2));
+    CHECK(count_entries(NULL, NULL, NVS_TYPE_ANY) == 2);
+
+    // iterating doesn't read values
+    emu.clearStats();
+    CHECK(count_entries(NULL, NULL, NVS_TYPE_ANY) == 2);
+    CHECK(emu.getReadBytes() == emu.getReadOps() * Page::ENTRY_SIZE);
+
+    nvs_close(handle_1);
+    nvs_close(handle_2);
+    TEST_ESP_OK(nvs_flash_deinit());
+}
+
+TEST_CASE("nvs iterators list values held by the write-back cache", "[nvs]")
+{
+    SpiFlashEmulator emu(4);
+    TEST_ESP_OK(nvs_flash_init_custom(NVS_DEFAULT_PART_NAME, 0, 4));
+
+    nvs_handle handle;
+    TEST_ESP_OK(nvs_open("namespace1", NVS_READWRITE, &handle));
+    TEST_ESP_OK(nvs_set_u32(handle, "stored", 1));
+    TEST_ESP_OK(nvs_enable_write_back(handle, NULL));
+    TEST_ESP_OK(nvs_set_u32(handle, "stored", 2));
+    TEST_ESP_OK(nvs_set_u32(handle, "cached", 3));
+
+    CHECK(count_entries(NULL, "namespace1", NVS_TYPE_ANY) == 2);
+    CHECK(count_entries(NULL, "namespace1", NVS_TYPE_U32) == 2);
+    TEST_ESP_OK(nvs_commit(handle));
+    CHECK(count_entries(NULL, "namespace1", NVS_TYPE_ANY) == 2);
+
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_flash_deinit());
+}
+
 TEST_CASE("check partition generation utility with multipage blob support disabled", "[nvs_part_gen]")
 {
     int childpid = fork();
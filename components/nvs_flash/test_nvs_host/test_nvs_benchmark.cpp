@@ -0,0 +1,341 @@
+// Copyright 2015-2019 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmarks of NVS workloads on the flash emulator. They are hidden from the
+// default test run, use "make benchmark" or "./test_nvs [benchmark]".
+//
+// Times are emulated flash times as modelled by SpiFlashEmulator, so results
+// are reproducible and comparable between host machines. Host CPU time is
+// reported as well, it shows the cost of the RAM structures (HashList,
+// index, entry tables) which the emulated time doesn't cover.
+
+#include "catch.hpp"
+#include "nvs.hpp"
+#include "nvs_test_api.h"
+#include "spi_flash_emulation.h"
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#define TEST_ESP_OK(rc) CHECK((rc) == ESP_OK)
+
+using namespace std;
+using namespace nvs;
+
+namespace
+{
+
+/**
+ * Collects flash statistics and latency of single operations. Emulator
+ * statistics are cleared before every operation.
+ */
+class Bench
+{
+public:
+    Bench(const char* name, SpiFlashEmulator& emu) : mName(name), mEmu(emu)
+    {
+    }
+
+    template<typename TFunc>
+    esp_err_t run(size_t logicalBytes, TFunc func)
+    {
+        mEmu.clearStats();
+        auto start = chrono::steady_clock::now();
+        esp_err_t err = func();
+        mHostTime += chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - start).count();
+        mLatency.push_back(mEmu.getTotalTime());
+        mLogicalBytes += logicalBytes;
+        mReadBytes += mEmu.getReadBytes();
+        mWriteBytes += mEmu.getWriteBytes();
+        mEraseOps += mEmu.getEraseOps();
+        return err;
+    }
+
+    void report() const
+    {
+        if (mLatency.empty()) {
+            return;
+        }
+        vector<uint32_t> sorted(mLatency);
+        sort(sorted.begin(), sorted.end());
+        uint64_t total = 0;
+        for (auto t : sorted) {
+            total += t;
+        }
+        printf("%-36s %7zu ops %9.0f ops/s  p50 %6u us  p90 %6u us  p99 %6u us  max %7u us",
+               mName, sorted.size(), perSecond(sorted.size(), total),
+               percentile(sorted, 50), percentile(sorted, 90), percentile(sorted, 99), sorted.back());
+        if (mLogicalBytes != 0) {
+            printf("  WA %6.2f", static_cast<double>(mWriteBytes) / mLogicalBytes);
+        }
+        printf("  erases %5zu  host %9.0f ops/s\n", mEraseOps, mHostTime ? sorted.size() * 1e9 / mHostTime : 0.0);
+    }
+
+    uint64_t totalTime() const
+    {
+        uint64_t total = 0;
+        for (auto t : mLatency) {
+            total += t;
+        }
+        return total;
+    }
+
+    uint64_t hostTime() const
+    {
+        return mHostTime;
+    }
+
+protected:
+    static uint32_t percentile(const vector<uint32_t>& sorted, size_t p)
+    {
+        return sorted[(sorted.size() - 1) * p / 100];
+    }
+
+    static double perSecond(size_t count, uint64_t us)
+    {
+        return us ? count * 1e6 / us : 0.0;
+    }
+
+    const char* mName;
+    SpiFlashEmulator& mEmu;
+    vector<uint32_t> mLatency;
+    size_t mLogicalBytes = 0;
+    size_t mReadBytes = 0;
+    size_t mWriteBytes = 0;
+    size_t mEraseOps = 0;
+    uint64_t mHostTime = 0;
+};
+
+nvs_sec_cfg_t* benchXtsConfig()
+{
+    static nvs_sec_cfg_t cfg;
+    for (int count = 0; count < NVS_KEY_SIZE; count++) {
+        cfg.eky[count] = 0x11;
+        cfg.tky[count] = 0x22;
+    }
+    return &cfg;
+}
+
+esp_err_t benchInit(uint32_t sectorCount, bool encrypted)
+{
+    if (encrypted) {
+        return nvs_flash_secure_init_custom(NVS_DEFAULT_PART_NAME, 0, sectorCount, benchXtsConfig());
+    }
+    return nvs_flash_init_custom(NVS_DEFAULT_PART_NAME, 0, sectorCount);
+}
+
+/**
+ * Counters updated in random order, committed after every update as an
+ * application persisting its state would do.
+ */
+void benchCounters(const char* name, bool encrypted, bool writeBack)
+{
+    const uint32_t SECTORS = 8;
+    const size_t COUNTERS = 16;
+    const size_t UPDATES = 20000;
+    const size_t FLUSH_PERIOD = 100;
+
+    SpiFlashEmulator emu(SECTORS);
+    TEST_ESP_OK(benchInit(SECTORS, encrypted));
+    nvs_handle handle;
+    TEST_ESP_OK(nvs_open("counters", NVS_READWRITE, &handle));
+    if (writeBack) {
+        TEST_ESP_OK(nvs_enable_write_back(handle, nullptr));
+    }
+
+    Bench bench(name, emu);
+    mt19937 gen(42);
+    uint32_t values[COUNTERS] = {0};
+    for (size_t i = 0; i < UPDATES; ++i) {
+        size_t index = gen() % COUNTERS;
+        char key[32];
+        snprintf(key, sizeof(key), "cnt%zu", index);
+        uint32_t value = ++values[index];
+        TEST_ESP_OK(bench.run(sizeof(value), [&]() {
+            esp_err_t err = nvs_set_u32(handle, key, value);
+            if (err == ESP_OK && (!writeBack || (i + 1) % FLUSH_PERIOD == 0)) {
+                err = nvs_commit(handle);
+            }
+            return err;
+        }));
+    }
+    bench.report();
+
+    TEST_ESP_OK(nvs_commit(handle));
+    for (size_t i = 0; i < COUNTERS; ++i) {
+        char key[32];
+        snprintf(key, sizeof(key), "cnt%zu", i);
+        uint32_t value = 0;
+        if (values[i] != 0) {
+            TEST_ESP_OK(nvs_get_u32(handle, key, &value));
+            CHECK(value == values[i]);
+        }
+    }
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_flash_deinit());
+}
+
+/**
+ * Blobs spanning several pages, rewritten and read back.
+ */
+void benchBlobs(const char* name, bool encrypted)
+{
+    const uint32_t SECTORS = 16;
+    const size_t BLOB_SIZE = 3 * 4000;
+    const size_t BLOBS = 2;
+    const size_t ROUNDS = 100;
+
+    SpiFlashEmulator emu(SECTORS);
+    TEST_ESP_OK(benchInit(SECTORS, encrypted));
+    nvs_handle handle;
+    TEST_ESP_OK(nvs_open("blobs", NVS_READWRITE, &handle));
+
+    string writeName = string(name) + " write";
+    string readName = string(name) + " read";
+    Bench write(writeName.c_str(), emu);
+    Bench read(readName.c_str(), emu);
+    vector<uint8_t> data(BLOB_SIZE);
+    vector<uint8_t> readback(BLOB_SIZE);
+    mt19937 gen(42);
+    for (size_t round = 0; round < ROUNDS; ++round) {
+        for (size_t i = 0; i < BLOBS; ++i) {
+            char key[32];
+            snprintf(key, sizeof(key), "blob%zu", i);
+            generate(data.begin(), data.end(), gen);
+            TEST_ESP_OK(write.run(BLOB_SIZE, [&]() {
+                esp_err_t err = nvs_set_blob(handle, key, data.data(), BLOB_SIZE);
+                return (err == ESP_OK) ? nvs_commit(handle) : err;
+            }));
+            size_t size = BLOB_SIZE;
+            TEST_ESP_OK(read.run(0, [&]() {
+                return nvs_get_blob(handle, key, readback.data(), &size);
+            }));
+            CHECK(size == BLOB_SIZE);
+            CHECK(readback == data);
+        }
+    }
+    write.report();
+    read.report();
+    printf("%-36s write %7.1f kB/s  read %7.1f kB/s\n", name,
+           BLOB_SIZE * BLOBS * ROUNDS * 1e6 / 1024 / write.totalTime(),
+           BLOB_SIZE * BLOBS * ROUNDS * 1e6 / 1024 / read.totalTime());
+
+    nvs_close(handle);
+    TEST_ESP_OK(nvs_flash_deinit());
+}
+
+} // namespace
+
+TEST_CASE("benchmark boot time bulk reads", "[.][benchmark]")
+{
+    const uint32_t SECTORS = 32;
+    const size_t KEY_COUNTS[] = {100, 500, 1000, 2000, 3500};
+
+    printf("\nMount and bulk read vs key count, %u sectors\n", SECTORS);
+    for (auto keyCount : KEY_COUNTS) {
+        SpiFlashEmulator emu(SECTORS);
+        {
+            Storage storage;
+            TEST_ESP_OK(storage.init(0, SECTORS));
+            uint8_t nsIndex;
+            TEST_ESP_OK(storage.createOrOpenNamespace("boot", true, nsIndex));
+            for (size_t i = 0; i < keyCount; ++i) {
+                char key[32];
+                snprintf(key, sizeof(key), "key%zu", i);
+                TEST_ESP_OK(storage.writeItem(nsIndex, key, static_cast<uint32_t>(i)));
+            }
+            TEST_ESP_OK(storage.writeSnapshots());
+        }
+
+        for (int fastMount = 0; fastMount < 2; ++fastMount) {
+            Bench mount(fastMount ? "  mount (fast)" : "  mount", emu);
+            Bench read("  read", emu);
+            Storage storage;
+            TEST_ESP_OK(mount.run(0, [&]() {
+                return storage.init(0, SECTORS, fastMount != 0);
+            }));
+            nvs_stats_t stats;
+            TEST_ESP_OK(storage.fillStats(stats));
+            uint8_t nsIndex;
+            TEST_ESP_OK(storage.createOrOpenNamespace("boot", false, nsIndex));
+            for (size_t i = 0; i < keyCount; ++i) {
+                char key[32];
+                snprintf(key, sizeof(key), "key%zu", i);
+                uint32_t value = 0;
+                TEST_ESP_OK(read.run(0, [&]() {
+                    return storage.readItem(nsIndex, key, value);
+                }));
+                CHECK(value == i);
+            }
+            printf("%5zu keys, %3zu%% full, %s: %7llu us emulated, %7llu us host; reads %7llu us emulated, %7llu us host\n",
+                   keyCount, stats.used_entries * 100 / stats.total_entries,
+                   fastMount ? "fast mount" : "full scan ",
+                   (unsigned long long) mount.totalTime(), (unsigned long long) mount.hostTime() / 1000,
+                   (unsigned long long) read.totalTime(), (unsigned long long) read.hostTime() / 1000);
+        }
+    }
+
+    // same key count, partition filled with longer values
+    const size_t STR_KEYS = 256;
+    const size_t STR_LENGTHS[] = {1, 64, 160, 256, 352};
+    printf("\nMount vs partition fill, %zu string keys, %u sectors\n", STR_KEYS, SECTORS);
+    for (auto length : STR_LENGTHS) {
+        SpiFlashEmulator emu(SECTORS);
+        string value(length, 'x');
+        {
+            Storage storage;
+            TEST_ESP_OK(storage.init(0, SECTORS));
+            uint8_t nsIndex;
+            TEST_ESP_OK(storage.createOrOpenNamespace("boot", true, nsIndex));
+            for (size_t i = 0; i < STR_KEYS; ++i) {
+                char key[32];
+                snprintf(key, sizeof(key), "str%zu", i);
+                TEST_ESP_OK(storage.writeItem(nsIndex, ItemType::SZ, key, value.c_str(), value.size() + 1));
+            }
+        }
+        Bench mount("  mount", emu);
+        Storage storage;
+        TEST_ESP_OK(mount.run(0, [&]() {
+            return storage.init(0, SECTORS);
+        }));
+        nvs_stats_t stats;
+        TEST_ESP_OK(storage.fillStats(stats));
+        printf("%5zu bytes per value, %3zu%% full: %7llu us emulated, %7llu us host\n",
+               length, stats.used_entries * 100 / stats.total_entries,
+               (unsigned long long) mount.totalTime(), (unsigned long long) mount.hostTime() / 1000);
+    }
+}
+
+TEST_CASE("benchmark churny counters", "[.][benchmark]")
+{
+    printf("\n");
+    benchCounters("counters", false, false);
+    benchCounters("counters, write-back", false, true);
+}
+
+TEST_CASE("benchmark multi-page blobs", "[.][benchmark]")
+{
+    printf("\n");
+    benchBlobs("blobs", false);
+}
+
+#ifdef CONFIG_NVS_ENCRYPTION
+TEST_CASE("benchmark encrypted partition", "[.][benchmark]")
+{
+    printf("\n");
+    benchCounters("encrypted counters", true, false);
+    benchBlobs("encrypted blobs", true);
+}
+#endif
@@ -526,6 +526,28 @@ size_t WL_Flash::calcAddr(size_t addr)
     return result;
 }
 
+size_t WL_Flash::calcExtent(size_t addr, size_t size, size_t &extent)
+{
+    // Mapping is linear except where the rotation wraps and at the dummy page
+    size_t result = (this->flash_size - this->state.move_count * this->cfg.page_size + addr) % this->flash_size;
+    size_t dummy_addr = this->state.pos * this->cfg.page_size;
+    size_t run_end;
+    if (result < dummy_addr) {
+        run_end = dummy_addr;
+    } else {
+        run_end = this->flash_size;
+    }
+    extent = run_end - result;
+    if (extent > size) {
+        extent = size;
+    }
+    if (result >= dummy_addr) {
+        result += this->cfg.page_size;
+    }
+    ESP_LOGV(TAG, "%s - addr= 0x%08x -> result= 0x%08x, extent= 0x%08x", __func__, (uint32_t) addr, (uint32_t) result, (uint32_t) extent);
+    return result;
+}
+
 
 size_t WL_Flash::chip_size()
 {
@@ -581,15 +603,15 @@ esp_err_t WL_Flash::write(size_t dest_addr, const void *src, size_t size)
         return ESP_ERR_INVALID_STATE;
     }
     ESP_LOGD(TAG, "%s - dest_addr= 0x%08x, size= 0x%08x", __func__, (uint32_t) dest_addr, (uint32_t) size);
-    uint32_t count = (size - 1) / this->cfg.page_size;
-    for (size_t i = 0; i < count; i++) {
-        size_t virt_addr = this->calcAddr(dest_addr + i * this->cfg.page_size);
-        result = this->flash_drv->write(this->cfg.start_addr + virt_addr, &((uint8_t *)src)[i * this->cfg.page_size], this->cfg.page_size);
+    // one flash operation per physically contiguous run
+    size_t done = 0;
+    while (done < size) {
+        size_t extent;
+        size_t virt_addr = this->calcExtent(dest_addr + done, size - done, extent);
+        result = this->flash_drv->write(this->cfg.start_addr + virt_addr, &((uint8_t *)src)[done], extent);
         WL_RESULT_CHECK(result);
+        done += extent;
     }
-    size_t virt_addr_last = this->calcAddr(dest_addr + count * this->cfg.page_size);
-    result = this->flash_drv->write(this->cfg.start_addr + virt_addr_last, &((uint8_t *)src)[count * this->cfg.page_size], size - count * this->cfg.page_size);
-    WL_RESULT_CHECK(result);
     return result;
 }
 
@@ -600,16 +622,15 @@ esp_err_t WL_Flash::read(size_t src_addr, void *dest, size_t size)
         return ESP_ERR_INVALID_STATE;
     }
     ESP_LOGD(TAG, "%s - src_addr= 0x%08x, size= 0x%08x", __func__, (uint32_t) src_addr, (uint32_t) size);
-    uint32_t count = (size - 1) / this->cfg.page_size;
-    for (size_t i = 0; i < count; i++) {
-        size_t virt_addr = this->calcAddr(src_addr + i * this->cfg.page_size);
-        ESP_LOGV(TAG, "%s - real_addr= 0x%08x, size= 0x%08x", __func__, (uint32_t) (this->cfg.start_addr + virt_addr), (uint32_t) size);
-        result = this->flash_drv->read(this->cfg.start_addr + virt_addr, &((uint8_t *)dest)[i * this->cfg.page_size], this->cfg.page_size);
+    size_t done = 0;
+    while (done < size) {
+        size_t extent;
+        size_t virt_addr = this->calcExtent(src_addr + done, size - done, extent);
+        ESP_LOGV(TAG, "%s - real_addr= 0x%08x, size= 0x%08x", __func__, (uint32_t) (this->cfg.start_addr + virt_addr), (uint32_t) extent);
+        result = this->flash_drv->read(this->cfg.start_addr + virt_addr, &((uint8_t *)dest)[done], extent);
         WL_RESULT_CHECK(result);
+        done += extent;
     }
-    size_t virt_addr_last = this->calcAddr(src_addr + count * this->cfg.page_size);
-    result = this->flash_drv->read(this->cfg.start_addr + virt_addr_last, &((uint8_t *)dest)[count * this->cfg.page_size], size - count * this->cfg.page_size);
-    WL_RESULT_CHECK(result);
     return result;
 }
 
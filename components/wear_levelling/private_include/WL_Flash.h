@@ -71,6 +71,11 @@ protected:
     esp_err_t updateWL();
     esp_err_t recoverPos();
     size_t calcAddr(size_t addr);
+    /**
+     * Physical offset of addr, and the length of the physically contiguous
+     * run starting there, at most size bytes
+     */
+    size_t calcExtent(size_t addr, size_t size, size_t &extent);
 
     esp_err_t updateVersion();
     esp_err_t updateV1_V2();
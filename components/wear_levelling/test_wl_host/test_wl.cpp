@@ -6,6 +6,7 @@
 #include "esp_partition.h"
 #include "wear_levelling.h"
 #include "WL_Flash.h"
+#include "Partition.h"
 #include "SpiFlash.h"
 
 #include "catch.hpp"
@@ -207,4 +208,107 @@ TEST_CASE("power down test", "[wear_levelling]")
     // Unmount
     result = wl_unmount(wl_handle);
     REQUIRE(result == ESP_OK);
-}
\ No newline at end of file
+}
+
+// Exposes the mapping state of WL_Flash to the test
+class WL_Flash_Test : public WL_Flash
+{
+public:
+    size_t max_pos()
+    {
+        return this->state.max_pos;
+    }
+    size_t moves()
+    {
+        return this->state.move_count * this->state.max_pos + this->state.pos;
+    }
+    size_t phys_addr(size_t addr)
+    {
+        return this->cfg.start_addr + this->calcAddr(addr);
+    }
+};
+
+TEST_CASE("multi sector access across the dummy page and the wrap", "[wear_levelling]")
+{
+    init_spi_flash(CONFIG_ESPTOOLPY_FLASHSIZE, CONFIG_WL_SECTOR_SIZE * 16, CONFIG_WL_SECTOR_SIZE, CONFIG_WL_SECTOR_SIZE, "partition_table.bin");
+
+    const esp_partition_t *partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, "storage");
+    REQUIRE(partition != NULL);
+
+    // Same configuration as wl_mount
+    wl_config_t cfg;
+    cfg.full_mem_size = partition->size;
+    cfg.start_addr = 0;
+    cfg.version = 2;
+    cfg.sector_size = SPI_FLASH_SEC_SIZE;
+    cfg.page_size = SPI_FLASH_SEC_SIZE;
+    cfg.updaterate = 16;
+    cfg.temp_buff_size = 32;
+    cfg.wr_size = 16;
+
+    Partition part(partition);
+    WL_Flash_Test wl;
+    REQUIRE(wl.config(&cfg, &part) == ESP_OK);
+    REQUIRE(wl.init() == ESP_OK);
+
+    size_t sector_size = wl.sector_size();
+    size_t flash_size = wl.chip_size();
+    size_t sectors = flash_size / sector_size;
+    size_t max_pos = wl.max_pos();
+
+    uint8_t *data = (uint8_t *) malloc(flash_size);
+    uint8_t *read = (uint8_t *) malloc(flash_size);
+    REQUIRE(data != NULL);
+    REQUIRE(read != NULL);
+
+    // Zero sized accesses do not touch the flash
+    REQUIRE(wl.read(0, read, 0) == ESP_OK);
+    REQUIRE(wl.write(0, data, 0) == ESP_OK);
+
+    // Dummy page in the middle, then wrapped mappings with the dummy page
+    // before and after the wrap point
+    const size_t targets[] = { max_pos / 2, max_pos + max_pos / 4, max_pos + 3 * max_pos / 4, 2 * max_pos + 20 };
+    for (size_t t = 0; t < sizeof(targets) / sizeof(targets[0]); t++) {
+        REQUIRE(wl.erase_range(0, flash_size) == ESP_OK);
+        while (wl.moves() < targets[t]) {
+            REQUIRE(wl.flush() == ESP_OK);
+        }
+
+        for (size_t i = 0; i < flash_size / sizeof(uint32_t); i++) {
+            ((uint32_t *) data)[i] = (t << 24) ^ i;
+        }
+
+        // One call for the whole volume
+        REQUIRE(wl.write(0, data, flash_size) == ESP_OK);
+        memset(read, 0, flash_size);
+        REQUIRE(wl.read(0, read, flash_size) == ESP_OK);
+        REQUIRE(memcmp(data, read, flash_size) == 0);
+
+        // Per sector reads, through WL and directly at the mapped address
+        for (size_t s = 0; s < sectors; s++) {
+            memset(read, 0, sector_size);
+            REQUIRE(wl.read(s * sector_size, read, sector_size) == ESP_OK);
+            REQUIRE(memcmp(&data[s * sector_size], read, sector_size) == 0);
+            memset(read, 0, sector_size);
+            REQUIRE(part.read(wl.phys_addr(s * sector_size), read, sector_size) == ESP_OK);
+            REQUIRE(memcmp(&data[s * sector_size], read, sector_size) == 0);
+        }
+
+        // Unaligned reads across every discontinuity of the mapping
+        int boundaries = 0;
+        for (size_t s = 1; s < sectors; s++) {
+            size_t addr = s * sector_size;
+            if (wl.phys_addr(addr) == wl.phys_addr(addr - sector_size) + sector_size) {
+                continue;
+            }
+            boundaries++;
+            memset(read, 0, 2 * sector_size);
+            REQUIRE(wl.read(addr - 100, read, 2 * sector_size) == ESP_OK);
+            REQUIRE(memcmp(&data[addr - 100], read, 2 * sector_size) == 0);
+        }
+        REQUIRE(boundaries > 0);
+    }
+
+    free(data);
+    free(read);
+}
@@ -4,26 +4,22 @@
 #include "freertos/event_groups.h"
 #include "esp_log.h"
 #include "port.h"
+#include "app_shadow.h"
 
 static const char *TAG = "APP_MODBUS:";
 //#define MB_LOG(...)
 #define MB_LOG(...) ESP_LOGW(__VA_ARGS__)
 
 #define T_WAIT_FOREVER 3
+/* protocol limits of a single read request */
+#define APP_READ_BITS_MAX 2000
+#define APP_READ_REGS_MAX 125
 
 USHORT usMDiscInStart = M_DISCRETE_INPUT_START;
-#if M_DISCRETE_INPUT_NDISCRETES % 8
-UCHAR ucMDiscInBuf[MB_MASTER_TOTAL_SLAVE_NUM][M_DISCRETE_INPUT_NDISCRETES / 8 + 1];
-#else
-UCHAR ucMDiscInBuf[MB_MASTER_TOTAL_SLAVE_NUM][M_DISCRETE_INPUT_NDISCRETES / 8];
-#endif
+UCHAR ucMDiscInBuf[MB_MASTER_TOTAL_SLAVE_NUM][M_DISCRETE_INPUT_NBYTES];
 //Master mode:Coils variables
 USHORT usMCoilStart = M_COIL_START;
-#if M_COIL_NCOILS % 8
-UCHAR ucMCoilBuf[MB_MASTER_TOTAL_SLAVE_NUM][M_COIL_NCOILS / 8 + 1];
-#else
-UCHAR ucMCoilBuf[MB_MASTER_TOTAL_SLAVE_NUM][M_COIL_NCOILS / 8];
-#endif
+UCHAR ucMCoilBuf[MB_MASTER_TOTAL_SLAVE_NUM][M_COIL_NBYTES];
 //Master mode:InputRegister variables
 USHORT usMRegInStart = M_REG_INPUT_START;
 USHORT usMRegInBuf[MB_MASTER_TOTAL_SLAVE_NUM][M_REG_INPUT_NREGS];
@@ -108,7 +104,7 @@ eMBErrorCode eMBRegInputCB(UCHAR *pucRegBuffer, USHORT usAddress, USHORT usNRegs
 {
     MB_LOG(TAG, "%s\r\n", __func__);
     eMBErrorCode eStatus = MB_ENOERR;
-    USHORT iRegIndex;
+    USHORT iRegIndex, iRegFirst;
     USHORT *pusRegInputBuf;
     USHORT REG_INPUT_START;
     USHORT REG_INPUT_NREGS;
@@ -125,6 +121,7 @@ eMBErrorCode eMBRegInputCB(UCHAR *pucRegBuffer, USHORT usAddress, USHORT usNRegs
     if ((usAddress >= REG_INPUT_START) && (usAddress + usNRegs <= REG_INPUT_START + REG_INPUT_NREGS))
     {
         iRegIndex = usAddress - usRegInStart;
+        iRegFirst = iRegIndex;
         while (usNRegs > 0)
         {
             pusRegInputBuf[iRegIndex] = *pucRegBuffer++ << 8;
@@ -132,6 +129,8 @@ eMBErrorCode eMBRegInputCB(UCHAR *pucRegBuffer, USHORT usAddress, USHORT usNRegs
             iRegIndex++;
             usNRegs--;
         }
+        app_shadow_mark_dirty(APP_SHADOW_INPUT, ucMBMasterGetDestAddress() - 1,
+                              iRegFirst * 2, (iRegIndex - iRegFirst) * 2);
         //usr add
         input_reg_event_gp_bit_set();
     }
@@ -167,7 +166,7 @@ eMBErrorCode eMBRegHoldingCB(UCHAR *pucRegBuffer, USHORT usAddress,
 {
     MB_LOG(TAG, "%s\r\n", __func__);
     eMBErrorCode eStatus = MB_ENOERR;
-    USHORT iRegIndex;
+    USHORT iRegIndex, iRegFirst;
     USHORT *pusRegHoldingBuf;
     USHORT REG_HOLDING_START;
     USHORT REG_HOLDING_NREGS;
@@ -200,6 +199,7 @@ eMBErrorCode eMBRegHoldingCB(UCHAR *pucRegBuffer, USHORT usAddress,
             break;
         /* write current register values with new values from the protocol stack. */
         case MB_REG_WRITE:
+            iRegFirst = iRegIndex;
             while (usNRegs > 0)
             {
                 pusRegHoldingBuf[iRegIndex] = *pucRegBuffer++ << 8;
@@ -207,6 +207,8 @@ eMBErrorCode eMBRegHoldingCB(UCHAR *pucRegBuffer, USHORT usAddress,
                 iRegIndex++;
                 usNRegs--;
             }
+            app_shadow_mark_dirty(APP_SHADOW_HOLDING, ucMBMasterGetDestAddress() - 1,
+                                  iRegFirst * 2, (iRegIndex - iRegFirst) * 2);
             break;
         }
     }
@@ -241,7 +243,7 @@ eMBErrorCode eMBRegCoilsCB(UCHAR *pucRegBuffer, USHORT usAddress,
 {
     MB_LOG(TAG, "%s\r\n", __func__);
     eMBErrorCode eStatus = MB_ENOERR;
-    USHORT iRegIndex, iRegBitIndex, iNReg;
+    USHORT iRegIndex, iRegBitIndex, iNReg, iRegFirst;
     UCHAR *pucCoilBuf;
     USHORT COIL_START;
     USHORT COIL_NCOILS;
@@ -283,6 +285,7 @@ eMBErrorCode eMBRegCoilsCB(UCHAR *pucRegBuffer, USHORT usAddress,
 
         /* write current coil values with new values from the protocol stack. */
         case MB_REG_WRITE:
+            iRegFirst = iRegIndex;
             while (iNReg > 1)
             {
                 xMBUtilSetBits(&pucCoilBuf[iRegIndex++], iRegBitIndex, 8,
@@ -297,6 +300,9 @@ eMBErrorCode eMBRegCoilsCB(UCHAR *pucRegBuffer, USHORT usAddress,
                 xMBUtilSetBits(&pucCoilBuf[iRegIndex++], iRegBitIndex, usNCoils,
                                *pucRegBuffer++);
             }
+            /* unaligned bits also change the byte after the last one */
+            app_shadow_mark_dirty(APP_SHADOW_COIL, ucMBMasterGetDestAddress() - 1,
+                                  iRegFirst, iRegIndex - iRegFirst + (iRegBitIndex ? 1 : 0));
             break;
         }
     }
@@ -329,7 +335,7 @@ eMBErrorCode eMBRegDiscreteCB(UCHAR *pucRegBuffer, USHORT usAddress, USHORT usND
 {
     MB_LOG(TAG, "%s\r\n", __func__);
     eMBErrorCode eStatus = MB_ENOERR;
-    USHORT iRegIndex, iRegBitIndex, iNReg;
+    USHORT iRegIndex, iRegBitIndex, iNReg, iRegFirst;
     UCHAR *pucDiscreteInputBuf;
     USHORT DISCRETE_INPUT_START;
     USHORT DISCRETE_INPUT_NDISCRETES;
@@ -349,6 +355,7 @@ eMBErrorCode eMBRegDiscreteCB(UCHAR *pucRegBuffer, USHORT usAddress, USHORT usND
         iRegIndex = (USHORT)(usAddress - usDiscreteInputStart) / 8;
         iRegBitIndex = (USHORT)(usAddress - usDiscreteInputStart) % 8;
 
+        iRegFirst = iRegIndex;
         /* write current discrete values with new values from the protocol stack. */
         while (iNReg > 1)
         {
@@ -364,6 +371,9 @@ eMBErrorCode eMBRegDiscreteCB(UCHAR *pucRegBuffer, USHORT usAddress, USHORT usND
             xMBUtilSetBits(&pucDiscreteInputBuf[iRegIndex++], iRegBitIndex,
                            usNDiscrete, *pucRegBuffer++);
         }
+        /* unaligned bits also change the byte after the last one */
+        app_shadow_mark_dirty(APP_SHADOW_DISCRETE, ucMBMasterGetDestAddress() - 1,
+                              iRegFirst, iRegIndex - iRegFirst + (iRegBitIndex ? 1 : 0));
         //usr add
         descret_event_gp_bit_set();
     }
@@ -404,6 +414,11 @@ int get_p_disc_buf(int i)
 void modebus_task(void *parameter)
 {
     eMBErrorCode eStatus;
+    /* warm start: show the last known values until the slaves are polled */
+    if (app_shadow_restore() == ESP_OK)
+    {
+        xTaskCreate(app_shadow_task, "app_shadow_task", 2048, NULL, 3, NULL);
+    }
     eStatus = eMBTCPInit(MB_TCP_PORT_USE_DEFAULT); //115200
     if (0 == eStatus)
     {
@@ -432,10 +447,60 @@ void modebus_task(void *parameter)
     vTaskDelete(NULL);
 }
 
+/* read a range of the master buffers from the slave */
+static int app_shadow_read(app_shadow_area_t area, uint8_t addr, int index, int num)
+{
+    switch (area)
+    {
+    case APP_SHADOW_COIL:
+        return app_coil_read(addr, 0x01, M_COIL_START + index, num);
+    case APP_SHADOW_DISCRETE:
+        return app_coil_discrete_input_read(addr, 0x02, M_DISCRETE_INPUT_START + index, num);
+    case APP_SHADOW_INPUT:
+        return app_input_register_read(addr, 0x04, M_REG_INPUT_START + index, num);
+    default:
+        return app_holding_register_read(addr, 0x03, M_REG_HOLDING_START + index, num);
+    }
+}
+
+/**
+ * First poll cycle after a warm start: refresh the pages restored from NVS
+ * before the regular requests. A slave which does not answer is skipped
+ * for the rest of the cycle.
+ */
+static void app_poll_stale(void)
+{
+    app_shadow_area_t area;
+    uint8_t addr;
+    int index, num;
+    uint32_t failed = 0; // one bit per slave address
+    int left = 0;
+
+    while (app_shadow_next_stale(&area, &addr, &index, &num))
+    {
+        int max = (area == APP_SHADOW_COIL || area == APP_SHADOW_DISCRETE) ? APP_READ_BITS_MAX : APP_READ_REGS_MAX;
+        for (int i = index; i < index + num && !(failed & (1UL << addr)); i += max)
+        {
+            int n = (index + num - i < max) ? index + num - i : max;
+            if (app_shadow_read(area, addr, i, n) != MB_MRE_NO_ERR)
+            {
+                failed |= 1UL << addr;
+            }
+        }
+        /* the callbacks clear the stale flag once the values are stored */
+        if (app_shadow_is_stale(area, addr, index))
+        {
+            left++;
+        }
+    }
+    MB_LOG(TAG, "stale pages polled, %d still stale", left);
+}
+
 void SysMonitor(void *parameter)
 {
     eMBReqErrCode errorCode = MB_MRE_NO_ERR;
     uint16_t errorCount = 0;
+    app_poll_stale();
     while (1)
     {
         for (int i = 0; i < 100; i++)
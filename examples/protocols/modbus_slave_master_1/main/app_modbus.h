@@ -15,6 +15,8 @@
 #define M_REG_INPUT_NREGS 32*16
 #define M_REG_HOLDING_START 40000
 #define M_REG_HOLDING_NREGS 32*16
+#define M_DISCRETE_INPUT_NBYTES ((M_DISCRETE_INPUT_NDISCRETES + 7) / 8)
+#define M_COIL_NBYTES ((M_COIL_NCOILS + 7) / 8)
 /* master mode: holding register's all address */
 #define M_HD_RESERVE 0
 /* master mode: input register's all address */
@@ -28,6 +30,12 @@
 extern "C" {
 #endif
 
+/* master shadow buffers, one row per slave (address - 1) */
+extern UCHAR ucMDiscInBuf[MB_MASTER_TOTAL_SLAVE_NUM][M_DISCRETE_INPUT_NBYTES];
+extern UCHAR ucMCoilBuf[MB_MASTER_TOTAL_SLAVE_NUM][M_COIL_NBYTES];
+extern USHORT usMRegInBuf[MB_MASTER_TOTAL_SLAVE_NUM][M_REG_INPUT_NREGS];
+extern USHORT usMRegHoldBuf[MB_MASTER_TOTAL_SLAVE_NUM][M_REG_HOLDING_NREGS];
+
 int descret_event_gp_bit_clear();
 
 int input_reg_event_gp_bit_clear();
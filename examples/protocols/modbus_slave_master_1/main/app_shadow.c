@@ -0,0 +1,275 @@
+#include <string.h>
+#include <stdio.h>
+#include "app_shadow.h"
+#include "app_modbus.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "nvs.h"
+#include "nvs_flash.h"
+
+static const char *TAG = "APP_SHADOW:";
+#define MB_LOG(...) ESP_LOGW(__VA_ARGS__)
+
+#define SHADOW_PAGES(bytes) (((bytes) + APP_SHADOW_PAGE_SIZE - 1) / APP_SHADOW_PAGE_SIZE)
+#define SHADOW_SLAVE_PAGES (SHADOW_PAGES(M_COIL_NBYTES) + SHADOW_PAGES(M_DISCRETE_INPUT_NBYTES) + \
+                            SHADOW_PAGES(M_REG_INPUT_NREGS * 2) + SHADOW_PAGES(M_REG_HOLDING_NREGS * 2))
+#define SHADOW_TOTAL_PAGES (MB_MASTER_TOTAL_SLAVE_NUM * SHADOW_SLAVE_PAGES)
+#define SHADOW_MAP_WORDS ((SHADOW_TOTAL_PAGES + 31) / 32)
+/* persisted pages are dropped when the buffer layout changes */
+#define SHADOW_LAYOUT ((uint32_t)(APP_SHADOW_PAGE_SIZE << 16) ^ (MB_MASTER_TOTAL_SLAVE_NUM << 10) ^ SHADOW_SLAVE_PAGES)
+
+typedef struct
+{
+    char key;             /* first character of the NVS keys of the area */
+    uint8_t *base;        /* buffer of the first slave */
+    int slave_size;       /* buffer bytes per slave */
+    int elem_per_byte;    /* 8 for bits, otherwise 0 (two bytes per register) */
+    int first_page;       /* first page number of the area */
+} shadow_area_t;
+
+static shadow_area_t s_areas[APP_SHADOW_AREA_COUNT] = {
+    [APP_SHADOW_COIL] = {'c', &ucMCoilBuf[0][0], M_COIL_NBYTES, 8, 0},
+    [APP_SHADOW_DISCRETE] = {'d', &ucMDiscInBuf[0][0], M_DISCRETE_INPUT_NBYTES, 8, 0},
+    [APP_SHADOW_INPUT] = {'i', (uint8_t *)&usMRegInBuf[0][0], M_REG_INPUT_NREGS * 2, 0, 0},
+    [APP_SHADOW_HOLDING] = {'h', (uint8_t *)&usMRegHoldBuf[0][0], M_REG_HOLDING_NREGS * 2, 0, 0},
+};
+
+static uint32_t s_dirty[SHADOW_MAP_WORDS];
+/* pages restored from NVS which have not been polled since */
+static uint32_t s_stale[SHADOW_MAP_WORDS];
+static int s_stale_cursor = 0;
+/* hash of the page content last written to (or read from) NVS */
+static uint32_t s_saved_hash[SHADOW_TOTAL_PAGES];
+static int s_save_cursor = 0;
+static nvs_handle s_nvs = 0;
+static portMUX_TYPE s_shadow_mux = portMUX_INITIALIZER_UNLOCKED;
+
+#define MAP_SET(map, n) ((map)[(n) >> 5] |= (1UL << ((n) & 31)))
+#define MAP_CLR(map, n) ((map)[(n) >> 5] &= ~(1UL << ((n) & 31)))
+#define MAP_GET(map, n) (((map)[(n) >> 5] >> ((n) & 31)) & 1)
+
+static uint32_t shadow_hash(const uint8_t *data, int len)
+{
+    uint32_t hash = 2166136261UL; // FNV-1a
+    while (len-- > 0)
+    {
+        hash ^= *data++;
+        hash *= 16777619UL;
+    }
+    return hash;
+}
+
+/* slave pages of an area */
+static int shadow_area_pages(const shadow_area_t *area)
+{
+    return SHADOW_PAGES(area->slave_size);
+}
+
+/* locate a page: area, slave index, byte range in the buffer */
+static shadow_area_t *shadow_page_locate(int page, int *slave_idx, int *offset, int *len)
+{
+    for (int a = APP_SHADOW_AREA_COUNT - 1; a >= 0; a--)
+    {
+        shadow_area_t *area = &s_areas[a];
+        if (page >= area->first_page)
+        {
+            int n = page - area->first_page;
+            *slave_idx = n / shadow_area_pages(area);
+            *offset = (n % shadow_area_pages(area)) * APP_SHADOW_PAGE_SIZE;
+            *len = area->slave_size - *offset;
+            if (*len > APP_SHADOW_PAGE_SIZE)
+            {
+                *len = APP_SHADOW_PAGE_SIZE;
+            }
+            return area;
+        }
+    }
+    return NULL;
+}
+
+static void shadow_page_key(char *key, const shadow_area_t *area, int slave_idx, int offset)
+{
+    sprintf(key, "%c%02x%02x", area->key, slave_idx, offset / APP_SHADOW_PAGE_SIZE);
+}
+
+static void shadow_init_layout(void)
+{
+    int page = 0;
+    for (int a = 0; a < APP_SHADOW_AREA_COUNT; a++)
+    {
+        s_areas[a].first_page = page;
+        page += shadow_area_pages(&s_areas[a]) * MB_MASTER_TOTAL_SLAVE_NUM;
+    }
+}
+
+esp_err_t app_shadow_restore(void)
+{
+    uint32_t layout = 0;
+    int restored = 0;
+    esp_err_t err;
+
+    shadow_init_layout();
+    err = nvs_flash_init_partition(APP_SHADOW_NVS_PARTITION);
+    if (err == ESP_ERR_NVS_NO_FREE_PAGES)
+    {
+        ESP_ERROR_CHECK(nvs_flash_erase_partition(APP_SHADOW_NVS_PARTITION));
+        err = nvs_flash_init_partition(APP_SHADOW_NVS_PARTITION);
+    }
+    if (err != ESP_OK)
+    {
+        MB_LOG(TAG, "nvs_flash_init_partition failed: %d", err);
+        return err;
+    }
+    err = nvs_open_from_partition(APP_SHADOW_NVS_PARTITION, APP_SHADOW_NVS_NAMESPACE,
+                                  NVS_READWRITE, &s_nvs);
+    if (err != ESP_OK)
+    {
+        MB_LOG(TAG, "nvs_open failed: %d", err);
+        return err;
+    }
+    if (nvs_get_u32(s_nvs, "layout", &layout) != ESP_OK || layout != SHADOW_LAYOUT)
+    {
+        MB_LOG(TAG, "shadow layout changed, start cold");
+        nvs_erase_all(s_nvs);
+        nvs_set_u32(s_nvs, "layout", SHADOW_LAYOUT);
+        return nvs_commit(s_nvs);
+    }
+    for (int page = 0; page < SHADOW_TOTAL_PAGES; page++)
+    {
+        int slave_idx, offset, len;
+        char key[8];
+        shadow_area_t *area = shadow_page_locate(page, &slave_idx, &offset, &len);
+        uint8_t *data = area->base + slave_idx * area->slave_size + offset;
+        size_t size = len;
+
+        shadow_page_key(key, area, slave_idx, offset);
+        if (nvs_get_blob(s_nvs, key, data, &size) == ESP_OK && size == len)
+        {
+            s_saved_hash[page] = shadow_hash(data, len);
+            MAP_SET(s_stale, page);
+            restored++;
+        }
+    }
+    MB_LOG(TAG, "%d pages restored", restored);
+    return ESP_OK;
+}
+
+void app_shadow_mark_dirty(app_shadow_area_t area_id, uint8_t slave_idx, int offset, int len)
+{
+    const shadow_area_t *area = &s_areas[area_id];
+    if (len <= 0 || slave_idx >= MB_MASTER_TOTAL_SLAVE_NUM || offset >= area->slave_size)
+    {
+        return;
+    }
+    int base = area->first_page + slave_idx * shadow_area_pages(area);
+    int first = base + offset / APP_SHADOW_PAGE_SIZE;
+    int last = base + (offset + len - 1) / APP_SHADOW_PAGE_SIZE;
+    if (last >= base + shadow_area_pages(area))
+    {
+        last = base + shadow_area_pages(area) - 1;
+    }
+    portENTER_CRITICAL(&s_shadow_mux);
+    for (int page = first; page <= last; page++)
+    {
+        MAP_SET(s_dirty, page);
+        MAP_CLR(s_stale, page);
+    }
+    portEXIT_CRITICAL(&s_shadow_mux);
+}
+
+int app_shadow_save(int max_pages)
+{
+    static uint8_t copy[APP_SHADOW_PAGE_SIZE];
+    int written = 0;
+
+    if (s_nvs == 0)
+    {
+        return -1;
+    }
+    for (int n = 0; n < SHADOW_TOTAL_PAGES && written < max_pages; n++)
+    {
+        int page = s_save_cursor;
+        int slave_idx, offset, len;
+        char key[8];
+
+        s_save_cursor = (s_save_cursor + 1) % SHADOW_TOTAL_PAGES;
+        if (!MAP_GET(s_dirty, page))
+        {
+            continue;
+        }
+        shadow_area_t *area = shadow_page_locate(page, &slave_idx, &offset, &len);
+        portENTER_CRITICAL(&s_shadow_mux);
+        memcpy(copy, area->base + slave_idx * area->slave_size + offset, len);
+        MAP_CLR(s_dirty, page);
+        portEXIT_CRITICAL(&s_shadow_mux);
+
+        uint32_t hash = shadow_hash(copy, len);
+        if (hash == s_saved_hash[page])
+        {
+            continue; // polled again but nothing changed, spare the flash
+        }
+        shadow_page_key(key, area, slave_idx, offset);
+        if (nvs_set_blob(s_nvs, key, copy, len) != ESP_OK)
+        {
+            portENTER_CRITICAL(&s_shadow_mux);
+            MAP_SET(s_dirty, page);
+            portEXIT_CRITICAL(&s_shadow_mux);
+            MB_LOG(TAG, "save of %s failed", key);
+            return -1;
+        }
+        s_saved_hash[page] = hash;
+        written++;
+    }
+    if (written > 0 && nvs_commit(s_nvs) != ESP_OK)
+    {
+        return -1;
+    }
+    return written;
+}
+
+bool app_shadow_is_stale(app_shadow_area_t area_id, uint8_t addr, int index)
+{
+    const shadow_area_t *area = &s_areas[area_id];
+    int offset = area->elem_per_byte ? index / area->elem_per_byte : index * 2;
+    if (addr == 0 || addr > MB_MASTER_TOTAL_SLAVE_NUM || index < 0 || offset >= area->slave_size)
+    {
+        return false;
+    }
+    int page = area->first_page + (addr - 1) * shadow_area_pages(area) + offset / APP_SHADOW_PAGE_SIZE;
+    return MAP_GET(s_stale, page);
+}
+
+bool app_shadow_next_stale(app_shadow_area_t *area_id, uint8_t *addr, int *index, int *num)
+{
+    for (int page = s_stale_cursor; page < SHADOW_TOTAL_PAGES; page++)
+    {
+        if (!MAP_GET(s_stale, page))
+        {
+            continue;
+        }
+        int slave_idx, offset, len;
+        shadow_area_t *area = shadow_page_locate(page, &slave_idx, &offset, &len);
+        *area_id = (app_shadow_area_t)(area - s_areas);
+        *addr = slave_idx + 1;
+        *index = area->elem_per_byte ? offset * area->elem_per_byte : offset / 2;
+        *num = area->elem_per_byte ? len * area->elem_per_byte : len / 2;
+        s_stale_cursor = page + 1;
+        return true;
+    }
+    s_stale_cursor = 0;
+    return false;
+}
+
+void app_shadow_task(void *parameter)
+{
+    while (1)
+    {
+        vTaskDelay(pdMS_TO_TICKS(APP_SHADOW_SAVE_PERIOD_MS));
+        int written = app_shadow_save(APP_SHADOW_PAGES_PER_SAVE);
+        if (written > 0)
+        {
+            MB_LOG(TAG, "%d pages saved", written);
+        }
+    }
+}
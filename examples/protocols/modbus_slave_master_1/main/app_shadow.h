@@ -0,0 +1,75 @@
+#ifndef _APP_SHADOW_H_
+#define _APP_SHADOW_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+/* -----------------------Shadow Defines -------------------------------------*/
+#define APP_SHADOW_NVS_NAMESPACE "mb_shadow"
+/* NVS partition holding the shadow, see partitions_example.csv */
+#define APP_SHADOW_NVS_PARTITION "mb_shadow"
+/* size of one persisted block of a master buffer */
+#define APP_SHADOW_PAGE_SIZE 256
+/* period of the save task and the number of pages written per period */
+#define APP_SHADOW_SAVE_PERIOD_MS 10000
+#define APP_SHADOW_PAGES_PER_SAVE 8
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum
+{
+    APP_SHADOW_COIL,
+    APP_SHADOW_DISCRETE,
+    APP_SHADOW_INPUT,
+    APP_SHADOW_HOLDING,
+    APP_SHADOW_AREA_COUNT
+} app_shadow_area_t;
+
+/**
+ * Initialize the shadow NVS partition, restore the master buffers from it
+ * and mark every restored page stale.
+ * Must be called once before polling starts.
+ */
+esp_err_t app_shadow_restore(void);
+
+/**
+ * Mark a byte range of a slave buffer as updated from the bus.
+ * Call it after the new values are in the buffer, the range is persisted
+ * by a later app_shadow_save() and its pages are no longer stale.
+ */
+void app_shadow_mark_dirty(app_shadow_area_t area, uint8_t slave_idx, int offset, int len);
+
+/**
+ * Write at most max_pages dirty pages to NVS.
+ *
+ * @return number of pages written or -1 on NVS error
+ */
+int app_shadow_save(int max_pages);
+
+/**
+ * Check if a register (or bit for coils and discretes) still holds a value
+ * restored at boot which has not been polled since.
+ */
+bool app_shadow_is_stale(app_shadow_area_t area, uint8_t addr, int index);
+
+/**
+ * Find the next stale page, to be polled before the others.
+ * Successive calls walk the stale pages once in page order, the call after
+ * the last one returns false and the next one starts over.
+ *
+ * @return true and the slave address, the first register (or bit) index and
+ *         the number of registers (or bits) of the page, false at the end
+ */
+bool app_shadow_next_stale(app_shadow_area_t *area, uint8_t *addr, int *index, int *num);
+
+/* periodic rate limited save of dirty pages */
+void app_shadow_task(void *parameter);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif